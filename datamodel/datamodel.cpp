@@ -36,6 +36,9 @@ class KeyValues;
 
 #define UNNAMED_ELEMENT_NAME	"unnamed"
 
+// how long (in seconds) each RemoveUnreferencedElements call spends collecting orphaned elements
+#define COLLECTOR_STEP_BUDGET	0.002f
+
 
 
 //-----------------------------------------------------------------------------
@@ -87,7 +90,6 @@ CDataModel::CDataModel() :
 	m_nElementsAllocatedSoFar = 0;
 	m_nMaxNumberOfElements = 0;
 	m_bIsUnserializing = false;
-	m_bDeleteOrphanedElements = false;
 }
 
 CDataModel::~CDataModel()
@@ -391,6 +393,8 @@ void CDataModel::DisplayMemoryStats( )
 	}
 
 	ConMsg( "\n" );
+
+	m_Collector.DisplayStats();
 }
 
 
@@ -1188,6 +1192,7 @@ void CDataModel::SetFileRoot( DmFileId_t fileid, DmElementHandle_t hRoot )
 		return;
 
 	fes->m_hRoot = hRoot;
+	m_Collector.OnFileRootChanged( hRoot );
 }
 
 bool CDataModel::IsFileLoaded( DmFileId_t fileid )
@@ -1341,6 +1346,7 @@ DmElementHandle_t CDataModel::ChangeElementId( DmElementHandle_t hElement, const
 	m_Handles.SetHandle( newHandle, GetElement( hElement ) );
 	CDmeElementAccessor::ChangeHandle( pElement, newHandle );
 	CDmeElementAccessor::SetReference( pElement, newRef );
+	m_Collector.OnElementHandleChanged( hElement, newHandle );
 	ReleaseElementHandle( hElement );
 
 	// move new element entry from the unloaded map to the loaded map
@@ -1403,6 +1409,8 @@ void CDataModel::OnElementReferenceAdded( DmElementHandle_t hElement, CDmAttribu
 //		pAttribute->GetOwner()->GetHandle(), pAttribute->GetName() );
 
 	pRef->AddAttribute( pAttribute );
+
+	m_Collector.OnElementReferenceAdded( hElement, pAttribute->GetOwner()->GetHandle() );
 }
 
 void CDataModel::OnElementReferenceAdded( DmElementHandle_t hElement, bool bRefCount )
@@ -1422,6 +1430,7 @@ void CDataModel::OnElementReferenceAdded( DmElementHandle_t hElement, bool bRefC
 	if ( bRefCount )
 	{
 		++pRef->m_nStrongHandleCount;
+		m_Collector.OnStrongReferenceAdded( hElement );
 	}
 	else
 	{
@@ -1450,6 +1459,7 @@ void CDataModel::OnElementReferenceRemoved( DmElementHandle_t hElement, CDmAttri
 //		pAttribute->GetOwner()->GetHandle(), pAttribute->GetName() );
 
 	pRef->RemoveAttribute( pAttribute );
+	m_Collector.OnElementReferenceRemoved( hElement );
 
 	if ( !pRef->IsStronglyReferenced() )
 	{
@@ -1490,6 +1500,7 @@ void CDataModel::OnElementReferenceRemoved( DmElementHandle_t hElement, bool bRe
 	if ( bRefCount )
 	{
 		--pRef->m_nStrongHandleCount;
+		m_Collector.OnElementReferenceRemoved( hElement );
 	}
 	else
 	{
@@ -1559,106 +1570,20 @@ void CDataModel::RemoveUnreferencedElements()
 	}
 	m_unreferencedElementHandles.RemoveAll();
 
-	if ( m_bDeleteOrphanedElements )
-	{
-		m_bDeleteOrphanedElements = false;
-		FindAndDeleteOrphanedElements();
-	}
+	// orphaned subtrees are collected incrementally, a little bit each time through
+	m_Collector.Step( COLLECTOR_STEP_BUDGET );
 }
 
 void CDataModel::FindAndDeleteOrphanedElements()
 {
-#if 1 // this appears to be faster, and is fully implemented
-	// mark & sweep algorithm for elements
-
-	// clear accessible flag from all elements
-	for ( DmElementHandle_t hElement = FirstAllocatedElement(); hElement != DMELEMENT_HANDLE_INVALID; hElement = NextAllocatedElement( hElement ) )
-	{
-		CDmElement *pElement = GetElement( hElement );
-		if ( !pElement )
-			continue;
-
-		DmFileId_t fileid = pElement->GetFileId();
-		if ( fileid == DMFILEID_INVALID )
-			continue;
-
-		pElement->MarkAccessible( false );
-	}
-
-	// mark elements accessible from file roots
-	int nFiles = NumFileIds();
-	for ( int i = 0; i < nFiles; ++i )
-	{
-		DmFileId_t fileid = GetFileId( i );
-		if ( fileid == DMFILEID_INVALID )
-			continue;
-
-		DmElementHandle_t hRoot = GetFileRoot( fileid );
-		CDmElement *pRoot = GetElement( hRoot );
-		if ( !pRoot )
-			continue;
-
-		pRoot->MarkAccessible( TD_ALL );
-	}
-
-	// mark elements accessible from counted handles
-	for ( DmElementHandle_t hElement = FirstAllocatedElement(); hElement != DMELEMENT_HANDLE_INVALID; hElement = NextAllocatedElement( hElement ) )
-	{
-		CDmElement *pElement = GetElement( hElement );
-		if ( !pElement )
-			continue;
-
-		DmFileId_t fileid = pElement->GetFileId();
-		if ( fileid == DMFILEID_INVALID )
-			continue;
-
-		if ( CDmeElementAccessor::GetReference( pElement )->m_nStrongHandleCount == 0 )
-			continue;
-
-		pElement->MarkAccessible( TD_ALL );
-	}
-
-	// delete elements that aren't accessible
-	for ( DmElementHandle_t hElement = FirstAllocatedElement(); hElement != DMELEMENT_HANDLE_INVALID; hElement = NextAllocatedElement( hElement ) )
-	{
-		CDmElement *pElement = GetElement( hElement );
-		if ( !pElement )
-			continue;
-
-		DmFileId_t fileid = pElement->GetFileId();
-		if ( fileid == DMFILEID_INVALID )
-			continue;
-
-		if ( pElement->IsAccessible() )
-			continue;
-
-		DeleteElement( hElement );
-	}
-#else
-	// root finding algorithm on elements
-
-	// JDTODO - this incorrectly deletes elements that are referenced by a counted handle, but aren't under the file root
-
-	CUtlVector< ElementPathItem_t > path;
-	for ( DmElementHandle_t hElement = FirstAllocatedElement(); hElement != DMELEMENT_HANDLE_INVALID; hElement = NextAllocatedElement( hElement ) )
-	{
-		CDmElement *pElement = GetElement( hElement );
-		if ( !pElement )
-			continue;
-
-		DmFileId_t fileid = pElement->GetFileId();
-		if ( fileid == DMFILEID_INVALID )
-			continue;
-
-		DmElementHandle_t hRoot = GetFileRoot( fileid );
+	CDisableUndoScopeGuard sg;
 
-		path.RemoveAll();
-		if ( hRoot == hElement || pElement->FindReferer( hRoot, path, TD_ALL ) )
-			continue;
+	// runs a full collection immediately, rather than spreading it out over RemoveUnreferencedElements calls
+	m_Collector.RequestCollection();
+	m_Collector.Finish();
 
-		DeleteElement( hElement );
-	}
-#endif
+	// elements held by undo records are roots, so having undo or redo data never holds collection up
+	Assert( !m_Collector.IsCollecting() );
 }
 
 
@@ -1934,6 +1859,7 @@ CDmElement* CDataModel::CreateElement( const DmElementReference_t &ref, const ch
 		CDmeElementAccessor::SetReference( pElement, ref );
 		m_Handles.SetHandle( ref.m_hElement, pElement );
 		m_elementIds.Insert( ref.m_hElement );
+		m_Collector.OnElementCreated( ref.m_hElement );
 		CDmeElementAccessor::PerformConstruction( pElement );
 
 		if ( pUndo )
@@ -2398,7 +2324,7 @@ void CDataModel::ClearUndo()
 	GetUndoMgr()->WipeUndo();
 	GetUndoMgr()->WipeRedo();
 
-	m_bDeleteOrphanedElements = true; // next time we delete unreferenced elements, delete orphaned subtrees as well
+	m_Collector.RequestCollection(); // start collecting orphaned subtrees the next time we delete unreferenced elements
 }
 
 UtlSymId_t CDataModel::GetUndoDescInternal( const char *context )
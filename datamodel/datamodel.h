@@ -24,6 +24,7 @@
 #include "tier2/tier2.h"
 #include "clipboardmanager.h"
 #include "undomanager.h"
+#include "dmelementcollector.h"
 #include "tier1/convar.h"
 #include "tier0/vprof.h" 
 
@@ -427,6 +428,7 @@ private:
 	friend class CDmeElementRefHelper;
 	friend class CDmAttribute;
 	template< class T > friend class CDmArrayAttributeOp;
+	friend class CDmElementCollector;
 
 	void OnElementReferenceAdded  ( DmElementHandle_t hElement, CDmAttribute *pAttribute );
 	void OnElementReferenceRemoved( DmElementHandle_t hElement, CDmAttribute *pAttribute );
@@ -444,13 +446,13 @@ private:
 	CUtlHandleTable< CDmElement, 20 > m_Handles;
 	CUtlHandleTable< CDmAttribute, 20 > m_AttributeHandles;
 	CUndoManager m_UndoMgr;
+	CDmElementCollector m_Collector;
 	CUtlLinkedList< MailingList_t, DmMailingList_t > m_MailingLists;
 
 	bool m_bIsUnserializing : 1;
 	bool m_bUnableToSetDefaultFactory : 1;
 	bool m_bOnlyCreateUntypedElements : 1;
 	bool m_bUnableToCreateOnlyUntypedElements : 1;
-	bool m_bDeleteOrphanedElements : 1;
 
 	CUtlHandleTable< FileElementSet_t, 20 > m_openFiles;
 
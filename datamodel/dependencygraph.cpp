@@ -18,28 +18,26 @@
 // memdbgon must be the last include file in a .cpp file!!!
 #include "tier0/memdbgon.h"
 //-----------------------------------------------------------------------------
-// Misc helper enums and classes for CDependencyGraph class
+// Misc helper classes for CDependencyGraph class
 //-----------------------------------------------------------------------------
-enum TraversalState_t
-{
-	TS_NOT_VISITED,
-	TS_VISITING,
-	TS_VISITED,
-};
-
 struct COperatorNode
 {
 	COperatorNode( IDmeOperator *pOp = NULL ) :
-		m_state( TS_NOT_VISITED ), 
 		m_operator( pOp ),
-		m_bInList( false )
+		m_nLevel( 0 ),
+		m_nPendingInputs( 0 ),
+		m_bInList( false ),
+		m_bBrokeCycle( false )
 	{
 	}
 
-	TraversalState_t m_state;
 	IDmeOperator *m_operator;
+	CUtlVector< CAttributeNode * > m_InputAttributes;
 	CUtlVector< CAttributeNode * > m_OutputAttributes;
+	int				m_nLevel;			// longest chain of operators feeding into this one
+	int				m_nPendingInputs;	// only used while computing levels
 	bool			m_bInList;
+	bool			m_bBrokeCycle;		// one of our inputs was ignored to break a cycle
 };
 
 class CAttributeNode
@@ -47,13 +45,13 @@ class CAttributeNode
 public:
 	CAttributeNode( CDmAttribute *attribute = NULL ) : 
 		m_attribute( attribute ),
-		m_bIsOutputToOperator( false )
+		m_nOutputOperatorCount( 0 )
 	{
 	}
 
 	CDmAttribute *m_attribute;
 	CUtlVector< COperatorNode * > m_InputDependentOperators;
-	bool		m_bIsOutputToOperator;
+	int			m_nOutputOperatorCount;
 };
 
 CClassMemoryPool< CAttributeNode >	g_AttrNodePool( 1000 );
@@ -74,7 +72,8 @@ uint HashEntryKeyFunc( CAttributeNode *const& keyinfo )
 // CDependencyGraph constructor - builds dependency graph from operators
 //-----------------------------------------------------------------------------
 CDependencyGraph::CDependencyGraph() :
-	m_attrNodes( 4096, 0, 0, HashEntryCompareFunc, HashEntryKeyFunc )
+	m_attrNodes( 4096, 0, 0, HashEntryCompareFunc, HashEntryKeyFunc ),
+	m_bLevelsDirty( true )
 {
 }
 
@@ -82,9 +81,6 @@ void CDependencyGraph::Reset( const CUtlVector< IDmeOperator * > &operators )
 {
 	VPROF_BUDGET( "CDependencyGraph::Reset", VPROF_BUDGETGROUP_TOOLS );
 
-	Cleanup();
-
-	CUtlVector< CDmAttribute * > attrs; // moved outside the loop to function as a temporary memory pool for performance
 	int on = operators.Count();
 	CUtlRBTree< IDmeOperator * > operatorDict( 0, on * 2, DefLessFunc(IDmeOperator *) );
 	for ( int i = 0; i < on; ++i )
@@ -92,6 +88,23 @@ void CDependencyGraph::Reset( const CUtlVector< IDmeOperator * > &operators )
 		operatorDict.Insert( operators[i] );
 	}
 
+	// Drop the nodes of operators which went away or whose attributes were rewired
+	CUtlRBTree< IDmeOperator * > nodeDict( 0, m_opNodes.Count() * 2, DefLessFunc(IDmeOperator *) );
+	for ( int oi = m_opNodes.Count(); --oi >= 0; )
+	{
+		COperatorNode *pOpNode = m_opNodes[ oi ];
+		if ( operatorDict.Find( pOpNode->m_operator ) == operatorDict.InvalidIndex() || HasOperatorNodeChanged( pOpNode ) )
+		{
+			RemoveOperatorNode( pOpNode );
+			m_opNodes.Remove( oi );
+			m_bLevelsDirty = true;
+			continue;
+		}
+
+		nodeDict.Insert( pOpNode->m_operator );
+	}
+
+	// Add nodes for new (or rewired) operators
 	m_opNodes.EnsureCapacity( on );
 	for ( int oi = 0; oi < on; ++oi )
 	{
@@ -100,31 +113,22 @@ void CDependencyGraph::Reset( const CUtlVector< IDmeOperator * > &operators )
 		if ( pOp == NULL )
 			continue;
 
-		COperatorNode *pOpNode = g_OperatorNodePool.Alloc();
-		pOpNode->m_operator = pOp;
+		if ( nodeDict.Find( pOp ) != nodeDict.InvalidIndex() )
+			continue;
 
-		attrs.RemoveAll();
-		pOp->GetInputAttributes( attrs );
-		int an = attrs.Count();
-		for ( int ai = 0; ai < an; ++ai )
-		{
-			CAttributeNode *pAttrNode = FindAttrNode( attrs[ ai ] );
-			pAttrNode->m_InputDependentOperators.AddToTail( pOpNode );
-		}
+		nodeDict.Insert( pOp );
 
-		attrs.RemoveAll();
-		pOp->GetOutputAttributes( attrs );
-		an = attrs.Count();
-		for ( int ai = 0; ai < an; ++ai )
-		{
-            CAttributeNode *pAttrNode = FindAttrNode( attrs[ ai ] );
-			pAttrNode->m_bIsOutputToOperator = true;
-			pOpNode->m_OutputAttributes.AddToTail( pAttrNode );
+		COperatorNode *pOpNode = AddOperatorNode( pOp );
+		m_opNodes.AddToTail( pOpNode );
+		m_bLevelsDirty = true;
 
 #ifdef _DEBUG
+		int an = pOpNode->m_OutputAttributes.Count();
+		for ( int ai = 0; ai < an; ++ai )
+		{
 			// Look for dependent operators, add them if they are not in the array
 			// FIXME: Should this happen for input attributes too?
-			CDmElement* pElement = pAttrNode->m_attribute->GetOwner();
+			CDmElement* pElement = pOpNode->m_OutputAttributes[ ai ]->m_attribute->GetOwner();
 			IDmeOperator *pOperator = dynamic_cast< IDmeOperator* >( pElement );
 			if ( pOperator )
 			{
@@ -136,10 +140,8 @@ void CDependencyGraph::Reset( const CUtlVector< IDmeOperator * > &operators )
 					Warning( "Found dependent operator '%s' referenced by operator '%s' that wasn't in the scene or trackgroups!\n", pOp1->GetName(), pOp2->GetName() );
 				}
 			}
-#endif
 		}
-
-		m_opNodes.AddToTail( pOpNode );
+#endif
 	}
 }
 
@@ -170,7 +172,102 @@ void CDependencyGraph::Cleanup()
 	m_opRoots.RemoveAll();
 	m_opNodes.RemoveAll();
 	m_attrNodes.RemoveAll();
+	m_levelOrder.RemoveAll();
 	m_operators.RemoveAll();
+	m_bLevelsDirty = true;
+}
+
+
+//-----------------------------------------------------------------------------
+// Creates the node for an operator and hooks it up to its attributes
+//-----------------------------------------------------------------------------
+COperatorNode *CDependencyGraph::AddOperatorNode( IDmeOperator *pOp )
+{
+	COperatorNode *pOpNode = g_OperatorNodePool.Alloc();
+	pOpNode->m_operator = pOp;
+
+	m_inputAttrs.RemoveAll();
+	pOp->GetInputAttributes( m_inputAttrs );
+	int an = m_inputAttrs.Count();
+	pOpNode->m_InputAttributes.EnsureCapacity( an );
+	for ( int ai = 0; ai < an; ++ai )
+	{
+		CAttributeNode *pAttrNode = FindAttrNode( m_inputAttrs[ ai ] );
+		pAttrNode->m_InputDependentOperators.AddToTail( pOpNode );
+		pOpNode->m_InputAttributes.AddToTail( pAttrNode );
+	}
+
+	m_outputAttrs.RemoveAll();
+	pOp->GetOutputAttributes( m_outputAttrs );
+	an = m_outputAttrs.Count();
+	pOpNode->m_OutputAttributes.EnsureCapacity( an );
+	for ( int ai = 0; ai < an; ++ai )
+	{
+		CAttributeNode *pAttrNode = FindAttrNode( m_outputAttrs[ ai ] );
+		++pAttrNode->m_nOutputOperatorCount;
+		pOpNode->m_OutputAttributes.AddToTail( pAttrNode );
+	}
+
+	return pOpNode;
+}
+
+
+//-----------------------------------------------------------------------------
+// Unhooks an operator node from its attributes and frees it
+// NOTE: This never touches the operator or attributes, which may already be gone
+//-----------------------------------------------------------------------------
+void CDependencyGraph::RemoveOperatorNode( COperatorNode *pOpNode )
+{
+	int an = pOpNode->m_InputAttributes.Count();
+	for ( int ai = 0; ai < an; ++ai )
+	{
+		CAttributeNode *pAttrNode = pOpNode->m_InputAttributes[ ai ];
+		pAttrNode->m_InputDependentOperators.FindAndRemove( pOpNode );
+		ReleaseAttrNode( pAttrNode );
+	}
+
+	an = pOpNode->m_OutputAttributes.Count();
+	for ( int ai = 0; ai < an; ++ai )
+	{
+		CAttributeNode *pAttrNode = pOpNode->m_OutputAttributes[ ai ];
+		--pAttrNode->m_nOutputOperatorCount;
+		ReleaseAttrNode( pAttrNode );
+	}
+
+	g_OperatorNodePool.Free( pOpNode );
+}
+
+
+//-----------------------------------------------------------------------------
+// Have the operator's input or output attributes changed since it was added?
+//-----------------------------------------------------------------------------
+bool CDependencyGraph::HasOperatorNodeChanged( COperatorNode *pOpNode )
+{
+	m_inputAttrs.RemoveAll();
+	pOpNode->m_operator->GetInputAttributes( m_inputAttrs );
+	int an = m_inputAttrs.Count();
+	if ( an != pOpNode->m_InputAttributes.Count() )
+		return true;
+
+	for ( int ai = 0; ai < an; ++ai )
+	{
+		if ( m_inputAttrs[ ai ] != pOpNode->m_InputAttributes[ ai ]->m_attribute )
+			return true;
+	}
+
+	m_outputAttrs.RemoveAll();
+	pOpNode->m_operator->GetOutputAttributes( m_outputAttrs );
+	an = m_outputAttrs.Count();
+	if ( an != pOpNode->m_OutputAttributes.Count() )
+		return true;
+
+	for ( int ai = 0; ai < an; ++ai )
+	{
+		if ( m_outputAttrs[ ai ] != pOpNode->m_OutputAttributes[ ai ]->m_attribute )
+			return true;
+	}
+
+	return false;
 }
 
 
@@ -188,7 +285,6 @@ void CDependencyGraph::FindRoots()
 	{
 		COperatorNode *pOpNode = m_opNodes[ oi ];
 		pOpNode->m_bInList = false;
-		pOpNode->m_state = TS_NOT_VISITED;
 
 		IDmeOperator *pOp = pOpNode->m_operator;
 		if ( !pOp->IsDirty() )
@@ -206,7 +302,7 @@ void CDependencyGraph::FindRoots()
 	{
 		CAttributeNode *pAttrNode = m_attrNodes[ h ];
 		//Msg( "attrib %s %p\n", pAttrNode->m_attribute->GetName(), pAttrNode->m_attribute );
-		if ( !pAttrNode->m_bIsOutputToOperator &&
+		if ( ( pAttrNode->m_nOutputOperatorCount == 0 ) &&
 			pAttrNode->m_attribute->IsFlagSet( FATTRIB_OPERATOR_DIRTY ) )
 		{
 			on = pAttrNode->m_InputDependentOperators.Count();
@@ -227,69 +323,155 @@ void CDependencyGraph::FindRoots()
 
 
 //-----------------------------------------------------------------------------
-// returns only the operators that need to be evaluated, sorted by dependencies
+// Sorts all operator nodes into levels, so that every operator comes after
+// all of the operators it depends on. Only done when the graph changes.
 //-----------------------------------------------------------------------------
-bool CDependencyGraph::CullAndSortOperators()
+void CDependencyGraph::ComputeLevels()
 {
-	FindRoots();
+	VPROF_BUDGET( "CDependencyGraph::ComputeLevels", VPROF_BUDGETGROUP_TOOLS );
 
-	m_operators.RemoveAll();
+	int on = m_opNodes.Count();
+	for ( int oi = 0; oi < on; ++oi )
+	{
+		COperatorNode *pOpNode = m_opNodes[ oi ];
+		pOpNode->m_nLevel = 0;
+		pOpNode->m_nPendingInputs = 0;
+		pOpNode->m_bBrokeCycle = false;
+	}
 
-	bool cycle = GetOperatorOrdering( m_opRoots, m_operators ); // leaves to roots (outputs to inputs)
+	// Count the operator -> operator links coming into each operator
+	for ( int oi = 0; oi < on; ++oi )
+	{
+		COperatorNode *pOpNode = m_opNodes[ oi ];
+		int an = pOpNode->m_OutputAttributes.Count();
+		for ( int ai = 0; ai < an; ++ai )
+		{
+			CAttributeNode *pAttrNode = pOpNode->m_OutputAttributes[ ai ];
+			int dn = pAttrNode->m_InputDependentOperators.Count();
+			for ( int di = 0; di < dn; ++di )
+			{
+				++pAttrNode->m_InputDependentOperators[ di ]->m_nPendingInputs;
+			}
+		}
+	}
 
-	int on = m_operators.Count();
-	int oh = on / 2;
-	for ( int oi = 0; oi < oh; ++oi )
+	// Kahn's algorithm; each operator's level is one past its deepest input operator
+	CUtlVector< COperatorNode* > readyNodes( 0, on );
+	for ( int oi = 0; oi < on; ++oi )
 	{
-		IDmeOperator *temp = std::move(m_operators[oi]);
-		m_operators[oi] = std::move(m_operators[on - oi - 1]);
-		m_operators[on - oi - 1] = std::move(temp);
+		if ( m_opNodes[ oi ]->m_nPendingInputs == 0 )
+		{
+			readyNodes.AddToTail( m_opNodes[ oi ] );
+		}
 	}
-	return cycle;
 
-//	return GetOperatorOrdering( m_opLeaves, operators ); // roots to leaves (inputs to outputs)
+	int nMaxLevel = 0;
+	int nProcessed = 0;
+	int nNextCycleCandidate = 0;
+	while ( nProcessed < on )
+	{
+		if ( nProcessed == readyNodes.Count() )
+		{
+			// Everything left is in or behind a cycle - ignore the remaining inputs of an arbitrary operator
+			while ( m_opNodes[ nNextCycleCandidate ]->m_nPendingInputs <= 0 )
+			{
+				++nNextCycleCandidate;
+			}
+			COperatorNode *pCycleNode = m_opNodes[ nNextCycleCandidate ];
+			pCycleNode->m_nPendingInputs = 0;
+			pCycleNode->m_bBrokeCycle = true;
+			readyNodes.AddToTail( pCycleNode );
+		}
+
+		COperatorNode *pOpNode = readyNodes[ nProcessed++ ];
+		nMaxLevel = max( nMaxLevel, pOpNode->m_nLevel );
+
+		int an = pOpNode->m_OutputAttributes.Count();
+		for ( int ai = 0; ai < an; ++ai )
+		{
+			CAttributeNode *pAttrNode = pOpNode->m_OutputAttributes[ ai ];
+			int dn = pAttrNode->m_InputDependentOperators.Count();
+			for ( int di = 0; di < dn; ++di )
+			{
+				COperatorNode *pDependent = pAttrNode->m_InputDependentOperators[ di ];
+				if ( pDependent->m_nPendingInputs <= 0 )
+					continue; // already placed, this link is part of a broken cycle
+
+				pDependent->m_nLevel = max( pDependent->m_nLevel, pOpNode->m_nLevel + 1 );
+				if ( --pDependent->m_nPendingInputs == 0 )
+				{
+					readyNodes.AddToTail( pDependent );
+				}
+			}
+		}
+	}
+
+	// Bucket by level, keeping the order within each level stable
+	CUtlVector< int > levelStarts;
+	levelStarts.SetCount( nMaxLevel + 2 );
+	memset( levelStarts.Base(), 0, levelStarts.Count() * sizeof( int ) );
+	for ( int oi = 0; oi < on; ++oi )
+	{
+		++levelStarts[ readyNodes[ oi ]->m_nLevel + 1 ];
+	}
+	for ( int li = 1; li < levelStarts.Count(); ++li )
+	{
+		levelStarts[ li ] += levelStarts[ li - 1 ];
+	}
+
+	m_levelOrder.SetCount( on );
+	for ( int oi = 0; oi < on; ++oi )
+	{
+		COperatorNode *pOpNode = readyNodes[ oi ];
+		m_levelOrder[ levelStarts[ pOpNode->m_nLevel ]++ ] = pOpNode;
+	}
+
+	m_bLevelsDirty = false;
 }
 
+
 //-----------------------------------------------------------------------------
-// GetOperatorOrdering is just a recursive post-order depth-first-search
-//   since we have two types of nodes, we manually traverse to the opnodes grandchildren, which are opnodes
-//   (skipping children, which are attrnodes)
-//   returns true if a cycle found - in this case, an arbitrary link of the cycle will be ignored
+// returns only the operators that need to be evaluated, sorted by dependencies
 //-----------------------------------------------------------------------------
-bool CDependencyGraph::GetOperatorOrdering( CUtlVector< COperatorNode * > &pOpNodes, CUtlVector< IDmeOperator * > &operators )
+bool CDependencyGraph::CullAndSortOperators()
 {
-	bool cycle = false;
+	if ( m_bLevelsDirty )
+	{
+		ComputeLevels();
+	}
 
-	uint on = pOpNodes.Count();
-	for ( uint oi = 0; oi < on; ++oi )
+	FindRoots();
+
+	m_operators.RemoveAll();
+
+	// Walk the operators in level order; anything downstream of a root needs evaluating too
+	bool cycle = false;
+	int on = m_levelOrder.Count();
+	for ( int oi = 0; oi < on; ++oi )
 	{
-		COperatorNode *pOpNode = pOpNodes[ oi ];
-		if ( pOpNode->m_state != TS_NOT_VISITED )
-		{
-			if ( pOpNode->m_state == TS_VISITING )
-			{
-				cycle = true;
-			}
+		COperatorNode *pOpNode = m_levelOrder[ oi ];
+		if ( !pOpNode->m_bInList )
 			continue;
-		}
-		pOpNode->m_state = TS_VISITING; // mark as in being visited
 
-		// DBG_PrintOperator( pIndent, pOpNode->m_operator );
-
-		// leaves to roots (outputs to inputs)
-		uint an = pOpNode->m_OutputAttributes.Count();
-		for ( uint ai = 0; ai < an; ++ai )
+		int an = pOpNode->m_OutputAttributes.Count();
+		for ( int ai = 0; ai < an; ++ai )
 		{
 			CAttributeNode *pAttrNode = pOpNode->m_OutputAttributes[ ai ];
-			if ( GetOperatorOrdering( pAttrNode->m_InputDependentOperators, operators ) )
+			int dn = pAttrNode->m_InputDependentOperators.Count();
+			for ( int di = 0; di < dn; ++di )
 			{
-				cycle = true;
+				pAttrNode->m_InputDependentOperators[ di ]->m_bInList = true;
 			}
 		}
 
-		operators.AddToTail( pOpNode->m_operator );
-		pOpNode->m_state = TS_VISITED; // mark as done visiting
+		if ( pOpNode->m_bBrokeCycle )
+		{
+			cycle = true;
+		}
+
+		m_operators.AddToTail( pOpNode->m_operator );
 	}
+
 	return cycle;
 }
 
@@ -322,6 +504,20 @@ CAttributeNode *CDependencyGraph::FindAttrNode( CDmAttribute *pAttr )
 	return pAttrNode;
 }
 
+//-----------------------------------------------------------------------------
+// internal helper method - frees attrNode once no operators refer to it
+//-----------------------------------------------------------------------------
+void CDependencyGraph::ReleaseAttrNode( CAttributeNode *pAttrNode )
+{
+	if ( pAttrNode->m_nOutputOperatorCount > 0 || pAttrNode->m_InputDependentOperators.Count() > 0 )
+		return;
+
+	UtlHashHandle_t idx = m_attrNodes.Find( pAttrNode );
+	Assert( idx != m_attrNodes.InvalidHandle() );
+	m_attrNodes.Remove( idx );
+	g_AttrNodePool.Free( pAttrNode );
+}
+
 //-----------------------------------------------------------------------------
 // temporary internal debugging function
 //-----------------------------------------------------------------------------
@@ -31,6 +31,7 @@ public:
 	CDependencyGraph();
 	~CDependencyGraph();
 
+	// Only operators that were added, removed or rewired since the last reset are updated
 	void Reset( const CUtlVector< IDmeOperator * > &operators );
 
 	// caches only the operators that need to be evaluated, sorted by dependencies
@@ -40,14 +41,18 @@ public:
 	const CUtlVector< IDmeOperator* > &GetSortedOperators() const { return m_operators; }
 
 private:
-	static bool GetOperatorOrdering( CUtlVector< COperatorNode* > &pOpNodes, CUtlVector< IDmeOperator * > &operators );
 	static void DBG_PrintOperator( const char *pIndent, IDmeOperator *pOp );
 
 	friend class CDmElementFramework;
 
 	void Cleanup();
 	void FindRoots();
+	void ComputeLevels();
 	CAttributeNode *FindAttrNode( CDmAttribute *pAttr );
+	void ReleaseAttrNode( CAttributeNode *pAttrNode );
+	COperatorNode *AddOperatorNode( IDmeOperator *pOp );
+	void RemoveOperatorNode( COperatorNode *pOpNode );
+	bool HasOperatorNodeChanged( COperatorNode *pOpNode );
 
 	CUtlVector< COperatorNode* > m_opRoots;
 //	CUtlVector< COperatorNode* > m_opLeaves;
@@ -56,7 +61,15 @@ private:
 
 	CUtlHash< CAttributeNode* > m_attrNodes;
 
+	// All operator nodes sorted by level, recomputed only when the graph changes
+	CUtlVector< COperatorNode* > m_levelOrder;
+	bool m_bLevelsDirty;
+
 	CUtlVector< IDmeOperator* > m_operators;
+
+	// Scratch space, kept around to avoid reallocating it every reset
+	CUtlVector< CDmAttribute* > m_inputAttrs;
+	CUtlVector< CDmAttribute* > m_outputAttrs;
 };
 
 #endif // DEPENDENCYGRAPH_H
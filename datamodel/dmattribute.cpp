@@ -594,6 +594,15 @@ public:
 		m_OldValue = pAttribute->GetValue<T>();
 		m_Value = newValue;
 		m_symAttribute = pAttribute->GetNameSymbol( );
+
+		// Element values are held by counted handles as well, so the element collector
+		// treats them as reachable for as long as this can be undone or redone
+		// (the cast only happens when the value actually is a DmElementHandle_t)
+		if ( CDmAttributeInfo< T >::AttributeType() == AT_ELEMENT )
+		{
+			m_hOldElement = *( DmElementHandle_t* )&m_OldValue;
+			m_hElement = *( DmElementHandle_t* )&m_Value;
+		}
 	}
 
 	CDmElement *GetOwner()
@@ -651,6 +660,8 @@ private:
 	DmElementHandle_t	m_hOwner;
 	StorageType_t		m_OldValue;
 	StorageType_t		m_Value;
+	CDmeCountedHandle	m_hOldElement;
+	CDmeCountedHandle	m_hElement;
 };
 
 
@@ -886,6 +886,22 @@ public:
 		m_Type( type )
 	{
 		Assert( pElement && pElement->GetFileId() != DMFILEID_INVALID );
+
+		// The removed attribute isn't on any element, so the elements it refers to are
+		// held by counted handles to keep the element collector from deleting them
+		if ( type == AT_ELEMENT )
+		{
+			m_hOldElements.AddToTail( pOldAttribute->GetValue< DmElementHandle_t >() );
+		}
+		else if ( type == AT_ELEMENT_ARRAY )
+		{
+			const CDmrElementArrayConst<> array( pOldAttribute );
+			int nCount = array.Count();
+			for ( int i = 0; i < nCount; ++i )
+			{
+				m_hOldElements.AddToTail( array.GetHandle( i ) );
+			}
+		}
 	}
 
 	~CUndoAttributeRemove()
@@ -914,6 +930,7 @@ private:
 	CUtlSymbol				m_symAttribute;
 	DmAttributeType_t		m_Type;
 	CDmAttribute			*m_pOldAttribute;
+	CUtlVector< CDmeCountedHandle > m_hOldElements;
 };
 
 
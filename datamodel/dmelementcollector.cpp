@@ -0,0 +1,524 @@
+//====== Copyright  1996-2005, Valve Corporation, All rights reserved. =======
+//
+// Purpose: Incremental, generational collection of orphaned element subtrees
+//
+//=============================================================================
+
+#include "dmelementcollector.h"
+#include "datamodel.h"
+#include "datamodel/dmelement.h"
+#include "datamodel/dmattribute.h"
+#include "datamodel/dmattributevar.h"
+#include "tier0/platform.h"
+#include "tier0/vprof.h"
+#include "tier1/utlhash.h"
+
+// defined in dmattribute.cpp
+bool HandleCompare( const DmElementHandle_t &a, const DmElementHandle_t &b );
+unsigned int HandleHash( const DmElementHandle_t &h );
+
+// memdbgon must be the last include file in a .cpp file!!!
+#include "tier0/memdbgon.h"
+
+
+//-----------------------------------------------------------------------------
+// How many elements are processed between checks of the time budget
+//-----------------------------------------------------------------------------
+#define COLLECTOR_WORK_SLICE 256
+
+
+//-----------------------------------------------------------------------------
+// Constructor
+//-----------------------------------------------------------------------------
+CDmElementCollector::CDmElementCollector() :
+	m_nPhase( PHASE_IDLE ),
+	m_nEpoch( 0 ),
+	m_bYoungOnly( false ),
+	m_bCollectionRequested( false ),
+	m_bOldGenerationDirty( true ),
+	m_bSweeping( false ),
+	m_nCursor( 0 ),
+	m_nYoungAtCycleStart( 0 )
+{
+	memset( &m_Stats, 0, sizeof( m_Stats ) );
+}
+
+
+//-----------------------------------------------------------------------------
+// Unlike CDataModel::GetElement, also finds elements destroyed while undo was
+// enabled; they are kept by their undo records, and so are their references
+//-----------------------------------------------------------------------------
+CDmElement *CDmElementCollector::GetElement( DmElementHandle_t hElement )
+{
+	if ( hElement == DMELEMENT_HANDLE_INVALID )
+		return NULL;
+
+	return g_pDataModelImp->m_Handles.GetHandle( hElement, false );
+}
+
+
+//-----------------------------------------------------------------------------
+// Per-element collector state, indexed by handle index
+//-----------------------------------------------------------------------------
+CDmElementCollector::ElementInfo_t &CDmElementCollector::GetInfo( DmElementHandle_t hElement )
+{
+	int nIndex = g_pDataModelImp->m_Handles.GetIndexFromHandle( hElement );
+	if ( nIndex >= m_ElementInfo.Count() )
+	{
+		int nFirst = m_ElementInfo.AddMultipleToTail( nIndex + 1 - m_ElementInfo.Count() );
+		memset( &m_ElementInfo[ nFirst ], 0, ( m_ElementInfo.Count() - nFirst ) * sizeof( ElementInfo_t ) );
+	}
+	return m_ElementInfo[ nIndex ];
+}
+
+bool CDmElementCollector::IsMarked( DmElementHandle_t hElement )
+{
+	return GetInfo( hElement ).m_nMarkEpoch == m_nEpoch;
+}
+
+bool CDmElementCollector::IsYoung( DmElementHandle_t hElement )
+{
+	return ( GetInfo( hElement ).m_nFlags & ELEMENT_YOUNG ) != 0;
+}
+
+
+//-----------------------------------------------------------------------------
+// Marks an element as reachable, and queues it up to have its references scanned
+//-----------------------------------------------------------------------------
+void CDmElementCollector::Shade( DmElementHandle_t hElement )
+{
+	if ( !GetElement( hElement ) )
+		return;
+
+	ElementInfo_t &info = GetInfo( hElement );
+	if ( info.m_nMarkEpoch == m_nEpoch )
+		return;
+
+	// Old elements are all assumed to be reachable during a young collection
+	if ( m_bYoungOnly && !( info.m_nFlags & ELEMENT_YOUNG ) )
+		return;
+
+	info.m_nMarkEpoch = m_nEpoch;
+	m_GreyElements.AddToTail( hElement );
+}
+
+void CDmElementCollector::ShadeFileRoots()
+{
+	int nFiles = g_pDataModelImp->NumFileIds();
+	for ( int i = 0; i < nFiles; ++i )
+	{
+		DmFileId_t fileid = g_pDataModelImp->GetFileId( i );
+		if ( fileid == DMFILEID_INVALID )
+			continue;
+
+		Shade( g_pDataModelImp->GetFileRoot( fileid ) );
+	}
+}
+
+
+//-----------------------------------------------------------------------------
+// Shades everything an element refers to
+//-----------------------------------------------------------------------------
+void CDmElementCollector::ScanElement( CDmElement *pElement )
+{
+	for ( const CDmAttribute *pAttr = pElement->FirstAttribute(); pAttr != NULL; pAttr = pAttr->NextAttribute() )
+	{
+		if ( !ShouldTraverse( pAttr, TD_ALL ) )
+			continue;
+
+		if ( pAttr->GetType() == AT_ELEMENT )
+		{
+			CDmElement *pChild = pAttr->GetValueElement< CDmElement >();
+			if ( pChild )
+			{
+				Shade( pChild->GetHandle() );
+			}
+		}
+		else if ( pAttr->GetType() == AT_ELEMENT_ARRAY )
+		{
+			const CDmrElementArrayConst<> elementArrayAttr( pAttr );
+			int nChildren = elementArrayAttr.Count();
+			for ( int i = 0; i < nChildren; ++i )
+			{
+				CDmElement *pChild = elementArrayAttr[ i ];
+				if ( pChild )
+				{
+					Shade( pChild->GetHandle() );
+				}
+			}
+		}
+	}
+}
+
+
+//-----------------------------------------------------------------------------
+// When an element is promoted, its references to elements which are still
+// young have to be remembered, since the write barrier didn't see them as old
+//-----------------------------------------------------------------------------
+void CDmElementCollector::RememberYoungReferences( CDmElement *pElement )
+{
+	for ( const CDmAttribute *pAttr = pElement->FirstAttribute(); pAttr != NULL; pAttr = pAttr->NextAttribute() )
+	{
+		if ( pAttr->GetType() == AT_ELEMENT )
+		{
+			CDmElement *pChild = pAttr->GetValueElement< CDmElement >();
+			if ( pChild && IsYoung( pChild->GetHandle() ) )
+			{
+				GetInfo( pChild->GetHandle() ).m_nFlags |= ELEMENT_REMEMBERED;
+			}
+		}
+		else if ( pAttr->GetType() == AT_ELEMENT_ARRAY )
+		{
+			const CDmrElementArrayConst<> elementArrayAttr( pAttr );
+			int nChildren = elementArrayAttr.Count();
+			for ( int i = 0; i < nChildren; ++i )
+			{
+				CDmElement *pChild = elementArrayAttr[ i ];
+				if ( pChild && IsYoung( pChild->GetHandle() ) )
+				{
+					GetInfo( pChild->GetHandle() ).m_nFlags |= ELEMENT_REMEMBERED;
+				}
+			}
+		}
+	}
+}
+
+
+//-----------------------------------------------------------------------------
+// Deletes an element if it wasn't reached
+//-----------------------------------------------------------------------------
+void CDmElementCollector::SweepElement( DmElementHandle_t hElement )
+{
+	CDmElement *pElement = g_pDataModel->GetElement( hElement );
+	if ( !pElement )
+		return;
+
+	// Elements that aren't in a file are never collected
+	if ( pElement->GetFileId() == DMFILEID_INVALID )
+		return;
+
+	if ( IsMarked( hElement ) )
+		return;
+
+	CUtlHash< DmElementHandle_t > visited( 16, 0, 0, HandleCompare, HandleHash );
+	m_Stats.m_nLastBytesReclaimed += CDmeElementAccessor::EstimateMemoryUsage( pElement, visited, TD_NONE, NULL );
+	++m_Stats.m_nLastElementsReclaimed;
+
+	// Children losing their references here are unreachable too, so they don't dirty the old generation
+	m_bSweeping = true;
+	g_pDataModelImp->DeleteElement( hElement );
+	m_bSweeping = false;
+}
+
+
+//-----------------------------------------------------------------------------
+// Collection requests
+//-----------------------------------------------------------------------------
+void CDmElementCollector::RequestCollection()
+{
+	m_bCollectionRequested = true;
+}
+
+bool CDmElementCollector::IsCollecting() const
+{
+	return m_nPhase != PHASE_IDLE;
+}
+
+void CDmElementCollector::BeginCycle()
+{
+	Assert( m_nPhase == PHASE_IDLE && m_GreyElements.Count() == 0 );
+
+	m_bCollectionRequested = false;
+	m_bYoungOnly = !m_bOldGenerationDirty;
+	m_bOldGenerationDirty = false;
+	m_nYoungAtCycleStart = m_YoungElements.Count();
+	m_nCursor = 0;
+
+	m_Stats.m_nLastElementsReclaimed = 0;
+	m_Stats.m_nLastBytesReclaimed = 0;
+
+	// A new epoch unmarks everything at once; 0 is reserved for 'never marked'
+	if ( ++m_nEpoch == 0 )
+	{
+		int nCount = m_ElementInfo.Count();
+		for ( int i = 0; i < nCount; ++i )
+		{
+			m_ElementInfo[ i ].m_nMarkEpoch = 0;
+		}
+		m_nEpoch = 1;
+	}
+
+	m_nPhase = PHASE_ROOTS;
+	ShadeFileRoots();
+}
+
+void CDmElementCollector::EndCycle()
+{
+	Assert( m_GreyElements.Count() == 0 );
+
+	// Everything that was young when we started has now been examined and survived
+	for ( int i = 0; i < m_nYoungAtCycleStart; ++i )
+	{
+		DmElementHandle_t hElement = m_YoungElements[ i ];
+		if ( GetElement( hElement ) )
+		{
+			GetInfo( hElement ).m_nFlags &= ~( ELEMENT_YOUNG | ELEMENT_REMEMBERED );
+		}
+	}
+
+	// Elements created during the cycle stay young, so old references to them must be remembered
+	if ( m_YoungElements.Count() > m_nYoungAtCycleStart )
+	{
+		for ( int i = 0; i < m_nYoungAtCycleStart; ++i )
+		{
+			CDmElement *pElement = GetElement( m_YoungElements[ i ] );
+			if ( pElement )
+			{
+				RememberYoungReferences( pElement );
+			}
+		}
+	}
+
+	m_YoungElements.RemoveMultiple( 0, m_nYoungAtCycleStart );
+	m_nYoungAtCycleStart = 0;
+
+	if ( m_bYoungOnly )
+	{
+		++m_Stats.m_nYoungCollections;
+	}
+	else
+	{
+		++m_Stats.m_nFullCollections;
+	}
+	m_Stats.m_nElementsReclaimed += m_Stats.m_nLastElementsReclaimed;
+	m_Stats.m_nBytesReclaimed += m_Stats.m_nLastBytesReclaimed;
+
+	m_nPhase = PHASE_IDLE;
+}
+
+
+//-----------------------------------------------------------------------------
+// Does roughly nUnits elements worth of work; returns true when the cycle is done
+//-----------------------------------------------------------------------------
+bool CDmElementCollector::DoWork( int nUnits )
+{
+	CUtlHandleTable< CDmElement, 20 > &handles = g_pDataModelImp->m_Handles;
+
+	for ( ; nUnits > 0; --nUnits )
+	{
+		// Grey elements always go first, since the write barrier can add more at any time
+		if ( m_GreyElements.Count() )
+		{
+			DmElementHandle_t hElement = m_GreyElements.Tail();
+			m_GreyElements.RemoveMultipleFromTail( 1 );
+
+			CDmElement *pElement = GetElement( hElement );
+			if ( pElement )
+			{
+				ScanElement( pElement );
+			}
+			continue;
+		}
+
+		switch ( m_nPhase )
+		{
+		case PHASE_ROOTS:
+			if ( m_bYoungOnly )
+			{
+				if ( m_nCursor >= m_nYoungAtCycleStart )
+				{
+					m_nPhase = PHASE_MARK;
+					break;
+				}
+
+				DmElementHandle_t hElement = m_YoungElements[ m_nCursor++ ];
+				CDmElement *pElement = GetElement( hElement );
+				if ( !pElement )
+					break;
+
+				if ( ( GetInfo( hElement ).m_nFlags & ELEMENT_REMEMBERED ) ||
+					CDmeElementAccessor::GetReference( pElement )->m_nStrongHandleCount > 0 )
+				{
+					Shade( hElement );
+				}
+			}
+			else
+			{
+				if ( m_nCursor >= (int)handles.GetHandleCount() )
+				{
+					m_nPhase = PHASE_MARK;
+					break;
+				}
+
+				DmElementHandle_t hElement = ( DmElementHandle_t )handles.GetHandleFromIndex( m_nCursor++ );
+				CDmElement *pElement = GetElement( hElement );
+				if ( pElement && CDmeElementAccessor::GetReference( pElement )->m_nStrongHandleCount > 0 )
+				{
+					Shade( hElement );
+				}
+			}
+			break;
+
+		case PHASE_MARK:
+			// File roots may have changed since we started
+			ShadeFileRoots();
+			if ( m_GreyElements.Count() == 0 )
+			{
+				m_nPhase = PHASE_SWEEP;
+				m_nCursor = 0;
+			}
+			break;
+
+		case PHASE_SWEEP:
+			if ( m_bYoungOnly )
+			{
+				if ( m_nCursor >= m_nYoungAtCycleStart )
+				{
+					EndCycle();
+					return true;
+				}
+				SweepElement( m_YoungElements[ m_nCursor++ ] );
+			}
+			else
+			{
+				if ( m_nCursor >= (int)handles.GetHandleCount() )
+				{
+					EndCycle();
+					return true;
+				}
+				SweepElement( ( DmElementHandle_t )handles.GetHandleFromIndex( m_nCursor++ ) );
+			}
+			break;
+
+		default:
+			return true;
+		}
+	}
+
+	return false;
+}
+
+
+//-----------------------------------------------------------------------------
+// Does as much collection work as fits into the time budget
+//-----------------------------------------------------------------------------
+void CDmElementCollector::Step( float flBudget )
+{
+	if ( m_nPhase == PHASE_IDLE )
+	{
+		if ( !m_bCollectionRequested )
+			return;
+
+		BeginCycle();
+	}
+
+	VPROF_BUDGET( "CDmElementCollector::Step", VPROF_BUDGETGROUP_TOOLS );
+
+	double flStart = Plat_FloatTime();
+	double flEnd = flStart + flBudget;
+	while ( !DoWork( COLLECTOR_WORK_SLICE ) )
+	{
+		if ( flBudget > 0.0f && Plat_FloatTime() >= flEnd )
+			break;
+	}
+
+	float flPause = (float)( Plat_FloatTime() - flStart );
+	++m_Stats.m_nSteps;
+	m_Stats.m_flLastPause = flPause;
+	m_Stats.m_flMaxPause = max( m_Stats.m_flMaxPause, flPause );
+	m_Stats.m_flTotalPause += flPause;
+}
+
+void CDmElementCollector::Finish()
+{
+	while ( m_bCollectionRequested || IsCollecting() )
+	{
+		Step( 0.0f );
+	}
+}
+
+
+//-----------------------------------------------------------------------------
+// Hooks from the datamodel
+//-----------------------------------------------------------------------------
+void CDmElementCollector::OnElementCreated( DmElementHandle_t hElement )
+{
+	// New elements are young, and are allocated already marked during a collection
+	ElementInfo_t &info = GetInfo( hElement );
+	info.m_nFlags = ELEMENT_YOUNG;
+	info.m_nMarkEpoch = ( m_nPhase != PHASE_IDLE ) ? m_nEpoch : 0;
+	m_YoungElements.AddToTail( hElement );
+}
+
+// The element is treated as old from now on, since it's no longer on the young list
+void CDmElementCollector::OnElementHandleChanged( DmElementHandle_t hOld, DmElementHandle_t hNew )
+{
+	ElementInfo_t oldInfo = GetInfo( hOld );
+	ElementInfo_t &info = GetInfo( hNew );
+	info.m_nMarkEpoch = oldInfo.m_nMarkEpoch;
+	info.m_nFlags = 0;
+	m_bOldGenerationDirty = true;
+}
+
+// Write barrier for element references stored in attributes
+void CDmElementCollector::OnElementReferenceAdded( DmElementHandle_t hElement, DmElementHandle_t hOwner )
+{
+	if ( !GetElement( hElement ) )
+		return;
+
+	if ( IsYoung( hElement ) && ( hOwner == DMELEMENT_HANDLE_INVALID || !IsYoung( hOwner ) ) )
+	{
+		GetInfo( hElement ).m_nFlags |= ELEMENT_REMEMBERED;
+	}
+
+	if ( m_nPhase != PHASE_IDLE )
+	{
+		Shade( hElement );
+	}
+}
+
+void CDmElementCollector::OnStrongReferenceAdded( DmElementHandle_t hElement )
+{
+	if ( m_nPhase != PHASE_IDLE )
+	{
+		Shade( hElement );
+	}
+}
+
+void CDmElementCollector::OnElementReferenceRemoved( DmElementHandle_t hElement )
+{
+	// Losing a reference is the only way an old element can become unreachable
+	if ( !m_bOldGenerationDirty && !m_bSweeping && GetElement( hElement ) && !IsYoung( hElement ) )
+	{
+		m_bOldGenerationDirty = true;
+	}
+}
+
+void CDmElementCollector::OnFileRootChanged( DmElementHandle_t hRoot )
+{
+	m_bOldGenerationDirty = true;
+	if ( m_nPhase != PHASE_IDLE )
+	{
+		Shade( hRoot );
+	}
+}
+
+
+//-----------------------------------------------------------------------------
+// Statistics
+//-----------------------------------------------------------------------------
+const DmCollectorStats_t &CDmElementCollector::GetStats() const
+{
+	return m_Stats;
+}
+
+void CDmElementCollector::DisplayStats() const
+{
+	ConMsg( "Element collector: %d full, %d young collections over %d steps\n",
+		m_Stats.m_nFullCollections, m_Stats.m_nYoungCollections, m_Stats.m_nSteps );
+	ConMsg( "    pauses: last %.2fms, max %.2fms, total %.2fms\n",
+		m_Stats.m_flLastPause * 1000.0f, m_Stats.m_flMaxPause * 1000.0f, m_Stats.m_flTotalPause * 1000.0f );
+	ConMsg( "    reclaimed: last cycle %d elements (%d bytes), total %d elements (%lld bytes)\n",
+		m_Stats.m_nLastElementsReclaimed, m_Stats.m_nLastBytesReclaimed, m_Stats.m_nElementsReclaimed, m_Stats.m_nBytesReclaimed );
+	ConMsg( "    %d young elements, %d waiting to be scanned\n", m_YoungElements.Count(), m_GreyElements.Count() );
+}
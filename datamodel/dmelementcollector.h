@@ -0,0 +1,129 @@
+//====== Copyright  1996-2005, Valve Corporation, All rights reserved. =======
+//
+// Purpose: Incremental, generational collection of orphaned element subtrees
+//
+//=============================================================================
+
+#ifndef DMELEMENTCOLLECTOR_H
+#define DMELEMENTCOLLECTOR_H
+#ifdef _WIN32
+#pragma once
+#endif
+
+#include "tier1/utlvector.h"
+#include "datamodel/dmattributetypes.h"
+
+
+//-----------------------------------------------------------------------------
+// Forward declarations
+//-----------------------------------------------------------------------------
+class CDmElement;
+
+
+//-----------------------------------------------------------------------------
+// Collection statistics
+//-----------------------------------------------------------------------------
+struct DmCollectorStats_t
+{
+	int		m_nFullCollections;
+	int		m_nYoungCollections;
+	int		m_nSteps;
+	float	m_flLastPause;
+	float	m_flMaxPause;
+	float	m_flTotalPause;
+	int		m_nLastElementsReclaimed;
+	int		m_nLastBytesReclaimed;
+	int		m_nElementsReclaimed;
+	int64	m_nBytesReclaimed;
+};
+
+
+//-----------------------------------------------------------------------------
+// Finds and deletes elements which can no longer be reached from a file root
+// or a counted handle. Work is split into small steps run under a time budget,
+// with a write barrier on element references keeping the marking correct while
+// the data model changes in between steps. When no references to elements
+// which survived the last full collection have been removed since, only
+// elements created since then (the young generation) are examined.
+// Undo records hold the elements they refer to with counted handles, so those
+// are roots like any other counted handle, including elements whose destruction
+// is waiting on the undo stack.
+//-----------------------------------------------------------------------------
+class CDmElementCollector
+{
+public:
+	CDmElementCollector();
+
+	// Asks for a collection; it will be carried out by subsequent calls to Step()
+	void			RequestCollection();
+	bool			IsCollecting() const;
+
+	// Does as much collection work as fits into the time budget (in seconds)
+	void			Step( float flBudget );
+
+	// Runs any requested or in-progress collection to completion
+	void			Finish();
+
+	// Hooks from the datamodel
+	void			OnElementCreated( DmElementHandle_t hElement );
+	void			OnElementHandleChanged( DmElementHandle_t hOld, DmElementHandle_t hNew );
+	void			OnElementReferenceAdded( DmElementHandle_t hElement, DmElementHandle_t hOwner );
+	void			OnStrongReferenceAdded( DmElementHandle_t hElement );
+	void			OnElementReferenceRemoved( DmElementHandle_t hElement );
+	void			OnFileRootChanged( DmElementHandle_t hRoot );
+
+	const DmCollectorStats_t &GetStats() const;
+	void			DisplayStats() const;
+
+private:
+	enum Phase_t
+	{
+		PHASE_IDLE = 0,
+		PHASE_ROOTS,	// shading elements held by counted handles
+		PHASE_MARK,		// draining the grey list
+		PHASE_SWEEP,	// deleting unmarked elements
+	};
+
+	enum
+	{
+		ELEMENT_YOUNG = 0x1,		// created since the last collection
+		ELEMENT_REMEMBERED = 0x2,	// young, and referenced by an old element
+	};
+
+	struct ElementInfo_t
+	{
+		unsigned char m_nMarkEpoch;
+		unsigned char m_nFlags;
+	};
+
+	void			BeginCycle();
+	void			EndCycle();
+	bool			DoWork( int nUnits );
+
+	CDmElement		*GetElement( DmElementHandle_t hElement );
+	ElementInfo_t	&GetInfo( DmElementHandle_t hElement );
+	bool			IsMarked( DmElementHandle_t hElement );
+	bool			IsYoung( DmElementHandle_t hElement );
+	void			Shade( DmElementHandle_t hElement );
+	void			ShadeFileRoots();
+	void			ScanElement( CDmElement *pElement );
+	void			RememberYoungReferences( CDmElement *pElement );
+	void			SweepElement( DmElementHandle_t hElement );
+
+	CUtlVector< ElementInfo_t >			m_ElementInfo;		// indexed by handle index
+	CUtlVector< DmElementHandle_t >		m_YoungElements;
+	CUtlVector< DmElementHandle_t >		m_GreyElements;
+
+	Phase_t			m_nPhase;
+	unsigned char	m_nEpoch;
+	bool			m_bYoungOnly;
+	bool			m_bCollectionRequested;
+	bool			m_bOldGenerationDirty;	// an old element may have become unreachable
+	bool			m_bSweeping;
+	int				m_nCursor;
+	int				m_nYoungAtCycleStart;
+
+	DmCollectorStats_t m_Stats;
+};
+
+#endif // DMELEMENTCOLLECTOR_H
@@ -15,6 +15,10 @@
 #include "DmElementFramework.h"
 #include "tier1/utlbuffer.h"
 #include <limits.h>
+#include <emmintrin.h>
+#ifdef _WIN32
+#include <intrin.h>
+#endif
 
 
 //-----------------------------------------------------------------------------
@@ -266,6 +270,7 @@ private:
 	bool UnserializeElementAttribute( CUtlBuffer &buf, DmElementDictHandle_t hElement, const char *pAttributeName, const char *pElementType );
 	bool UnserializeElementArrayAttribute( CUtlBuffer &buf, DmElementDictHandle_t hElement, const char *pAttributeName );
 	bool UnserializeArrayAttribute( CUtlBuffer &buf, DmElementDictHandle_t hElement, const char *pAttributeName, DmAttributeType_t nAttrType );
+	template< class T, class C > bool UnserializeNumericArrayAttribute( CUtlBuffer &buf, CDmAttribute *pAttribute, const char *pAttributeName );
 	bool UnserializeAttribute( CUtlBuffer &buf, DmElementDictHandle_t hElement, const char *pAttributeName, DmAttributeType_t nAttrType );
 	bool UnserializeElement( CUtlBuffer &buf, const char *pElementType, DmElementDictHandle_t *pHandle );
 	bool UnserializeElement( CUtlBuffer &buf, DmElementDictHandle_t *pHandle );
@@ -529,59 +534,322 @@ bool CDmSerializerKeyValues2::Serialize( CUtlBuffer &outBuf, CDmElement *pRoot )
 
 
 //-----------------------------------------------------------------------------
-// Eats whitespaces and c++ style comments
+// Block classification helpers for the tokenizer. These look at 16 bytes at
+// a time with SSE2 and drop down to single bytes for the tail of the buffer.
 //-----------------------------------------------------------------------------
-#pragma warning (disable:4706)
+static inline bool IsKV2Whitespace( char c )
+{
+	// Same set as isspace() in the C locale
+	return ( c == ' ' ) || ( c >= '\t' && c <= '\r' );
+}
 
-void CDmSerializerKeyValues2::EatWhitespacesAndComments( CUtlBuffer &buf )
+static inline int FirstSetBit( unsigned int nMask )
 {
-	// eating white spaces and remarks loop
-	int nMaxPut = buf.TellMaxPut() - buf.TellGet();
-	int nOffset = 0;
-	while ( nOffset < nMaxPut )	
+	Assert( nMask != 0 );
+#ifdef _WIN32
+	unsigned long nIndex;
+	_BitScanForward( &nIndex, nMask );
+	return (int)nIndex;
+#else
+	return __builtin_ctz( nMask );
+#endif
+}
+
+static inline int CountSetBits( unsigned int nMask )
+{
+	int nCount = 0;
+	for ( ; nMask; nMask &= nMask - 1 )
 	{
-		// Eat whitespaces, keep track of line count
-		const char *pPeek = NULL;
-		while ( pPeek = (const char *)buf.PeekGet( sizeof(char), nOffset ) )
+		++nCount;
+	}
+	return nCount;
+}
+
+// Returns the first non-whitespace character in [pText, pEnd), and counts the newlines skipped
+static const char *SkipWhitespace( const char *pText, const char *pEnd, int *pNewLines )
+{
+	const __m128i vSpace = _mm_set1_epi8( ' ' );
+	const __m128i vTabMinusOne = _mm_set1_epi8( '\t' - 1 );
+	const __m128i vCRPlusOne = _mm_set1_epi8( '\r' + 1 );
+	const __m128i vNewLine = _mm_set1_epi8( '\n' );
+
+	while ( pEnd - pText >= 16 )
+	{
+		__m128i vChars = _mm_loadu_si128( (const __m128i*)pText );
+		__m128i vIsSpace = _mm_or_si128( _mm_cmpeq_epi8( vChars, vSpace ),
+			_mm_and_si128( _mm_cmpgt_epi8( vChars, vTabMinusOne ), _mm_cmplt_epi8( vChars, vCRPlusOne ) ) );
+		unsigned int nSpaceMask = (unsigned int)_mm_movemask_epi8( vIsSpace );
+		unsigned int nNewLineMask = (unsigned int)_mm_movemask_epi8( _mm_cmpeq_epi8( vChars, vNewLine ) );
+		if ( nSpaceMask != 0xFFFF )
+		{
+			int nFirst = FirstSetBit( ~nSpaceMask & 0xFFFF );
+			*pNewLines += CountSetBits( nNewLineMask & ( ( 1u << nFirst ) - 1 ) );
+			return pText + nFirst;
+		}
+		*pNewLines += CountSetBits( nNewLineMask );
+		pText += 16;
+	}
+
+	for ( ; pText < pEnd && IsKV2Whitespace( *pText ); ++pText )
+	{
+		if ( *pText == '\n' )
+		{
+			++(*pNewLines);
+		}
+	}
+	return pText;
+}
+
+// Returns the first quote or escape character in [pText, pEnd), or pEnd
+static const char *FindQuoteOrEscape( const char *pText, const char *pEnd )
+{
+	const __m128i vQuote = _mm_set1_epi8( '\"' );
+	const __m128i vEscape = _mm_set1_epi8( '\\' );
+
+	while ( pEnd - pText >= 16 )
+	{
+		__m128i vChars = _mm_loadu_si128( (const __m128i*)pText );
+		unsigned int nMask = (unsigned int)_mm_movemask_epi8( 
+			_mm_or_si128( _mm_cmpeq_epi8( vChars, vQuote ), _mm_cmpeq_epi8( vChars, vEscape ) ) );
+		if ( nMask )
+			return pText + FirstSetBit( nMask );
+		pText += 16;
+	}
+
+	for ( ; pText < pEnd; ++pText )
+	{
+		if ( *pText == '\"' || *pText == '\\' )
+			break;
+	}
+	return pText;
+}
+
+static int CountNewLines( const char *pText, const char *pEnd )
+{
+	const __m128i vNewLine = _mm_set1_epi8( '\n' );
+
+	int nCount = 0;
+	while ( pEnd - pText >= 16 )
+	{
+		__m128i vChars = _mm_loadu_si128( (const __m128i*)pText );
+		nCount += CountSetBits( (unsigned int)_mm_movemask_epi8( _mm_cmpeq_epi8( vChars, vNewLine ) ) );
+		pText += 16;
+	}
+
+	for ( ; pText < pEnd; ++pText )
+	{
+		if ( *pText == '\n' )
 		{
-			if ( !isspace( *pPeek ) )
-				break;
+			++nCount;
+		}
+	}
+	return nCount;
+}
 
-			if ( *pPeek == '\n' )
+
+//-----------------------------------------------------------------------------
+// Fast number parsing for numeric array values. Floats with at most 24 bits of
+// significant digits and a decimal exponent within +-10 are computed exactly
+// with one float multiply or divide, so they round the same as sscanf( "%f" ).
+// Anything else (long mantissas, large exponents, inf, hex) goes to sscanf.
+// NOTE: Tokens always end with a closing quote, so strtol can never run off
+// the end of the token even though it isn't null terminated.
+//-----------------------------------------------------------------------------
+static const float s_pPowersOf10[] = 
+{
+	1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f, 1e10f
+};
+
+static const char *ParseNumber( const char *pText, const char *pEnd, float *pValue )
+{
+	int nNewLines = 0;
+	const char *p = SkipWhitespace( pText, pEnd, &nNewLines );
+	const char *pStart = p;
+
+	bool bNegative = false;
+	if ( p < pEnd && ( *p == '-' || *p == '+' ) )
+	{
+		bNegative = ( *p == '-' );
+		++p;
+	}
+
+	// Trailing zeros are folded into the exponent, so 1000 and 0.5000 stay exact
+	uint64 nMantissa = 0;
+	int nPendingZeros = 0;
+	int nDigits = 0;
+	int nExponent = 0;
+	bool bExact = true;
+	for ( bool bFraction = false; p < pEnd; ++p )
+	{
+		if ( *p == '.' && !bFraction )
+		{
+			bFraction = true;
+			continue;
+		}
+
+		if ( *p < '0' || *p > '9' )
+			break;
+
+		++nDigits;
+		if ( bFraction )
+		{
+			--nExponent;
+		}
+
+		if ( *p == '0' )
+		{
+			if ( nMantissa )
 			{
-				g_KeyValues2ErrorStack.IncrementCurrentLine();
+				++nPendingZeros;
 			}
-			if ( ++nOffset >= nMaxPut )
-				break;
 		}
+		else if ( bExact )
+		{
+			for ( ; nPendingZeros > 0 && nMantissa <= ( 1 << 24 ); --nPendingZeros )
+			{
+				nMantissa *= 10;
+			}
+			nMantissa = nMantissa * 10 + ( *p - '0' );
+			bExact = ( nPendingZeros == 0 ) && ( nMantissa <= ( 1 << 24 ) );
+		}
+	}
+	nExponent += nPendingZeros;
 
-		// If we don't have a a c++ style comment next, we're done
-		pPeek = (const char *)buf.PeekGet( 2 * sizeof(char), nOffset );
-		if ( ( nOffset >= nMaxPut ) || !pPeek || ( pPeek[0] != '/' ) || ( pPeek[1] != '/' ) )
-			break;
+	if ( nDigits > 0 && p < pEnd && ( *p == 'e' || *p == 'E' ) )
+	{
+		const char *pExponent = p + 1;
+		bool bNegativeExponent = false;
+		if ( pExponent < pEnd && ( *pExponent == '-' || *pExponent == '+' ) )
+		{
+			bNegativeExponent = ( *pExponent == '-' );
+			++pExponent;
+		}
 
-		// Deal with c++ style comments
-		nOffset += 2;
+		if ( pExponent < pEnd && *pExponent >= '0' && *pExponent <= '9' )
+		{
+			int nExplicitExponent = 0;
+			for ( p = pExponent; p < pEnd && *p >= '0' && *p <= '9'; ++p )
+			{
+				nExplicitExponent = min( nExplicitExponent * 10 + ( *p - '0' ), 100000 );
+			}
+			nExponent += bNegativeExponent ? -nExplicitExponent : nExplicitExponent;
+		}
+	}
 
-		// read complete line
-		while ( pPeek = (const char *)buf.PeekGet( sizeof(char), nOffset ) )
+	bool bSpecial = ( nDigits == 0 ) || ( p < pEnd && ( *p == 'x' || *p == 'X' ) );
+	if ( !bSpecial && ( nMantissa == 0 || ( bExact && nExponent >= -10 && nExponent <= 10 ) ) )
+	{
+		float flValue = (float)nMantissa;
+		if ( nMantissa == 0 )
+		{
+			flValue = 0.0f;
+		}
+		else if ( nExponent < 0 )
+		{
+			flValue /= s_pPowersOf10[ -nExponent ];
+		}
+		else
 		{
-			if ( *pPeek == '\n' )
-				break;
-			if ( ++nOffset >= nMaxPut )
-				break;
+			flValue *= s_pPowersOf10[ nExponent ];
 		}
+		*pValue = bNegative ? -flValue : flValue;
+		return p;
+	}
+
+	// Slow path: hand a null terminated copy of the number to sscanf
+	char pNumber[ 128 ];
+	int nLen = 0;
+	for ( const char *q = pStart; q < pEnd && *q > ' ' && *q != ',' && nLen < (int)sizeof( pNumber ) - 1; ++q )
+	{
+		pNumber[ nLen++ ] = *q;
+	}
+	pNumber[ nLen ] = '\0';
+
+	int nConsumed = 0;
+	if ( nLen == 0 || sscanf( pNumber, "%f%n", pValue, &nConsumed ) != 1 )
+		return NULL;
+	return pStart + nConsumed;
+}
 
-		g_KeyValues2ErrorStack.IncrementCurrentLine();
+static const char *ParseNumber( const char *pText, const char *pEnd, int *pValue )
+{
+	int nNewLines = 0;
+	const char *p = SkipWhitespace( pText, pEnd, &nNewLines );
+	const char *pStart = p;
+
+	bool bNegative = false;
+	if ( p < pEnd && ( *p == '-' || *p == '+' ) )
+	{
+		bNegative = ( *p == '-' );
+		++p;
 	}
 
-	buf.SeekGet( CUtlBuffer::SEEK_CURRENT, nOffset );
+	int64 nValue = 0;
+	const char *pDigits = p;
+	// At most 9 digits, so the value always fits in an int
+	for ( ; p < pEnd && *p >= '0' && *p <= '9' && ( p - pDigits ) < 9; ++p )
+	{
+		nValue = nValue * 10 + ( *p - '0' );
+	}
+
+	if ( p == pDigits || ( p < pEnd && *p >= '0' && *p <= '9' ) )
+	{
+		if ( pStart == pEnd )
+			return NULL;
+
+		char *pParseEnd;
+		long nLongValue = strtol( pStart, &pParseEnd, 10 );
+		if ( pParseEnd == pStart || pParseEnd > pEnd )
+			return NULL;
+		*pValue = (int)nLongValue;
+		return pParseEnd;
+	}
+
+	*pValue = (int)( bNegative ? -nValue : nValue );
+	return p;
+}
+
+
+//-----------------------------------------------------------------------------
+// Eats whitespaces and c++ style comments
+//-----------------------------------------------------------------------------
+void CDmSerializerKeyValues2::EatWhitespacesAndComments( CUtlBuffer &buf )
+{
+	// NOTE: UnserializeElements guarantees the whole text is resident
+	int nMaxPut = buf.TellMaxPut() - buf.TellGet();
+	if ( nMaxPut <= 0 )
+		return;
+
+	const char *pStart = (const char *)buf.PeekGet();
+	const char *pEnd = pStart + nMaxPut;
+	const char *pText = pStart;
+
+	// eating white spaces and remarks loop
+	int nNewLines = 0;
+	while ( pText < pEnd )
+	{
+		// Eat whitespaces, keep track of line count
+		pText = SkipWhitespace( pText, pEnd, &nNewLines );
+
+		// If we don't have a a c++ style comment next, we're done
+		if ( ( pEnd - pText < 2 ) || ( pText[0] != '/' ) || ( pText[1] != '/' ) )
+			break;
+
+		// Deal with c++ style comments; read complete line
+		const char *pNewLine = (const char *)memchr( pText + 2, '\n', pEnd - pText - 2 );
+		pText = pNewLine ? pNewLine : pEnd;
+		++nNewLines;
+	}
+
+	g_KeyValues2ErrorStack.SetCurrentLine( g_KeyValues2ErrorStack.GetCurrentLine() + nNewLines );
+	buf.SeekGet( CUtlBuffer::SEEK_CURRENT, pText - pStart );
 }
 
-#pragma warning (default:4706)
 
 //-----------------------------------------------------------------------------
 // Reads a single token, points the token utlbuffer at it
+// NOTE: The token is a read-only view into the source buffer, not a copy, 
+// and is only valid until the next call to ReadToken with the same token buffer
 //-----------------------------------------------------------------------------
 CDmSerializerKeyValues2::TokenType_t CDmSerializerKeyValues2::ReadToken( CUtlBuffer &buf, CUtlBuffer &token )
 {
@@ -593,11 +861,13 @@ CDmSerializerKeyValues2::TokenType_t CDmSerializerKeyValues2::ReadToken( CUtlBuf
 	if ( !buf.IsValid() || ( buf.TellGet() == buf.TellMaxPut() ) )
 		return TOKEN_EOF;
 
+	const char *pStart = (const char *)buf.PeekGet();
+	const char *pEnd = pStart + ( buf.TellMaxPut() - buf.TellGet() );
+
 	// Compute token length and type
 	int nLength = 0;
 	TokenType_t t = TOKEN_INVALID;
-	char c = *((const char *)buf.PeekGet());
-	switch( c )
+	switch( *pStart )
 	{
 	case '{':
 		nLength = 1;
@@ -625,16 +895,25 @@ CDmSerializerKeyValues2::TokenType_t CDmSerializerKeyValues2::ReadToken( CUtlBuf
 		break;
 
 	case '\"':
-		// NOTE: The -1 is because peek includes room for the /0
-		nLength = buf.PeekDelimitedStringLength( GetCStringCharConversion(), false ) - 1;
-		if ( (nLength <= 1) || ( *(const char *)buf.PeekGet( nLength - 1 ) != '\"' ))
-		{
-			g_KeyValues2ErrorStack.ReportError( "Unexpected EOF in quoted string" );
-			t = TOKEN_INVALID;
-		}
-		else
 		{
-			t = TOKEN_DELIMITED_STRING;
+			// Escape sequences are always two characters, so we can skip straight past them
+			const char *pText = pStart + 1;
+			while ( ( pText = FindQuoteOrEscape( pText, pEnd ) ) < pEnd && *pText == '\\' )
+			{
+				pText = min( pText + 2, pEnd );
+			}
+
+			if ( pText == pEnd )
+			{
+				nLength = pEnd - pStart;
+				g_KeyValues2ErrorStack.ReportError( "Unexpected EOF in quoted string" );
+				t = TOKEN_INVALID;
+			}
+			else
+			{
+				nLength = pText - pStart + 1;
+				t = TOKEN_DELIMITED_STRING;
+			}
 		}
 		break;
 
@@ -643,19 +922,14 @@ CDmSerializerKeyValues2::TokenType_t CDmSerializerKeyValues2::ReadToken( CUtlBuf
 		break;
 	}
 
-	token.EnsureCapacity( nLength );
-	buf.Get( token.Base(), nLength );
-	token.SeekGet( CUtlBuffer::SEEK_HEAD, 0 );
-	token.SeekPut( CUtlBuffer::SEEK_HEAD, nLength );
+	token.SetExternalBuffer( const_cast<char*>( pStart ), nLength, nLength, CUtlBuffer::TEXT_BUFFER | CUtlBuffer::READ_ONLY );
+	buf.SeekGet( CUtlBuffer::SEEK_CURRENT, nLength );
 
 	// Count the number of crs in the token + update the current line
-	const char *pMem = (const char *)token.Base();
-	for ( int i = 0; i < nLength; ++i )
+	int nNewLines = CountNewLines( pStart, pStart + nLength );
+	if ( nNewLines )
 	{
-		if ( pMem[i] == '\n' )
-		{
-			g_KeyValues2ErrorStack.IncrementCurrentLine();
-		}
+		g_KeyValues2ErrorStack.SetCurrentLine( g_KeyValues2ErrorStack.GetCurrentLine() + nNewLines );
 	}
 
 	return t;
@@ -860,6 +1134,87 @@ bool CDmSerializerKeyValues2::UnserializeAttributeValueFromToken( CDmAttribute *
 }
 
 
+//-----------------------------------------------------------------------------
+// Reads a numeric array attribute; values are parsed straight out of the
+// token views and handed to the attribute in a single bulk update
+//-----------------------------------------------------------------------------
+template< class T, class C >
+bool CDmSerializerKeyValues2::UnserializeNumericArrayAttribute( CUtlBuffer &buf, CDmAttribute *pAttribute, const char *pAttributeName )
+{
+	const int nComponents = sizeof( T ) / sizeof( C );
+
+	// Arrays first must have a '[' specified
+	TokenType_t token;
+	CUtlBuffer tokenBuf( 0, 0, CUtlBuffer::TEXT_BUFFER );
+	token = ReadToken( buf, tokenBuf );
+	if ( token != TOKEN_OPEN_BRACKET )
+	{
+		g_KeyValues2ErrorStack.ReportError( "Expecting '[', didn't find it!" );
+		return false;
+	}
+
+	CUtlVector< T > values;
+	int nElementIndex = 0;
+
+	// Now read a list of array values, separated by commas
+	while ( buf.IsValid() )
+	{
+		token = ReadToken( buf, tokenBuf );
+		if ( token == TOKEN_INVALID || token == TOKEN_EOF )
+		{
+			g_KeyValues2ErrorStack.ReportError( "Expecting ']', didn't find it!" );
+			return false;
+		}
+
+		// Then, keep reading until we hit a ']'
+		if ( token == TOKEN_CLOSE_BRACKET )
+			break;
+
+		// If we've already read in an array value, we need to read a comma next
+		if ( nElementIndex > 0 )
+		{
+			if ( token != TOKEN_COMMA )
+			{
+				g_KeyValues2ErrorStack.ReportError( "Expecting ',', didn't find it!" );
+				return false;
+			}
+
+			// Read in the next thing, which should be a value
+			token = ReadToken( buf, tokenBuf );
+		}
+
+		// Ok, we must be reading an attributearray value
+		if ( token != TOKEN_DELIMITED_STRING )
+		{
+			g_KeyValues2ErrorStack.ReportError( "Expecting array attribute value, didn't find it!" );
+			return false;
+		}
+
+		// Parse the components between the quotes
+		const char *pText = (const char *)tokenBuf.Base() + 1;
+		const char *pEnd = (const char *)tokenBuf.Base() + tokenBuf.TellMaxPut() - 1;
+		C *pComponents = reinterpret_cast< C* >( &values[ values.AddToTail() ] );
+		for ( int i = 0; i < nComponents; ++i )
+		{
+			pText = ParseNumber( pText, pEnd, &pComponents[i] );
+			if ( !pText )
+			{
+				g_KeyValues2ErrorStack.ReportError("Error reading in array attribute \"%s\" element %d", pAttributeName, nElementIndex );
+				return false;
+			}
+		}
+
+		// Ok, we've read in another value
+		++nElementIndex;
+	}
+
+	CDmrArray< T > array( pAttribute );
+	int nFirst = array.AddMultipleToTail( values.Count() );
+	array.SetMultiple( nFirst, values.Count(), values.Base() );
+	return true;
+}
+
+
 //-----------------------------------------------------------------------------
 // Reads an attribute for an element array
 //-----------------------------------------------------------------------------
@@ -874,6 +1229,24 @@ bool CDmSerializerKeyValues2::UnserializeArrayAttribute( CUtlBuffer &buf, DmElem
 		return false;
 	}
 
+	switch( nAttrType )
+	{
+	case AT_INT_ARRAY:
+		return UnserializeNumericArrayAttribute< int, int >( buf, pAttribute, pAttributeName );
+	case AT_FLOAT_ARRAY:
+		return UnserializeNumericArrayAttribute< float, float >( buf, pAttribute, pAttributeName );
+	case AT_VECTOR2_ARRAY:
+		return UnserializeNumericArrayAttribute< Vector2D, float >( buf, pAttribute, pAttributeName );
+	case AT_VECTOR3_ARRAY:
+		return UnserializeNumericArrayAttribute< Vector, float >( buf, pAttribute, pAttributeName );
+	case AT_VECTOR4_ARRAY:
+		return UnserializeNumericArrayAttribute< Vector4D, float >( buf, pAttribute, pAttributeName );
+	case AT_QANGLE_ARRAY:
+		return UnserializeNumericArrayAttribute< QAngle, float >( buf, pAttribute, pAttributeName );
+	case AT_QUATERNION_ARRAY:
+		return UnserializeNumericArrayAttribute< Quaternion, float >( buf, pAttribute, pAttributeName );
+	}
+
 	// Arrays first must have a '[' specified
 	TokenType_t token;
 	CUtlBuffer tokenBuf( 0, 0, CUtlBuffer::TEXT_BUFFER );
@@ -1338,11 +1711,25 @@ bool CDmSerializerKeyValues2::UnserializeElements( CUtlBuffer &buf, DmFileId_t f
 	m_hRoot = ELEMENT_DICT_HANDLE_INVALID;
 	m_ElementDict.Clear();
 
+	// The tokenizer hands out views straight into the text, so all of it must be resident.
+	// Stream buffers will normally load the rest of the file on the peek; copy it if they can't
+	int nTextSize = buf.TellMaxPut() - buf.TellGet();
+	const void *pText = ( nTextSize > 0 ) ? buf.PeekGet( nTextSize, 0 ) : NULL;
+	CUtlBuffer residentBuf;
+	bool bCopiedText = ( nTextSize > 0 && !pText );
+	if ( bCopiedText )
+	{
+		residentBuf.EnsureCapacity( nTextSize );
+		buf.Get( residentBuf.Base(), nTextSize );
+		pText = residentBuf.Base();
+	}
+	CUtlBuffer textBuf( pText, max( nTextSize, 0 ), CUtlBuffer::TEXT_BUFFER | CUtlBuffer::READ_ONLY );
+
 	bool bOk = true;
-	while ( buf.IsValid() )
+	while ( textBuf.IsValid() )
 	{
 		DmElementDictHandle_t h;
-		bOk = UnserializeElement( buf, &h );
+		bOk = UnserializeElement( textBuf, &h );
 		if ( !bOk || ( h == ELEMENT_DICT_HANDLE_INVALID ) )
 			break;
 
@@ -1352,6 +1739,12 @@ bool CDmSerializerKeyValues2::UnserializeElements( CUtlBuffer &buf, DmFileId_t f
 		}
 	}
 
+	// Leave the source buffer where parsing stopped
+	if ( !bCopiedText )
+	{
+		buf.SeekGet( CUtlBuffer::SEEK_CURRENT, textBuf.TellGet() );
+	}
+
 	// do this *before* getting the root, since the first element might be deleted due to id conflicts
 	m_ElementDict.HookUpElementReferences();
 
@@ -8,6 +8,7 @@
 #include <ctype.h>
 #include "tier1/utlbuffer.h"
 #include "tier1/utlbufferutil.h"
+#include "tier1/generichash.h"
 #include <limits.h>
 #include "dmxserializationdictionary.h"
 
@@ -284,9 +285,24 @@ private:
 	void HookUpElementAttributes();
 	void HookUpElementArrayAttributes();
 
+	// Maintains the lookup tables
+	DmxElementDictHandle_t &FindSlot( CDmxElement *pElement );
+	DmxElementDictHandle_t &FindSlot( const DmObjectId_t &objectId );
+	void HashElement( DmxElementDictHandle_t hElement );
+	void HashElementId( DmxElementDictHandle_t hElement );
+	void RehashElements();
+	void RehashElementIds();
+
 	CUtlVector< DictInfo_t > m_Dict;
 	AttributeList_t m_Attributes;
 	AttributeList_t m_ArrayAttributes;
+
+	// Open-addressed tables of handles into m_Dict, keyed by element pointer and by element id.
+	// Their sizes are powers of two and they are kept at most half full. Where several
+	// elements share an id, the lowest handle is kept, as a search of m_Dict would find.
+	CUtlVector< DmxElementDictHandle_t > m_ElementHash;
+	CUtlVector< DmxElementDictHandle_t > m_IdHash;
+	int m_nIdHashCount;
 };
 
 
@@ -295,6 +311,7 @@ private:
 //-----------------------------------------------------------------------------
 CDmxElementDictionary::CDmxElementDictionary()
 {
+	m_nIdHashCount = 0;
 }
 
 
@@ -306,6 +323,153 @@ void CDmxElementDictionary::Clear()
 	m_Dict.Purge();
 	m_Attributes.Purge();
 	m_ArrayAttributes.Purge();
+	m_ElementHash.Purge();
+	m_IdHash.Purge();
+	m_nIdHashCount = 0;
+}
+
+
+//-----------------------------------------------------------------------------
+// Returns the size of a lookup table holding at least nCount entries
+//-----------------------------------------------------------------------------
+static int ComputeHashSize( int nCount )
+{
+	int nSize = 256;
+	while ( nSize < 2 * nCount )
+	{
+		nSize <<= 1;
+	}
+	return nSize;
+}
+
+
+//-----------------------------------------------------------------------------
+// Returns the slot holding the element, or the empty slot where it belongs
+//-----------------------------------------------------------------------------
+DmxElementDictHandle_t &CDmxElementDictionary::FindSlot( CDmxElement *pElement )
+{
+	int nMask = m_ElementHash.Count() - 1;
+	for ( int i = HashItem( pElement ) & nMask; ; i = ( i + 1 ) & nMask )
+	{
+		DmxElementDictHandle_t &h = m_ElementHash[i];
+		if ( h == ELEMENT_DICT_HANDLE_INVALID || m_Dict[h].m_pElement == pElement )
+			return h;
+	}
+}
+
+
+//-----------------------------------------------------------------------------
+// Returns the slot holding the id, or the empty slot where it belongs
+//-----------------------------------------------------------------------------
+DmxElementDictHandle_t &CDmxElementDictionary::FindSlot( const DmObjectId_t &objectId )
+{
+	int nMask = m_IdHash.Count() - 1;
+	for ( int i = HashItem( objectId ) & nMask; ; i = ( i + 1 ) & nMask )
+	{
+		DmxElementDictHandle_t &h = m_IdHash[i];
+		if ( h == ELEMENT_DICT_HANDLE_INVALID || IsUniqueIdEqual( objectId, m_Dict[h].m_Id ) )
+			return h;
+	}
+}
+
+
+//-----------------------------------------------------------------------------
+// Adds an element to the pointer lookup table
+//-----------------------------------------------------------------------------
+void CDmxElementDictionary::HashElement( DmxElementDictHandle_t hElement )
+{
+	if ( 2 * m_Dict.Count() > m_ElementHash.Count() )
+	{
+		// Rehashing picks up the new element too
+		RehashElements();
+		return;
+	}
+
+	DmxElementDictHandle_t &h = FindSlot( m_Dict[hElement].m_pElement );
+	if ( h == ELEMENT_DICT_HANDLE_INVALID || hElement < h )
+	{
+		h = hElement;
+	}
+}
+
+
+//-----------------------------------------------------------------------------
+// Adds an element to the id lookup table
+//-----------------------------------------------------------------------------
+void CDmxElementDictionary::HashElementId( DmxElementDictHandle_t hElement )
+{
+	if ( 2 * ( m_nIdHashCount + 1 ) > m_IdHash.Count() )
+	{
+		// Rehashing picks up the new id too
+		RehashElementIds();
+		return;
+	}
+
+	DmxElementDictHandle_t &h = FindSlot( m_Dict[hElement].m_Id );
+	if ( h == ELEMENT_DICT_HANDLE_INVALID )
+	{
+		h = hElement;
+		++m_nIdHashCount;
+	}
+	else if ( hElement < h )
+	{
+		h = hElement;
+	}
+}
+
+
+//-----------------------------------------------------------------------------
+// Rebuilds the pointer lookup table from the dictionary
+//-----------------------------------------------------------------------------
+void CDmxElementDictionary::RehashElements()
+{
+	int nCount = m_Dict.Count();
+	int nSize = ComputeHashSize( nCount );
+	m_ElementHash.SetCount( nSize );
+	for ( int i = 0; i < nSize; ++i )
+	{
+		m_ElementHash[i] = ELEMENT_DICT_HANDLE_INVALID;
+	}
+
+	// Walking the handles in order keeps the lowest handle for each element
+	for ( int i = 0; i < nCount; ++i )
+	{
+		DmxElementDictHandle_t &h = FindSlot( m_Dict[i].m_pElement );
+		if ( h == ELEMENT_DICT_HANDLE_INVALID )
+		{
+			h = i;
+		}
+	}
+}
+
+
+//-----------------------------------------------------------------------------
+// Rebuilds the id lookup table from the dictionary
+//-----------------------------------------------------------------------------
+void CDmxElementDictionary::RehashElementIds()
+{
+	int nCount = m_Dict.Count();
+	int nSize = ComputeHashSize( nCount );
+	m_IdHash.SetCount( nSize );
+	for ( int i = 0; i < nSize; ++i )
+	{
+		m_IdHash[i] = ELEMENT_DICT_HANDLE_INVALID;
+	}
+
+	// Walking the handles in order keeps the lowest handle for each id
+	m_nIdHashCount = 0;
+	for ( int i = 0; i < nCount; ++i )
+	{
+		if ( !IsUniqueIdValid( m_Dict[i].m_Id ) )
+			continue;
+
+		DmxElementDictHandle_t &h = FindSlot( m_Dict[i].m_Id );
+		if ( h == ELEMENT_DICT_HANDLE_INVALID )
+		{
+			h = i;
+			++m_nIdHashCount;
+		}
+	}
 }
 
 
@@ -318,6 +482,7 @@ DmxElementDictHandle_t CDmxElementDictionary::InsertElement( CDmxElement *pEleme
 	DmxElementDictHandle_t h = m_Dict.AddToTail( );
 	m_Dict[h].m_pElement = pElement;
 	InvalidateUniqueId( &m_Dict[h].m_Id );
+	HashElement( h );
 	return h;
 }
 
@@ -328,7 +493,19 @@ DmxElementDictHandle_t CDmxElementDictionary::InsertElement( CDmxElement *pEleme
 void CDmxElementDictionary::SetElementId( DmxElementDictHandle_t hElement, const DmObjectId_t &objectId )
 {
 	Assert( hElement != ELEMENT_DICT_HANDLE_INVALID );
+
+	bool bHadId = IsUniqueIdValid( m_Dict[hElement].m_Id );
 	CopyUniqueId( objectId, &m_Dict[hElement].m_Id );
+
+	if ( bHadId )
+	{
+		// The old id may still be in the table; start over
+		RehashElementIds();
+	}
+	else if ( IsUniqueIdValid( objectId ) )
+	{
+		HashElementId( hElement );
+	}
 }
 
 
@@ -381,13 +558,10 @@ void CDmxElementDictionary::AddArrayAttribute( CDmxAttribute *pAttribute, const
 //-----------------------------------------------------------------------------
 DmxElementDictHandle_t CDmxElementDictionary::FindElement( CDmxElement *pElement )
 {
-	int nCount = m_Dict.Count();
-	for ( int i = 0; i < nCount; ++i )
-	{
-		if ( pElement == m_Dict[i].m_pElement )
-			return i;
-	}
-	return ELEMENT_DICT_HANDLE_INVALID;
+	if ( m_ElementHash.Count() == 0 )
+		return ELEMENT_DICT_HANDLE_INVALID;
+
+	return FindSlot( pElement );
 }
 
 
@@ -396,13 +570,10 @@ DmxElementDictHandle_t CDmxElementDictionary::FindElement( CDmxElement *pElement
 //-----------------------------------------------------------------------------
 DmxElementDictHandle_t CDmxElementDictionary::FindElement( const DmObjectId_t &objectId )
 {
-	int nCount = m_Dict.Count();
-	for ( int i = 0; i < nCount; ++i )
-	{
-		if ( IsUniqueIdEqual( objectId, m_Dict[i].m_Id ) )
-			return i;
-	}
-	return ELEMENT_DICT_HANDLE_INVALID;
+	if ( m_IdHash.Count() == 0 )
+		return ELEMENT_DICT_HANDLE_INVALID;
+
+	return FindSlot( objectId );
 }
 
 
@@ -433,6 +604,17 @@ void CDmxElementDictionary::HookUpElementArrayAttributes()
 	{
 		CUtlVector< CDmxElement* > &array = m_ArrayAttributes[i].m_pAttribute->GetArrayForEdit<CDmxElement*>();
 
+		// The entries for an array are added together while it is read, so make room for them all at once
+		if ( i == 0 || m_ArrayAttributes[i].m_pAttribute != m_ArrayAttributes[i-1].m_pAttribute )
+		{
+			int nEnd = i + 1;
+			while ( nEnd < n && m_ArrayAttributes[nEnd].m_pAttribute == m_ArrayAttributes[i].m_pAttribute )
+			{
+				++nEnd;
+			}
+			array.EnsureCapacity( array.Count() + nEnd - i );
+		}
+
 		if ( m_ArrayAttributes[i].m_nType == AT_ELEMENT )
 		{
 			CDmxElement *pElement = GetElement( m_ArrayAttributes[i].m_hElement );
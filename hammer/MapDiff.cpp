@@ -0,0 +1,1090 @@
+//========= Copyright  1996-2005, Valve Corporation, All rights reserved. ============//
+//
+// Purpose: Structural comparison of two maps. See MapDiff.h.
+//
+// $NoKeywords: $
+//=============================================================================//
+
+#include "stdafx.h"
+#include "ChunkFile.h"
+#include "fgdlib/GameData.h"
+#include "GameConfig.h"
+#include "MapDiff.h"
+#include "MapDisp.h"
+#include "MapEntity.h"
+#include "MapFace.h"
+#include "MapGroup.h"
+#include "MapSolid.h"
+#include "MapWorld.h"
+
+// memdbgon must be the last include file in a .cpp file!!!
+#include <tier0/memdbgon.h>
+
+
+//
+// Number of buckets in the ID and hash indices. Must be a power of two. Object
+// IDs are allocated sequentially, so they spread evenly over the buckets.
+//
+#define MAPDIFF_INDEX_BUCKETS	16384
+
+
+//
+// Chunks whose keys are part of the content of the object that contains them.
+// Chunks that aren't listed, such as displacement triangle tags or overlay
+// helpers, are derived from other data and are skipped.
+//
+static const char *g_pszContentChunks[] =
+{
+	"side",
+	"dispinfo",
+	"normals",
+	"distances",
+	"offsets",
+	"offset_normals",
+	"alphas",
+	"connections",
+};
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Adds a string to a hash in a canonical form: brackets and runs of
+//			whitespace become a single space, letters are lowercased, and
+//			numbers are reduced to float precision and printed with %g. Commas
+//			are kept since they separate the fields of entity connections.
+//-----------------------------------------------------------------------------
+static void HashCanonical(CRC32_t *pHash, const char *pszString)
+{
+	bool bSpace = false;
+
+	while (*pszString != '\0')
+	{
+		char ch = *pszString;
+		if ((ch == ' ') || (ch == '\t') || (ch == '(') || (ch == ')') || (ch == '[') || (ch == ']'))
+		{
+			pszString++;
+			continue;
+		}
+
+		if (ch == ',')
+		{
+			CRC32_ProcessBuffer(pHash, ",", 1);
+			bSpace = false;
+			pszString++;
+			continue;
+		}
+
+		if (bSpace)
+		{
+			CRC32_ProcessBuffer(pHash, " ", 1);
+		}
+
+		int nLen = (int)strcspn(pszString, " \t()[],");
+
+		char *pszEnd;
+		double flValue = strtod(pszString, &pszEnd);
+		if (pszEnd == pszString + nLen)
+		{
+			char szNumber[32];
+			Q_snprintf(szNumber, sizeof(szNumber), "%g", (double)(float)flValue);
+			CRC32_ProcessBuffer(pHash, szNumber, (int)strlen(szNumber));
+		}
+		else
+		{
+			for (int i = 0; i < nLen; i++)
+			{
+				char chLower = (char)tolower((unsigned char)pszString[i]);
+				CRC32_ProcessBuffer(pHash, &chLower, 1);
+			}
+		}
+
+		pszString += nLen;
+		bSpace = true;
+	}
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Orders hashes for sorting.
+//-----------------------------------------------------------------------------
+static int __cdecl CompareHashes(const void *pHash1, const void *pHash2)
+{
+	CRC32_t nHash1 = *(const CRC32_t *)pHash1;
+	CRC32_t nHash2 = *(const CRC32_t *)pHash2;
+
+	if (nHash1 < nHash2)
+	{
+		return -1;
+	}
+
+	return (nHash1 > nHash2) ? 1 : 0;
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Constructor. Opens the chunk of the object itself.
+//-----------------------------------------------------------------------------
+CMapDiffHash::CMapDiffHash(void)
+{
+	BeginChunk();
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Adds a key/value pair to the innermost open chunk.
+//-----------------------------------------------------------------------------
+void CMapDiffHash::AddKeyValue(const char *pszKey, const char *pszValue)
+{
+	CRC32_t nHash;
+	CRC32_Init(&nHash);
+	HashCanonical(&nHash, pszKey);
+	CRC32_ProcessBuffer(&nHash, "=", 1);
+	HashCanonical(&nHash, pszValue);
+	CRC32_Final(&nHash);
+
+	m_Hashes.AddToTail(nHash);
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Opens a chunk nested in the innermost open chunk.
+//-----------------------------------------------------------------------------
+void CMapDiffHash::BeginChunk(void)
+{
+	m_ChunkStart.AddToTail(m_Hashes.Count());
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Closes the innermost open chunk, replacing the hashes of its keys
+//			and chunks with a single hash of the chunk's name and their sorted
+//			values.
+//-----------------------------------------------------------------------------
+void CMapDiffHash::EndChunk(const char *pszName)
+{
+	int nStart = m_ChunkStart.Tail();
+	int nCount = m_Hashes.Count() - nStart;
+	m_ChunkStart.RemoveMultiple(m_ChunkStart.Count() - 1, 1);
+
+	if (nCount > 1)
+	{
+		qsort(m_Hashes.Base() + nStart, nCount, sizeof(CRC32_t), CompareHashes);
+	}
+
+	CRC32_t nHash;
+	CRC32_Init(&nHash);
+	HashCanonical(&nHash, pszName);
+	CRC32_ProcessBuffer(&nHash, "{", 1);
+	if (nCount > 0)
+	{
+		CRC32_ProcessBuffer(&nHash, m_Hashes.Base() + nStart, nCount * (int)sizeof(CRC32_t));
+	}
+	CRC32_Final(&nHash);
+
+	m_Hashes.RemoveMultiple(nStart, nCount);
+	m_Hashes.AddToTail(nHash);
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Closes the object's chunk and returns its hash.
+//-----------------------------------------------------------------------------
+CRC32_t CMapDiffHash::Finish(void)
+{
+	Assert(m_ChunkStart.Count() == 1);
+	EndChunk("");
+	return m_Hashes.Tail();
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Constructor.
+//-----------------------------------------------------------------------------
+CMapDiffSnapshot::CMapDiffSnapshot(void) :
+	m_IDIndex(MAPDIFF_INDEX_BUCKETS, 0, 0, HashEntry_t::Compare, HashEntry_t::HashKey),
+	m_HashIndex(MAPDIFF_INDEX_BUCKETS, 0, 0, HashEntry_t::Compare, HashEntry_t::HashKey)
+{
+	m_nCurrentObject = -1;
+	m_pCurrentHash = NULL;
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Frees all objects and indices.
+//-----------------------------------------------------------------------------
+void CMapDiffSnapshot::Purge(void)
+{
+	m_Objects.Purge();
+	m_IDIndex.Purge();
+	m_HashIndex.Purge();
+	m_Enclosing.Purge();
+	m_GroupIDs.Purge();
+	m_nCurrentObject = -1;
+	m_pCurrentHash = NULL;
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Adds an object with no content yet.
+// Output : Returns the index of the new object.
+//-----------------------------------------------------------------------------
+int CMapDiffSnapshot::AddObject(int nID, int nParentID)
+{
+	int nIndex = m_Objects.AddToTail();
+
+	MapDiffObject_t &Object = m_Objects[nIndex];
+	Object.m_nID = nID;
+	Object.m_nParentID = nParentID;
+	Object.m_nOwnHash = 0;
+	Object.m_nHash = 0;
+	Object.m_nMatch = -1;
+	Object.m_eResult = MAPDIFF_UNCHANGED;
+	Object.m_nNextSameHash = -1;
+
+	return nIndex;
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Reads the solids, entities, and groups from a world in memory,
+//			hashing the same content that saving them to a VMF file would write.
+//-----------------------------------------------------------------------------
+void CMapDiffSnapshot::LoadWorld(CMapWorld *pWorld)
+{
+	Purge();
+	pWorld->EnumChildrenRecurseGroupsOnly((ENUMMAPCHILDRENPROC)LoadWorldCallback, (DWORD)this);
+	FinishLoad();
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Reads an object of the world. Entities are read along with the
+//			solids they contain, as they are saved.
+//-----------------------------------------------------------------------------
+BOOL CMapDiffSnapshot::LoadWorldCallback(CMapClass *pObject, CMapDiffSnapshot *pSnapshot)
+{
+	CMapEntity *pEntity = dynamic_cast<CMapEntity *>(pObject);
+	if (pEntity != NULL)
+	{
+		// Solid entities without solids aren't saved.
+		if (!pEntity->IsPlaceholder() && (pEntity->GetChildCount() == 0))
+		{
+			return(TRUE);
+		}
+
+		pSnapshot->LoadObject(pEntity);
+
+		EnumChildrenPos_t pos;
+		CMapClass *pChild = pEntity->GetFirstDescendent(pos);
+		while (pChild != NULL)
+		{
+			if (pChild->ShouldSerialize() && (dynamic_cast<CMapSolid *>(pChild) != NULL))
+			{
+				pSnapshot->LoadObject(pChild);
+			}
+
+			pChild = pEntity->GetNextDescendent(pos);
+		}
+	}
+	else if ((dynamic_cast<CMapSolid *>(pObject) != NULL) || (dynamic_cast<CMapGroup *>(pObject) != NULL))
+	{
+		pSnapshot->LoadObject(pObject);
+	}
+
+	return(TRUE);
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Adds a solid, entity, or group from memory.
+//-----------------------------------------------------------------------------
+void CMapDiffSnapshot::LoadObject(CMapClass *pObject)
+{
+	CMapClass *pParent = pObject->GetParent();
+	int nParentID = 0;
+	if ((dynamic_cast<CMapGroup *>(pParent) != NULL) || (dynamic_cast<CMapEntity *>(pParent) != NULL))
+	{
+		nParentID = pParent->GetID();
+	}
+
+	int nIndex = AddObject(pObject->GetID(), nParentID);
+
+	CMapDiffHash Hash;
+
+	CMapEntity *pEntity = dynamic_cast<CMapEntity *>(pObject);
+	if (pEntity != NULL)
+	{
+		HashEntity(pEntity, Hash);
+	}
+
+	CMapSolid *pSolid = dynamic_cast<CMapSolid *>(pObject);
+	if (pSolid != NULL)
+	{
+		HashSolid(pSolid, Hash);
+	}
+
+	m_Objects[nIndex].m_nOwnHash = Hash.Finish();
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Hashes an entity's keys and connections, including the keys that
+//			CEditGameClass::SaveVMF and CMapEntity::SaveVMF add when saving.
+//-----------------------------------------------------------------------------
+void CMapDiffSnapshot::HashEntity(CMapEntity *pEntity, CMapDiffHash &Hash)
+{
+	Hash.AddKeyValue("classname", pEntity->GetClassName());
+
+	for (int i = pEntity->GetFirstKeyValue(); i != pEntity->GetInvalidKeyValue(); i = pEntity->GetNextKeyValue(i))
+	{
+		if (stricmp(pEntity->GetKey(i), "classname"))
+		{
+			Hash.AddKeyValue(pEntity->GetKey(i), pEntity->GetKeyValue(i));
+		}
+	}
+
+	//
+	// Keys missing from the object are saved with their nonzero defaults.
+	//
+	GDclass *pGameDataClass = NULL;
+	if (pGD != NULL)
+	{
+		pGameDataClass = g_pGameConfig->ClassForName(pEntity->GetClassName());
+	}
+
+	if (pGameDataClass != NULL)
+	{
+		int nVariableCount = pGameDataClass->GetVariableCount();
+		for (int i = 0; i < nVariableCount; i++)
+		{
+			GDinputvariable *pVar = pGameDataClass->GetVariableAt(i);
+			if ((pVar != NULL) && (pEntity->GetKeyValue(pVar->GetName()) == NULL))
+			{
+				MDkeyvalue TempKey;
+				pVar->ResetDefaults();
+				pVar->ToKeyValue(&TempKey);
+
+				if ((TempKey.szKey[0] != 0) && (TempKey.szValue[0] != 0) && (stricmp(TempKey.szValue, "0")))
+				{
+					Hash.AddKeyValue(TempKey.szKey, TempKey.szValue);
+				}
+			}
+		}
+	}
+
+	if (pEntity->IsPlaceholder() && (!pEntity->IsClass() || pEntity->GetClass()->VarForName("origin") == NULL))
+	{
+		Vector vecOrigin;
+		pEntity->GetOrigin(vecOrigin);
+
+		char szOrigin[80];
+		sprintf(szOrigin, "%g %g %g", (double)vecOrigin[0], (double)vecOrigin[1], (double)vecOrigin[2]);
+		Hash.AddKeyValue("origin", szOrigin);
+	}
+
+	int nConnCount = pEntity->Connections_GetCount();
+	if (nConnCount > 0)
+	{
+		Hash.BeginChunk();
+
+		for (int i = 0; i < nConnCount; i++)
+		{
+			CEntityConnection *pConnection = pEntity->Connections_Get(i);
+			if (pConnection != NULL)
+			{
+				char szTemp[512];
+				sprintf(szTemp, "%s,%s,%s,%g,%d", pConnection->GetTargetName(), pConnection->GetInputName(), pConnection->GetParam(), pConnection->GetDelay(), pConnection->GetTimesToFire());
+				Hash.AddKeyValue(pConnection->GetOutputName(), szTemp);
+			}
+		}
+
+		Hash.EndChunk("connections");
+	}
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Hashes a solid's faces as CMapFace::SaveVMF writes them.
+//-----------------------------------------------------------------------------
+void CMapDiffSnapshot::HashSolid(CMapSolid *pSolid, CMapDiffHash &Hash)
+{
+	char szBuf[512];
+
+	int nFaceCount = pSolid->GetFaceCount();
+	for (int nFace = 0; nFace < nFaceCount; nFace++)
+	{
+		CMapFace *pFace = pSolid->GetFace(nFace);
+		Hash.BeginChunk();
+
+		const PLANE &plane = pFace->plane;
+		sprintf(szBuf, "(%g %g %g) (%g %g %g) (%g %g %g)",
+				(double)plane.planepts[0][0], (double)plane.planepts[0][1], (double)plane.planepts[0][2],
+				(double)plane.planepts[1][0], (double)plane.planepts[1][1], (double)plane.planepts[1][2],
+				(double)plane.planepts[2][0], (double)plane.planepts[2][1], (double)plane.planepts[2][2]);
+		Hash.AddKeyValue("plane", szBuf);
+
+		const TEXTURE &texture = pFace->texture;
+		Hash.AddKeyValue("material", texture.texture);
+
+		sprintf(szBuf, "[%g %g %g %g] %g", (double)texture.UAxis[0], (double)texture.UAxis[1], (double)texture.UAxis[2], (double)texture.UAxis[3], (double)texture.scale[0]);
+		Hash.AddKeyValue("uaxis", szBuf);
+
+		sprintf(szBuf, "[%g %g %g %g] %g", (double)texture.VAxis[0], (double)texture.VAxis[1], (double)texture.VAxis[2], (double)texture.VAxis[3], (double)texture.scale[1]);
+		Hash.AddKeyValue("vaxis", szBuf);
+
+		sprintf(szBuf, "%g", (double)texture.rotate);
+		Hash.AddKeyValue("rotation", szBuf);
+
+		sprintf(szBuf, "%d", texture.nLightmapScale);
+		Hash.AddKeyValue("lightmapscale", szBuf);
+
+		sprintf(szBuf, "%d", (int)pFace->GetSmoothingGroups());
+		Hash.AddKeyValue("smoothing_groups", szBuf);
+
+		if (pFace->HasDisp())
+		{
+			HashDisp(EditDispMgr()->GetDisp(pFace->GetDisp()), Hash);
+		}
+
+		Hash.EndChunk("side");
+	}
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Hashes a displacement as CMapDisp::SaveVMF writes it, leaving out
+//			the triangle tags and allowed vertices, which are derived data.
+//-----------------------------------------------------------------------------
+void CMapDiffSnapshot::HashDisp(CMapDisp *pDisp, CMapDiffHash &Hash)
+{
+	char szBuf[MAX_KEYVALUE_LEN];
+	char szTemp[80];
+	char szKey[10];
+
+	Hash.BeginChunk();
+
+	int power = pDisp->GetPower();
+	sprintf(szBuf, "%d", power);
+	Hash.AddKeyValue("power", szBuf);
+
+	Vector vecStart;
+	pDisp->GetCoreDispInfo()->GetSurface()->GetPoint(0, vecStart);
+	sprintf(szBuf, "%g %g %g", (double)vecStart[0], (double)vecStart[1], (double)vecStart[2]);
+	Hash.AddKeyValue("startposition", szBuf);
+
+	sprintf(szBuf, "%d", pDisp->GetFlags());
+	Hash.AddKeyValue("flags", szBuf);
+
+	sprintf(szBuf, "%g", (double)pDisp->GetElevation());
+	Hash.AddKeyValue("elevation", szBuf);
+
+	sprintf(szBuf, "%d", (int)pDisp->IsSubdivided());
+	Hash.AddKeyValue("subdiv", szBuf);
+
+	//
+	// Per vertex data, one key per row like the file has.
+	//
+	enum { DISP_NORMALS, DISP_DISTANCES, DISP_OFFSETS, DISP_OFFSET_NORMALS, DISP_ALPHAS, DISP_ROW_CHUNKS };
+	static const char *pszRowChunks[DISP_ROW_CHUNKS] = { "normals", "distances", "offsets", "offset_normals", "alphas" };
+
+	int nRows = (1 << power) + 1;
+	int nCols = nRows;
+
+	for (int nChunk = 0; nChunk < DISP_ROW_CHUNKS; nChunk++)
+	{
+		Hash.BeginChunk();
+
+		for (int nRow = 0; nRow < nRows; nRow++)
+		{
+			szBuf[0] = '\0';
+
+			for (int nCol = 0; nCol < nCols; nCol++)
+			{
+				int nIndex = nRow * nCols + nCol;
+				Vector vec;
+
+				switch (nChunk)
+				{
+					case DISP_NORMALS:
+					{
+						pDisp->GetFieldVector(nIndex, vec);
+						sprintf(szTemp, " %g %g %g", (double)vec[0], (double)vec[1], (double)vec[2]);
+						break;
+					}
+
+					case DISP_DISTANCES:
+					{
+						sprintf(szTemp, " %g", (double)pDisp->GetFieldDistance(nIndex));
+						break;
+					}
+
+					case DISP_OFFSETS:
+					{
+						pDisp->GetSubdivPosition(nIndex, vec);
+						sprintf(szTemp, " %g %g %g", (double)vec[0], (double)vec[1], (double)vec[2]);
+						break;
+					}
+
+					case DISP_OFFSET_NORMALS:
+					{
+						pDisp->GetSubdivNormal(nIndex, vec);
+						sprintf(szTemp, " %g %g %g", (double)vec[0], (double)vec[1], (double)vec[2]);
+						break;
+					}
+
+					default:
+					{
+						sprintf(szTemp, " %g", (double)pDisp->GetAlpha(nIndex));
+						break;
+					}
+				}
+
+				Q_strncat(szBuf, szTemp, sizeof(szBuf), COPY_ALL_CHARACTERS);
+			}
+
+			sprintf(szKey, "row%d", nRow);
+			Hash.AddKeyValue(szKey, szBuf);
+		}
+
+		Hash.EndChunk(pszRowChunks[nChunk]);
+	}
+
+	Hash.EndChunk("dispinfo");
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Reads the solids, entities, and groups from a VMF file. Keys outside
+//			of those objects (world keys, visgroups, view settings, etc.) are
+//			ignored.
+// Input  : pszFileName - Full path of the file to read.
+// Output : Returns ChunkFile_Ok on success, an error code otherwise.
+//-----------------------------------------------------------------------------
+ChunkFileResult_t CMapDiffSnapshot::LoadVMF(const char *pszFileName)
+{
+	Purge();
+
+	CChunkFile File;
+	ChunkFileResult_t eResult = File.Open(pszFileName, ChunkFile_Read);
+
+	if (eResult == ChunkFile_Ok)
+	{
+		//
+		// The same handlers are used at every depth, since the chunk names
+		// don't collide between levels of the file.
+		//
+		CChunkHandlerMap Handlers;
+		Handlers.AddHandler("world", (ChunkHandler_t)LoadPassThroughCallback, this);
+		Handlers.AddHandler("hidden", (ChunkHandler_t)LoadPassThroughCallback, this);
+
+		Handlers.AddHandler("solid", (ChunkHandler_t)LoadObjectCallback, this);
+		Handlers.AddHandler("entity", (ChunkHandler_t)LoadObjectCallback, this);
+		Handlers.AddHandler("group", (ChunkHandler_t)LoadObjectCallback, this);
+
+		Handlers.AddHandler("editor", (ChunkHandler_t)LoadEditorCallback, this);
+
+		ContentChunk_t ContentChunks[ARRAYSIZE(g_pszContentChunks)];
+		for (int i = 0; i < ARRAYSIZE(g_pszContentChunks); i++)
+		{
+			ContentChunks[i].m_pSnapshot = this;
+			ContentChunks[i].m_pszName = g_pszContentChunks[i];
+			Handlers.AddHandler(g_pszContentChunks[i], (ChunkHandler_t)LoadContentCallback, &ContentChunks[i]);
+		}
+
+		File.PushHandlers(&Handlers);
+
+		while (eResult == ChunkFile_Ok)
+		{
+			eResult = File.ReadChunk();
+		}
+
+		if (eResult == ChunkFile_EOF)
+		{
+			eResult = ChunkFile_Ok;
+		}
+
+		File.PopHandlers();
+	}
+
+	if (eResult == ChunkFile_Ok)
+	{
+		//
+		// Grouped objects name their group in their editor chunk. Otherwise our
+		// parent is the entity whose chunk we were read from, if any.
+		//
+		for (int i = 0; i < m_Objects.Count(); i++)
+		{
+			if (m_GroupIDs[i] != 0)
+			{
+				m_Objects[i].m_nParentID = m_GroupIDs[i];
+			}
+			else if (m_Enclosing[i] != -1)
+			{
+				m_Objects[i].m_nParentID = m_Objects[m_Enclosing[i]].m_nID;
+			}
+		}
+
+		m_Enclosing.Purge();
+		m_GroupIDs.Purge();
+
+		FinishLoad();
+	}
+	else
+	{
+		Purge();
+	}
+
+	return(eResult);
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Builds the ID index, combines each object's hash with those of its
+//			descendents, and builds the hash index.
+//-----------------------------------------------------------------------------
+void CMapDiffSnapshot::FinishLoad(void)
+{
+	int nCount = m_Objects.Count();
+
+	for (int i = 0; i < nCount; i++)
+	{
+		// Keep the first object if the map has duplicate IDs.
+		if (FindByID(m_Objects[i].m_nID) == -1)
+		{
+			HashEntry_t Entry;
+			Entry.m_nKey = m_Objects[i].m_nID;
+			Entry.m_nIndex = i;
+			m_IDIndex.Insert(Entry);
+		}
+	}
+
+	//
+	// Resolve parents and find each object's depth in the tree. A file can
+	// have a cycle of group IDs, which is broken where it is found.
+	//
+	CUtlVector<int> Parents;
+	CUtlVector<int> Depths;
+	Parents.SetCount(nCount);
+	Depths.SetCount(nCount);
+
+	for (int i = 0; i < nCount; i++)
+	{
+		int nParentID = m_Objects[i].m_nParentID;
+		Parents[i] = (nParentID != 0) ? FindByID(nParentID) : -1;
+		Depths[i] = -1;
+	}
+
+	int nMaxDepth = 0;
+	CUtlVector<int> Chain;
+	for (int i = 0; i < nCount; i++)
+	{
+		Chain.RemoveAll();
+
+		int nIndex = i;
+		while ((nIndex != -1) && (Depths[nIndex] == -1))
+		{
+			Depths[nIndex] = -2;
+			Chain.AddToTail(nIndex);
+			nIndex = Parents[nIndex];
+		}
+
+		if ((nIndex != -1) && (Depths[nIndex] == -2))
+		{
+			Parents[Chain.Tail()] = -1;
+			nIndex = -1;
+		}
+
+		int nDepth = (nIndex == -1) ? 0 : Depths[nIndex] + 1;
+		for (int j = Chain.Count() - 1; j >= 0; j--)
+		{
+			Depths[Chain[j]] = nDepth++;
+		}
+
+		nMaxDepth = max(nMaxDepth, nDepth);
+	}
+
+	//
+	// Link each object's children and sort the objects deepest first, so that
+	// every object comes after all of its descendents.
+	//
+	CUtlVector<int> FirstChild;
+	CUtlVector<int> NextSibling;
+	FirstChild.SetCount(nCount);
+	NextSibling.SetCount(nCount);
+
+	for (int i = 0; i < nCount; i++)
+	{
+		FirstChild[i] = -1;
+	}
+
+	for (int i = nCount - 1; i >= 0; i--)
+	{
+		NextSibling[i] = -1;
+		if (Parents[i] != -1)
+		{
+			NextSibling[i] = FirstChild[Parents[i]];
+			FirstChild[Parents[i]] = i;
+		}
+	}
+
+	CUtlVector<int> DepthStart;
+	DepthStart.SetCount(nMaxDepth + 1);
+	for (int i = 0; i <= nMaxDepth; i++)
+	{
+		DepthStart[i] = 0;
+	}
+
+	for (int i = 0; i < nCount; i++)
+	{
+		DepthStart[nMaxDepth - Depths[i]]++;
+	}
+
+	for (int i = 0, nStart = 0; i <= nMaxDepth; i++)
+	{
+		int nInDepth = DepthStart[i];
+		DepthStart[i] = nStart;
+		nStart += nInDepth;
+	}
+
+	CUtlVector<int> Order;
+	Order.SetCount(nCount);
+	for (int i = 0; i < nCount; i++)
+	{
+		Order[DepthStart[nMaxDepth - Depths[i]]++] = i;
+	}
+
+	//
+	// Hash each object's own hash together with the sorted hashes of its
+	// children, so the result doesn't depend on the order of the children.
+	//
+	CUtlVector<CRC32_t> ChildHashes;
+	for (int i = 0; i < nCount; i++)
+	{
+		MapDiffObject_t &Object = m_Objects[Order[i]];
+
+		ChildHashes.RemoveAll();
+		for (int nChild = FirstChild[Order[i]]; nChild != -1; nChild = NextSibling[nChild])
+		{
+			ChildHashes.AddToTail(m_Objects[nChild].m_nHash);
+		}
+
+		if (ChildHashes.Count() > 1)
+		{
+			qsort(ChildHashes.Base(), ChildHashes.Count(), sizeof(CRC32_t), CompareHashes);
+		}
+
+		CRC32_t nHash;
+		CRC32_Init(&nHash);
+		CRC32_ProcessBuffer(&nHash, &Object.m_nOwnHash, (int)sizeof(Object.m_nOwnHash));
+		if (ChildHashes.Count() > 0)
+		{
+			CRC32_ProcessBuffer(&nHash, ChildHashes.Base(), ChildHashes.Count() * (int)sizeof(CRC32_t));
+		}
+		CRC32_Final(&nHash);
+
+		Object.m_nHash = nHash;
+	}
+
+	//
+	// Chain objects with equal hashes in map order.
+	//
+	for (int i = nCount - 1; i >= 0; i--)
+	{
+		HashEntry_t Entry;
+		Entry.m_nKey = m_Objects[i].m_nHash;
+		Entry.m_nIndex = i;
+
+		UtlHashHandle_t h = m_HashIndex.Find(Entry);
+		if (h == m_HashIndex.InvalidHandle())
+		{
+			m_HashIndex.Insert(Entry);
+		}
+		else
+		{
+			m_Objects[i].m_nNextSameHash = m_HashIndex[h].m_nIndex;
+			m_HashIndex[h].m_nIndex = i;
+		}
+	}
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Returns the index of the first object with the given ID, -1 if none.
+//-----------------------------------------------------------------------------
+int CMapDiffSnapshot::FindByID(int nID) const
+{
+	HashEntry_t Entry;
+	Entry.m_nKey = nID;
+
+	UtlHashHandle_t h = m_IDIndex.Find(Entry);
+	if (h == m_IDIndex.InvalidHandle())
+	{
+		return -1;
+	}
+
+	return m_IDIndex[h].m_nIndex;
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Returns the index of the first object with the given hash that has
+//			not been matched yet, -1 if none. Matched objects at the front of
+//			the chain are dropped from it, so repeated calls for the same hash
+//			cost linear time in total.
+//-----------------------------------------------------------------------------
+int CMapDiffSnapshot::FindUnmatchedByHash(CRC32_t nHash)
+{
+	HashEntry_t Entry;
+	Entry.m_nKey = nHash;
+
+	UtlHashHandle_t h = m_HashIndex.Find(Entry);
+	if (h == m_HashIndex.InvalidHandle())
+	{
+		return -1;
+	}
+
+	int nIndex = m_HashIndex[h].m_nIndex;
+	while ((nIndex != -1) && (m_Objects[nIndex].m_nMatch != -1))
+	{
+		nIndex = m_Objects[nIndex].m_nNextSameHash;
+	}
+
+	m_HashIndex[h].m_nIndex = nIndex;
+	return nIndex;
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Reads the contents of a chunk that only wraps other chunks, such as
+//			the world or a hidden object.
+//-----------------------------------------------------------------------------
+ChunkFileResult_t CMapDiffSnapshot::LoadPassThroughCallback(CChunkFile *pFile, CMapDiffSnapshot *pSnapshot)
+{
+	return(pFile->ReadChunk());
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Reads a solid, entity, or group. Any objects nested in it are read
+//			as objects of their own.
+//-----------------------------------------------------------------------------
+ChunkFileResult_t CMapDiffSnapshot::LoadObjectCallback(CChunkFile *pFile, CMapDiffSnapshot *pSnapshot)
+{
+	int nEnclosing = pSnapshot->m_nCurrentObject;
+	CMapDiffHash *pEnclosingHash = pSnapshot->m_pCurrentHash;
+
+	int nIndex = pSnapshot->AddObject(0, 0);
+	pSnapshot->m_Enclosing.AddToTail(nEnclosing);
+	pSnapshot->m_GroupIDs.AddToTail(0);
+
+	CMapDiffHash Hash;
+	pSnapshot->m_nCurrentObject = nIndex;
+	pSnapshot->m_pCurrentHash = &Hash;
+
+	ChunkFileResult_t eResult = pFile->ReadChunk((KeyHandler_t)LoadObjectKeyCallback, pSnapshot);
+
+	pSnapshot->m_nCurrentObject = nEnclosing;
+	pSnapshot->m_pCurrentHash = pEnclosingHash;
+	pSnapshot->m_Objects[nIndex].m_nOwnHash = Hash.Finish();
+
+	return(eResult);
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Handles keys of a solid, entity, or group.
+//-----------------------------------------------------------------------------
+ChunkFileResult_t CMapDiffSnapshot::LoadObjectKeyCallback(const char *szKey, const char *szValue, CMapDiffSnapshot *pSnapshot)
+{
+	if (!stricmp(szKey, "id"))
+	{
+		CChunkFile::ReadKeyValueInt(szValue, pSnapshot->m_Objects[pSnapshot->m_nCurrentObject].m_nID);
+	}
+	else
+	{
+		pSnapshot->m_pCurrentHash->AddKeyValue(szKey, szValue);
+	}
+
+	return(ChunkFile_Ok);
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Reads a chunk whose keys are part of the content of the object that
+//			contains it: faces, displacement data, entity connections, etc.
+//-----------------------------------------------------------------------------
+ChunkFileResult_t CMapDiffSnapshot::LoadContentCallback(CChunkFile *pFile, ContentChunk_t *pChunk)
+{
+	CMapDiffSnapshot *pSnapshot = pChunk->m_pSnapshot;
+	if (pSnapshot->m_pCurrentHash == NULL)
+	{
+		return(pFile->ReadChunk());
+	}
+
+	pSnapshot->m_pCurrentHash->BeginChunk();
+	ChunkFileResult_t eResult = pFile->ReadChunk((KeyHandler_t)LoadContentKeyCallback, pSnapshot);
+	pSnapshot->m_pCurrentHash->EndChunk(pChunk->m_pszName);
+
+	return(eResult);
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Handles keys of a content chunk. Face IDs are left out of the hash
+//			because they are renumbered whenever a solid is copied.
+//-----------------------------------------------------------------------------
+ChunkFileResult_t CMapDiffSnapshot::LoadContentKeyCallback(const char *szKey, const char *szValue, CMapDiffSnapshot *pSnapshot)
+{
+	if (stricmp(szKey, "id"))
+	{
+		pSnapshot->m_pCurrentHash->AddKeyValue(szKey, szValue);
+	}
+
+	return(ChunkFile_Ok);
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Reads an object's editor chunk. Only the group ID is kept; colors,
+//			visgroups, and visibility are editor state, not map content.
+//-----------------------------------------------------------------------------
+ChunkFileResult_t CMapDiffSnapshot::LoadEditorCallback(CChunkFile *pFile, CMapDiffSnapshot *pSnapshot)
+{
+	return(pFile->ReadChunk((KeyHandler_t)LoadEditorKeyCallback, pSnapshot));
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Handles keys of an object's editor chunk.
+//-----------------------------------------------------------------------------
+ChunkFileResult_t CMapDiffSnapshot::LoadEditorKeyCallback(const char *szKey, const char *szValue, CMapDiffSnapshot *pSnapshot)
+{
+	if ((pSnapshot->m_nCurrentObject != -1) && !stricmp(szKey, "groupid"))
+	{
+		CChunkFile::ReadKeyValueInt(szValue, pSnapshot->m_GroupIDs[pSnapshot->m_nCurrentObject]);
+	}
+
+	return(ChunkFile_Ok);
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Constructor.
+//-----------------------------------------------------------------------------
+CMapDiff::CMapDiff(void)
+{
+	memset(m_nCount, 0, sizeof(m_nCount));
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Matches the objects of a world against those of a VMF file.
+// Input  : pCurrentWorld - World of the map being edited.
+//			pszOtherFile - VMF file to compare it against.
+// Output : Returns true on success, false if the file could not be read.
+//-----------------------------------------------------------------------------
+bool CMapDiff::Compare(CMapWorld *pCurrentWorld, const char *pszOtherFile)
+{
+	memset(m_nCount, 0, sizeof(m_nCount));
+
+	if (m_Other.LoadVMF(pszOtherFile) != ChunkFile_Ok)
+	{
+		return false;
+	}
+
+	m_Current.LoadWorld(pCurrentWorld);
+	MatchObjects();
+	return true;
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Matches the objects of two worlds against each other.
+// Input  : pCurrentWorld - World of the map being edited.
+//			pOtherWorld - World to compare it against.
+//-----------------------------------------------------------------------------
+void CMapDiff::Compare(CMapWorld *pCurrentWorld, CMapWorld *pOtherWorld)
+{
+	memset(m_nCount, 0, sizeof(m_nCount));
+
+	m_Current.LoadWorld(pCurrentWorld);
+	m_Other.LoadWorld(pOtherWorld);
+	MatchObjects();
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Matches objects first by ID, then by content hash. Objects that
+//			are left over were added to or removed from the current map.
+//-----------------------------------------------------------------------------
+void CMapDiff::MatchObjects(void)
+{
+	int nCurrentCount = m_Current.Count();
+
+	for (int i = 0; i < nCurrentCount; i++)
+	{
+		MapDiffObject_t &Current = m_Current.Element(i);
+
+		int nOther = m_Other.FindByID(Current.m_nID);
+		if ((nOther == -1) || (m_Other.Element(nOther).m_nMatch != -1))
+		{
+			continue;
+		}
+
+		MapDiffObject_t &Other = m_Other.Element(nOther);
+		Current.m_nMatch = nOther;
+		Other.m_nMatch = i;
+
+		if (Current.m_nHash != Other.m_nHash)
+		{
+			Current.m_eResult = MAPDIFF_MODIFIED;
+		}
+		else if (Current.m_nParentID != Other.m_nParentID)
+		{
+			Current.m_eResult = MAPDIFF_MOVED;
+		}
+		else
+		{
+			Current.m_eResult = MAPDIFF_UNCHANGED;
+		}
+
+		Other.m_eResult = Current.m_eResult;
+	}
+
+	for (int i = 0; i < nCurrentCount; i++)
+	{
+		MapDiffObject_t &Current = m_Current.Element(i);
+		if (Current.m_nMatch != -1)
+		{
+			continue;
+		}
+
+		int nOther = m_Other.FindUnmatchedByHash(Current.m_nHash);
+		if (nOther != -1)
+		{
+			Current.m_nMatch = nOther;
+			Current.m_eResult = MAPDIFF_MOVED;
+			m_Other.Element(nOther).m_nMatch = i;
+			m_Other.Element(nOther).m_eResult = MAPDIFF_MOVED;
+		}
+		else
+		{
+			Current.m_eResult = MAPDIFF_ADDED;
+		}
+	}
+
+	for (int i = 0; i < nCurrentCount; i++)
+	{
+		m_nCount[m_Current.Element(i).m_eResult]++;
+	}
+
+	int nOtherCount = m_Other.Count();
+	for (int i = 0; i < nOtherCount; i++)
+	{
+		MapDiffObject_t &Other = m_Other.Element(i);
+		if (Other.m_nMatch == -1)
+		{
+			Other.m_eResult = MAPDIFF_REMOVED;
+			m_nCount[MAPDIFF_REMOVED]++;
+		}
+	}
+}
@@ -0,0 +1,191 @@
+//========= Copyright  1996-2005, Valve Corporation, All rights reserved. ============//
+//
+// Purpose: Structural comparison of two maps. Objects are read from a world in
+//			memory or straight from a VMF file into flat snapshots, hashed by
+//			content, and matched by ID and by hash in linear time.
+//
+// $NoKeywords: $
+//=============================================================================//
+
+#ifndef MAPDIFF_H
+#define MAPDIFF_H
+#ifdef _WIN32
+#pragma once
+#endif
+
+#include "UtlVector.h"
+#include "tier1/utlhash.h"
+#include "tier1/checksum_crc.h"
+
+
+class CChunkFile;
+class CMapClass;
+class CMapDisp;
+class CMapEntity;
+class CMapSolid;
+class CMapWorld;
+enum ChunkFileResult_t;
+
+
+enum MapDiffResult_t
+{
+	MAPDIFF_UNCHANGED = 0,	// Same ID, same content, same parent.
+	MAPDIFF_MODIFIED,		// Same ID, different content.
+	MAPDIFF_MOVED,			// Same content, but a different ID or parent.
+	MAPDIFF_ADDED,			// Only in the current map.
+	MAPDIFF_REMOVED,		// Only in the other map.
+};
+
+
+//
+// One solid, entity, or group.
+//
+struct MapDiffObject_t
+{
+	int m_nID;
+	int m_nParentID;			// Group or entity that contains this object, zero for the world.
+	CRC32_t m_nOwnHash;			// Our keys, sides, displacements, and connections, excluding IDs and editor state.
+	CRC32_t m_nHash;			// Our own hash combined with those of all our descendents.
+	int m_nMatch;				// Index of the matching object in the other snapshot, -1 if none.
+	MapDiffResult_t m_eResult;
+
+	int m_nNextSameHash;		// Next object with the same m_nHash, -1 if none.
+};
+
+
+//-----------------------------------------------------------------------------
+// Builds the content hash of one object. Each chunk is hashed from the sorted
+// hashes of the key/value pairs and chunks in it, so the result doesn't depend
+// on the order they were written in. Numbers are compared at float precision
+// so that values read from a file match the ones they were written from.
+//-----------------------------------------------------------------------------
+class CMapDiffHash
+{
+public:
+
+	CMapDiffHash();
+
+	void AddKeyValue(const char *pszKey, const char *pszValue);
+
+	void BeginChunk(void);
+	void EndChunk(const char *pszName);
+
+	CRC32_t Finish(void);
+
+private:
+
+	CUtlVector<CRC32_t> m_Hashes;		// Hashes of the keys and chunks of all open chunks.
+	CUtlVector<int> m_ChunkStart;		// Where each open chunk's hashes begin in m_Hashes.
+};
+
+
+//-----------------------------------------------------------------------------
+// Flat list of the objects in a map, read either from a world in memory or
+// from a VMF file without building a document. Both produce the same hashes
+// for the same content.
+//-----------------------------------------------------------------------------
+class CMapDiffSnapshot
+{
+public:
+
+	CMapDiffSnapshot();
+
+	ChunkFileResult_t LoadVMF(const char *pszFileName);
+	void LoadWorld(CMapWorld *pWorld);
+
+	inline int Count(void) const { return m_Objects.Count(); }
+	inline MapDiffObject_t &Element(int nIndex) { return m_Objects[nIndex]; }
+	inline const MapDiffObject_t &Element(int nIndex) const { return m_Objects[nIndex]; }
+
+	int FindByID(int nID) const;
+	int FindUnmatchedByHash(CRC32_t nHash);
+
+private:
+
+	struct HashEntry_t
+	{
+		unsigned int m_nKey;
+		int m_nIndex;
+
+		static bool Compare(const HashEntry_t &a, const HashEntry_t &b) { return a.m_nKey == b.m_nKey; }
+		static unsigned int HashKey(const HashEntry_t &a) { return a.m_nKey; }
+	};
+
+	typedef CUtlHash<HashEntry_t> CIndexHash;
+
+	//
+	// Binds a content chunk name to us for the chunk file callbacks.
+	//
+	struct ContentChunk_t
+	{
+		CMapDiffSnapshot *m_pSnapshot;
+		const char *m_pszName;
+	};
+
+	void Purge(void);
+	int AddObject(int nID, int nParentID);
+	void FinishLoad(void);
+
+	//
+	// Reading objects from memory.
+	//
+	static BOOL LoadWorldCallback(CMapClass *pObject, CMapDiffSnapshot *pSnapshot);
+	void LoadObject(CMapClass *pObject);
+	static void HashEntity(CMapEntity *pEntity, CMapDiffHash &Hash);
+	static void HashSolid(CMapSolid *pSolid, CMapDiffHash &Hash);
+	static void HashDisp(CMapDisp *pDisp, CMapDiffHash &Hash);
+
+	//
+	// Chunk file callbacks.
+	//
+	static ChunkFileResult_t LoadPassThroughCallback(CChunkFile *pFile, CMapDiffSnapshot *pSnapshot);
+	static ChunkFileResult_t LoadObjectCallback(CChunkFile *pFile, CMapDiffSnapshot *pSnapshot);
+	static ChunkFileResult_t LoadObjectKeyCallback(const char *szKey, const char *szValue, CMapDiffSnapshot *pSnapshot);
+	static ChunkFileResult_t LoadContentCallback(CChunkFile *pFile, ContentChunk_t *pChunk);
+	static ChunkFileResult_t LoadContentKeyCallback(const char *szKey, const char *szValue, CMapDiffSnapshot *pSnapshot);
+	static ChunkFileResult_t LoadEditorCallback(CChunkFile *pFile, CMapDiffSnapshot *pSnapshot);
+	static ChunkFileResult_t LoadEditorKeyCallback(const char *szKey, const char *szValue, CMapDiffSnapshot *pSnapshot);
+
+	CUtlVector<MapDiffObject_t> m_Objects;
+	CIndexHash m_IDIndex;		// Object ID to index of the first object with that ID.
+	CIndexHash m_HashIndex;		// m_nHash to index of the first object with that hash.
+
+	//
+	// Only valid while loading a VMF file.
+	//
+	CUtlVector<int> m_Enclosing;	// For each object, the index of the object whose chunk it was read from, -1 if none.
+	CUtlVector<int> m_GroupIDs;		// For each object, the group ID from its editor chunk, zero if none.
+	int m_nCurrentObject;			// Object being read, -1 when outside of any object.
+	CMapDiffHash *m_pCurrentHash;	// Hash of the object being read, NULL when outside of any object.
+};
+
+
+//-----------------------------------------------------------------------------
+// Matches the objects of two maps against each other.
+//-----------------------------------------------------------------------------
+class CMapDiff
+{
+public:
+
+	CMapDiff();
+
+	bool Compare(CMapWorld *pCurrentWorld, const char *pszOtherFile);
+	void Compare(CMapWorld *pCurrentWorld, CMapWorld *pOtherWorld);
+
+	inline const CMapDiffSnapshot &GetCurrent(void) const { return m_Current; }
+	inline const CMapDiffSnapshot &GetOther(void) const { return m_Other; }
+
+	inline int GetCount(MapDiffResult_t eResult) const { return m_nCount[eResult]; }
+
+private:
+
+	void MatchObjects(void);
+
+	CMapDiffSnapshot m_Current;
+	CMapDiffSnapshot m_Other;
+
+	int m_nCount[MAPDIFF_REMOVED + 1];
+};
+
+
+#endif // MAPDIFF_H
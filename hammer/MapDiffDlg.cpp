@@ -4,6 +4,7 @@
 #include "GlobalFunctions.h"
 #include "History.h"
 #include "MainFrm.h"
+#include "MapDiff.h"
 #include "MapDiffDlg.h"
 #include "MapDoc.h"
 #include "MapEntity.h"
@@ -31,6 +32,7 @@ CMapDiffDlg::CMapDiffDlg(CWnd* pParent )
 	: CDialog(CMapDiffDlg::IDD, pParent)
 {
 	m_bCheckSimilar = true;
+	m_bCheckChanges = false;
 }
 
 void CMapDiffDlg::DoDataExchange(CDataExchange* pDX)
@@ -38,12 +40,14 @@ void CMapDiffDlg::DoDataExchange(CDataExchange* pDX)
 	CDialog::DoDataExchange(pDX);
 
 	DDX_Check(pDX, IDC_SIMILARCHECK, m_bCheckSimilar);
+	DDX_Check(pDX, IDC_CHANGESCHECK, m_bCheckChanges);
 	DDX_Control(pDX, IDC_MAPNAME, m_mapName);
 }
 
 
 BEGIN_MESSAGE_MAP(CMapDiffDlg, CDialog)
 	ON_BN_CLICKED(IDC_SIMILARCHECK, OnBnClickedSimilarcheck)
+	ON_BN_CLICKED(IDC_CHANGESCHECK, OnBnClickedChangescheck)
 	ON_BN_CLICKED(IDC_MAPBROWSE, OnBnClickedMapbrowse)
 	ON_BN_CLICKED(IDOK, OnBnClickedOk)
 	ON_BN_CLICKED(IDCANCEL, OnBnClickedCancel)
@@ -69,6 +73,11 @@ void CMapDiffDlg::OnBnClickedSimilarcheck()
 	m_bCheckSimilar = !m_bCheckSimilar;
 }
 
+void CMapDiffDlg::OnBnClickedChangescheck()
+{
+	m_bCheckChanges = !m_bCheckChanges;
+}
+
 void CMapDiffDlg::OnBnClickedMapbrowse()
 {
 	CString	m_pszFilename;
@@ -105,51 +114,123 @@ void CMapDiffDlg::OnBnClickedOk()
 
 
 //-----------------------------------------------------------------------------
-// Purpose: 
+// Purpose: Compares the current map against the chosen file. Top level objects
+//			whose IDs are in both maps go into the "Similar" visgroup, and
+//			changed objects of the current map into visgroups named after the
+//			change, if those options are checked.
 //-----------------------------------------------------------------------------
 void CMapDiffDlg::OnOK()
 {
 	CString strFilename;
 	m_mapName.GetWindowText( strFilename );
-	CHammer *pApp = (CHammer*) AfxGetApp();
-	CMapDoc *pDoc = (CMapDoc*) pApp->pMapDocTemplate->OpenDocumentFile( strFilename );	
-    CUtlVector <int> IDList;
-	
-	const CMapObjectList *pChildren = pDoc->GetMapWorld()->GetChildren();
 
-	FOR_EACH_OBJ( *pChildren, pos )
-	{		
-		int nID = pChildren->Element(pos)->GetID();
-		IDList.AddToTail( nID );
-	}	
+	CMapWorld *pWorld = s_pCurrentMap->GetMapWorld();
+	CMapDiff Diff;
+	bool bOK;
+
+	//
+	// VMF files are read directly. Older formats have to be loaded as a document.
+	//
+	const char *pszExt = V_GetFileExtension( strFilename );
+	if ( ( pszExt != NULL ) && ( !Q_stricmp( pszExt, "vmf" ) || !Q_stricmp( pszExt, "vmf_autosave" ) ) )
+	{
+		bOK = Diff.Compare( pWorld, strFilename );
+	}
+	else
+	{
+		CHammer *pApp = (CHammer*) AfxGetApp();
+		CMapDoc *pDoc = (CMapDoc*) pApp->pMapDocTemplate->OpenDocumentFile( strFilename );
+		bOK = ( pDoc != NULL );
+		if ( bOK )
+		{
+			Diff.Compare( pWorld, pDoc->GetMapWorld() );
+			pDoc->OnCloseDocument();
+		}
+	}
+
+	if ( !bOK )
+	{
+		GetMainWnd()->MessageBox( "The maps could not be compared.", "Map Diff", MB_OK | MB_ICONEXCLAMATION );
+		DestroyWindow();
+		return;
+	}
+
+	const CMapDiffSnapshot &Current = Diff.GetCurrent();
+	const CMapDiffSnapshot &Other = Diff.GetOther();
 
-	pDoc->OnCloseDocument();
-	
-	CVisGroup *resultsVisGroup = NULL;	
-	pChildren = s_pCurrentMap->GetMapWorld()->GetChildren();
 	int nTotalSimilarities = 0;
 	if ( m_bCheckSimilar )
 	{
+		CVisGroup *resultsVisGroup = NULL;
+		const CMapObjectList *pChildren = pWorld->GetChildren();
 		FOR_EACH_OBJ( *pChildren, pos )
 		{
-			CMapClass *pChild = pChildren->Element(pos)	;
-			int ID = pChild->GetID();
-			if ( IDList.Find( ID ) != -1 )
-			{	
+			CMapClass *pChild = pChildren->Element(pos);
+			int nOther = Other.FindByID( pChild->GetID() );
+			if ( ( nOther != -1 ) && ( Other.Element( nOther ).m_nParentID == 0 ) )
+			{
 				if ( resultsVisGroup == NULL )
 				{
 					resultsVisGroup = s_pCurrentMap->VisGroups_AddGroup( "Similar" );
-					nTotalSimilarities++;
 				}
 				pChild->AddVisGroup( resultsVisGroup );
+				nTotalSimilarities++;
 			}
-		}	
+		}
 	}
-	if ( nTotalSimilarities > 0 )
+
+	if ( m_bCheckChanges )
 	{
-		GetMainWnd()->MessageBox( "Similarities were found and placed into the \"Similar\" visgroup.", "Map Similarities Found", MB_OK | MB_ICONEXCLAMATION);
+		//
+		// Objects inside entities follow their entity's visgroups, so only objects
+		// in the world or in groups are added.
+		//
+		static const char *pszVisGroupNames[] = { NULL, "Modified", "Moved", "Added" };
+		CVisGroup *pVisGroups[ARRAYSIZE( pszVisGroupNames )] = { NULL, NULL, NULL, NULL };
+
+		EnumChildrenPos_t pos;
+		CMapClass *pChild = pWorld->GetFirstDescendent( pos );
+		while ( pChild != NULL )
+		{
+			int nIndex = Current.FindByID( pChild->GetID() );
+			CMapClass *pParent = pChild->GetParent();
+			if ( ( nIndex != -1 ) && ( pParent != NULL ) && !pParent->IsMapClass( MAPCLASS_TYPE( CMapEntity ) ) )
+			{
+				MapDiffResult_t eResult = Current.Element( nIndex ).m_eResult;
+				if ( eResult != MAPDIFF_UNCHANGED )
+				{
+					if ( pVisGroups[eResult] == NULL )
+					{
+						pVisGroups[eResult] = s_pCurrentMap->VisGroups_AddGroup( pszVisGroupNames[eResult] );
+					}
+					pChild->AddVisGroup( pVisGroups[eResult] );
+				}
+			}
+
+			pChild = pWorld->GetNextDescendent( pos );
+		}
 	}
+
 	s_pCurrentMap->VisGroups_UpdateAll();
+
+	char szMessage[512];
+	Q_snprintf( szMessage, sizeof( szMessage ),
+		"%d modified, %d moved, %d added and %d removed objects; %d objects are unchanged.",
+		Diff.GetCount( MAPDIFF_MODIFIED ), Diff.GetCount( MAPDIFF_MOVED ), Diff.GetCount( MAPDIFF_ADDED ),
+		Diff.GetCount( MAPDIFF_REMOVED ), Diff.GetCount( MAPDIFF_UNCHANGED ) );
+
+	if ( m_bCheckChanges )
+	{
+		Q_strncat( szMessage, "\n\nChanged objects were placed into visgroups named after the change.", sizeof( szMessage ), COPY_ALL_CHARACTERS );
+	}
+
+	if ( nTotalSimilarities > 0 )
+	{
+		Q_strncat( szMessage, "\n\nSimilarities were found and placed into the \"Similar\" visgroup.", sizeof( szMessage ), COPY_ALL_CHARACTERS );
+	}
+
+	GetMainWnd()->MessageBox( szMessage, "Map Differences", MB_OK | MB_ICONINFORMATION );
+
 	DestroyWindow();
 }
 
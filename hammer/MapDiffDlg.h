@@ -20,6 +20,7 @@ private:
 	enum { IDD = IDD_DIFFMAP };
 
 	BOOL	m_bCheckSimilar;
+	BOOL	m_bCheckChanges;
 	CEdit	m_mapName;
 	
 
@@ -33,6 +34,7 @@ protected:
 	DECLARE_MESSAGE_MAP()
 public:
 	afx_msg void OnBnClickedSimilarcheck();
+	afx_msg void OnBnClickedChangescheck();
 	afx_msg void OnBnClickedMapbrowse();
 	afx_msg void OnBnClickedOk();
 	afx_msg void OnBnClickedCancel();
@@ -154,19 +154,8 @@ void CSoundBrowser::ClearSoundList()
 }
 
 //-----------------------------------------------------------------------------
-// Sound filter
+// Fills the list with the sounds that pass the filter
 //-----------------------------------------------------------------------------
-bool CSoundBrowser::ShowSoundInList( const char *pSoundName )
-{
-	for (int i = 0; i < m_nFilters; i++)
-	{
-		if ( Q_stristr(pSoundName, m_Filters[i]) == NULL )
-			return false;
-	}
-
-	return true;
-}
-
 void CSoundBrowser::PopulateSoundList()
 {
 	m_SoundList.SetRedraw( FALSE );
@@ -174,16 +163,15 @@ void CSoundBrowser::PopulateSoundList()
 	ClearSoundList();
 
 	SoundType_t type = GetSoundType();
-	for ( int i = g_Sounds.SoundCount( type ); --i >= 0; )
+	CUtlVector< int > sounds;
+	g_Sounds.FindSoundsContaining( type, m_Filters, m_nFilters, sounds );
+	for ( int i = sounds.Count(); --i >= 0; )
 	{
-		const char *pSoundName = g_Sounds.SoundName( type, i );
-		if ( ShowSoundInList( pSoundName ) )
-		{
-			CString str;
-			str.Format( _T(pSoundName) );
-			int nIndex = m_SoundList.AddString( str );
-			m_SoundList.SetItemDataPtr( nIndex, (PVOID)i );
-		}
+		const char *pSoundName = g_Sounds.SoundName( type, sounds[i] );
+		CString str;
+		str.Format( _T(pSoundName) );
+		int nIndex = m_SoundList.AddString( str );
+		m_SoundList.SetItemDataPtr( nIndex, (PVOID)sounds[i] );
 	}
 
 	m_SoundList.SetRedraw( TRUE );
@@ -74,7 +74,6 @@ private:
 	void PopulateSoundList();
 	void CopySoundNameToSelected();
 	SoundType_t GetSoundType() const;
-	bool ShowSoundInList( const char *pSoundName );
 	void OnFilterChanged( const char *pFilter );
 
 	DWORD m_uLastFilterChange;
@@ -23,6 +23,7 @@
 #include "ToolManager.h"
 #include "vgui/Cursor.h"
 #include "Selection.h"
+#include "vstdlib/jobthread.h"
 
 // memdbgon must be the last include file in a .cpp file!!!
 #include <tier0/memdbgon.h>
@@ -71,6 +72,21 @@ CClipGroup::~CClipGroup()
 }
 
 
+//-----------------------------------------------------------------------------
+// Purpose: Deletes the clip solids so that new ones can be made.
+//-----------------------------------------------------------------------------
+void CClipGroup::DestroyClipSolids( void )
+{
+	delete m_pClipSolids[0];
+	delete m_pClipSolids[1];
+	m_pClipSolids[0] = NULL;
+	m_pClipSolids[1] = NULL;
+
+	m_nClipSide = -1;
+	m_nClipMode = -1;
+}
+
+
 //-----------------------------------------------------------------------------
 // Purpose: constructor - initialize the clipper variables
 //-----------------------------------------------------------------------------
@@ -167,10 +183,11 @@ bool Clipper3D::UpdateTranslation( const Vector &vUpdate, UINT uFlags )
 
 	m_ClipPoints[m_ClipPointHit] = vNewPos;
 
-    // build the new clip plane and update clip results
+    // build the new clip plane and update clip results -- the clip list
+    // was set up when the drag started
     BuildClipPlane();
 
-    GetClipResults();
+    CalcClipResults();
 
 	m_pDocument->UpdateAllViews( MAPVIEW_UPDATE_TOOL );
 
@@ -186,7 +203,7 @@ bool Clipper3D::UpdateTranslation( const Vector &vUpdate, UINT uFlags )
 void Clipper3D::FinishTranslation( bool bSave )
 {
     // get the clip results -- in case the update is a click and not a drag
-    GetClipResults();
+    CalcClipResults();
 
     Tool3D::FinishTranslation( bSave );
 }
@@ -309,9 +326,81 @@ void Clipper3D::SetClipObjects( const CMapObjectList *pList )
 }
 
 
+//-----------------------------------------------------------------------------
+// Purpose: A solid to classify against the clip plane, for ClassifyClipGroups.
+//-----------------------------------------------------------------------------
+struct ClipClassifyItem_t
+{
+    CClipGroup  *pClipGroup;
+    PLANE       *pPlane;
+};
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Works out which side of the clip plane a clip group's original
+//          solid is on. Only reads the solid, so it can run on any thread.
+//-----------------------------------------------------------------------------
+static void ClassifyClipGroup( ClipClassifyItem_t &item )
+{
+    CMapSolid *pOrigSolid = item.pClipGroup->GetOrigSolid();
+    if( !pOrigSolid )
+        return;
+
+    int side;
+    switch( pOrigSolid->ClassifyPlane( item.pPlane ) )
+    {
+    case CMapSolid::PLANESIDE_FRONT:
+        side = Clipper3D::FRONT;
+        break;
+    case CMapSolid::PLANESIDE_BACK:
+        side = Clipper3D::BACK;
+        break;
+    default:
+        side = Clipper3D::BOTH;
+        break;
+    }
+
+    item.pClipGroup->SetPlaneSide( side );
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Classifies the original solids of all clip groups against the
+//          clip plane, spreading the work across the thread pool when there
+//          are many of them.
+//-----------------------------------------------------------------------------
+void Clipper3D::ClassifyClipGroups( void )
+{
+    CUtlVector<ClipClassifyItem_t> items;
+    items.SetCount( m_ClipResults.Count() );
+
+    for( int i = 0; i < m_ClipResults.Count(); i++ )
+    {
+        items[i].pClipGroup = m_ClipResults[i];
+        items[i].pPlane = &m_ClipPlane;
+    }
+
+    if( ( items.Count() > 64 ) && g_pThreadPool && ( g_pThreadPool->NumThreads() > 0 ) )
+    {
+        ParallelProcess( "Clipper3D::ClassifyClipGroups", items.Base(), items.Count(), &ClassifyClipGroup );
+    }
+    else
+    {
+        for( int i = 0; i < items.Count(); i++ )
+        {
+            ClassifyClipGroup( items[i] );
+        }
+    }
+}
+
+
 //-----------------------------------------------------------------------------
 // Purpose: This function calculates based on the defined or given clipping
-//          plane and clipping mode the new clip solids.
+//          plane and clipping mode the new clip solids. Solids that lie
+//          entirely on one side of the plane are copied whole, and the copy
+//          doesn't depend on where the plane is, so it is kept for as long as
+//          the solid stays on that side. Only solids that straddle the plane
+//          are split again each time it moves.
 //-----------------------------------------------------------------------------
 void Clipper3D::CalcClipResults( void )
 {
@@ -319,6 +408,8 @@ void Clipper3D::CalcClipResults( void )
     if( IsEmpty() )
         return;
 
+    ClassifyClipGroups();
+
     //
     // iterate through and clip all of the solids in the clip list
     //
@@ -329,6 +420,12 @@ void Clipper3D::CalcClipResults( void )
         if( !pOrigSolid )
             continue;
 
+        int side = pClipGroup->GetPlaneSide();
+        if( ( side != BOTH ) && pClipGroup->IsClipState( side, m_Mode ) )
+            continue;
+
+        pClipGroup->DestroyClipSolids();
+
         //
         // check the modes for which solids to generate
         //
@@ -358,6 +455,8 @@ void Clipper3D::CalcClipResults( void )
 			pBack->SetTemporary(true);
             pClipGroup->SetClipSolid( pBack, BACK );
         }
+
+        pClipGroup->SetClipState( side, m_Mode );
     }
 }
 
@@ -590,11 +689,11 @@ void Clipper3D::RenderTool2D(CRender2D *pRender)
 				{
 					pRender->DrawHandles( pFace->nPoints, pFace->Points );
 				}
+            }
 
-                if( m_bDrawMeasurements )
-                {
-                    DrawBrushExtents( pRender, pClipBack, DBT_TOP | DBT_LEFT | DBT_BACK );
-                }
+            if( m_bDrawMeasurements )
+            {
+                DrawBrushExtents( pRender, pClipBack, DBT_TOP | DBT_LEFT | DBT_BACK );
             }
         }
 
@@ -611,11 +710,11 @@ void Clipper3D::RenderTool2D(CRender2D *pRender)
 				{
 					pRender->DrawHandles( pFace->nPoints, pFace->Points );
 				}
+            }
 
-                if( m_bDrawMeasurements )
-                {
-                    DrawBrushExtents( pRender, pClipFront, DBT_BOTTOM | DBT_RIGHT );
-                }
+            if( m_bDrawMeasurements )
+            {
+                DrawBrushExtents( pRender, pClipFront, DBT_BOTTOM | DBT_RIGHT );
             }
         }
 	}
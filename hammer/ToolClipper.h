@@ -41,11 +41,22 @@ public:
 
     inline void SetClipSolid( CMapSolid *pSolid, int side );
     inline CMapSolid *GetClipSolid( int side );
+    void DestroyClipSolids( void );
+
+    inline void SetPlaneSide( int side );
+    inline int GetPlaneSide( void );
+
+    inline void SetClipState( int side, int mode );
+    inline bool IsClipState( int side, int mode );
 
 private:
 
     CMapSolid   *m_pOrigSolid;
     CMapSolid   *m_pClipSolids[2];      // front, back
+
+    int         m_nPlaneSide;           // side of the clip plane the original is on { front, back, both }
+    int         m_nClipSide;            // side and clip mode the clip solids were made for,
+    int         m_nClipMode;            // -1 if there are none
 };
 
 
@@ -56,6 +67,9 @@ inline CClipGroup::CClipGroup()
     m_pOrigSolid = NULL;
     m_pClipSolids[0] = NULL;
     m_pClipSolids[1] = NULL;
+    m_nPlaneSide = -1;
+    m_nClipSide = -1;
+    m_nClipMode = -1;
 }
 
 
@@ -91,6 +105,39 @@ inline CMapSolid *CClipGroup::GetClipSolid( int side )
 }
 
 
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+inline void CClipGroup::SetPlaneSide( int side )
+{
+    m_nPlaneSide = side;
+}
+
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+inline int CClipGroup::GetPlaneSide( void )
+{
+    return m_nPlaneSide;
+}
+
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+inline void CClipGroup::SetClipState( int side, int mode )
+{
+    m_nClipSide = side;
+    m_nClipMode = mode;
+}
+
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+inline bool CClipGroup::IsClipState( int side, int mode )
+{
+    return ( ( m_nClipSide == side ) && ( m_nClipMode == mode ) );
+}
+
+
 class Clipper3D : public Tool3D
 {
     friend BOOL AddToClipList( CMapSolid *pSolid, Clipper3D *pClipper );
@@ -151,6 +198,7 @@ private:
     void GetClipResults( void );
     void CalcClipResults( void );
     void ResetClipResults( void );
+    void ClassifyClipGroups( void );
 
 	void RemoveOrigSolid( CMapSolid *pOrigSolid );
 	void SaveClipSolid( CMapSolid *pSolid, CMapSolid *pOrigSolid );
@@ -66,6 +66,9 @@ Morph3D::Morph3D(void)
 	memset(&m_DragHandle, 0, sizeof(m_DragHandle));
 	m_bMorphing = false;
 	m_bMovingSelected = false;
+
+	m_TreeSolids.SetLessFunc(DefLessFunc(CSSolid*));
+	m_bHandleTreeValid = false;
 }
 
 
@@ -260,6 +263,7 @@ void Morph3D::SelectObject(CMapSolid *pSolid, UINT cmd)
 
 			// remove from linked list
 			m_StrucSolids.FindAndRemove(pStrucSolid);
+			InvalidateHandleTree();
 			
 			// make sure none of its handles are selected
 			for(int i = m_SelectedHandles.Count()-1; i >=0; i--)
@@ -292,6 +296,104 @@ void Morph3D::SelectObject(CMapSolid *pSolid, UINT cmd)
 
 	// add to list of structured solids
 	m_StrucSolids.AddToTail(pStrucSolid);
+	InvalidateHandleTree();
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Marks the handle tree as out of date. Called whenever solids are
+//			added or removed, or their vertices or edges change.
+//-----------------------------------------------------------------------------
+void Morph3D::InvalidateHandleTree(void)
+{
+	m_bHandleTreeValid = false;
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Rebuilds the handle tree from the vertices and edges of all the
+//			solids being morphed, if it is out of date.
+//-----------------------------------------------------------------------------
+void Morph3D::UpdateHandleTree(void)
+{
+	if (m_bHandleTreeValid)
+		return;
+
+	m_TreeHandles.RemoveAll();
+	m_TreeSolids.RemoveAll();
+
+	CUtlVector<Vector> Points;
+
+	FOR_EACH_OBJ( m_StrucSolids, pos )
+	{
+		CSSolid *pStrucSolid = m_StrucSolids.Element(pos);
+
+		TreeSolid_t TreeSolid;
+		TreeSolid.nFirstHandle = m_TreeHandles.Count();
+		TreeSolid.nHandles = pStrucSolid->m_nVertices + pStrucSolid->m_nEdges;
+		m_TreeSolids.Insert(pStrucSolid, TreeSolid);
+
+		for (int i = 0; i < pStrucSolid->m_nVertices; i++)
+		{
+			int nHandle = m_TreeHandles.AddToTail();
+			m_TreeHandles[nHandle].pStrucSolid = pStrucSolid;
+			m_TreeHandles[nHandle].eType = shtVertex;
+			m_TreeHandles[nHandle].nIndex = i;
+			Points.AddToTail(pStrucSolid->m_Vertices[i].pos);
+		}
+
+		for (int i = 0; i < pStrucSolid->m_nEdges; i++)
+		{
+			int nHandle = m_TreeHandles.AddToTail();
+			m_TreeHandles[nHandle].pStrucSolid = pStrucSolid;
+			m_TreeHandles[nHandle].eType = shtEdge;
+			m_TreeHandles[nHandle].nIndex = i;
+			Points.AddToTail(pStrucSolid->m_Edges[i].ptCenter);
+		}
+	}
+
+	m_HandleTree.Build(Points.Base(), Points.Count());
+	m_bHandleTreeValid = true;
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Updates the handle tree after the vertices of a solid have moved.
+// Input  : pStrucSolid - Solid whose vertices moved.
+//-----------------------------------------------------------------------------
+void Morph3D::RefitHandleTree(CSSolid *pStrucSolid)
+{
+	if (!m_bHandleTreeValid)
+		return;
+
+	int nIndex = m_TreeSolids.Find(pStrucSolid);
+	if (nIndex == m_TreeSolids.InvalidIndex())
+	{
+		InvalidateHandleTree();
+		return;
+	}
+
+	const TreeSolid_t &TreeSolid = m_TreeSolids[nIndex];
+	if (TreeSolid.nHandles != pStrucSolid->m_nVertices + pStrucSolid->m_nEdges)
+	{
+		InvalidateHandleTree();
+		return;
+	}
+
+	CUtlVector<Vector> Points;
+	Points.EnsureCapacity(TreeSolid.nHandles);
+
+	for (int i = 0; i < pStrucSolid->m_nVertices; i++)
+	{
+		Points.AddToTail(pStrucSolid->m_Vertices[i].pos);
+	}
+
+	for (int i = 0; i < pStrucSolid->m_nEdges; i++)
+	{
+		Points.AddToTail(pStrucSolid->m_Edges[i].ptCenter);
+	}
+
+	m_HandleTree.MovePoints(TreeSolid.nFirstHandle, TreeSolid.nHandles, Points.Base());
 }
 
 
@@ -317,6 +419,15 @@ bool CompareMorphHandles(const MORPHHANDLE &mh1, const MORPHHANDLE &mh2)
 }
 
 
+//-----------------------------------------------------------------------------
+// Purpose: Sorts handle tree results into handle order.
+//-----------------------------------------------------------------------------
+static int __cdecl CompareHandleNumbers(const int *pHandle1, const int *pHandle2)
+{
+	return *pHandle1 - *pHandle2;
+}
+
+
 //-----------------------------------------------------------------------------
 // Purpose: Returns whether or not the given morph handle is selected.
 //-----------------------------------------------------------------------------
@@ -362,61 +473,70 @@ bool Morph3D::MorphHitTest(CMapView *pView, const Vector2D &vPoint, MORPHHANDLE
 		}
 	}
 
-	FOR_EACH_OBJ( m_StrucSolids, pos )
+	UpdateHandleTree();
+
+	// gather the handles near the point, and take the first one hit
+	CUtlVector<int> Candidates;
+	Vector2D vecRadius(HANDLE_RADIUS, HANDLE_RADIUS);
+	m_HandleTree.FindPointsNearRect(pView, vPoint - vecRadius, vPoint + vecRadius, Candidates);
+	Candidates.Sort(CompareHandleNumbers);
+
+	CSSolid *pStrucSolid = NULL;
+
+	for (int i = 0; i < Candidates.Count(); i++)
 	{
-		CSSolid *pStrucSolid = m_StrucSolids.Element(pos);
+		TreeHandle_t &Handle = m_TreeHandles[Candidates[i]];
 
-		// do a hit test on all handles:
-		if (m_HandleMode & hmVertex)
+		if (Handle.eType == shtVertex)
 		{
-			for(int i = 0; i < pStrucSolid->m_nVertices; i++)
-			{
-				CSSVertex &v = pStrucSolid->m_Vertices[i];
+			if (!(m_HandleMode & hmVertex))
+				continue;
 
-				if( HitRect( pView, vPoint, v.pos, HANDLE_RADIUS ) )
-				{
-					hnd = v.id;
-					break;
-				}
+			CSSVertex &v = Handle.pStrucSolid->m_Vertices[Handle.nIndex];
+			if( HitRect( pView, vPoint, v.pos, HANDLE_RADIUS ) )
+			{
+				hnd = v.id;
 			}
 		}
-
-		if (!hnd && (m_HandleMode & hmEdge))
+		else
 		{
-			for (int i = 0; i < pStrucSolid->m_nEdges; i++)
-			{
-				CSSEdge &e = pStrucSolid->m_Edges[i];
+			if (!(m_HandleMode & hmEdge))
+				continue;
 
-				if( HitRect( pView, vPoint, e.ptCenter, HANDLE_RADIUS ) )
-				{
-					hnd = e.id;
-					break;
-				}
+			CSSEdge &e = Handle.pStrucSolid->m_Edges[Handle.nIndex];
+			if( HitRect( pView, vPoint, e.ptCenter, HANDLE_RADIUS ) )
+			{
+				hnd = e.id;
 			}
 		}
 
 		if (hnd)
 		{
-			if ( bIs2D )
-			{
-				SSHANDLEINFO hi;
-				pStrucSolid->GetHandleInfo(&hi, hnd);
+			pStrucSolid = Handle.pStrucSolid;
+			break;
+		}
+	}
+
+	if (hnd)
+	{
+		if ( bIs2D )
+		{
+			SSHANDLEINFO hi;
+			pStrucSolid->GetHandleInfo(&hi, hnd);
 
-				// see if there is a 2d match that is already selected - if
-				//  there is, select that instead
-				SSHANDLE hMatch = Get2DMatches( dynamic_cast<CMapView2D*>(pView), pStrucSolid, hi);
+			// see if there is a 2d match that is already selected - if
+			//  there is, select that instead
+			SSHANDLE hMatch = Get2DMatches( dynamic_cast<CMapView2D*>(pView), pStrucSolid, hi);
 
-				if(hMatch)
-					hnd = hMatch;
-			}
+			if(hMatch)
+				hnd = hMatch;
+		}
 
-			if(pInfo)
-			{
-				pInfo->pMapSolid = pStrucSolid->m_pMapSolid;
-				pInfo->pStrucSolid = pStrucSolid;
-				pInfo->ssh = hnd;
-			}
-			break;
+		if(pInfo)
+		{
+			pInfo->pMapSolid = pStrucSolid->m_pMapSolid;
+			pInfo->pStrucSolid = pStrucSolid;
+			pInfo->ssh = hnd;
 		}
 	}
 
@@ -600,10 +720,20 @@ void Morph3D::SelectHandle(MORPHHANDLE *pInfo, UINT cmd)
 	if(cmd & scClear)
 	{
 		// clear handles first
-		while( m_SelectedHandles.Count()>0)
+		bool bCleared = (m_SelectedHandles.Count() > 0);
+		for (int i = 0; i < m_SelectedHandles.Count(); i++)
 		{
-			SelectHandle(&m_SelectedHandles[0], scUnselect);
+			MORPHHANDLE &mh = m_SelectedHandles[i];
+			SSHANDLEINFO hi;
+			if (mh.pStrucSolid->GetHandleInfo(&hi, mh.ssh))
+			{
+				hi.p2DHandle->m_bSelected = FALSE;
+			}
 		}
+		m_SelectedHandles.RemoveAll();
+
+		if(bCleared && m_bScaling && cmd != scClear)
+			OnScaleCmd(TRUE);
 	}
 
 	if(cmd == scClear)
@@ -671,7 +801,10 @@ void Morph3D::MoveSelectedHandles(const Vector &Delta)
 	FOR_EACH_OBJ( m_StrucSolids, pos )
 	{
 		CSSolid *pStrucSolid = m_StrucSolids.Element(pos);
-		pStrucSolid->MoveSelectedHandles(Delta);
+		if (pStrucSolid->MoveSelectedHandles(Delta))
+		{
+			RefitHandleTree(pStrucSolid);
+		}
 	}
 }
 
@@ -950,30 +1083,24 @@ void Morph3D::SelectInBox()
 	if(countzero > 1)
 		return;
 
-	FOR_EACH_OBJ( m_StrucSolids, pos )
-	{	
-		CSSolid *pStrucSolid = m_StrucSolids.Element(pos);
+	UpdateHandleTree();
 
-		for(int i = 0; i < pStrucSolid->m_nVertices; i++)
-		{
-			CSSVertex& v = pStrucSolid->m_Vertices[i];
-			int i2;
-			for(i2 = 0; i2 < 3; i2++)
-			{
-				if(v.pos[i2] < bmins[i2] || v.pos[i2] > bmaxs[i2])
-					break;
-			}
-			
-			if(i2 == 3)
-			{
-				// completed loop - intersects - select handle
-				MORPHHANDLE mh;
-				mh.ssh = v.id;
-				mh.pStrucSolid = pStrucSolid;
-				mh.pMapSolid = pStrucSolid->m_pMapSolid;
-				SelectHandle(&mh, scSelect);
-			}
-		}
+	CUtlVector<int> Inside;
+	m_HandleTree.FindPointsInBox(bmins, bmaxs, Inside);
+	Inside.Sort(CompareHandleNumbers);
+
+	for(int i = 0; i < Inside.Count(); i++)
+	{
+		TreeHandle_t &Handle = m_TreeHandles[Inside[i]];
+		if(Handle.eType != shtVertex)
+			continue;
+
+		// inside the box - select handle
+		MORPHHANDLE mh;
+		mh.ssh = Handle.pStrucSolid->m_Vertices[Handle.nIndex].id;
+		mh.pStrucSolid = Handle.pStrucSolid;
+		mh.pMapSolid = Handle.pStrucSolid->m_pMapSolid;
+		SelectHandle(&mh, scSelect);
 	}
 }
 
@@ -1025,6 +1152,7 @@ void Morph3D::FinishTranslation(bool bSave)
 				{
 					int nDeleted;
 					SSHANDLE *pDeleted = pStrucSolid->MergeSameVertices(nDeleted);
+					InvalidateHandleTree();
 					// ensure deleted handles are not marked
 					for(int i = 0; i < nDeleted; i++)
 					{
@@ -1064,6 +1192,8 @@ bool Morph3D::SplitFace()
 	if(m_SelectedHandles[0].pStrucSolid->SplitFace(m_SelectedHandles[0].ssh,
 		m_SelectedHandles[1].ssh))
 	{
+		InvalidateHandleTree();
+
 		// unselect those invalid edges
 		if(m_SelectedType == shtVertex)
 		{
@@ -1249,6 +1379,7 @@ void Morph3D::UpdateScale()
 
 	// match up selected vertices to original position in m_pOrigPosList.
 	int iMoved = 0;
+	CUtlVector<CSSolid*> Moved;
 	for(int i = 0; i < m_SelectedHandles.Count(); i++)
 	{
 		MORPHHANDLE &hnd = m_SelectedHandles[i];
@@ -1279,6 +1410,14 @@ void Morph3D::UpdateScale()
 		{
 			hnd.pStrucSolid->CalcEdgeCenter(pEdges[e]);
 		}
+
+		if(Moved.Find(hnd.pStrucSolid) == -1)
+			Moved.AddToTail(hnd.pStrucSolid);
+	}
+
+	for(int i = 0; i < Moved.Count(); i++)
+	{
+		RefitHandleTree(Moved[i]);
 	}
 
 	m_pDocument->UpdateAllViews( MAPVIEW_UPDATE_TOOL );
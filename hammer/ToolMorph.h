@@ -17,7 +17,9 @@
 #include "Resource.h"
 #include "ScaleVerticesDlg.h"
 #include "ToolInterface.h"
+#include "PointTree.h"
 #include "mathlib/vector.h"
+#include "tier1/utlmap.h"
 
 
 class IMesh;
@@ -136,11 +138,36 @@ private:
 
 	bool CanDeselectList( void );
 
+	void InvalidateHandleTree(void);
+	void UpdateHandleTree(void);
+	void RefitHandleTree(CSSolid *pStrucSolid);
+
 	// list of active Structured Solids:
 	CUtlVector<CSSolid*> m_StrucSolids;
 	
 	// list of selected nodes:
 	CUtlVector<MORPHHANDLE> m_SelectedHandles;
+
+	// vertex and edge handles of all solids, for picking:
+	struct TreeHandle_t
+	{
+		CSSolid *pStrucSolid;
+		SSHANDLETYPE eType;
+		int nIndex;				// index into the solid's vertices or edges
+	};
+
+	struct TreeSolid_t
+	{
+		int nFirstHandle;
+		int nHandles;
+	};
+
+	// handles are numbered in solid order, each solid's vertices before its
+	//  edges, so the lowest numbered hit is the one the user expects.
+	CUtlVector<TreeHandle_t> m_TreeHandles;
+	CUtlMap<CSSolid*, TreeSolid_t, int> m_TreeSolids;
+	CPointTree m_HandleTree;
+	bool m_bHandleTreeValid;
 	
 	// type of selected handles:
 	SSHANDLETYPE m_SelectedType;
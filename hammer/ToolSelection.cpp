@@ -276,11 +276,13 @@ void Selection3D::TransformSelection(void)
 {
 	// Transform the selected objects.
 	const CMapObjectList *pSelList = m_pSelection->GetList();
+	CMapFace::BeginTextureCoordBatch();
 	for (int i = 0; i < pSelList->Count(); i++)
 	{
 		CMapClass *pobj = pSelList->Element(i);
 		pobj->Transform( GetTransformMatrix() );
 	}
+	CMapFace::EndTextureCoordBatch();
 
 	m_pDocument->SetModifiedFlag();
 }
@@ -255,7 +255,7 @@ void CEditGameClass::SetClass(LPCTSTR pszClass, bool bLoading)
 
 	if (pGD)
 	{
-		m_pClass = pGD->ClassForName(m_szClass);
+		m_pClass = g_pGameConfig->ClassForName(m_szClass);
 	}
 }
 
@@ -424,7 +424,7 @@ ChunkFileResult_t CEditGameClass::SaveVMF(CChunkFile *pFile, CSaveInfo *pSaveInf
 	GDclass *pGameDataClass = NULL;
 	if (pGD != NULL)
 	{
-		pGameDataClass = pGD->ClassForName(m_szClass);
+		pGameDataClass = g_pGameConfig->ClassForName(m_szClass);
 	}
 
 	//
@@ -56,6 +56,9 @@ void CGameConfig::SetActiveGame(CGameConfig *pGame)
 {
 	if (pGame != NULL)
 	{
+		// Game data files are only parsed for the configurations that get used.
+		pGame->EnsureGDFilesLoaded();
+
 		g_pGameConfig = pGame;
 		pGD = &pGame->GD;
 
@@ -90,9 +93,12 @@ void CGameConfig::SetActiveGame(CGameConfig *pGame)
 // Purpose: Constructor. Maintains a static	counter uniquely identifying each
 //			game configuration.
 //-----------------------------------------------------------------------------
-CGameConfig::CGameConfig(void)
+CGameConfig::CGameConfig(void) :
+	m_ClassNames(k_eDictCompareTypeCaseSensitive)
 {
 	nGDFiles = 0;
+	m_bGDFilesLoaded = false;
+	m_nGDFilesCRC = 0;
 	textureformat = tfNone;
 	m_fDefaultTextureScale = DEFAULT_TEXTURE_SCALE;
 	m_nDefaultLightmapScale = DEFAULT_LIGHTMAP_SCALE;
@@ -190,7 +196,12 @@ BOOL CGameConfig::Import(std::fstream& file, float fVersion)
 		GDFiles.Add(CString(szBuf));
 	}
 
-	LoadGDFiles();
+	// Defer parsing the game data until this configuration is used. Once it
+	// has been parsed, keep it current; unchanged files are not parsed again.
+	if (m_bGDFilesLoaded || (this == g_pGameConfig))
+	{
+		LoadGDFiles();
+	}
 	
 	return TRUE;
 }
@@ -267,7 +278,12 @@ bool CGameConfig::Load(KeyValues *pkv)
 		Q_StripTrailingSlash(m_szMaterialExcludeDirs[i]);
 	}
 
-	LoadGDFiles();
+	// Defer parsing the game data until this configuration is used. Once it
+	// has been parsed, keep it current; unchanged files are not parsed again.
+	if (m_bGDFilesLoaded || (this == g_pGameConfig))
+	{
+		LoadGDFiles();
+	}
 	
 	return(true);
 }
@@ -414,24 +430,134 @@ void CGameConfig::CopyFrom(CGameConfig *pConfig)
 //-----------------------------------------------------------------------------
 // Purpose: 
 // Input  : pEntity - 
-//			pGD - 
+//			pGame - 
 // Output : Returns TRUE to keep enumerating.
 //-----------------------------------------------------------------------------
-static BOOL UpdateClassPointer(CMapEntity *pEntity, GameData *pGD)
+static BOOL UpdateClassPointer(CMapEntity *pEntity, CGameConfig *pGame)
 {
-	GDclass *pClass = pGD->ClassForName(pEntity->GetClassName());
+	GDclass *pClass = pGame->ClassForName(pEntity->GetClassName());
 	pEntity->SetClass(pClass);
 	return(TRUE);
 }
 
 
 //-----------------------------------------------------------------------------
-// Purpose: 
+// Purpose: Adds a game data file and the files it includes to a checksum.
+//			Included files are found the way GameData finds them: next to
+//			the including file first, then relative to the working directory.
+// Input  : crc - Checksum to add to.
+//			pszFileName - File to add.
+//			Visited - Files already added, to stop include loops.
+//-----------------------------------------------------------------------------
+static void ChecksumGDFile(CRC32_t &crc, const char *pszFileName, CUtlDict<int, int> &Visited)
+{
+	CRC32_ProcessBuffer(&crc, pszFileName, (int)strlen(pszFileName) + 1);
+
+	if (Visited.Find(pszFileName) != Visited.InvalidIndex())
+	{
+		return;
+	}
+	Visited.Insert(pszFileName, 0);
+
+	FILE *fp = fopen(pszFileName, "rb");
+	if (fp == NULL)
+	{
+		// A missing file still changes the checksum, through its name.
+		return;
+	}
+
+	fseek(fp, 0, SEEK_END);
+	int nSize = ftell(fp);
+	fseek(fp, 0, SEEK_SET);
+
+	CUtlVector<char> Text;
+	Text.SetCount(nSize + 1);
+	nSize = (int)fread(Text.Base(), 1, nSize, fp);
+	Text[nSize] = '\0';
+	fclose(fp);
+
+	CRC32_ProcessBuffer(&crc, Text.Base(), nSize);
+
+	//
+	// Look for @include "file" outside of comments and strings.
+	//
+	const char *pch = Text.Base();
+	while (*pch != '\0')
+	{
+		if ((pch[0] == '/') && (pch[1] == '/'))
+		{
+			while ((*pch != '\0') && (*pch != '\n'))
+			{
+				pch++;
+			}
+		}
+		else if (*pch == '"')
+		{
+			pch++;
+			while ((*pch != '\0') && (*pch != '"'))
+			{
+				pch++;
+			}
+
+			if (*pch != '\0')
+			{
+				pch++;
+			}
+		}
+		else if ((*pch == '@') && !Q_strnicmp(pch + 1, "include", 7) && !isalnum((unsigned char)pch[8]) && (pch[8] != '_'))
+		{
+			pch += 8;
+			while ((*pch != '\0') && isspace((unsigned char)*pch))
+			{
+				pch++;
+			}
+
+			if (*pch != '"')
+			{
+				continue;
+			}
+
+			const char *pszStart = ++pch;
+			while ((*pch != '\0') && (*pch != '"'))
+			{
+				pch++;
+			}
+
+			char szInclude[MAX_PATH];
+			Q_strncpy(szInclude, pszStart, min((int)(pch - pszStart) + 1, (int)sizeof(szInclude)));
+
+			if (*pch != '\0')
+			{
+				pch++;
+			}
+
+			char szPath[MAX_PATH];
+			Q_ExtractFilePath(pszFileName, szPath, sizeof(szPath));
+			Q_strncat(szPath, szInclude, sizeof(szPath), COPY_ALL_CHARACTERS);
+
+			if (_access(szPath, 0) == 0)
+			{
+				ChecksumGDFile(crc, szPath, Visited);
+			}
+			else
+			{
+				ChecksumGDFile(crc, szInclude, Visited);
+			}
+		}
+		else
+		{
+			pch++;
+		}
+	}
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Parses the game data files into GD, unless neither the list of
+//			files nor their contents have changed since they were last parsed.
 //-----------------------------------------------------------------------------
 void CGameConfig::LoadGDFiles(void)
 {
-	GD.ClearData();
-	
 	// Save the old working directory
 	char szOldDir[MAX_PATH];
 	_getcwd( szOldDir, sizeof(szOldDir) );
@@ -441,6 +567,24 @@ void CGameConfig::LoadGDFiles(void)
 	APP()->GetDirectory( DIR_PROGRAM, szAppDir );
 	_chdir( szAppDir );
 
+	CRC32_t nCRC;
+	CRC32_Init(&nCRC);
+	CUtlDict<int, int> Visited;
+	for (int i = 0; i < nGDFiles; i++)
+	{
+		ChecksumGDFile(nCRC, GDFiles[i], Visited);
+	}
+	CRC32_Final(&nCRC);
+
+	if (m_bGDFilesLoaded && (nCRC == m_nGDFilesCRC))
+	{
+		// Nothing has changed, so the class pointers are still good.
+		_chdir( szOldDir );
+		return;
+	}
+
+	GD.ClearData();
+	
 	for (int i = 0; i < nGDFiles; i++)
 	{
 		GD.Load(GDFiles[i]);
@@ -449,6 +593,24 @@ void CGameConfig::LoadGDFiles(void)
 	// Reset our old working directory
 	_chdir( szOldDir );
 
+	m_bGDFilesLoaded = true;
+	m_nGDFilesCRC = nCRC;
+
+	//
+	// Index the classes by name. Where names repeat, the first class wins,
+	// as it does in GameData::ClassForName.
+	//
+	m_ClassNames.RemoveAll();
+	int nClassCount = GD.GetClassCount();
+	for (int i = 0; i < nClassCount; i++)
+	{
+		GDclass *pClass = GD.GetClass(i);
+		if (m_ClassNames.Find(pClass->GetName()) == m_ClassNames.InvalidIndex())
+		{
+			m_ClassNames.Insert(pClass->GetName(), pClass);
+		}
+	}
+
 	// All the class pointers have changed - now we have to
 	// reset all the class pointers in each map doc that 
 	// uses this game.
@@ -459,13 +621,31 @@ void CGameConfig::LoadGDFiles(void)
 		if (pDoc->GetGame() == this)
 		{
 			CMapWorld *pWorld = pDoc->GetMapWorld();
-			pWorld->SetClass(GD.ClassForName(pWorld->GetClassName()));
-			pWorld->EnumChildren((ENUMMAPCHILDRENPROC)UpdateClassPointer, (DWORD)&GD, MAPCLASS_TYPE(CMapEntity));
+			pWorld->SetClass(ClassForName(pWorld->GetClassName()));
+			pWorld->EnumChildren((ENUMMAPCHILDRENPROC)UpdateClassPointer, (DWORD)this, MAPCLASS_TYPE(CMapEntity));
 		}
 	}
 }
 
 
+//-----------------------------------------------------------------------------
+// Purpose: Finds a game data class by name.
+// Input  : pszName - Class name.
+// Output : Returns the class, or NULL if there is no class by that name.
+//-----------------------------------------------------------------------------
+GDclass *CGameConfig::ClassForName(const char *pszName)
+{
+	int nIndex = m_ClassNames.Find(pszName);
+	if (nIndex != m_ClassNames.InvalidIndex())
+	{
+		return m_ClassNames[nIndex];
+	}
+
+	// Not an exact match; let GameData apply its own rules.
+	return GD.ClassForName(pszName);
+}
+
+
 //-----------------------------------------------------------------------------
 // Purpose: Searches for the given filename, starting in szStartDir and looking
 //			up the directory tree.
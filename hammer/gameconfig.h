@@ -20,6 +20,8 @@
 #include "GamePalette.h"
 #include "IEditorTexture.h"
 #include "UtlVector.h"
+#include "utldict.h"
+#include "checksum_crc.h"
 
 
 class MDkeyvalue;
@@ -99,6 +101,9 @@ public:
 	bool Save(const char *pszFileName, const char *pszSection);
 	void CopyFrom(CGameConfig *pConfig);
 	void LoadGDFiles(void);
+	inline void EnsureGDFilesLoaded(void);
+
+	GDclass *ClassForName(const char *pszName);
 
 	void ParseGameInfo();
 
@@ -112,6 +117,10 @@ protected:
 	int m_nDefaultLightmapScale;
 	char m_szCordonTexture[MAX_PATH];
 
+	bool m_bGDFilesLoaded;					// Whether GD holds the current game data files.
+	CRC32_t m_nGDFilesCRC;					// Checksum of the game data files (and their includes) in GD.
+	CUtlDict<GDclass *, int> m_ClassNames;	// Classes in GD by name, for fast lookup.
+
 		// These settings are loaded from GameInfo.txt:
 		char m_szSteamDir[MAX_PATH];			// The full path to steam.exe
 		char m_szSteamUserDir[MAX_PATH];		// The full path to the users's directory under SteamApps
@@ -119,6 +128,19 @@ protected:
 };
 
 
+//-----------------------------------------------------------------------------
+// Purpose: Loads the game data files if they haven't been loaded since the
+//			configuration was loaded.
+//-----------------------------------------------------------------------------
+void CGameConfig::EnsureGDFilesLoaded(void)
+{
+	if (!m_bGDFilesLoaded)
+	{
+		LoadGDFiles();
+	}
+}
+
+
 //-----------------------------------------------------------------------------
 // Purpose: 
 //-----------------------------------------------------------------------------
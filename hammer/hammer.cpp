@@ -53,6 +53,7 @@
 #include "tier0/dbg.h"
 #include "tier0/icommandline.h"
 #include "utlmap.h"
+#include "vstdlib/jobthread.h"
 #include "vgui_controls/Controls.h"
 //#include "SteamWriteMiniDump.h"
 #include "datacache/idatacache.h"
@@ -890,6 +891,10 @@ InitReturnVal_t CHammer::HammerInternalInit()
 	if ( nRetVal != INIT_OK )
 		return nRetVal;
 
+	// Start the job threads used to spread loading work over all cores
+	ThreadPoolStartParams_t startParams;
+	g_pThreadPool->Start( startParams );
+
 	if ( !Check16BitColor() )
 		return INIT_FAILED;
 
@@ -1170,6 +1175,8 @@ void CHammer::Shutdown()
 		g_LPreviewThread = 0;
 	}
 
+	g_pThreadPool->Stop();
+
 #ifdef VPROF_HAMMER
 	g_VProfCurrentProfile.Stop();
 #endif
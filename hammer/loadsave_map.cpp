@@ -857,7 +857,7 @@ int CEditGameClass::SerializeMAP(std::fstream& file, BOOL fIsStoring)
 		GDclass *pGameDataClass = NULL;
 		if (pGD != NULL)
 		{
-			pGameDataClass = pGD->ClassForName(m_szClass);
+			pGameDataClass = g_pGameConfig->ClassForName(m_szClass);
 		}
 
 		//
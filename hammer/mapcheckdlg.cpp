@@ -740,7 +740,7 @@ static BOOL FindPlayer(CMapEntity *pObject, DWORD)
 static void CheckRequirements(CListBox *pList, CMapWorld *pWorld)
 {
 	// ensure there's a player start .. 
-	if (pWorld->EnumChildren((ENUMMAPCHILDRENPROC)FindPlayer, 0, MAPCLASS_TYPE(CMapEntity)))
+	if (pWorld->EnumObjects((ENUMMAPCHILDRENPROC)FindPlayer, 0, MAPCLASS_TYPE(CMapEntity)))
 	{
 		// if rvl is !0, it was not stopped prematurely.. which means there is 
 		// NO player start.
@@ -788,7 +788,7 @@ static BOOL _CheckMixedFaces(CMapSolid *pSolid, CListBox *pList)
 
 static void CheckMixedFaces(CListBox *pList, CMapWorld *pWorld)
 {
-	pWorld->EnumChildren((ENUMMAPCHILDRENPROC)_CheckMixedFaces, (DWORD)pList, MAPCLASS_TYPE(CMapSolid));
+	pWorld->EnumObjects((ENUMMAPCHILDRENPROC)_CheckMixedFaces, (DWORD)pList, MAPCLASS_TYPE(CMapSolid));
 }
 
 
@@ -803,12 +803,10 @@ bool FindDuplicateNodeID(CMapEntity *pNode, CMapWorld *pWorld)
 	if ( !IsCheckVisible( pNode ) )
 		return false;
 
-	EnumChildrenPos_t pos;
-	CMapClass *pChild = pWorld->GetFirstDescendent(pos);
-	while (pChild != NULL)
+	CMapWorldObjectIter<CMapEntity> it(pWorld->EntityList_Get());
+	for (CMapEntity *pEntity = it.First(); pEntity != NULL; pEntity = it.Next())
 	{
-		CMapEntity *pEntity = dynamic_cast<CMapEntity *>(pChild);
-		if (pEntity && IsCheckVisible( pEntity ) && (pEntity != pNode) && pEntity->IsNodeClass())
+		if (IsCheckVisible( pEntity ) && (pEntity != pNode) && pEntity->IsNodeClass())
 		{
 			int nNodeID1 = pNode->GetNodeID();
 			int nNodeID2 = pEntity->GetNodeID();
@@ -817,8 +815,6 @@ bool FindDuplicateNodeID(CMapEntity *pNode, CMapWorld *pWorld)
 				return true;
 			}
 		}
-		
-		pChild = pWorld->GetNextDescendent(pos);
 	}
 
 	return false;
@@ -830,20 +826,16 @@ bool FindDuplicateNodeID(CMapEntity *pNode, CMapWorld *pWorld)
 //-----------------------------------------------------------------------------
 static void CheckDuplicateNodeIDs(CListBox *pList, CMapWorld *pWorld)
 {
-	EnumChildrenPos_t pos;
-	CMapClass *pChild = pWorld->GetFirstDescendent(pos);
-	while (pChild != NULL)
+	CMapWorldObjectIter<CMapEntity> it(pWorld->EntityList_Get());
+	for (CMapEntity *pEntity = it.First(); pEntity != NULL; pEntity = it.Next())
 	{
-		CMapEntity *pEntity = dynamic_cast<CMapEntity *>(pChild);
-		if (pEntity && pEntity->IsNodeClass())
+		if (pEntity->IsNodeClass())
 		{
 			if (FindDuplicateNodeID(pEntity, pWorld))
 			{
 				AddError(pList, ErrorDuplicateNodeIDs, (DWORD)pWorld, pEntity);
 			}
 		}
-		
-		pChild = pWorld->GetNextDescendent(pos);
 	}
 }
 
@@ -906,7 +898,7 @@ static BOOL _CheckDuplicatePlanes(CMapSolid *pSolid, CListBox *pList)
 
 static void CheckDuplicatePlanes(CListBox *pList, CMapWorld *pWorld)
 {
-	pWorld->EnumChildren((ENUMMAPCHILDRENPROC)_CheckDuplicatePlanes, (DWORD)pList, MAPCLASS_TYPE(CMapSolid));
+	pWorld->EnumObjects((ENUMMAPCHILDRENPROC)_CheckDuplicatePlanes, (DWORD)pList, MAPCLASS_TYPE(CMapSolid));
 }
 
 
@@ -960,7 +952,7 @@ static void CheckDuplicateFaceIDs(CListBox *pList, CMapWorld *pWorld)
 	Lists.All.SetGrowSize(128);
 	Lists.Duplicates.SetGrowSize(128);
 
-	pWorld->EnumChildren((ENUMMAPCHILDRENPROC)_CheckDuplicateFaceIDs, (DWORD)&Lists, MAPCLASS_TYPE(CMapSolid));
+	pWorld->EnumObjects((ENUMMAPCHILDRENPROC)_CheckDuplicateFaceIDs, (DWORD)&Lists, MAPCLASS_TYPE(CMapSolid));
 
 	for (int i = 0; i < Lists.Duplicates.Count(); i++)
 	{
@@ -1040,7 +1032,7 @@ static BOOL _CheckMissingTargets(CMapEntity *pEntity, CListBox *pList)
 
 static void CheckMissingTargets(CListBox *pList, CMapWorld *pWorld)
 {
-	pWorld->EnumChildren((ENUMMAPCHILDRENPROC)_CheckMissingTargets, (DWORD)pList, MAPCLASS_TYPE(CMapEntity));
+	pWorld->EnumObjects((ENUMMAPCHILDRENPROC)_CheckMissingTargets, (DWORD)pList, MAPCLASS_TYPE(CMapEntity));
 }
 
 
@@ -1082,7 +1074,7 @@ static BOOL _CheckSolidIntegrity(CMapSolid *pSolid, CListBox *pList)
 
 static void CheckSolidIntegrity(CListBox *pList, CMapWorld *pWorld)
 {
-	pWorld->EnumChildren((ENUMMAPCHILDRENPROC)_CheckSolidIntegrity, (DWORD)pList, MAPCLASS_TYPE(CMapSolid));
+	pWorld->EnumObjects((ENUMMAPCHILDRENPROC)_CheckSolidIntegrity, (DWORD)pList, MAPCLASS_TYPE(CMapSolid));
 }
 
 
@@ -1121,7 +1113,7 @@ static void CheckSolidContents(CListBox *pList, CMapWorld *pWorld)
 {
 	if (CMapDoc::GetActiveMapDoc() && CMapDoc::GetActiveMapDoc()->GetGame() && CMapDoc::GetActiveMapDoc()->GetGame()->mapformat == mfQuake2)
 	{
-		pWorld->EnumChildren((ENUMMAPCHILDRENPROC)_CheckSolidContents, (DWORD)pList, MAPCLASS_TYPE(CMapSolid));
+		pWorld->EnumObjects((ENUMMAPCHILDRENPROC)_CheckSolidContents, (DWORD)pList, MAPCLASS_TYPE(CMapSolid));
 	}
 }
 
@@ -1163,7 +1155,7 @@ static BOOL _CheckInvalidTextures(CMapSolid *pSolid, CListBox *pList)
 
 static void CheckInvalidTextures(CListBox *pList, CMapWorld *pWorld)
 {
-	pWorld->EnumChildren((ENUMMAPCHILDRENPROC)_CheckInvalidTextures, (DWORD)pList, MAPCLASS_TYPE(CMapSolid));
+	pWorld->EnumObjects((ENUMMAPCHILDRENPROC)_CheckInvalidTextures, (DWORD)pList, MAPCLASS_TYPE(CMapSolid));
 }
 
 
@@ -1200,7 +1192,7 @@ static BOOL _CheckUnusedKeyvalues(CMapEntity *pEntity, CListBox *pList)
 
 static void CheckUnusedKeyvalues(CListBox *pList, CMapWorld *pWorld)
 {
-	pWorld->EnumChildren((ENUMMAPCHILDRENPROC)_CheckUnusedKeyvalues, (DWORD)pList, MAPCLASS_TYPE(CMapEntity));
+	pWorld->EnumObjects((ENUMMAPCHILDRENPROC)_CheckUnusedKeyvalues, (DWORD)pList, MAPCLASS_TYPE(CMapEntity));
 }
 
 
@@ -1226,7 +1218,7 @@ static BOOL _CheckEmptyEntities(CMapEntity *pEntity, CListBox *pList)
 
 static void CheckEmptyEntities(CListBox *pList, CMapWorld *pWorld)
 {
-	pWorld->EnumChildren((ENUMMAPCHILDRENPROC)_CheckEmptyEntities, (DWORD)pList, MAPCLASS_TYPE(CMapEntity));
+	pWorld->EnumObjects((ENUMMAPCHILDRENPROC)_CheckEmptyEntities, (DWORD)pList, MAPCLASS_TYPE(CMapEntity));
 }
 
 
@@ -1263,7 +1255,7 @@ static BOOL _CheckBadConnections(CMapEntity *pEntity, CListBox *pList)
 
 static void CheckBadConnections(CListBox *pList, CMapWorld *pWorld)
 {
-	pWorld->EnumChildren((ENUMMAPCHILDRENPROC)_CheckBadConnections, (DWORD)pList, MAPCLASS_TYPE(CMapEntity));
+	pWorld->EnumObjects((ENUMMAPCHILDRENPROC)_CheckBadConnections, (DWORD)pList, MAPCLASS_TYPE(CMapEntity));
 }
 
 
@@ -1391,7 +1383,7 @@ static BOOL _CheckOverlayFaceList( CMapEntity *pEntity, CListBox *pList )
 //-----------------------------------------------------------------------------
 static void CheckOverlayFaceList( CListBox *pList, CMapWorld *pWorld )
 {
-	pWorld->EnumChildren( ( ENUMMAPCHILDRENPROC )_CheckOverlayFaceList, ( DWORD )pList, MAPCLASS_TYPE( CMapEntity ));
+	pWorld->EnumObjects( ( ENUMMAPCHILDRENPROC )_CheckOverlayFaceList, ( DWORD )pList, MAPCLASS_TYPE( CMapEntity ));
 }
 
 //
@@ -107,6 +107,11 @@ CMapClass::CMapClass(void)
 
 	r = g = b = 220;
 	m_pParent = NULL;
+	m_nChildIndex = -1;
+	m_nChildBatchDepth = 0;
+	m_nChildBatchHoles = 0;
+	m_bChildBatchAdded = false;
+	m_bChildBatchRemoved = false;
 	m_nRenderFrame = 0;
 	m_pEditorKeys = NULL;
 	m_Dependents.Purge();
@@ -638,19 +643,83 @@ void CMapClass::RemoveAllVisGroups(void)
 }
 
 
+//-----------------------------------------------------------------------------
+// Purpose: Returns whether the given object is in our child list. Each child
+//			remembers its slot in its parent's list, so this is constant time.
+//			The parent pointer alone is not enough since CopyFrom copies it
+//			without adding the copy to the parent's list.
+//-----------------------------------------------------------------------------
+bool CMapClass::IsChildInList(CMapClass *pChild) const
+{
+	int nIndex = pChild->m_nChildIndex;
+	return (nIndex >= 0) && (nIndex < m_Children.Count()) && (m_Children[nIndex] == pChild);
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Removes the child at the given slot, keeping the order of the
+//			remaining children. During a batch the slot is just emptied, and
+//			EndChildBatch closes up all the empty slots at once. Otherwise the
+//			children after the slot shift down by one and their indices are
+//			fixed up. Does not touch the removed child's parent pointer.
+// Input  : nIndex - Slot of the child to remove.
+//-----------------------------------------------------------------------------
+void CMapClass::RemoveChildAt(int nIndex)
+{
+	m_Children[nIndex]->m_nChildIndex = -1;
+
+	if (m_nChildBatchDepth > 0)
+	{
+		m_Children[nIndex] = NULL;
+		m_nChildBatchHoles++;
+		return;
+	}
+
+	m_Children.Remove(nIndex);
+
+	for (int i = nIndex; i < m_Children.Count(); i++)
+	{
+		m_Children[i]->m_nChildIndex = i;
+	}
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Closes up the slots emptied by removals during a batch, keeping the
+//			order of the remaining children.
+//-----------------------------------------------------------------------------
+void CMapClass::CompactChildren(void)
+{
+	int nCount = 0;
+	for (int i = 0; i < m_Children.Count(); i++)
+	{
+		CMapClass *pChild = m_Children[i];
+		if (pChild != NULL)
+		{
+			m_Children[nCount] = pChild;
+			pChild->m_nChildIndex = nCount;
+			nCount++;
+		}
+	}
+
+	m_Children.RemoveMultipleFromTail(m_Children.Count() - nCount);
+	m_nChildBatchHoles = 0;
+}
+
+
 //-----------------------------------------------------------------------------
 // Purpose: Adds the specified child to this object.
 // Input  : pChild - Object to add as a child of this object.
 //-----------------------------------------------------------------------------
 void CMapClass::AddChild(CMapClass *pChild)
 {
-	if ( m_Children.Find(pChild) != -1 )
+	if (IsChildInList(pChild))
 	{
 		pChild->m_pParent = this;
 		return;
 	}
 
-	m_Children.AddToTail(pChild);
+	pChild->m_nChildIndex = m_Children.AddToTail(pChild);
 	pChild->m_pParent = this;
 
 	//
@@ -665,7 +734,11 @@ void CMapClass::AddChild(CMapClass *pChild)
 	pChild->GetRender2DBox(vecMins, vecMaxs);
 	m_Render2DBox.UpdateBounds(vecMins, vecMaxs);
 
-	if (m_pParent != NULL)
+	if (m_nChildBatchDepth > 0)
+	{
+		m_bChildBatchAdded = true;
+	}
+	else if (m_pParent != NULL)
 	{
 		GetParent()->UpdateChild(this);
 	}
@@ -682,13 +755,18 @@ void CMapClass::RemoveAllChildren(void)
 	//
 	FOR_EACH_OBJ( m_Children, pos )
 	{	
-		m_Children[pos]->m_pParent = NULL;
+		if (m_Children[pos] != NULL)
+		{
+			m_Children[pos]->m_pParent = NULL;
+			m_Children[pos]->m_nChildIndex = -1;
+		}
 	}	
 
 	//
 	// Remove them from our list.
 	//
 	m_Children.RemoveAll();
+	m_nChildBatchHoles = 0;
 }
 
 
@@ -699,7 +777,7 @@ void CMapClass::RemoveAllChildren(void)
 //-----------------------------------------------------------------------------
 void CMapClass::RemoveChild(CMapClass *pChild, bool bUpdateBounds)
 {
-	int index = m_Children.Find(pChild);
+	int index = IsChildInList(pChild) ? pChild->m_nChildIndex : -1;
 
 	if (index == -1)
 	{
@@ -707,13 +785,61 @@ void CMapClass::RemoveChild(CMapClass *pChild, bool bUpdateBounds)
 		return;
 	}
 
-	m_Children.Remove(index);
+	RemoveChildAt(index);
 	pChild->m_pParent = NULL;
 
 	if (bUpdateBounds)
+	{
+		if (m_nChildBatchDepth > 0)
+		{
+			m_bChildBatchRemoved = true;
+		}
+		else
+		{
+			PostUpdate(Notify_Removed);
+		}
+	}
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Starts a batch of child changes. Until the matching EndChildBatch,
+//			adding or removing children does not propagate bounds up the tree.
+//-----------------------------------------------------------------------------
+void CMapClass::BeginChildBatch(void)
+{
+	m_nChildBatchDepth++;
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Ends a batch of child changes, doing the single update that AddChild
+//			and RemoveChild would otherwise have done once per child.
+//-----------------------------------------------------------------------------
+void CMapClass::EndChildBatch(void)
+{
+	Assert(m_nChildBatchDepth > 0);
+	if (--m_nChildBatchDepth > 0)
+	{
+		return;
+	}
+
+	if (m_nChildBatchHoles > 0)
+	{
+		CompactChildren();
+	}
+
+	if (m_bChildBatchRemoved)
 	{
 		PostUpdate(Notify_Removed);
 	}
+	else if (m_bChildBatchAdded && (m_pParent != NULL))
+	{
+		GetParent()->UpdateChild(this);
+	}
+
+	m_bChildBatchAdded = false;
+	m_bChildBatchRemoved = false;
 }
 
 
@@ -724,6 +850,8 @@ void CMapClass::RemoveChild(CMapClass *pChild, bool bUpdateBounds)
 //-----------------------------------------------------------------------------
 void CMapClass::CopyChildrenFrom(CMapClass *pobj, bool bUpdateDependencies)
 {
+	BeginChildBatch();
+
 	FOR_EACH_OBJ( pobj->m_Children, pos )
 	{
 		CMapClass *pChild = pobj->m_Children.Element(pos);
@@ -731,6 +859,8 @@ void CMapClass::CopyChildrenFrom(CMapClass *pobj, bool bUpdateDependencies)
 		pChildCopy->CopyChildrenFrom(pChild, bUpdateDependencies);
 		AddChild(pChildCopy);
 	}
+
+	EndChildBatch();
 }
 
 
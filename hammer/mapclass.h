@@ -216,6 +216,15 @@ public:
 	virtual void RemoveChild(CMapClass *pChild, bool bUpdateBounds = true);
 	virtual void UpdateChild(CMapClass *pChild);
 
+	//
+	// Defers bounds propagation to our parent while many children are added or
+	// removed at once. Calls may be nested; the update happens at the outermost end.
+	// Children removed during a batch leave empty slots in the child list which
+	// are closed up in one pass at the outermost end.
+	//
+	void BeginChildBatch(void);
+	void EndChildBatch(void);
+
 	inline int GetChildCount(void) { return( m_Children.Count()); }
 	inline const CMapObjectList *GetChildren() { return &m_Children; }
 		
@@ -418,12 +427,21 @@ protected:
 
 	void UpdateParent(CMapClass *pNewParent);
 
+	bool IsChildInList(CMapClass *pChild) const;
+	void RemoveChildAt(int nIndex);
+	void CompactChildren(void);
+
 	CSmartPtr< CSafeObject< CMapClass > > m_pSafeObject;
 
 	BoundBox m_CullBox;				// Our bounds for culling in the 3D views and intersecting with the cordon.
 	BoundBox m_Render2DBox;			// Our bounds for rendering in the 2D views.
 
 	CMapObjectList m_Children;		// Each object can have many children. Children usually transform with their parents, etc.
+	int m_nChildIndex;				// Our slot in our parent's child list, -1 if we are not in one.
+	int m_nChildBatchDepth;			// Nesting depth of BeginChildBatch/EndChildBatch.
+	int m_nChildBatchHoles;			// Empty slots left in m_Children by removals during the current batch.
+	bool m_bChildBatchAdded;		// Whether children were added during the current batch.
+	bool m_bChildBatchRemoved;		// Whether children were removed during the current batch.
 	CMapObjectList m_Dependents;	// Objects that this object should notify if it changes.
 
 	int m_nID;						// This object's unique ID.
@@ -4313,6 +4313,25 @@ void CMapDoc::OnToolsGroup(void)
 
 	pGroup->SetRenderColor(100 + (random() % 156), 100 + (random() % 156), 0);
 
+	//
+	// Update the group's bounds once rather than once per object. The objects'
+	// old parents are batched too, so their child lists are closed up in one
+	// pass instead of once per removed object.
+	//
+	pGroup->BeginChildBatch();
+
+	CUtlVector<CMapClass *> OldParents;
+	OldParents.EnsureCapacity(pSelList->Count());
+	for (int i = 0; i < pSelList->Count(); i++)
+	{
+		CMapClass *pParent = pSelList->Element(i)->GetParent();
+		if (pParent != NULL)
+		{
+			pParent->BeginChildBatch();
+			OldParents.AddToTail(pParent);
+		}
+	}
+
 	for (int i = 0; i < pSelList->Count(); i++)
 	{
 		CMapClass *pobj = pSelList->Element(i);
@@ -4323,6 +4342,13 @@ void CMapDoc::OnToolsGroup(void)
 		pGroup->AddChild(pobj);
 	}
 
+	for (int i = 0; i < OldParents.Count(); i++)
+	{
+		OldParents[i]->EndChildBatch();
+	}
+
+	pGroup->EndChildBatch();
+
 	//
 	// Keep the group as a new object. Don't keep its children here,
 	// because they are not new.
@@ -4385,12 +4411,15 @@ void CMapDoc::OnToolsUngroup(void)
 		//
 		// Move the group's former children to the group's parent.
 		//
+		CMapClass *pParent = pobj->GetParent();
+		pParent->BeginChildBatch();
+
 		int nChildCount = ChildList.Count();
 		for (int i = 0; i < nChildCount; i++)
 		{		
 			CMapClass *pChild = ChildList.Element(i);
 
-			pobj->GetParent()->AddChild(pChild);
+			pParent->AddChild(pChild);
 			
 			int nVisGroupCount = pobj->GetVisGroupCount();
 			for (int nVisGroup = 0; nVisGroup < nVisGroupCount; nVisGroup++)
@@ -4403,6 +4432,8 @@ void CMapDoc::OnToolsUngroup(void)
 			SelectObject(pChild, scSelect);
 		}
 
+		pParent->EndChildBatch();
+
 		//
 		// The group is empty; delete it.
 		//
@@ -7192,6 +7223,7 @@ void CMapDoc::ReplaceTextures(LPCTSTR pszFind, LPCTSTR pszReplace, BOOL bEveryth
 	CFaceEditSheet *pSheet = GetMainWnd()->m_pFaceEditSheet;
 	HCURSOR hCursorOld = SetCursor(LoadCursor(NULL, IDC_WAIT));
 	pSheet->EnableUpdate(false);
+	CMapFace::BeginTextureCoordBatch();
 
 	// set up info struct to pass to callback
 	ReplaceTexInfo_t info;
@@ -7261,6 +7293,8 @@ void CMapDoc::ReplaceTextures(LPCTSTR pszFind, LPCTSTR pszReplace, BOOL bEveryth
 		}
 	}
 
+	CMapFace::EndTextureCoordBatch();
+
 	CString str;
 	if (!info.bMarkOnly)
 	{
@@ -7320,6 +7354,7 @@ void CMapDoc::BatchReplaceTextures( FileHandle_t fp )
 	char buf[MAX_REPLACE_LINE_LENGTH];
 	BatchReplaceTextures_t Info;
 
+	CMapFace::BeginTextureCoordBatch();
 	while( g_pFullFileSystem->ReadLine( buf, sizeof( buf ), fp ) )
 	{
 		scan = buf;
@@ -7386,6 +7421,7 @@ void CMapDoc::BatchReplaceTextures( FileHandle_t fp )
 		m_pWorld->EnumChildren( ( ENUMMAPCHILDRENPROC )BatchReplaceTextureCallback, ( DWORD )&Info, MAPCLASS_TYPE( CMapSolid ) ); 
 next_line:;
 	}
+	CMapFace::EndTextureCoordBatch();
 }
 
 
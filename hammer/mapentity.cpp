@@ -826,12 +826,20 @@ void CMapEntity::SetOrigin(Vector& o)
 //-----------------------------------------------------------------------------
 void CMapEntity::RemoveHelpers(bool bRemoveSolids)
 {
+	// The helpers leave the world without going through RemoveObjectFromWorld.
+	CMapWorld *pWorld = (CMapWorld *)GetWorldObject(this);
+
 	for( int pos=m_Children.Count()-1; pos>=0; pos-- )
 	{
 		CMapClass *pChild = m_Children[pos];
 		if (bRemoveSolids || ((dynamic_cast <CMapSolid *> (pChild)) == NULL))
 		{
-			m_Children.FastRemove(pos);
+			if (pWorld != NULL)
+			{
+				pWorld->ObjectLists_Remove(pChild, true);
+			}
+
+			RemoveChildAt(pos);
 		}
 		// LEAKLEAK: need to KeepForDestruction to avoid undo crashes, but how? where?
 		//delete pChild;
@@ -25,6 +25,7 @@
 #include "camera.h"
 #include "options.h"
 #include "hammer.h"
+#include "vstdlib/jobthread.h"
 
 
 // memdbgon must be the last include file in a .cpp file!!!
@@ -65,6 +66,8 @@ LPCTSTR GetDefaultTextureName();
 //
 bool CMapFace::m_bShowFaceSelection = true;
 IEditorTexture *CMapFace::m_pLightmapGrid = NULL;
+int CMapFace::m_nTextureCoordBatchDepth = 0;
+CUtlVector<CMapFace *> CMapFace::m_TextureCoordBatchFaces;
 
 
 //-----------------------------------------------------------------------------
@@ -85,6 +88,8 @@ CMapFace::CMapFace(void)
 	m_nFaceID = 0;
 	m_pTextureCoords = NULL;
 	m_pLightmapCoords = NULL;
+	m_bTextureCoordsDirty = false;
+	m_nTextureCoordBatchSlot = -1;
 	m_uchAlpha = 255;
 
 	m_pDetailObjects = NULL;
@@ -114,6 +119,13 @@ CMapFace::CMapFace(void)
 CMapFace::~CMapFace(void)
 {
 	SignalUpdate( EVTYPE_FACE_CHANGED );
+	if ( m_nTextureCoordBatchSlot != -1 )
+	{
+		// Leave a hole rather than searching the batch; EndTextureCoordBatch skips it.
+		Assert( m_TextureCoordBatchFaces[m_nTextureCoordBatchSlot] == this );
+		m_TextureCoordBatchFaces[m_nTextureCoordBatchSlot] = NULL;
+	}
+
 	delete [] Points;
 	Points = NULL;
 
@@ -218,6 +230,19 @@ void CMapFace::UpdateFaceFlags( void )
 }
 
 
+//-----------------------------------------------------------------------------
+// Purpose: Sets the unique ID of this face.
+//-----------------------------------------------------------------------------
+void CMapFace::SetFaceID(int nID)
+{
+	if (m_nFaceID != nID)
+	{
+		m_nFaceID = nID;
+		CMapWorld::FaceID_UpdateFace(this);
+	}
+}
+
+
 //-----------------------------------------------------------------------------
 // Purpose: Populates this face with another face's information.
 // Input  : pFrom - The face to copy.
@@ -259,7 +284,11 @@ CMapFace *CMapFace::CopyFrom(const CMapFace *pObject, DWORD dwFlags, bool bUpdat
 		//
 		// Copy the member data.
 		//
-		m_nFaceID = pFrom->m_nFaceID;
+		if (m_nFaceID != pFrom->m_nFaceID)
+		{
+			m_nFaceID = pFrom->m_nFaceID;
+			CMapWorld::FaceID_UpdateFace(this);
+		}
 		m_eSelectionState = pFrom->GetSelectionState();
 		texture = pFrom->texture;
 		m_pTexture = pFrom->m_pTexture;
@@ -275,6 +304,7 @@ CMapFace *CMapFace::CopyFrom(const CMapFace *pObject, DWORD dwFlags, bool bUpdat
 
 			if (pFrom->Points && nPoints)
 			{
+				const_cast<CMapFace *>(pFrom)->ResolveTextureCoords();
 				AllocatePoints(nPoints);
 				AllocTangentSpaceAxes( nPoints );
 				memcpy(Points, pFrom->Points, sizeof(Vector) * nPoints);
@@ -1408,12 +1438,11 @@ void CMapFace::CalcLightmapCoordAtPoint( const Vector& pt, Vector2D &lightCoord
 
 //-----------------------------------------------------------------------------
 // Purpose: Calculates the U,V texture coordinates of all points on this face.
+//			Within a texture coordinate batch, faces without displacements are
+//			only marked, and updated when the batch ends.
 //-----------------------------------------------------------------------------
 void CMapFace::CalcTextureCoords(void)
 {
-	float s, t;
-	int i;
-
 	if (m_pTexture == NULL)
 	{
 		return;
@@ -1432,52 +1461,185 @@ void CMapFace::CalcTextureCoords(void)
 		texture.scale[1] = g_pGameConfig->GetDefaultTextureScale();
 	}
 
+	if ( ( m_nTextureCoordBatchDepth > 0 ) && ( m_DispHandle == EDITDISPHANDLE_INVALID ) )
+	{
+		m_bTextureCoordsDirty = true;
+		if ( m_nTextureCoordBatchSlot == -1 )
+		{
+			m_nTextureCoordBatchSlot = m_TextureCoordBatchFaces.AddToTail( this );
+		}
+		return;
+	}
+
+	UpdateTextureCoords();
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Calculates the texture coordinates, lightmap coordinates and tangent
+//			space axes of this face right away.
+//-----------------------------------------------------------------------------
+void CMapFace::UpdateTextureCoords(void)
+{
+	m_bTextureCoordsDirty = false;
+
+	if (m_pTexture == NULL)
+	{
+		return;
+	}
+
+	ComputeTextureCoords( m_pTexture->GetWidth(), m_pTexture->GetHeight() );
+
+	//
+    // update the displacement map with new texture coordinates and calculate lightmap coordinates
+	//
+	if( ( m_DispHandle != EDITDISPHANDLE_INVALID ) && nPoints == 4 )
+    {
+		CMapDisp *pDisp = EditDispMgr()->GetDisp( m_DispHandle );
+		pDisp->InitDispSurfaceData( this, false );
+		pDisp->Create();
+    }
+
+	// re-calculate the tangent space
+	CalcTangentSpaceAxes();
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Recalculates the U,V texture coordinates and, when there is no
+//			displacement, the lightmap coordinates of all points. Only touches
+//			this face, so batches of faces can be done on several threads.
+//-----------------------------------------------------------------------------
+void CMapFace::ComputeTextureCoords( int nTextureWidth, int nTextureHeight )
+{
+	const Vector &UAxis = texture.UAxis.AsVector3D();
+	const Vector &VAxis = texture.VAxis.AsVector3D();
+	bool bLightmapCoords = ( m_DispHandle == EDITDISPHANDLE_INVALID );
+	float shiftScaleU = texture.scale[0] / (float)texture.nLightmapScale;
+	float shiftScaleV = texture.scale[1] / (float)texture.nLightmapScale;
+
 	//
 	// Recalculate U,V coordinates for all points.
 	//
-	for (i = 0; i < nPoints; i++)
+	for (int i = 0; i < nPoints; i++)
 	{
+		float flDotU = DotProduct(UAxis, Points[i]);
+		float flDotV = DotProduct(VAxis, Points[i]);
+
 		//
 		// Generate texture coordinates.
 		//
-		s = DotProduct(texture.UAxis.AsVector3D(), Points[i]) / texture.scale[0] + texture.UAxis[3];
-		t = DotProduct(texture.VAxis.AsVector3D(), Points[i]) / texture.scale[1] + texture.VAxis[3];
+		float s = flDotU / texture.scale[0] + texture.UAxis[3];
+		float t = flDotV / texture.scale[1] + texture.VAxis[3];
 
-		if (m_pTexture->GetWidth())
-			m_pTextureCoords[i][0] = s / (float)m_pTexture->GetWidth();
+		if (nTextureWidth)
+			m_pTextureCoords[i][0] = s / (float)nTextureWidth;
 		else
 			m_pTextureCoords[i][0] = 0.0f;
 
-		if (m_pTexture->GetHeight())
-			m_pTextureCoords[i][1] = t / (float)m_pTexture->GetHeight();
+		if (nTextureHeight)
+			m_pTextureCoords[i][1] = t / (float)nTextureHeight;
  		else
 			m_pTextureCoords[i][1] = 0.0f;
 
 		//
-		// Generate lightmap coordinates.  Lightmap coordinates for displacements happens below.
+		// Generate lightmap coordinates.  Lightmap coordinates for displacements are
+		// calculated by the displacement.
 		//
-		if ( m_DispHandle == EDITDISPHANDLE_INVALID )
+		if ( bLightmapCoords )
 		{
-			float shiftScaleU = texture.scale[0] / (float)texture.nLightmapScale;
-			float shiftScaleV = texture.scale[1] / (float)texture.nLightmapScale;
-
-			m_pLightmapCoords[i][0] = DotProduct(texture.UAxis.AsVector3D(), Points[i]) / texture.nLightmapScale + texture.UAxis[3] * shiftScaleU + 0.5;
-			m_pLightmapCoords[i][1] = DotProduct(texture.VAxis.AsVector3D(), Points[i]) / texture.nLightmapScale + texture.VAxis[3] * shiftScaleV + 0.5;
+			m_pLightmapCoords[i][0] = flDotU / texture.nLightmapScale + texture.UAxis[3] * shiftScaleU + 0.5;
+			m_pLightmapCoords[i][1] = flDotV / texture.nLightmapScale + texture.VAxis[3] * shiftScaleV + 0.5;
 		}
  	}
+}
 
-	//
-    // update the displacement map with new texture coordinates and calculate lightmap coordinates
-	//
-	if( ( m_DispHandle != EDITDISPHANDLE_INVALID ) && nPoints == 4 )
-    {
-		CMapDisp *pDisp = EditDispMgr()->GetDisp( m_DispHandle );
-		pDisp->InitDispSurfaceData( this, false );
-		pDisp->Create();
-    }
 
-	// re-calculate the tangent space
-	CalcTangentSpaceAxes();
+//-----------------------------------------------------------------------------
+// Purpose: Opens a texture coordinate batch. Batches nest; only the outermost
+//			one updates the faces marked during it when it ends.
+//-----------------------------------------------------------------------------
+void CMapFace::BeginTextureCoordBatch( void )
+{
+	++m_nTextureCoordBatchDepth;
+}
+
+
+//-----------------------------------------------------------------------------
+// A face left waiting on a texture coordinate batch, with its texture size
+//-----------------------------------------------------------------------------
+struct CMapFace::TextureCoordJob_t
+{
+	CMapFace *pFace;
+	int nTextureWidth;
+	int nTextureHeight;
+};
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Updates one face of a texture coordinate batch. Only touches the
+//			face itself, so it can run on any thread.
+//-----------------------------------------------------------------------------
+void CMapFace::CalcTextureCoordsJob( TextureCoordJob_t &job )
+{
+	job.pFace->ComputeTextureCoords( job.nTextureWidth, job.nTextureHeight );
+	job.pFace->FillTangentSpaceAxes();
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Closes a texture coordinate batch, updating each face marked during
+//			it once.
+//-----------------------------------------------------------------------------
+void CMapFace::EndTextureCoordBatch( void )
+{
+	Assert( m_nTextureCoordBatchDepth > 0 );
+	if ( --m_nTextureCoordBatchDepth > 0 )
+		return;
+
+	// Getting a texture's size can load it, and the tangent space axes are
+	// allocated from the heap, so both are done here before going wide.
+	CUtlVector<TextureCoordJob_t> jobs;
+	jobs.EnsureCapacity( m_TextureCoordBatchFaces.Count() );
+	for ( int i = 0; i < m_TextureCoordBatchFaces.Count(); i++ )
+	{
+		CMapFace *pFace = m_TextureCoordBatchFaces[i];
+		if ( pFace == NULL )
+			continue;
+
+		pFace->m_nTextureCoordBatchSlot = -1;
+		if ( !pFace->m_bTextureCoordsDirty )
+			continue;
+
+		// The face may have been given a displacement or lost its texture since
+		if ( ( pFace->m_pTexture == NULL ) || pFace->HasDisp() )
+		{
+			pFace->UpdateTextureCoords();
+			continue;
+		}
+
+		pFace->m_bTextureCoordsDirty = false;
+		pFace->FreeTangentSpaceAxes();
+		pFace->AllocTangentSpaceAxes( pFace->nPoints );
+
+		TextureCoordJob_t &job = jobs[ jobs.AddToTail() ];
+		job.pFace = pFace;
+		job.nTextureWidth = pFace->m_pTexture->GetWidth();
+		job.nTextureHeight = pFace->m_pTexture->GetHeight();
+	}
+	m_TextureCoordBatchFaces.RemoveAll();
+
+	if ( ( jobs.Count() > 64 ) && g_pThreadPool && ( g_pThreadPool->NumThreads() > 0 ) )
+	{
+		ParallelProcess( "CMapFace::EndTextureCoordBatch", jobs.Base(), jobs.Count(), &CMapFace::CalcTextureCoordsJob );
+	}
+	else
+	{
+		for ( int i = 0; i < jobs.Count(); i++ )
+		{
+			CalcTextureCoordsJob( jobs[i] );
+		}
+	}
 }
 
 
@@ -1702,6 +1864,8 @@ static bool ModeUsesTextureCoords(EditorRenderMode_t mode)
 //-----------------------------------------------------------------------------
 void CMapFace::DrawFace( Color &pColor, EditorRenderMode_t mode )
 {
+	ResolveTextureCoords();
+
 	// retrieve the coordinate frame to render into 
 	// (most likely just the identity, unless we're animating)
 	VMatrix frame;
@@ -1976,6 +2140,8 @@ void CMapFace::RenderGridsIfCloseEnough( CRender3D* pRender, int nCount, CMapFac
 //-----------------------------------------------------------------------------
 void CMapFace::AddFaceVertices( CMeshBuilder &meshBuilder, CRender3D* pRender, bool bRenderSelected, SelectionState_t faceSelectionState)
 {
+	ResolveTextureCoords();
+
 	Vector point;
 	VMatrix frame;
 	Color color;
@@ -2822,6 +2988,7 @@ void CMapFace::SetShowSelection(bool bShowSelection)
 //-----------------------------------------------------------------------------
 void CMapFace::SetTextureCoords(int nPoint, float u, float v)
 {
+	ResolveTextureCoords();
 	if (nPoint < nPoints)
 	{
 		m_pTextureCoords[nPoint][0] = u;
@@ -3011,9 +3178,6 @@ bool CMapFace::TraceLineInside( Vector &HitPos, Vector &HitNormal,
 
 
 //-----------------------------------------------------------------------------
-// NOTE: actually this could be calculated once for the face since only the
-//       face normal is being used (no smoothing groups, etc.), but that may 
-//       change????
 //-----------------------------------------------------------------------------
 void CMapFace::CalcTangentSpaceAxes( void )
 {
@@ -3024,6 +3188,19 @@ void CMapFace::CalcTangentSpaceAxes( void )
 	if( !AllocTangentSpaceAxes( nPoints ) )
 		return;
 
+	FillTangentSpaceAxes();
+}
+
+
+//-----------------------------------------------------------------------------
+// NOTE: only the face normal is being used (no smoothing groups, etc.), so the
+//       axes are calculated once for the face and copied to every point.
+//-----------------------------------------------------------------------------
+void CMapFace::FillTangentSpaceAxes( void )
+{
+	if( !m_pTangentAxes )
+		return;
+
 	//
 	// get the texture space axes
 	//
@@ -3031,33 +3208,29 @@ void CMapFace::CalcTangentSpaceAxes( void )
 	Vector4D& vVect = texture.VAxis;
 
 	//
-	// calculate the tangent space per polygon point
+	// create the axes
 	//
+	TangentSpaceAxes_t axis;
+	axis.binormal = vVect.AsVector3D();
+	VectorNormalize( axis.binormal );
+	CrossProduct( plane.normal, axis.binormal, axis.tangent );
+	VectorNormalize( axis.tangent );
+	CrossProduct( axis.tangent, plane.normal, axis.binormal );
+	VectorNormalize( axis.binormal );
 
-	for( int ptIndex = 0; ptIndex < nPoints; ptIndex++ )
+	//
+	// adjust tangent for "backwards" mapping if need be
+	//
+	Vector tmpVect;
+	CrossProduct( uVect.AsVector3D(), vVect.AsVector3D(), tmpVect );
+	if( DotProduct( plane.normal, tmpVect ) > 0.0f )
 	{
-		// get the current tangent space axes
-		TangentSpaceAxes_t *pAxis = &m_pTangentAxes[ptIndex];
-
-		//
-		// create the axes
-		//
-		pAxis->binormal = vVect.AsVector3D();
-		VectorNormalize( pAxis->binormal );
-		CrossProduct( plane.normal, pAxis->binormal, pAxis->tangent );
-		VectorNormalize( pAxis->tangent );
-		CrossProduct( pAxis->tangent, plane.normal, pAxis->binormal );
-		VectorNormalize( pAxis->binormal );
+		VectorScale( axis.tangent, -1.0f, axis.tangent );
+	}
 
-		//
-		// adjust tangent for "backwards" mapping if need be
-		//
-		Vector tmpVect;
-		CrossProduct( uVect.AsVector3D(), vVect.AsVector3D(), tmpVect );
-		if( DotProduct( plane.normal, tmpVect ) > 0.0f )
-		{
-			VectorScale( pAxis->tangent, -1.0f, pAxis->tangent );
-		}
+	for( int ptIndex = 0; ptIndex < nPoints; ptIndex++ )
+	{
+		m_pTangentAxes[ptIndex] = axis;
 	}
 }
 
@@ -281,6 +281,7 @@ public:
 	void CalcPlaneFromFacePoints(void);
 
 	void CalcTextureCoords();
+	inline void ResolveTextureCoords();
 	void OffsetTexture(const Vector &Delta);
 	void SetTextureCoords(int nPoint, float u, float v);
 
@@ -294,6 +295,12 @@ public:
 	bool AllocTangentSpaceAxes( int count );
 	void FreeTangentSpaceAxes( void );
 
+	// While a batch is open, CalcTextureCoords only marks faces without displacements
+	// as needing new texture coordinates. Ending the outermost batch updates each of
+	// them once, spread across the thread pool when there are many.
+	static void BeginTextureCoordBatch( void );
+	static void EndTextureCoordBatch( void );
+
 	void Render2D(CRender2D *pRender);
 	void Render3D(CRender3D *pRender);
 	void Render3DGrid(CRender3D *pRender);
@@ -322,9 +329,10 @@ public:
 	size_t GetDataSize( void );
 
 	inline int GetFaceID(void);
-	inline void SetFaceID(int nFaceID);
+	void SetFaceID(int nFaceID);
 
 	// Smoothing group.
+	inline unsigned int GetSmoothingGroups( void ) const { return m_fSmoothingGroups; }
 	int SmoothingGroupCount( void );
 	void AddSmoothingGroup( int iGroup );
 	void RemoveSmoothingGroup( int iGroup );
@@ -351,6 +359,13 @@ public:
 	
 protected:
 
+	struct TextureCoordJob_t;
+
+	void UpdateTextureCoords( void );
+	void ComputeTextureCoords( int nTextureWidth, int nTextureHeight );
+	void FillTangentSpaceAxes( void );
+	static void CalcTextureCoordsJob( TextureCoordJob_t &job );
+
 	void ComputeColor( CRender3D* pRender, bool bRenderAsSelected, SelectionState_t faceSelectionState,
 					   bool ignoreLighting, Color &pColor );
 
@@ -387,11 +402,20 @@ protected:
 
 	static bool m_bShowFaceSelection;	// Whether to render faces with a special color when they are selected.
 
+	static int m_nTextureCoordBatchDepth;					// Nesting depth of BeginTextureCoordBatch calls.
+	static CUtlVector<CMapFace *> m_TextureCoordBatchFaces;	// Faces marked during the open batch, NULL once deleted.
+
+	int m_nTextureCoordBatchSlot;		// Index in m_TextureCoordBatchFaces, -1 if not in the open batch.
+
 	Vector2D *m_pTextureCoords;			// An array of texture coordinates, one per face point.
 	Vector2D *m_pLightmapCoords;			// An array of lightmap coordinates, one per face point.
 
 	bool m_bIsCordonFace : 1;
 
+	// Texture coordinates and tangent axes are waiting on the open batch.
+	bool m_bTextureCoordsDirty : 1;
+
+
 	// should this be affected by lighting?
 	bool m_bIgnoreLighting : 1;
 
@@ -419,6 +443,7 @@ inline int CMapFace::GetFaceID(void)
 inline void CMapFace::GetLightmapCoord( Vector2D& LightmapCoord, int nIndex )
 {
     Assert( nIndex < nPoints );
+	ResolveTextureCoords();
     LightmapCoord[0] = m_pLightmapCoords[nIndex][0];
     LightmapCoord[1] = m_pLightmapCoords[nIndex][1];
 }
@@ -432,6 +457,7 @@ inline void CMapFace::GetLightmapCoord( Vector2D& LightmapCoord, int nIndex )
 inline void CMapFace::SetLightmapCoord( const Vector2D &LightmapCoord, int nIndex )
 {
     Assert( nIndex < nPoints );
+	ResolveTextureCoords();
 	m_pLightmapCoords[nIndex][0] = LightmapCoord[0];
 	m_pLightmapCoords[nIndex][1] = LightmapCoord[1];
 }
@@ -444,11 +470,25 @@ inline void CMapFace::SetLightmapCoord( const Vector2D &LightmapCoord, int nInde
 inline void CMapFace::GetTexCoord( Vector2D& TexCoord, int nTexCoord )
 {
     Assert( nTexCoord < nPoints );
+	ResolveTextureCoords();
     TexCoord[0] = m_pTextureCoords[nTexCoord][0];
     TexCoord[1] = m_pTextureCoords[nTexCoord][1];
 }
 
 
+//-----------------------------------------------------------------------------
+// Purpose: Brings texture coordinates left for the open batch up to date now,
+//			for code that reads or overrides them before the batch ends.
+//-----------------------------------------------------------------------------
+inline void CMapFace::ResolveTextureCoords()
+{
+	if ( m_bTextureCoordsDirty )
+	{
+		UpdateTextureCoords();
+	}
+}
+
+
 //-----------------------------------------------------------------------------
 // Purpose: Returns a pointer to the texture that is applied to this face, NULL if none.
 //-----------------------------------------------------------------------------
@@ -487,15 +527,6 @@ inline void CMapFace::GetFaceNormal( Vector& normal )
 }
 
 
-//-----------------------------------------------------------------------------
-// Purpose: Sets the unique ID of this face.
-//-----------------------------------------------------------------------------
-inline void CMapFace::SetFaceID(int nID)
-{
-	m_nFaceID = nID;
-}
-
-
 //-----------------------------------------------------------------------------
 // Purpose: Attaches a displacement surface to this face.
 // Input  : handle - Displacement surface handle of surface attached to this face
@@ -603,6 +634,19 @@ int CMapFaceList::FindFaceID(int nFaceID)
 }
 
 
+//-----------------------------------------------------------------------------
+// A face and the ID it was entered into its world's face ID index under,
+// linked to the other faces indexed under the same ID.
+//-----------------------------------------------------------------------------
+struct IndexedFaceID_t
+{
+	CMapFace *pFace;
+	int nFaceID;
+	int nPrev;		// Previous face with the same ID, or -1.
+	int nNext;		// Next face with the same ID, or -1.
+};
+
+
 //-----------------------------------------------------------------------------
 // Defines a container class for a list of face IDs.
 //-----------------------------------------------------------------------------
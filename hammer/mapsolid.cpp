@@ -44,6 +44,7 @@ CMapSolid::CMapSolid(CMapClass *Parent0)
 	m_pParent = Parent0;
 	m_eSolidType = btSolid;
 	m_bIsCordonBrush = false;
+	m_pFaceIDWorld = NULL;
 
 	PickRandomColor();
 }
@@ -54,6 +55,7 @@ CMapSolid::CMapSolid(CMapClass *Parent0)
 //-----------------------------------------------------------------------------
 CMapSolid::~CMapSolid(void)
 {
+	CMapWorld::FaceID_RemoveSolid(this);
 	Faces.SetCount(0);
 }
 
@@ -328,6 +330,78 @@ void CMapSolid::OnPrePaste(CMapClass *pCopy, CMapWorld *pSourceWorld, CMapWorld
 }
 
 
+#define SPLIT_DIST_EPSILON	0.001f
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Determines which side of a plane the solid's points are on. Points
+//			within SPLIT_DIST_EPSILON of the plane are on neither side. The
+//			bounds are checked first, so the points are only visited when the
+//			plane passes near or through the solid.
+//   Input: pPlane - the plane to classify against
+//  Output: PLANESIDE_FRONT - on front side
+//          PLANESIDE_BACK - on back side (or entirely on the plane)
+//          PLANESIDE_BOTH - on both sides
+//-----------------------------------------------------------------------------
+int CMapSolid::ClassifyPlane( const PLANE *pPlane )
+{
+	//
+	// The bounds contain every face point, so if the box is well clear of the
+	// plane the points are too.
+	//
+	Vector vecMins, vecMaxs;
+	m_Render2DBox.GetBounds( vecMins, vecMaxs );
+	if ( m_Render2DBox.IsValidBox() )
+	{
+		Vector vecCenter = ( vecMins + vecMaxs ) * 0.5f;
+		Vector vecExtents = ( vecMaxs - vecMins ) * 0.5f;
+
+		float flCenterDist = DotProduct( vecCenter, pPlane->normal ) - pPlane->dist;
+		float flRadius = fabs( vecExtents.x * pPlane->normal.x ) + fabs( vecExtents.y * pPlane->normal.y ) + fabs( vecExtents.z * pPlane->normal.z );
+
+		// Leave a margin for rounding in the bounds math.
+		if ( flCenterDist - flRadius > SPLIT_DIST_EPSILON + 0.01f )
+		{
+			return PLANESIDE_FRONT;
+		}
+
+		if ( flCenterDist + flRadius < -( SPLIT_DIST_EPSILON + 0.01f ) )
+		{
+			return PLANESIDE_BACK;
+		}
+	}
+
+    int   frontCount = 0;
+    int   backCount = 0;
+    
+    int faceCount = GetFaceCount();
+    for( int i = 0; i < faceCount; i++ )
+    {
+        CMapFace *pFace = GetFace( i );
+
+        for( int j = 0; j < pFace->nPoints; j++ )
+        {
+            float dist = DotProduct( pFace->Points[j], pPlane->normal ) - pPlane->dist;
+            if( dist > SPLIT_DIST_EPSILON )
+            {
+                frontCount++;
+            }
+            else if( dist < -SPLIT_DIST_EPSILON )
+            {
+                backCount++;
+            }
+        }
+
+		if ( frontCount && backCount )
+		{
+			return PLANESIDE_BOTH;
+		}
+    }
+
+	return ( frontCount == 0 ) ? PLANESIDE_BACK : PLANESIDE_FRONT;
+}
+
+
 //-----------------------------------------------------------------------------
 // Purpose: to split the solid by the given plane into frontside and backside 
 //          solids; memory is allocated in the function for the solids;
@@ -343,7 +417,6 @@ void CMapSolid::OnPrePaste(CMapClass *pCopy, CMapWorld *pSourceWorld, CMapWorld
 //-----------------------------------------------------------------------------
 int CMapSolid::Split( PLANE *pPlane, CMapSolid **pFront, CMapSolid **pBack )
 {
-    const float SPLIT_DIST_EPSILON = 0.001f;
     CMapSolid *pFrontSolid = NULL;
     CMapSolid *pBackSolid = NULL;
     CMapFace  face;
@@ -360,37 +433,17 @@ int CMapSolid::Split( PLANE *pPlane, CMapSolid **pFront, CMapSolid **pBack )
     //
     // check for plane intersection with solid
     //
-    int   frontCount = 0;
-    int   backCount = 0;
-    
-    int faceCount = GetFaceCount();
-    for( int i = 0; i < faceCount; i++ )
-    {
-        CMapFace *pFace = GetFace( i );
-
-        for( int j = 0; j < pFace->nPoints; j++ )
-        {
-            float dist = DotProduct( pFace->Points[j], pPlane->normal ) - pPlane->dist;
-            if( dist > SPLIT_DIST_EPSILON )
-            {
-                frontCount++;
-            }
-            else if( dist < -SPLIT_DIST_EPSILON )
-            {
-                backCount++;
-            }
-        }
-    }
+    int side = ClassifyPlane( pPlane );
 
     //
     // If we're all on one side of the splitting plane, copy ourselves into the appropriate
 	// destination solid.
     //
-	if ((frontCount == 0) || (backCount == 0))
+	if (side != PLANESIDE_BOTH)
 	{
 		CMapSolid **pReturn;
 
-		if (frontCount == 0)
+		if (side == PLANESIDE_BACK)
 		{
 			pReturn = pBack;
 		}
@@ -525,6 +578,19 @@ void CMapSolid::AddFace(CMapFace *pFace)
 	pNewFace->SetRenderColor(r, g, b);
 	pNewFace->SetCordonFace( m_bIsCordonBrush );
 	pNewFace->SetParent(this);
+
+	CMapWorld::FaceID_UpdateSolid(this);
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Sets the number of faces on this solid. Faces past the new count
+//			are discarded, new faces are empty.
+//-----------------------------------------------------------------------------
+void CMapSolid::SetFaceCount(int nFaceCount)
+{
+	Faces.SetCount(nFaceCount);
+	CMapWorld::FaceID_UpdateSolid(this);
 }
 
 
@@ -578,6 +644,8 @@ CMapClass *CMapSolid::CopyFrom(CMapClass *pobj, bool bUpdateDependencies)
 		Assert(pToFace->GetPointCount() != 0);
 	}
 
+	CMapWorld::FaceID_UpdateSolid(this);
+
 	return(this);
 }
 
@@ -613,6 +681,7 @@ void CMapSolid::DeleteFace(int iIndex)
 	}
 
 	Faces.SetCount(nFaces-1);
+	CMapWorld::FaceID_UpdateSolid(this);
 }
 
 
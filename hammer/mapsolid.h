@@ -43,6 +43,7 @@ typedef BlockArray <CMapFace, 6, (MAPSOLID_MAX_FACES / 6) + 1> CSolidFaces;
 class CMapSolid : public CMapClass
 {
 	friend CSSolid;
+	friend class CMapWorld;
 
 public:
 
@@ -80,6 +81,10 @@ public:
 	virtual CMapClass *Copy(bool bUpdateDependencies);
 	virtual CMapClass *CopyFrom(CMapClass *pFrom, bool bUpdateDependencies);
 	int Split(PLANE *pPlane, CMapSolid **pFront = NULL, CMapSolid **pBack = NULL);
+
+	// Which side of a plane ClassifyPlane finds the solid on.
+	enum { PLANESIDE_FRONT = 0, PLANESIDE_BACK, PLANESIDE_BOTH };
+	int ClassifyPlane(const PLANE *pPlane);
 	bool Subtract(CMapObjectList *pInside, CMapObjectList *pOutside, CMapClass *pSubtractWith);
 
 	virtual bool ShouldAppearInLightingPreview(void);
@@ -121,7 +126,7 @@ public:
 	// face info
 	//
 	inline int GetFaceCount( void ) { return( Faces.GetCount() ); }
-	inline void SetFaceCount( int nFaceCount ) { Faces.SetCount( nFaceCount ); }
+	void SetFaceCount( int nFaceCount );
 	inline CMapFace *GetFace( int nFace ) { return( &Faces[nFace] ); }		
 	int GetFaceIndex( CMapFace *pFace );	// Returns the index (you could use it with GetFace) or -1 if the face doesn't exist in this solid.
 	void AddFace( CMapFace *pFace );
@@ -177,6 +182,9 @@ protected:
 	bool m_bIsCordonBrush : 1;				// Whether this brush was added by the cordon tool.
 
 	HL1_SolidType_t m_eSolidType;		// Used for HalfLife 1 maps only - solid, water, slime, lava.
+
+	CMapWorld *m_pFaceIDWorld;						// The world whose face ID index holds our faces, if any.
+	CUtlVector<int> m_IndexedFaceIDs;				// Our faces' entries in that world's face ID index.
 };
 
 
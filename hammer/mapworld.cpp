@@ -21,6 +21,7 @@
 #include "hammer.h"
 #include "Worldsize.h"
 #include "MapOverlay.h"
+#include "MapLight.h"
 
 // memdbgon must be the last include file in a .cpp file!!!
 #include <tier0/memdbgon.h>
@@ -29,6 +30,9 @@
 #pragma warning(disable:4244)
 
 
+#define FACEID_INDEX_BUCKETS	8192	// Hash buckets of the face ID index.
+
+
 class CCullTreeNode;
 
 
@@ -133,7 +137,8 @@ bool BoxesIntersect(Vector const &mins1, Vector const &maxs1, Vector const &mins
 //-----------------------------------------------------------------------------
 // Purpose: Constructor. Initializes data members.
 //-----------------------------------------------------------------------------
-CMapWorld::CMapWorld(void)
+CMapWorld::CMapWorld(void) :
+	m_FaceIDIndex(FACEID_INDEX_BUCKETS, 0, 0, FaceIDChain_t::Compare, FaceIDChain_t::HashKey)
 {
 	//
 	// Make sure subsequent UpdateBounds() will be effective.
@@ -167,6 +172,20 @@ CMapWorld::~CMapWorld(void)
 
 	// destroy the world displacement manager
 	DestroyWorldEditDispMgr( &m_pWorldDispMgr );
+
+	//
+	// Our children are deleted after the face ID index is gone, so they must not
+	// try to take themselves out of it.
+	//
+	for (int i = 0; i < m_SolidList.Count(); i++)
+	{
+		CMapSolid *pSolid = m_SolidList.Element(i);
+		if (pSolid->m_pFaceIDWorld == this)
+		{
+			pSolid->m_pFaceIDWorld = NULL;
+			pSolid->m_IndexedFaceIDs.RemoveAll();
+		}
+	}
 }
 
 
@@ -217,10 +236,9 @@ void CMapWorld::AddObjectToWorld(CMapClass *pObject, CMapClass *pParent)
 	pParent->AddChild(pObject);
 
 	//
-	// If this object or any of its children are entities, add the entities
-	// to our optimized list of entities.
+	// Add this object and its children to our lists of objects by type.
 	//
-	EntityList_Add(pObject);
+	ObjectLists_Add(pObject);
 
 	//
 	// Notify the object that it has been added to the world.
@@ -351,11 +369,9 @@ int CMapWorld::FindEntityBucket( CMapEntity *pEntity, int *pnIndex )
 //-----------------------------------------------------------------------------
 void CMapWorld::AddEntity( CMapEntity *pEntity )
 {
-	if ( m_EntityList.Find( pEntity ) != -1 )
-		return;
-
 	// Add it to the flat list.
-	m_EntityList.AddToTail( pEntity );
+	if ( !m_EntityList.Add( pEntity ) )
+		return;
 	
 	// If it has a name, add it to the list of entities hashed by name checksum.
 	const char *pszName = pEntity->GetKeyValue( "targetname" );
@@ -368,66 +384,129 @@ void CMapWorld::AddEntity( CMapEntity *pEntity )
 
 
 //-----------------------------------------------------------------------------
-// Purpose: Adds any entities found in the given object tree to the list of
-//			entities that are in this world. Called whenever an object is added
-//			to this world.
-// Input  : pObject - object (and children) to add to the entity list.
 //-----------------------------------------------------------------------------
-void CMapWorld::EntityList_Add(CMapClass *pObject)
+void CMapWorld::RemoveEntity( CMapEntity *pEntity )
 {
-	CMapEntity *pEntity = dynamic_cast<CMapEntity *>(pObject);
-	if (pEntity != NULL)
+	// Remove the entity from the flat list.
+	m_EntityList.Remove( pEntity );
+
+	// Remove the entity from the hashed list.
+	int nIndex;
+	int nOldBucket = FindEntityBucket( pEntity, &nIndex );
+	if ( nOldBucket != -1 )
 	{
-		AddEntity(pEntity);
+		m_EntityListByName[ nOldBucket ].FastRemove( nIndex );
 	}
 
-	EnumChildrenPos_t pos;	
-	CMapClass *pChild = pObject->GetFirstDescendent(pos);
-	while (pChild != NULL)
+	Assert( !m_EntityList.HasElement( pEntity ) );
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Adds a single object to the list for its type, if any. The type is
+//			checked by comparing type names rather than with dynamic_cast, as
+//			this runs for every object that enters the world.
+// Input  : pObject - object to add.
+//-----------------------------------------------------------------------------
+void CMapWorld::ObjectLists_AddObject(CMapClass *pObject)
+{
+	MAPCLASSTYPE Type = pObject->GetType();
+
+	if (Type == MAPCLASS_TYPE(CMapSolid))
+	{
+		m_SolidList.Add((CMapSolid *)pObject);
+		FaceID_IndexSolid((CMapSolid *)pObject);
+	}
+	else if (Type == MAPCLASS_TYPE(CMapEntity))
+	{
+		AddEntity((CMapEntity *)pObject);
+	}
+	else if (Type == MAPCLASS_TYPE(CMapOverlay))
+	{
+		m_OverlayList.Add((CMapOverlay *)pObject);
+	}
+	else if (Type == MAPCLASS_TYPE(CMapLight))
+	{
+		m_LightList.Add((CMapLight *)pObject);
+	}
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Removes a single object from the list for its type, if any.
+// Input  : pObject - object to remove.
+//-----------------------------------------------------------------------------
+void CMapWorld::ObjectLists_RemoveObject(CMapClass *pObject)
+{
+	MAPCLASSTYPE Type = pObject->GetType();
+
+	if (Type == MAPCLASS_TYPE(CMapSolid))
 	{
-		CMapEntity *pEntity = dynamic_cast<CMapEntity *>(pChild);
-		if ((pEntity != NULL) && (m_EntityList.Find(pEntity) == -1))
+		m_SolidList.Remove((CMapSolid *)pObject);
+		if (((CMapSolid *)pObject)->m_pFaceIDWorld == this)
 		{
-			AddEntity(pEntity);
+			FaceID_RemoveSolid((CMapSolid *)pObject);
 		}
+	}
+	else if (Type == MAPCLASS_TYPE(CMapEntity))
+	{
+		// Only the flat list; the hashed list is kept up to date by RemoveEntity.
+		m_EntityList.Remove((CMapEntity *)pObject);
+	}
+	else if (Type == MAPCLASS_TYPE(CMapOverlay))
+	{
+		m_OverlayList.Remove((CMapOverlay *)pObject);
+	}
+	else if (Type == MAPCLASS_TYPE(CMapLight))
+	{
+		m_LightList.Remove((CMapLight *)pObject);
+	}
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Adds the given object tree to this world's lists of entities,
+//			solids, overlays and lights. Called whenever an object is added
+//			to this world.
+// Input  : pObject - object (and children) to add to the object lists.
+//-----------------------------------------------------------------------------
+void CMapWorld::ObjectLists_Add(CMapClass *pObject)
+{
+	ObjectLists_AddObject(pObject);
 
+	EnumChildrenPos_t pos;	
+	CMapClass *pChild = pObject->GetFirstDescendent(pos);
+	while (pChild != NULL)
+	{
+		ObjectLists_AddObject(pChild);
 		pChild = pObject->GetNextDescendent(pos);
 	}
 }
 
 //-----------------------------------------------------------------------------
-// Purpose: Removes this object (if it is an entity) or any of its entity
-//			descendents from this world's entity list. Called when an object is
-//			removed from this world.
-// Input  : pObject - Object to remove from the entity list.
+// Purpose: Removes this object and, optionally, its descendents from this
+//			world's object lists. Called when an object is removed from this
+//			world.
+// Input  : pObject - Object to remove from the object lists.
+//			bRemoveChildren - Whether the object's descendents are leaving
+//				the world as well.
 //-----------------------------------------------------------------------------
-void CMapWorld::EntityList_Remove(CMapClass *pObject, bool bRemoveChildren)
+void CMapWorld::ObjectLists_Remove(CMapClass *pObject, bool bRemoveChildren)
 {
 	//
 	// Remove the object itself.
 	//
-	CMapEntity *pEntity = dynamic_cast<CMapEntity *>(pObject);
-	if (pEntity != NULL)
+	if (pObject->GetType() == MAPCLASS_TYPE(CMapEntity))
 	{
-		// Remove the entity from the flat list.
-		int nIndex = m_EntityList.Find( pEntity );
-		if ( nIndex != -1 )
-		{
-			m_EntityList.FastRemove( nIndex );
-		}
-
-		// Remove the entity from the hashed list.
-		int nOldBucket = FindEntityBucket( pEntity, &nIndex );
-		if ( nOldBucket != -1 )
-		{
-			m_EntityListByName[ nOldBucket ].FastRemove( nIndex );
-		}
-
-		Assert( m_EntityList.Find( pEntity ) == -1 );
+		RemoveEntity((CMapEntity *)pObject);
+	}
+	else
+	{
+		ObjectLists_RemoveObject(pObject);
 	}
 	
 	//
-	// Remove entity children.
+	// Remove the children.
 	//
 	if (bRemoveChildren)
 	{
@@ -435,17 +514,69 @@ void CMapWorld::EntityList_Remove(CMapClass *pObject, bool bRemoveChildren)
 		CMapClass *pChild = pObject->GetFirstDescendent(pos);
 		while (pChild != NULL)
 		{
-			CMapEntity *pEntity = dynamic_cast<CMapEntity *>(pChild);
-			if (pEntity != NULL)
-			{
-				m_EntityList.FindAndRemove(pEntity);
-			}
+			ObjectLists_RemoveObject(pChild);
 			pChild = pObject->GetNextDescendent(pos);
 		}
 	}
 }
 
 
+//-----------------------------------------------------------------------------
+// Purpose: Calls the enumeration callback for each object in an object list.
+// Output : Returns FALSE if the enumeration was terminated early, TRUE if it completed.
+//-----------------------------------------------------------------------------
+template <class T>
+static BOOL EnumObjectList(const CMapWorldObjectList<T> &List, ENUMMAPCHILDRENPROC pfn, unsigned int dwParam)
+{
+	int nCount = List.Count();
+	for (int i = 0; i < nCount; i++)
+	{
+		if (!(*pfn)(List.Element(i), dwParam))
+		{
+			return FALSE;
+		}
+	}
+
+	return TRUE;
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Enumerates all the objects of a given type in this world. Types with
+//			an object list are enumerated from the list, in no particular order,
+//			instead of by descending through the whole world. Other types fall
+//			back to EnumChildren.
+// Input  : pfn - Enumeration callback function. Called once per object.
+//			dwParam - User data to pass into the enumerating callback.
+//			Type - Only objects of the given type will be enumerated.
+// Output : Returns FALSE if the enumeration was terminated early, TRUE if it completed.
+//-----------------------------------------------------------------------------
+BOOL CMapWorld::EnumObjects(ENUMMAPCHILDRENPROC pfn, unsigned int dwParam, MAPCLASSTYPE Type)
+{
+	if (Type == MAPCLASS_TYPE(CMapSolid))
+	{
+		return EnumObjectList(m_SolidList, pfn, dwParam);
+	}
+
+	if (Type == MAPCLASS_TYPE(CMapEntity))
+	{
+		return EnumObjectList(m_EntityList, pfn, dwParam);
+	}
+
+	if (Type == MAPCLASS_TYPE(CMapOverlay))
+	{
+		return EnumObjectList(m_OverlayList, pfn, dwParam);
+	}
+
+	if (Type == MAPCLASS_TYPE(CMapLight))
+	{
+		return EnumObjectList(m_LightList, pfn, dwParam);
+	}
+
+	return EnumChildren(pfn, dwParam, Type);
+}
+
+
 //-----------------------------------------------------------------------------
 // Purpose: Overridden to maintain the culling tree. Root level children of the
 //			world are kept in the culling tree.
@@ -489,10 +620,10 @@ void CMapWorld::RemoveObjectFromWorld(CMapClass *pObject, bool bRemoveChildren)
 	}
 
 	//
-	// If it (or any of its children) is an entity, remove it from this
-	// world's list of entities.
+	// Remove it (and its children, if they are leaving too) from this
+	// world's lists of objects by type.
 	//
-	EntityList_Remove(pObject, bRemoveChildren);
+	ObjectLists_Remove(pObject, bRemoveChildren);
 
 	//
 	// Notify the object so it can release any pointers it may have to other
@@ -549,8 +680,16 @@ void CMapWorld::UpdateChild(CMapClass *pChild)
 void CMapWorld::GetUsedTextures(CUsedTextureList &List)
 {
 	List.RemoveAll();
-	EnumChildren((ENUMMAPCHILDRENPROC)AddUsedTextures, (DWORD)&List, MAPCLASS_TYPE(CMapSolid));
-	EnumChildren((ENUMMAPCHILDRENPROC)AddOverlayTextures, (DWORD)&List, MAPCLASS_TYPE(CMapOverlay));
+
+	for (int i = 0; i < m_SolidList.Count(); i++)
+	{
+		AddUsedTextures(m_SolidList.Element(i), &List);
+	}
+
+	for (int i = 0; i < m_OverlayList.Count(); i++)
+	{
+		AddOverlayTextures(m_OverlayList.Element(i), &List);
+	}
 }
 
 
@@ -827,15 +966,15 @@ void CMapWorld::PostloadWorld(void)
 	}
 
 	//
-	// Call PostLoadWorld on all our children and add any entities to the
-	// entity list.
+	// Call PostLoadWorld on all our children and add them to the object
+	// lists.
 	//
 
 	FOR_EACH_OBJ( m_Children, pos )
 	{
 		CMapClass *pChild = m_Children[pos];
 		pChild->PostloadWorld(this);
-		EntityList_Add(pChild);
+		ObjectLists_Add(pChild);
 	}
 	
 	// Since s_bLoadingVMF was on before, a bunch of stuff got delayed. Now let's do that stuff.
@@ -1143,34 +1282,163 @@ static bool EnsureTrailingChar(char *psz, char ch, int nSize)
 
 
 //-----------------------------------------------------------------------------
-// Purpose: Finds the face with the corresponding face ID.
-//			FIXME: AAARGH, slow!! Need to build a table or something.
-// Input  : nFaceID - 
+// Purpose: Enters a face into the face ID index. If other faces already have
+//			the same ID, the face waits behind them in case they go away.
+// Output : Returns the face's entry, to take it out again with.
 //-----------------------------------------------------------------------------
-CMapFace *CMapWorld::FaceID_FaceForID(int nFaceID)
+int CMapWorld::FaceID_AddFace(CMapFace *pFace, int nFaceID)
 {
-	EnumChildrenPos_t pos;
-	CMapClass *pChild = GetFirstDescendent(pos);
-	while (pChild != NULL)
+	int nEntry = m_FaceIDEntries.AddToTail();
+	IndexedFaceID_t &Entry = m_FaceIDEntries[nEntry];
+	Entry.pFace = pFace;
+	Entry.nFaceID = nFaceID;
+	Entry.nNext = -1;
+
+	FaceIDChain_t Chain;
+	Chain.nFaceID = nFaceID;
+	UtlHashHandle_t h = m_FaceIDIndex.Find(Chain);
+	if (h == m_FaceIDIndex.InvalidHandle())
+	{
+		Entry.nPrev = -1;
+		Chain.nHead = Chain.nTail = nEntry;
+		m_FaceIDIndex.Insert(Chain);
+		return(nEntry);
+	}
+
+	FaceIDChain_t &Found = m_FaceIDIndex[h];
+	Entry.nPrev = Found.nTail;
+	m_FaceIDEntries[Found.nTail].nNext = nEntry;
+	Found.nTail = nEntry;
+	return(nEntry);
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Takes a face out of the face ID index, letting the next face with
+//			the same ID take its place if there is one.
+// Input  : nEntry - The face's entry, as returned by FaceID_AddFace.
+//-----------------------------------------------------------------------------
+void CMapWorld::FaceID_RemoveFace(int nEntry)
+{
+	IndexedFaceID_t &Entry = m_FaceIDEntries[nEntry];
+
+	if (Entry.nPrev != -1)
+	{
+		m_FaceIDEntries[Entry.nPrev].nNext = Entry.nNext;
+	}
+
+	if (Entry.nNext != -1)
+	{
+		m_FaceIDEntries[Entry.nNext].nPrev = Entry.nPrev;
+	}
+
+	if ((Entry.nPrev == -1) || (Entry.nNext == -1))
 	{
-		CMapSolid *pSolid = dynamic_cast <CMapSolid *>(pChild);
-		if (pSolid != NULL)
+		FaceIDChain_t Chain;
+		Chain.nFaceID = Entry.nFaceID;
+		UtlHashHandle_t h = m_FaceIDIndex.Find(Chain);
+		Assert(h != m_FaceIDIndex.InvalidHandle());
+
+		if ((Entry.nPrev == -1) && (Entry.nNext == -1))
 		{
-			int nFaceCount = pSolid->GetFaceCount();
-			for (int nFace = 0; nFace < nFaceCount; nFace++)
-			{
-				CMapFace *pFace = pSolid->GetFace(nFace);
-				if (pFace->GetFaceID() == nFaceID)
-				{
-					return(pFace);
-				}
-			}
+			m_FaceIDIndex.Remove(h);
+		}
+		else if (Entry.nPrev == -1)
+		{
+			m_FaceIDIndex[h].nHead = Entry.nNext;
+		}
+		else
+		{
+			m_FaceIDIndex[h].nTail = Entry.nPrev;
 		}
+	}
 
-		pChild = GetNextDescendent(pos);
+	m_FaceIDEntries.Remove(nEntry);
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Enters all of a solid's faces into this world's face ID index,
+//			replacing any entries the solid already had.
+//-----------------------------------------------------------------------------
+void CMapWorld::FaceID_IndexSolid(CMapSolid *pSolid)
+{
+	FaceID_RemoveSolid(pSolid);
+
+	int nFaceCount = pSolid->GetFaceCount();
+	pSolid->m_IndexedFaceIDs.SetCount(nFaceCount);
+	for (int nFace = 0; nFace < nFaceCount; nFace++)
+	{
+		CMapFace *pFace = pSolid->GetFace(nFace);
+		pSolid->m_IndexedFaceIDs[nFace] = FaceID_AddFace(pFace, pFace->GetFaceID());
+	}
+
+	pSolid->m_pFaceIDWorld = this;
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Takes a solid's faces out of the face ID index they are in, if any.
+//-----------------------------------------------------------------------------
+void CMapWorld::FaceID_RemoveSolid(CMapSolid *pSolid)
+{
+	CMapWorld *pWorld = pSolid->m_pFaceIDWorld;
+	if (pWorld == NULL)
+	{
+		return;
+	}
+
+	for (int i = 0; i < pSolid->m_IndexedFaceIDs.Count(); i++)
+	{
+		pWorld->FaceID_RemoveFace(pSolid->m_IndexedFaceIDs[i]);
+	}
+
+	pSolid->m_IndexedFaceIDs.RemoveAll();
+	pSolid->m_pFaceIDWorld = NULL;
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Called when a solid's faces or their IDs change. Updates the face
+//			ID index of the world the solid is in, if any.
+//-----------------------------------------------------------------------------
+void CMapWorld::FaceID_UpdateSolid(CMapSolid *pSolid)
+{
+	if (pSolid->m_pFaceIDWorld != NULL)
+	{
+		pSolid->m_pFaceIDWorld->FaceID_IndexSolid(pSolid);
+	}
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Called when a face's ID changes.
+//-----------------------------------------------------------------------------
+void CMapWorld::FaceID_UpdateFace(CMapFace *pFace)
+{
+	CMapSolid *pSolid = dynamic_cast<CMapSolid *>(pFace->GetParent());
+	if (pSolid != NULL)
+	{
+		FaceID_UpdateSolid(pSolid);
+	}
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Finds the face with the corresponding face ID.
+// Input  : nFaceID - 
+//-----------------------------------------------------------------------------
+CMapFace *CMapWorld::FaceID_FaceForID(int nFaceID)
+{
+	FaceIDChain_t Chain;
+	Chain.nFaceID = nFaceID;
+	UtlHashHandle_t h = m_FaceIDIndex.Find(Chain);
+	if (h == m_FaceIDIndex.InvalidHandle())
+	{
+		return(NULL);
 	}
 
-	return(NULL);
+	return(m_FaceIDEntries[m_FaceIDIndex[h].nHead].pFace);
 }
 
 
@@ -1490,7 +1758,6 @@ void CMapWorld::FaceID_StringToFaceLists(CMapFaceList *pFullFaceList, CMapFaceLi
 			//
 			// Get the corresponding face and add it to the list.
 			//
-			// FACEID TODO: fix so we only interate the world objects once
 			CMapFace *pFace = FaceID_FaceForID(FullFaceIDList.Element(i));
 			if (pFace != NULL)
 			{
@@ -1508,7 +1775,6 @@ void CMapWorld::FaceID_StringToFaceLists(CMapFaceList *pFullFaceList, CMapFaceLi
 			//
 			// Get the corresponding face and add it to the list.
 			//
-			// FACEID TODO: fix so we only interate the world objects once
 			CMapFace *pFace = FaceID_FaceForID(PartialFaceIDList.Element(i));
 			if (pFace != NULL)
 			{
@@ -1667,7 +1933,7 @@ CMapEntity *CMapWorld::FindEntityByName( const char *pszName, bool bVisiblesOnly
 	if ( !pszName )
 		return NULL;
 
-	CMapEntityList *pList = &m_EntityList;
+	const CMapEntityList *pList = &m_EntityList.GetList();
 
 	if ( !strchr( pszName, '*' ) )
 	{
@@ -1769,7 +2035,7 @@ bool CMapWorld::FindEntitiesByName( CMapEntityList &Found, const char *pszName,
 	if ( !pszName )
 		return false;
 		
-	CMapEntityList *pList = &m_EntityList;
+	const CMapEntityList *pList = &m_EntityList.GetList();
 
 	if ( !strchr( pszName, '*' ) )
 	{
@@ -14,6 +14,9 @@
 #include "EditGameClass.h"
 #include "MapClass.h"
 #include "MapPath.h"
+#include "tier1/utlmap.h"
+#include "tier1/utlhash.h"
+#include "tier1/utllinkedlist.h"
 
 // Flags for SaveVMF.
 #define SAVEFLAGS_LIGHTSONLY	(1<<0)
@@ -29,8 +32,11 @@ class BoundBox;
 class CChunkFile;
 class CVisGroup;
 class CCullTreeNode;
+class CMapSolid;
 class IEditorTexture;
 class CMapGroup;
+class CMapLight;
+class CMapOverlay;
 
 struct SaveLists_t;
 
@@ -61,6 +67,146 @@ public:
 };
 
 
+//-----------------------------------------------------------------------------
+// Purpose: A flat list of every object of one type in a world. An index from
+//			object to list position keeps adds and removes from searching the
+//			list, so the world can keep it up to date as objects come and go.
+//-----------------------------------------------------------------------------
+template <class T>
+class CMapWorldObjectList
+{
+	public:
+
+		CMapWorldObjectList(void) : m_Index(0, 0, DefLessFunc(T *)) {}
+
+		inline bool Add(T *pObject);
+		inline bool Remove(T *pObject);
+		inline void RemoveAll(void);
+		inline bool HasElement(T *pObject) const { return m_Index.IsValidIndex(m_Index.Find(pObject)); }
+
+		inline int Count(void) const { return m_Objects.Count(); }
+		inline T *Element(int nIndex) const { return m_Objects.Element(nIndex); }
+		inline const CUtlVector<T *> &GetList(void) const { return m_Objects; }
+
+	private:
+
+		CUtlVector<T *> m_Objects;
+		CUtlMap<T *, int, int> m_Index;		// Maps each object to its position in m_Objects.
+};
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Adds an object to the list.
+// Output : Returns false if the object was already in the list.
+//-----------------------------------------------------------------------------
+template <class T>
+inline bool CMapWorldObjectList<T>::Add(T *pObject)
+{
+	if (HasElement(pObject))
+	{
+		return false;
+	}
+
+	m_Index.Insert(pObject, m_Objects.AddToTail(pObject));
+	return true;
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Removes an object from the list. The last object in the list takes
+//			its place, so the order of the list is not preserved.
+// Output : Returns false if the object was not in the list.
+//-----------------------------------------------------------------------------
+template <class T>
+inline bool CMapWorldObjectList<T>::Remove(T *pObject)
+{
+	int nIndex = m_Index.Find(pObject);
+	if (!m_Index.IsValidIndex(nIndex))
+	{
+		return false;
+	}
+
+	int nPos = m_Index[nIndex];
+	m_Index.RemoveAt(nIndex);
+
+	m_Objects.FastRemove(nPos);
+	if (nPos < m_Objects.Count())
+	{
+		m_Index[m_Index.Find(m_Objects[nPos])] = nPos;
+	}
+
+	return true;
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Empties the list.
+//-----------------------------------------------------------------------------
+template <class T>
+inline void CMapWorldObjectList<T>::RemoveAll(void)
+{
+	m_Objects.RemoveAll();
+	m_Index.RemoveAll();
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Walks one of a world's object lists, optionally skipping hidden
+//			objects and objects outside of a given visgroup:
+//
+//			CMapWorldObjectIter<CMapSolid> it(pWorld->SolidList_Get(), true);
+//			for (CMapSolid *pSolid = it.First(); pSolid != NULL; pSolid = it.Next())
+//
+//			Objects must not be added to or removed from the world while
+//			walking the list.
+//-----------------------------------------------------------------------------
+template <class T>
+class CMapWorldObjectIter
+{
+	public:
+
+		CMapWorldObjectIter(const CMapWorldObjectList<T> &List, bool bVisiblesOnly = false, CVisGroup *pVisGroup = NULL) :
+			m_List(List), m_bVisiblesOnly(bVisiblesOnly), m_pVisGroup(pVisGroup), m_nPos(-1) {}
+
+		inline T *First(void) { m_nPos = -1; return Next(); }
+		inline T *Next(void);
+
+	private:
+
+		const CMapWorldObjectList<T> &m_List;
+		bool m_bVisiblesOnly;
+		CVisGroup *m_pVisGroup;
+		int m_nPos;
+};
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Returns the next object that passes the filters, NULL at the end.
+//-----------------------------------------------------------------------------
+template <class T>
+inline T *CMapWorldObjectIter<T>::Next(void)
+{
+	while (++m_nPos < m_List.Count())
+	{
+		T *pObject = m_List.Element(m_nPos);
+
+		if (m_bVisiblesOnly && !pObject->IsVisible())
+		{
+			continue;
+		}
+
+		if ((m_pVisGroup != NULL) && !pObject->IsInVisGroup(m_pVisGroup))
+		{
+			continue;
+		}
+
+		return pObject;
+	}
+
+	return NULL;
+}
+
+
 class CMapWorld : public CMapClass, public CEditGameClass
 {
 	public:
@@ -120,16 +266,34 @@ class CMapWorld : public CMapClass, public CEditGameClass
 		static bool FaceID_FaceIDListsToString(char *pszList, int nSize, CMapFaceIDList *pFullFaceIDList, CMapFaceIDList *pPartialFaceIDList);
 		static bool FaceID_FaceListsToString(char *pszValue, int nSize, CMapFaceList *pFullFaceList, CMapFaceList *pPartialFaceList);
 
+		// Keep the face ID index of the world a solid is in up to date as its faces change.
+		static void FaceID_UpdateSolid(CMapSolid *pSolid);
+		static void FaceID_UpdateFace(CMapFace *pFace);
+		static void FaceID_RemoveSolid(CMapSolid *pSolid);
+
 		void GetUsedTextures(CUsedTextureList &List);
 		void Subtract(CMapObjectList &Results, CMapClass *pSubtractWith, CMapClass *pSubtractFrom);
 
 		CUtlVector<CMapPath*> m_Paths;
 
 		// Interface to list of all the entities in the world:
-		const CMapEntityList *EntityList_GetList(void) { return(&m_EntityList); }
+		const CMapEntityList *EntityList_GetList(void) { return(&m_EntityList.GetList()); }
 		inline int EntityList_GetCount();
 		inline CMapEntity *EntityList_GetEntity( int nIndex );
 
+		// Lists of all the objects of a given type in the world, for use with CMapWorldObjectIter.
+		// Displacements are kept by the world displacement manager.
+		inline const CMapWorldObjectList<CMapEntity> &EntityList_Get(void) const { return m_EntityList; }
+		inline const CMapWorldObjectList<CMapSolid> &SolidList_Get(void) const { return m_SolidList; }
+		inline const CMapWorldObjectList<CMapOverlay> &OverlayList_Get(void) const { return m_OverlayList; }
+		inline const CMapWorldObjectList<CMapLight> &LightList_Get(void) const { return m_LightList; }
+
+		// Like EnumChildren, but walks the object list for the given type when there is one.
+		BOOL EnumObjects(ENUMMAPCHILDRENPROC pfn, unsigned int dwParam, MAPCLASSTYPE Type);
+
+		// Removes objects that are leaving the world without going through RemoveObjectFromWorld.
+		void ObjectLists_Remove(CMapClass *pObject, bool bRemoveChildren);
+
 		CMapEntity *FindEntityByName( const char *pszName, bool bVisiblesOnly = false );
 		bool FindEntitiesByKeyValue(CMapEntityList &Found, const char *szKey, const char *szValue, bool bVisiblesOnly);
 		bool FindEntitiesByName(CMapEntityList &Found, const char *szName, bool bVisiblesOnly);
@@ -149,11 +313,17 @@ class CMapWorld : public CMapClass, public CEditGameClass
 		// Protected entity list functions.
 		//
 		void AddEntity( CMapEntity *pEntity );
-		void EntityList_Add(CMapClass *pObject);
-		void EntityList_Remove(CMapClass *pObject, bool bRemoveChildren);
+		void RemoveEntity( CMapEntity *pEntity );
+		void ObjectLists_AddObject(CMapClass *pObject);
+		void ObjectLists_RemoveObject(CMapClass *pObject);
+		void ObjectLists_Add(CMapClass *pObject);
 
 		int FindEntityBucket( CMapEntity *pEntity, int *pnIndex );
 
+		void FaceID_IndexSolid(CMapSolid *pSolid);
+		int FaceID_AddFace(CMapFace *pFace, int nFaceID);
+		void FaceID_RemoveFace(int nEntry);
+
 		//
 		// Serialization.
 		//
@@ -178,11 +348,31 @@ class CMapWorld : public CMapClass, public CEditGameClass
 
 		CCullTreeNode *m_pCullTree;		// This world's objects stored in a spatial hierarchy for culling.
 		
-		CMapEntityList m_EntityList;									// A flat list of all the entities in this world.
+		CMapWorldObjectList<CMapEntity> m_EntityList;					// A flat list of all the entities in this world.
 		CMapEntityList m_EntityListByName[NUM_HASHED_ENTITY_BUCKETS];	// A list of all the entities in the world, hashed by name checksum.
+		CMapWorldObjectList<CMapSolid> m_SolidList;						// A flat list of all the solids in this world.
+		CMapWorldObjectList<CMapOverlay> m_OverlayList;					// A flat list of all the overlays in this world.
+		CMapWorldObjectList<CMapLight> m_LightList;						// A flat list of all the light helpers in this world.
 
 		int m_nNextFaceID;						// Used for assigning unique IDs to every solid face in this world.
 
+		//
+		// The faces indexed under one face ID, oldest first. The oldest one is the
+		// one FaceID_FaceForID returns.
+		//
+		struct FaceIDChain_t
+		{
+			int nFaceID;
+			int nHead;
+			int nTail;
+
+			static bool Compare(const FaceIDChain_t &a, const FaceIDChain_t &b) { return a.nFaceID == b.nFaceID; }
+			static unsigned int HashKey(const FaceIDChain_t &a) { return (unsigned int)a.nFaceID; }
+		};
+
+		CUtlHash<FaceIDChain_t> m_FaceIDIndex;					// Maps face IDs to the faces of the solids in m_SolidList.
+		CUtlLinkedList<IndexedFaceID_t, int> m_FaceIDEntries;	// Every indexed face; solids keep the indices of theirs.
+
 		IWorldEditDispMgr	*m_pWorldDispMgr;	// world editable displacement manager
 };
 
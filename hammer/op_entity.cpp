@@ -592,6 +592,15 @@ void COP_Entity::MergeObjectKeyValues(CEditGameClass *pEdit)
 	//VPROF_BUDGET( "COP_Entity::MergeObjectKeyValues", "Object Properties" );
 	for ( int i=pEdit->GetFirstKeyValue(); i != pEdit->GetInvalidKeyValue(); i=pEdit->GetNextKeyValue( i ) )
 	{
+		//
+		// Skip keys that are already "different" or will be merged later.
+		//
+		int nState = m_KeyMergeState.Find(pEdit->GetKey(i));
+		if ((nState != m_KeyMergeState.InvalidIndex()) && m_KeyMergeState[nState].bMerged)
+		{
+			continue;
+		}
+
 		LPCTSTR pszCurValue = m_kv.GetValue(pEdit->GetKey(i));
 		if (pszCurValue == NULL)
 		{
@@ -630,9 +639,25 @@ void COP_Entity::MergeKeyValue(char const *pszKey)
 
 	bool bHandled = false;
 
+	//
+	// Look up the key's class variable the first time the key is merged.
+	//
+	int nState = m_KeyMergeState.Find(pszKey);
+	if (nState == m_KeyMergeState.InvalidIndex())
+	{
+		nState = m_KeyMergeState.Insert(pszKey);
+
+		KeyMergeState_t &NewState = m_KeyMergeState[nState];
+		NewState.pVar = (m_pEditClass != NULL) ? m_pEditClass->VarForName(pszKey) : NULL;
+		NewState.bMerged = false;
+		NewState.bSideListPending = false;
+	}
+
+	KeyMergeState_t &State = m_KeyMergeState[nState];
+
 	if (m_pEditClass != NULL)
 	{
-		GDinputvariable *pVar = m_pEditClass->VarForName(pszKey);
+		GDinputvariable *pVar = State.pVar;
 		if (pVar != NULL)
 		{
 			switch (pVar->GetType())
@@ -640,17 +665,12 @@ void COP_Entity::MergeKeyValue(char const *pszKey)
 				case ivSideList:
 				{
 					//
-					// Merging sidelist keys is a little complicated. We build a string
-					// representing the merged sidelists.
+					// Merging sidelist keys is a little complicated. The merged value
+					// depends on every object being edited, so it is built once in
+					// FlushKeyMergeState.
 					//
-					CMapFaceIDList FaceIDListFull;
-					CMapFaceIDList FaceIDListPartial;
-
-					GetFaceIDListsForKey(FaceIDListFull, FaceIDListPartial, pszKey);
-
-					char szValue[KEYVALUE_MAX_VALUE_LENGTH];
-					CMapWorld::FaceID_FaceIDListsToString(szValue, sizeof(szValue), &FaceIDListFull, &FaceIDListPartial);
-					m_kv.SetValue(pszKey, szValue);
+					State.bSideListPending = true;
+					State.bMerged = true;
 			
 					bHandled = true;
 					break;
@@ -679,6 +699,7 @@ void COP_Entity::MergeKeyValue(char const *pszKey)
 		// Can't merge with current value - show a "different" string.
 		//
 		m_kv.SetValue(pszKey, VALUE_DIFFERENT_STRING);
+		State.bMerged = true;
 
 		if (!stricmp(pszKey, "angles"))
 		{
@@ -689,6 +710,36 @@ void COP_Entity::MergeKeyValue(char const *pszKey)
 }
 
 
+//-----------------------------------------------------------------------------
+// Purpose: Builds the merged values of the sidelist keys that differ across
+//			the objects being edited, then forgets the merge state. Called when
+//			all the objects have been merged, or before the edit class changes.
+//-----------------------------------------------------------------------------
+void COP_Entity::FlushKeyMergeState(void)
+{
+	for (int i = m_KeyMergeState.First(); i != m_KeyMergeState.InvalidIndex(); i = m_KeyMergeState.Next(i))
+	{
+		if (!m_KeyMergeState[i].bSideListPending)
+		{
+			continue;
+		}
+
+		const char *pszKey = m_KeyMergeState.GetElementName(i);
+
+		CMapFaceIDList FaceIDListFull;
+		CMapFaceIDList FaceIDListPartial;
+
+		GetFaceIDListsForKey(FaceIDListFull, FaceIDListPartial, pszKey);
+
+		char szValue[KEYVALUE_MAX_VALUE_LENGTH];
+		CMapWorld::FaceID_FaceIDListsToString(szValue, sizeof(szValue), &FaceIDListFull, &FaceIDListPartial);
+		m_kv.SetValue(pszKey, szValue);
+	}
+
+	m_KeyMergeState.RemoveAll();
+}
+
+
 //-----------------------------------------------------------------------------
 // Purpose: 
 // Input  : Mode - 
@@ -713,6 +764,7 @@ void COP_Entity::UpdateData(int Mode, PVOID pData)
 
 	if (Mode == LoadFinished)
 	{
+		FlushKeyMergeState();
 		m_kvAdded.RemoveAll();
 		m_bAllowPresentProperties = true;
 		PresentProperties();
@@ -781,6 +833,7 @@ void COP_Entity::UpdateData(int Mode, PVOID pData)
 		// Add entity's keys to our local storage
 		//
 		m_kv.RemoveAll();
+		m_KeyMergeState.RemoveAll();
 		for ( int i=pEdit->GetFirstKeyValue(); i != pEdit->GetInvalidKeyValue(); i=pEdit->GetNextKeyValue( i ) )
 		{
 			const char *pszKey = pEdit->GetKey(i);
@@ -818,6 +871,12 @@ void COP_Entity::UpdateData(int Mode, PVOID pData)
 			m_cClasses.ForceEditControlText( "" );
 			m_bClassSelectionEmpty = true;
 
+			// The merge state holds variables of the old edit class.
+			if (m_pEditClass != NULL)
+			{
+				FlushKeyMergeState();
+			}
+
 			UpdateEditClass("", false);
 			UpdateDisplayClass("");
 		}
@@ -838,8 +897,9 @@ void COP_Entity::UpdateData(int Mode, PVOID pData)
 			m_Comments.SetWindowText(VALUE_DIFFERENT_STRING);
 		}
 
+		// The current key is selected again when the properties are presented
+		// after the last object has been merged.
 		MergeObjectKeyValues(pEdit);
-		SetCurKey(m_strLastKey);
 	}
 	else
 	{
@@ -22,6 +22,7 @@
 #include "ToolPickFace.h"
 #include "FilteredComboBox.h"
 #include "AnchorMgr.h"
+#include "utldict.h"
 
 
 class CEditGameClass;
@@ -294,6 +295,7 @@ class COP_Entity : public CObjectPage, CFilteredComboBox::ICallbacks, public CCo
 		bool BrowseModels( char *szModelName, int length, int &nSkin );
 		void MergeObjectKeyValues(CEditGameClass *pEdit);
 		void MergeKeyValue(char const *pszKey);
+		void FlushKeyMergeState(void);
 		void SetCurKey(LPCTSTR pszKey);
 		void GetCurKey(CString& strKey);
 
@@ -359,6 +361,16 @@ class COP_Entity : public CObjectPage, CFilteredComboBox::ICallbacks, public CCo
 		WCKeyValues m_kv;				// Our kv storage. Holds merged keyvalues for multiselect.
 		WCKeyValues m_kvAdded;			// Corresponding keys set to value "1" if they were added
 
+		// What we know about each key while merging the keyvalues of a multiselection.
+		struct KeyMergeState_t
+		{
+			GDinputvariable *pVar;		// The key's variable in m_pEditClass, if any.
+			bool bMerged;				// Further values can't change the merged value.
+			bool bSideListPending;		// The merged value is built from the whole selection when loading finishes.
+		};
+
+		CUtlDict<KeyMergeState_t, int> m_KeyMergeState;
+
 		GDIV_TYPE m_eEditType;			// The type of the currently selected key when SmartEdit is enabled.
 
 		bool	 m_bIgnoreKVChange;			// Set to ignore Windows notifications when setting up controls.
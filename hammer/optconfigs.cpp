@@ -485,6 +485,8 @@ void COPTConfigs::UpdateEntityLists(void)
 
 	CGameConfig *pConfig = m_pLastSelConfig;
 
+	pConfig->EnsureGDFilesLoaded();
+
 	int nCount = pConfig->GD.GetClassCount();
 	for (int i = 0; i < nCount; i++)
 	{
@@ -0,0 +1,354 @@
+//========= Copyright  1996-2005, Valve Corporation, All rights reserved. ============//
+//
+// Purpose: Bounding volume hierarchy over points, used for picking handles.
+//
+//=============================================================================//
+
+#include "stdafx.h"
+#include "PointTree.h"
+#include "Camera.h"
+#include "MapView.h"
+
+// memdbgon must be the last include file in a .cpp file!!!
+#include <tier0/memdbgon.h>
+
+
+#define POINTTREE_LEAF_SIZE	4
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Constructor.
+//-----------------------------------------------------------------------------
+CPointTree::CPointTree(void)
+{
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Frees the points and the tree.
+//-----------------------------------------------------------------------------
+void CPointTree::Purge(void)
+{
+	m_Points.Purge();
+	m_Order.Purge();
+	m_PointLeaf.Purge();
+	m_Nodes.Purge();
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Builds the tree over a copy of the given points. The points keep
+//			their indices.
+//-----------------------------------------------------------------------------
+void CPointTree::Build(const Vector *pPoints, int nPoints)
+{
+	m_Points.RemoveAll();
+	m_Points.AddMultipleToTail(nPoints, pPoints);
+
+	m_Order.SetCount(nPoints);
+	for (int i = 0; i < nPoints; i++)
+	{
+		m_Order[i] = i;
+	}
+
+	m_PointLeaf.SetCount(nPoints);
+
+	m_Nodes.RemoveAll();
+	m_Nodes.EnsureCapacity(2 * (nPoints / POINTTREE_LEAF_SIZE) + 1);
+	if (nPoints > 0)
+	{
+		int nRoot = m_Nodes.AddToTail();
+		m_Nodes[nRoot].m_nParent = -1;
+		BuildNode(nRoot, 0, nPoints);
+	}
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Makes a node for a range of m_Order, splitting it at the median
+//			along the longest axis of its bounds until the leaves are small.
+//-----------------------------------------------------------------------------
+void CPointTree::BuildNode(int nNode, int nFirst, int nCount)
+{
+	m_Nodes[nNode].m_nFirst = nFirst;
+	m_Nodes[nNode].m_nCount = nCount;
+	m_Nodes[nNode].m_nChild = -1;
+
+	if (nCount <= POINTTREE_LEAF_SIZE)
+	{
+		for (int i = nFirst; i < nFirst + nCount; i++)
+		{
+			m_PointLeaf[m_Order[i]] = nNode;
+		}
+
+		CalcBounds(nNode);
+		return;
+	}
+
+	Vector vecMins = m_Points[m_Order[nFirst]];
+	Vector vecMaxs = vecMins;
+	for (int i = nFirst + 1; i < nFirst + nCount; i++)
+	{
+		VectorMin(vecMins, m_Points[m_Order[i]], vecMins);
+		VectorMax(vecMaxs, m_Points[m_Order[i]], vecMaxs);
+	}
+
+	Vector vecSize = vecMaxs - vecMins;
+	int nAxis = 0;
+	if (vecSize[1] > vecSize[nAxis])
+	{
+		nAxis = 1;
+	}
+	if (vecSize[2] > vecSize[nAxis])
+	{
+		nAxis = 2;
+	}
+
+	SelectMedian(nFirst, nCount, nAxis);
+
+	int nChild = m_Nodes.AddMultipleToTail(2);
+	m_Nodes[nNode].m_nChild = nChild;
+	m_Nodes[nChild].m_nParent = nNode;
+	m_Nodes[nChild + 1].m_nParent = nNode;
+
+	int nHalf = nCount / 2;
+	BuildNode(nChild, nFirst, nHalf);
+	BuildNode(nChild + 1, nFirst + nHalf, nCount - nHalf);
+
+	CalcBounds(nNode);
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Reorders a range of m_Order so that the point in the middle has
+//			the median coordinate along an axis, with no greater coordinates
+//			before it and no smaller ones after it.
+//-----------------------------------------------------------------------------
+void CPointTree::SelectMedian(int nFirst, int nCount, int nAxis)
+{
+	int nMid = nFirst + nCount / 2;
+	int nLow = nFirst;
+	int nHigh = nFirst + nCount - 1;
+
+	while (nLow < nHigh)
+	{
+		float flPivot = m_Points[m_Order[(nLow + nHigh) / 2]][nAxis];
+		int i = nLow;
+		int j = nHigh;
+
+		while (i <= j)
+		{
+			while (m_Points[m_Order[i]][nAxis] < flPivot)
+			{
+				i++;
+			}
+
+			while (m_Points[m_Order[j]][nAxis] > flPivot)
+			{
+				j--;
+			}
+
+			if (i <= j)
+			{
+				int nTemp = m_Order[i];
+				m_Order[i] = m_Order[j];
+				m_Order[j] = nTemp;
+				i++;
+				j--;
+			}
+		}
+
+		if (nMid <= j)
+		{
+			nHigh = j;
+		}
+		else if (nMid >= i)
+		{
+			nLow = i;
+		}
+		else
+		{
+			break;
+		}
+	}
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Recalculates the bounds of a node from its points or children.
+//-----------------------------------------------------------------------------
+void CPointTree::CalcBounds(int nNode)
+{
+	Node_t &Node = m_Nodes[nNode];
+
+	if (Node.m_nChild == -1)
+	{
+		Node.m_vecMins = m_Points[m_Order[Node.m_nFirst]];
+		Node.m_vecMaxs = Node.m_vecMins;
+		for (int i = Node.m_nFirst + 1; i < Node.m_nFirst + Node.m_nCount; i++)
+		{
+			VectorMin(Node.m_vecMins, m_Points[m_Order[i]], Node.m_vecMins);
+			VectorMax(Node.m_vecMaxs, m_Points[m_Order[i]], Node.m_vecMaxs);
+		}
+	}
+	else
+	{
+		const Node_t &Child1 = m_Nodes[Node.m_nChild];
+		const Node_t &Child2 = m_Nodes[Node.m_nChild + 1];
+		VectorMin(Child1.m_vecMins, Child2.m_vecMins, Node.m_vecMins);
+		VectorMax(Child1.m_vecMaxs, Child2.m_vecMaxs, Node.m_vecMaxs);
+	}
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Moves a range of points. The leaves holding them and the nodes
+//			above those are refit; the shape of the tree doesn't change.
+//-----------------------------------------------------------------------------
+void CPointTree::MovePoints(int nFirst, int nCount, const Vector *pPoints)
+{
+	Assert((nFirst >= 0) && (nFirst + nCount <= m_Points.Count()));
+
+	for (int i = 0; i < nCount; i++)
+	{
+		m_Points[nFirst + i] = pPoints[i];
+	}
+
+	for (int i = 0; i < nCount; i++)
+	{
+		int nNode = m_PointLeaf[nFirst + i];
+		while (nNode != -1)
+		{
+			Vector vecOldMins = m_Nodes[nNode].m_vecMins;
+			Vector vecOldMaxs = m_Nodes[nNode].m_vecMaxs;
+
+			CalcBounds(nNode);
+
+			// If this node didn't change, nothing above it will.
+			if ((m_Nodes[nNode].m_vecMins == vecOldMins) && (m_Nodes[nNode].m_vecMaxs == vecOldMaxs))
+			{
+				break;
+			}
+
+			nNode = m_Nodes[nNode].m_nParent;
+		}
+	}
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Adds the points inside a box to the list, in no particular order.
+//-----------------------------------------------------------------------------
+void CPointTree::FindPointsInBox(const Vector &vecMins, const Vector &vecMaxs, CUtlVector<int> &Points) const
+{
+	if (m_Nodes.Count() == 0)
+	{
+		return;
+	}
+
+	CUtlVector<int> Stack;
+	Stack.AddToTail(0);
+
+	while (Stack.Count() > 0)
+	{
+		const Node_t &Node = m_Nodes[Stack.Tail()];
+		Stack.RemoveMultipleFromTail(1);
+
+		if (!IsBoxIntersectingBox(Node.m_vecMins, Node.m_vecMaxs, vecMins, vecMaxs))
+		{
+			continue;
+		}
+
+		if (Node.m_nChild != -1)
+		{
+			Stack.AddToTail(Node.m_nChild);
+			Stack.AddToTail(Node.m_nChild + 1);
+			continue;
+		}
+
+		for (int i = Node.m_nFirst; i < Node.m_nFirst + Node.m_nCount; i++)
+		{
+			const Vector &vecPoint = m_Points[m_Order[i]];
+			if ((vecPoint.x >= vecMins.x) && (vecPoint.x <= vecMaxs.x) &&
+				(vecPoint.y >= vecMins.y) && (vecPoint.y <= vecMaxs.y) &&
+				(vecPoint.z >= vecMins.z) && (vecPoint.z <= vecMaxs.z))
+			{
+				Points.AddToTail(m_Order[i]);
+			}
+		}
+	}
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Adds the points of every leaf whose box may project onto a client
+//			rectangle of the view, in no particular order. The box's projection
+//			is bounded by the projections of its corners unless part of it is
+//			behind the camera, in which case the node is always looked into.
+//-----------------------------------------------------------------------------
+void CPointTree::FindPointsNearRect(CMapView *pView, const Vector2D &vecMins, const Vector2D &vecMaxs, CUtlVector<int> &Points) const
+{
+	if (m_Nodes.Count() == 0)
+	{
+		return;
+	}
+
+	bool bPerspective = !pView->IsOrthographic();
+	Vector vecEye;
+	Vector vecForward;
+	if (bPerspective)
+	{
+		pView->GetCamera()->GetViewPoint(vecEye);
+		pView->GetCamera()->GetViewForward(vecForward);
+	}
+
+	CUtlVector<int> Stack;
+	Stack.AddToTail(0);
+
+	while (Stack.Count() > 0)
+	{
+		const Node_t &Node = m_Nodes[Stack.Tail()];
+		Stack.RemoveMultipleFromTail(1);
+
+		bool bBehind = false;
+		Vector2D vecClientMins(FLT_MAX, FLT_MAX);
+		Vector2D vecClientMaxs(-FLT_MAX, -FLT_MAX);
+		for (int nCorner = 0; (nCorner < 8) && !bBehind; nCorner++)
+		{
+			Vector vecCorner((nCorner & 1) ? Node.m_vecMaxs.x : Node.m_vecMins.x,
+							 (nCorner & 2) ? Node.m_vecMaxs.y : Node.m_vecMins.y,
+							 (nCorner & 4) ? Node.m_vecMaxs.z : Node.m_vecMins.z);
+
+			if (bPerspective && (DotProduct(vecCorner - vecEye, vecForward) <= 0))
+			{
+				bBehind = true;
+				break;
+			}
+
+			Vector2D vecClient;
+			pView->WorldToClient(vecClient, vecCorner);
+			Vector2DMin(vecClientMins, vecClient, vecClientMins);
+			Vector2DMax(vecClientMaxs, vecClient, vecClientMaxs);
+		}
+
+		// Allow a pixel for rounding in the projection.
+		if (!bBehind &&
+			((vecClientMaxs.x < vecMins.x - 1) || (vecClientMins.x > vecMaxs.x + 1) ||
+			 (vecClientMaxs.y < vecMins.y - 1) || (vecClientMins.y > vecMaxs.y + 1)))
+		{
+			continue;
+		}
+
+		if (Node.m_nChild != -1)
+		{
+			Stack.AddToTail(Node.m_nChild);
+			Stack.AddToTail(Node.m_nChild + 1);
+			continue;
+		}
+
+		for (int i = Node.m_nFirst; i < Node.m_nFirst + Node.m_nCount; i++)
+		{
+			Points.AddToTail(m_Order[i]);
+		}
+	}
+}
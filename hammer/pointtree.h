@@ -0,0 +1,73 @@
+//========= Copyright  1996-2005, Valve Corporation, All rights reserved. ============//
+//
+// Purpose: Bounding volume hierarchy over points, used for picking handles.
+//
+//=============================================================================//
+
+#ifndef POINTTREE_H
+#define POINTTREE_H
+#ifdef _WIN32
+#pragma once
+#endif
+
+#include "UtlVector.h"
+#include "mathlib/vector.h"
+#include "mathlib/vector2d.h"
+
+
+class CMapView;
+
+
+//-----------------------------------------------------------------------------
+// Points grouped into leaves of a binary tree of bounding boxes. Points can be
+// moved without rebuilding the tree; the boxes above them are refit instead.
+//-----------------------------------------------------------------------------
+class CPointTree
+{
+public:
+
+	CPointTree();
+
+	void Build(const Vector *pPoints, int nPoints);
+	void Purge(void);
+
+	inline int GetPointCount(void) const { return m_Points.Count(); }
+	inline const Vector &GetPoint(int nPoint) const { return m_Points[nPoint]; }
+
+	void MovePoints(int nFirst, int nCount, const Vector *pPoints);
+
+	//
+	// Adds the points that lie within a box to the list.
+	//
+	void FindPointsInBox(const Vector &vecMins, const Vector &vecMaxs, CUtlVector<int> &Points) const;
+
+	//
+	// Adds the points in all leaves whose projection overlaps a rectangle in
+	// the view's client space to the list. The points themselves aren't tested.
+	//
+	void FindPointsNearRect(CMapView *pView, const Vector2D &vecMins, const Vector2D &vecMaxs, CUtlVector<int> &Points) const;
+
+private:
+
+	struct Node_t
+	{
+		Vector m_vecMins;
+		Vector m_vecMaxs;
+		int m_nParent;
+		int m_nChild;		// The first of two consecutive children, -1 for leaves.
+		int m_nFirst;		// Leaves: first point in m_Order.
+		int m_nCount;		// Leaves: number of points.
+	};
+
+	void BuildNode(int nNode, int nFirst, int nCount);
+	void SelectMedian(int nFirst, int nCount, int nAxis);
+	void CalcBounds(int nNode);
+
+	CUtlVector<Vector> m_Points;
+	CUtlVector<int> m_Order;		// Point indices, grouped by leaf.
+	CUtlVector<int> m_PointLeaf;	// Per point, the leaf holding it.
+	CUtlVector<Node_t> m_Nodes;		// The root is the first node.
+};
+
+
+#endif // POINTTREE_H
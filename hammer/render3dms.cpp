@@ -13,6 +13,7 @@
 #include "MapDefs.h"
 #include "MapDoc.h"
 #include "MapEntity.h"
+#include "MapSolid.h"
 #include "MapWorld.h"
 #include "Render3DMS.h"
 #include "SSolid.h"
@@ -800,13 +801,11 @@ void CRender3D::SendShadowTriangles( void )
 		if (g_pLPreviewOutputBitmap)
 			delete g_pLPreviewOutputBitmap;
 		g_pLPreviewOutputBitmap = NULL;
-		EnumChildrenPos_t pos;
-		CMapClass *pChild = pWorld->GetFirstDescendent( pos );
-		while ( pChild )
+		// Only solids cast shadows.
+		CMapWorldObjectIter<CMapSolid> it( pWorld->SolidList_Get(), true );
+		for ( CMapSolid *pSolid = it.First(); pSolid; pSolid = it.Next() )
 		{
-			if (pChild->IsVisible())
-				pChild->AddShadowingTriangles( *tri_list );
-			pChild = pWorld->GetNextDescendent( pos );
+			pSolid->AddShadowingTriangles( *tri_list );
 		}
 		if ( tri_list->Count() )
 		{
@@ -940,6 +940,7 @@
 #define IDC_PARAMETER_LABEL             1674
 #define IDC_DELAY_LABEL                 1675
 #define IDC_INFO_TEXT                   1676
+#define IDC_CHANGESCHECK                1677
 #define IDI_OUTPUT_GREY                 31235
 #define IDI_OUTPUTBAD_GREY              31236
 #define IDI_INPUT_GREY                  31237
@@ -1257,7 +1258,7 @@
 #define _APS_3D_CONTROLS                     1
 #define _APS_NEXT_RESOURCE_VALUE        339
 #define _APS_NEXT_COMMAND_VALUE         33226
-#define _APS_NEXT_CONTROL_VALUE         1677
+#define _APS_NEXT_CONTROL_VALUE         1678
 #define _APS_NEXT_SYMED_VALUE           116
 #endif
 #endif
@@ -14,6 +14,10 @@
 #include "HammerScene.h"
 #include "ScenePreviewDlg.h"
 #include "soundchars.h"
+#include "checksum_crc.h"
+#include "tier1/utlbuffer.h"
+#include "tier1/utldict.h"
+#include "vstdlib/jobthread.h"
 
 // memdbgon must be the last include file in a .cpp file!!!
 #include <tier0/memdbgon.h>
@@ -24,6 +28,13 @@
 #define SOUNDGENDER_MACRO		"$gender"
 #define SOUNDGENDER_MACRO_LENGTH 7		// Length of above including $
 
+#define GAMESOUND_CACHE_ID		(('C'<<24)+('S'<<16)+('G'<<8)+'H')
+#define GAMESOUND_CACHE_VERSION	1
+
+// FNV-1a, used to hash sound names
+#define SOUND_NAME_HASH_SEED	2166136261U
+#define SOUND_NAME_HASH_PRIME	16777619U
+
 
 // Sounds we're playing are loaded into here for Windows to access while playing them.
 CUtlVector<char> g_SoundPlayData;
@@ -74,26 +85,49 @@ void CSoundSystem::ShutDown(void)
 }
 
 
+//-----------------------------------------------------------------------------
+// A soundscript and the game sounds declared in it, stored as name and wave
+// strings one after the other. Filled in by parsing or from the sound cache.
+//-----------------------------------------------------------------------------
+struct CSoundSystem::GameSoundFile_t
+{
+	const char *m_pFileName;
+	long m_nFileTime;
+	bool m_bCached;
+	CUtlBuffer m_Text;					// Contents of the soundscript, only while it is being parsed
+	CUtlVector< char > m_Sounds;
+};
+
+
 //-----------------------------------------------------------------------------
 // Build the list of sounds
 //-----------------------------------------------------------------------------
 bool CSoundSystem::BuildSoundList( SoundType_t type )
 {
+	static const char *s_pRawExtensions[] = { "wav", "mp3" };
+	static const char *s_pSceneExtensions[] = { "vcd" };
+
 	CleanupSoundList( type );
 
+	bool bOk = false;
 	switch( type )
 	{
 	case SOUND_TYPE_RAW:
-		return RecurseIntoDirectories( "sound", &CSoundSystem::ProcessDirectory_RawFileList );
+		bOk = RecurseIntoDirectories( "sound", s_pRawExtensions, ARRAYSIZE( s_pRawExtensions ), SOUND_TYPE_RAW );
+		break;
 
 	case SOUND_TYPE_GAMESOUND:
-		return BuildGameSoundList();
+		bOk = BuildGameSoundList();
+		break;
 
 	case SOUND_TYPE_SCENE:
-		return RecurseIntoDirectories( "scenes", &CSoundSystem::ProcessDirectory_SceneFileList );
+		bOk = RecurseIntoDirectories( "scenes", s_pSceneExtensions, ARRAYSIZE( s_pSceneExtensions ), SOUND_TYPE_SCENE );
+		break;
 	}
 
-	return false;
+	// Index whatever made it into the list, even if building it stopped part way
+	BuildNameIndex( type );
+	return bOk;
 }
 
 
@@ -105,6 +139,68 @@ void CSoundSystem::CleanupSoundList( SoundType_t type )
 	m_SoundList[type].m_Sounds.RemoveAll();
 	DestroyStringCache( m_SoundList[type].m_pStrings );
 	m_SoundList[type].m_pStrings = NULL;
+
+	m_SoundList[type].m_NameHashHead.RemoveAll();
+	m_SoundList[type].m_NameHashNext.RemoveAll();
+	m_SoundList[type].m_NameLengths.RemoveAll();
+	m_SoundList[type].m_NameTrigrams.Purge();
+}
+
+
+//-----------------------------------------------------------------------------
+// Hashes one more character of a sound name, case insensitive
+//-----------------------------------------------------------------------------
+static inline unsigned int HashSoundNameChar( unsigned int nHash, char c )
+{
+	return ( nHash ^ (unsigned char)tolower( (unsigned char)c ) ) * SOUND_NAME_HASH_PRIME;
+}
+
+
+//-----------------------------------------------------------------------------
+// Builds the hashed name lookup for a sound list
+//-----------------------------------------------------------------------------
+void CSoundSystem::BuildNameIndex( SoundType_t type )
+{
+	SoundList_t &list = m_SoundList[type];
+	int nCount = list.m_Sounds.Count();
+
+	int nBuckets = 16;
+	while ( nBuckets < nCount )
+	{
+		nBuckets <<= 1;
+	}
+
+	list.m_NameHashHead.SetCount( nBuckets );
+	for ( int i = 0; i < nBuckets; ++i )
+	{
+		list.m_NameHashHead[i] = -1;
+	}
+
+	list.m_NameHashNext.SetCount( nCount );
+	list.m_NameLengths.RemoveAll();
+
+	// Each sound goes to the front of its bucket, so buckets list later sounds first
+	for ( int i = 0; i < nCount; ++i )
+	{
+		const char *pName = list.m_Sounds[i].m_pSoundName;
+
+		unsigned int nHash = SOUND_NAME_HASH_SEED;
+		int nLen = 0;
+		for ( ; pName[nLen]; ++nLen )
+		{
+			nHash = HashSoundNameChar( nHash, pName[nLen] );
+		}
+
+		int nBucket = nHash & ( nBuckets - 1 );
+		list.m_NameHashNext[i] = list.m_NameHashHead[nBucket];
+		list.m_NameHashHead[nBucket] = i;
+
+		while ( list.m_NameLengths.Count() <= nLen )
+		{
+			list.m_NameLengths.AddToTail( false );
+		}
+		list.m_NameLengths[nLen] = true;
+	}
 }
 
 
@@ -181,47 +277,33 @@ void CSoundSystem::AddSoundToList( SoundType_t type, const char *pSoundName, con
 
 
 //-----------------------------------------------------------------------------
-// Add all sounds that lie within a single directory
+// Adds a single file found in a sound directory
 //-----------------------------------------------------------------------------
-void CSoundSystem::BuildFileListInDirectory( char const* pDirectoryName, const char *pExt, SoundType_t soundType )
+void CSoundSystem::AddFileInDirectory( char const* pDirectoryName, const char *pFileName, SoundType_t soundType )
 {
-	Assert( Q_strlen( pExt ) <= 3 );
-
-	int nDirectoryNameLen = V_strlen( pDirectoryName );
-	char *pWildCard = ( char * )stackalloc( nDirectoryNameLen + 7 );
-	Q_snprintf( pWildCard, nDirectoryNameLen + 7, "%s/*.%s", pDirectoryName, pExt );
-
-	FileFindHandle_t findHandle;
-	const char *pFileName = g_pFullFileSystem->FindFirst( pWildCard, &findHandle );
-	for ( ; pFileName; pFileName = g_pFullFileSystem->FindNext( findHandle ) )
-	{
-		if( g_pFullFileSystem->FindIsDirectory( findHandle ) )
-			continue;
-
-		// Strip off the 'sound/' part of the sound name.
-		int nAllocSize = nDirectoryNameLen + Q_strlen(pFileName) + 2;
-		char *pFileNameWithPath = (char *)stackalloc( nAllocSize );
-		
-		const char *pStartPos = max( strchr( pDirectoryName, '/' ), strchr( pDirectoryName, '\\' ) );
-		if ( pStartPos )
-			Q_snprintf(	pFileNameWithPath, nAllocSize, "%s%c%s", pStartPos+1, CORRECT_PATH_SEPARATOR, pFileName ); 
-		else
-			V_strncpy( pFileNameWithPath, pFileName, nAllocSize );
-		
-		Q_strnlwr( pFileNameWithPath, nAllocSize );
-		AddSoundToList( soundType, pFileNameWithPath, pFileNameWithPath, NULL );
-	}
-	g_pFullFileSystem->FindClose( findHandle );
+	// Strip off the 'sound/' part of the sound name.
+	int nAllocSize = V_strlen( pDirectoryName ) + Q_strlen(pFileName) + 2;
+	char *pFileNameWithPath = (char *)stackalloc( nAllocSize );
+	
+	const char *pStartPos = max( strchr( pDirectoryName, '/' ), strchr( pDirectoryName, '\\' ) );
+	if ( pStartPos )
+		Q_snprintf(	pFileNameWithPath, nAllocSize, "%s%c%s", pStartPos+1, CORRECT_PATH_SEPARATOR, pFileName ); 
+	else
+		V_strncpy( pFileNameWithPath, pFileName, nAllocSize );
+	
+	Q_strnlwr( pFileNameWithPath, nAllocSize );
+	AddSoundToList( soundType, pFileNameWithPath, pFileNameWithPath, NULL );
 }
 
 
 //-----------------------------------------------------------------------------
-// Populate the list of .WAV files
+// Add all files with the given extensions that lie within a directory and its
+// subdirectories. Each directory is enumerated once; the files are added
+// grouped by extension, before the files in any of the subdirectories.
 //-----------------------------------------------------------------------------
-bool CSoundSystem::RecurseIntoDirectories( char const* pDirectoryName, pDirCallbackFn fn )
+bool CSoundSystem::RecurseIntoDirectories( char const* pDirectoryName, const char **ppExtensions, int nExtensions, SoundType_t soundType )
 {
-	// Have the callback process the directory.
-	if ( !(this->*fn)( pDirectoryName ) )
+	if ( !g_pFileSystem )
 		return false;
 
 	int nDirectoryNameLen = Q_strlen( pDirectoryName );
@@ -231,58 +313,64 @@ bool CSoundSystem::RecurseIntoDirectories( char const* pDirectoryName, pDirCallb
 	strcat(pWildCard, "/*.*");
 	int nPathStrLen = nDirectoryNameLen + 1;
 
+	// Names of the matching files and of the subdirectories, null terminated
+	CUtlVector< char > names;
+	CUtlVector< int > files;
+	CUtlVector< int > fileExtensions;
+	CUtlVector< int > subDirectories;
+
 	FileFindHandle_t findHandle;
 	const char *pFileName = g_pFullFileSystem->FindFirst( pWildCard, &findHandle );
 	for ( ; pFileName; pFileName = g_pFullFileSystem->FindNext( findHandle ) )
 	{
-		if ((pFileName[0] != '.') || (pFileName[1] != '.' && pFileName[1] != 0))
+		if( g_pFullFileSystem->FindIsDirectory( findHandle ) )
 		{
-			if( !g_pFullFileSystem->FindIsDirectory( findHandle ) )
-				continue;
+			if ((pFileName[0] != '.') || (pFileName[1] != '.' && pFileName[1] != 0))
+			{
+				subDirectories.AddToTail( names.AddMultipleToTail( Q_strlen( pFileName ) + 1, pFileName ) );
+			}
+			continue;
+		}
 
-			int fileNameStrLen = Q_strlen( pFileName );
-			char *pFileNameWithPath = ( char * )stackalloc( nPathStrLen + fileNameStrLen + 1 );
-			memcpy( pFileNameWithPath, pWildCard, nPathStrLen );
-			pFileNameWithPath[nPathStrLen] = '\0';
-			Q_strncat( pFileNameWithPath, pFileName, nPathStrLen + fileNameStrLen + 1 );
+		const char *pExt = Q_GetFileExtension( pFileName );
+		if ( !pExt )
+			continue;
 
-			if (!RecurseIntoDirectories( pFileNameWithPath, fn ))
-				return false;
+		for ( int i = 0; i < nExtensions; ++i )
+		{
+			if ( !Q_stricmp( pExt, ppExtensions[i] ) )
+			{
+				files.AddToTail( names.AddMultipleToTail( Q_strlen( pFileName ) + 1, pFileName ) );
+				fileExtensions.AddToTail( i );
+				break;
+			}
 		}
 	}
-	return true;
-}
-
-
-//-----------------------------------------------------------------------------
-// Populate the list of .WAV files
-//-----------------------------------------------------------------------------
-bool CSoundSystem::ProcessDirectory_RawFileList( char const* pDirectoryName )
-{
-	if ( !g_pFileSystem )
-		return false;
-
-	Assert( Q_strnicmp( pDirectoryName, "sound", 5 ) == 0 );
-
-	// Get all sound files out of this directory
-	BuildFileListInDirectory( pDirectoryName, "wav", SOUND_TYPE_RAW );
-	BuildFileListInDirectory( pDirectoryName, "mp3", SOUND_TYPE_RAW );
-
-	return true;
-}
-
-
-//-----------------------------------------------------------------------------
-// Populate the list of .VCD files
-//-----------------------------------------------------------------------------
-bool CSoundSystem::ProcessDirectory_SceneFileList( char const* pDirectoryName )
-{
-	if ( !g_pFileSystem )
-		return false;
+	g_pFullFileSystem->FindClose( findHandle );
 
-	// Get all sound files out of this directory
-	BuildFileListInDirectory( pDirectoryName, "vcd", SOUND_TYPE_SCENE );
+	for ( int i = 0; i < nExtensions; ++i )
+	{
+		for ( int j = 0; j < files.Count(); ++j )
+		{
+			if ( fileExtensions[j] == i )
+			{
+				AddFileInDirectory( pDirectoryName, &names[ files[j] ], soundType );
+			}
+		}
+	}
 
+	for ( int i = 0; i < subDirectories.Count(); ++i )
+	{
+		const char *pSubDirectory = &names[ subDirectories[i] ];
+		int fileNameStrLen = Q_strlen( pSubDirectory );
+		char *pFileNameWithPath = ( char * )stackalloc( nPathStrLen + fileNameStrLen + 1 );
+		memcpy( pFileNameWithPath, pWildCard, nPathStrLen );
+		pFileNameWithPath[nPathStrLen] = '\0';
+		Q_strncat( pFileNameWithPath, pSubDirectory, nPathStrLen + fileNameStrLen + 1 );
+
+		if (!RecurseIntoDirectories( pFileNameWithPath, ppExtensions, nExtensions, soundType ))
+			return false;
+	}
 	return true;
 }
 
@@ -362,19 +450,52 @@ void CSoundSystem::AddGameSoundToList( const char *pGameSound, char const *pFile
 #include <tier0/memdbgoff.h>
 
 //-----------------------------------------------------------------------------
-// Load all game sounds from a particular file 
+// Appends a string to the game sounds of a soundscript
 //-----------------------------------------------------------------------------
-void CSoundSystem::AddGameSoundsFromFile( const char *pFileName )
+static void AppendGameSoundString( CUtlVector< char > &sounds, const char *pString )
 {
-	KeyValues *kv = new KeyValues( pFileName );
-	if ( !kv->LoadFromFile( g_pFileSystem, pFileName, "GAME" ) )
+	sounds.AddMultipleToTail( V_strlen( pString ) + 1, pString );
+}
+
+
+//-----------------------------------------------------------------------------
+// Reads a soundscript into memory. This only touches the file passed in, so
+// several soundscripts can be read at once.
+//-----------------------------------------------------------------------------
+void CSoundSystem::ReadGameSoundFile( GameSoundFile_t *&pFile )
+{
+	pFile->m_Text.Purge();
+	if ( g_pFullFileSystem->ReadFile( pFile->m_pFileName, "GAME", pFile->m_Text ) )
+	{
+		pFile->m_Text.PutChar( '\0' );
+	}
+	else
+	{
+		pFile->m_Text.Purge();
+	}
+}
+
+
+//-----------------------------------------------------------------------------
+// Parses the game sounds out of a soundscript read by ReadGameSoundFile.
+// KeyValues isn't safe to use from several threads, so this runs on the main
+// thread.
+//-----------------------------------------------------------------------------
+void CSoundSystem::ParseGameSoundFile( GameSoundFile_t &file )
+{
+	file.m_Sounds.RemoveAll();
+	if ( !file.m_Text.TellPut() )
+		return;
+
+	KeyValues *kv = new KeyValues( file.m_pFileName );
+	bool bLoaded = kv->LoadFromBuffer( file.m_pFileName, (const char *)file.m_Text.Base(), g_pFileSystem, "GAME" );
+	file.m_Text.Purge();
+	if ( !bLoaded )
 	{
 		kv->deleteThis();
 		return;
 	}
 
-	const char *pSourceFile = AddStringToCache( SOUND_TYPE_GAMESOUND, pFileName );
-
 	// parse out all of the top level sections and save their names
 	for ( KeyValues *pKeys = kv; pKeys; pKeys = pKeys->GetNextKey() )
 	{
@@ -382,11 +503,7 @@ void CSoundSystem::AddGameSoundsFromFile( const char *pFileName )
 			continue;
 
 		const char *pRawFile = pKeys->GetString( "wave", NULL );
-		if ( pRawFile )
-		{
-			AddGameSoundToList( pKeys->GetName(), pRawFile, pSourceFile );
-		}
-		else
+		if ( !pRawFile )
 		{
 			KeyValues *pRndWave = pKeys->FindKey( "rndwave" );
 			if ( pRndWave )
@@ -394,15 +511,40 @@ void CSoundSystem::AddGameSoundsFromFile( const char *pFileName )
 				KeyValues *pFirstFile = pRndWave->GetFirstSubKey();
 				if ( pFirstFile )
 				{
-					AddGameSoundToList( pKeys->GetName(), pFirstFile->GetString(), pSourceFile );
+					pRawFile = pFirstFile->GetString();
 				}
 			}
 		}
+
+		if ( pRawFile )
+		{
+			AppendGameSoundString( file.m_Sounds, pKeys->GetName() );
+			AppendGameSoundString( file.m_Sounds, pRawFile );
+		}
 	}
 
-	if ( kv )
+	kv->deleteThis();
+}
+
+
+//-----------------------------------------------------------------------------
+// Load all game sounds from a particular file 
+//-----------------------------------------------------------------------------
+void CSoundSystem::AddGameSoundsFromFile( const GameSoundFile_t &file )
+{
+	const char *pString = file.m_Sounds.Base();
+	const char *pEnd = pString + file.m_Sounds.Count();
+	while ( pString < pEnd )
 	{
-		kv->deleteThis();
+		const char *pGameSound = pString;
+		pString += V_strlen( pString ) + 1;
+		if ( pString >= pEnd )
+			break;
+
+		const char *pRawFile = pString;
+		pString += V_strlen( pString ) + 1;
+
+		AddGameSoundToList( pGameSound, pRawFile, file.m_pFileName );
 	}
 }
 
@@ -419,6 +561,7 @@ bool CSoundSystem::BuildGameSoundList()
 		return false;
 	}
 
+	CUtlVector< GameSoundFile_t > files;
 	for ( KeyValues *sub = manifest->GetFirstSubKey(); sub != NULL; sub = sub->GetNextKey() )
 	{
 		if ( !Q_stricmp( sub->GetName(), "precache_file" ) ||
@@ -426,14 +569,172 @@ bool CSoundSystem::BuildGameSoundList()
 			!Q_stricmp( sub->GetName(), "preload_file" ) )
 		{
 			// Add and always precache
-			AddGameSoundsFromFile( sub->GetString() );
+			GameSoundFile_t &file = files[ files.AddToTail() ];
+			file.m_pFileName = AddStringToCache( SOUND_TYPE_GAMESOUND, sub->GetString() );
+			file.m_nFileTime = g_pFullFileSystem->GetFileTime( file.m_pFileName, "GAME" );
+			file.m_bCached = false;
 		}
 	}
 	manifest->deleteThis();
+
+	// Only soundscripts which changed since they were cached need to be parsed
+	ReadGameSoundCache( files );
+
+	CUtlVector< GameSoundFile_t* > parseFiles;
+	for ( int i = 0; i < files.Count(); ++i )
+	{
+		if ( !files[i].m_bCached )
+		{
+			parseFiles.AddToTail( &files[i] );
+		}
+	}
+
+	// Only the file reads are spread over the job threads; parsing stays on this thread
+	if ( ( parseFiles.Count() > 1 ) && g_pThreadPool && ( g_pThreadPool->NumThreads() > 0 ) )
+	{
+		ParallelProcess( "CSoundSystem::BuildGameSoundList", parseFiles.Base(), parseFiles.Count(), &CSoundSystem::ReadGameSoundFile );
+	}
+	else
+	{
+		for ( int i = 0; i < parseFiles.Count(); ++i )
+		{
+			ReadGameSoundFile( parseFiles[i] );
+		}
+	}
+
+	for ( int i = 0; i < parseFiles.Count(); ++i )
+	{
+		ParseGameSoundFile( *parseFiles[i] );
+	}
+
+	// Sounds are added in manifest order, no matter where they came from
+	for ( int i = 0; i < files.Count(); ++i )
+	{
+		AddGameSoundsFromFile( files[i] );
+	}
+
+	if ( parseFiles.Count() )
+	{
+		WriteGameSoundCache( files );
+	}
 	return true;
 }
 
 
+//-----------------------------------------------------------------------------
+// The sound cache lives next to the editor, one per mod directory
+//-----------------------------------------------------------------------------
+void CSoundSystem::GetGameSoundCacheFileName( char *pFileName, int nMaxLen )
+{
+	char modDir[MAX_PATH];
+	APP()->GetDirectory( DIR_MOD, modDir );
+	V_FixSlashes( modDir );
+	Q_strlower( modDir );
+	CRC32_t nModCRC = CRC32_ProcessSingleBuffer( modDir, V_strlen( modDir ) );
+
+	char programDir[MAX_PATH];
+	char cacheName[MAX_PATH];
+	APP()->GetDirectory( DIR_PROGRAM, programDir );
+	Q_snprintf( cacheName, sizeof( cacheName ), "soundcache_%08x.dat", nModCRC );
+	V_ComposeFileName( programDir, cacheName, pFileName, nMaxLen );
+}
+
+
+//-----------------------------------------------------------------------------
+// Fills in the game sounds of all soundscripts whose file time matches the
+// one they were cached with.
+//-----------------------------------------------------------------------------
+void CSoundSystem::ReadGameSoundCache( CUtlVector< GameSoundFile_t > &files )
+{
+	char cacheFileName[MAX_PATH];
+	GetGameSoundCacheFileName( cacheFileName, sizeof( cacheFileName ) );
+
+	CUtlBuffer buf;
+	if ( !g_pFullFileSystem->ReadFile( cacheFileName, NULL, buf ) )
+		return;
+
+	if ( ( buf.GetInt() != GAMESOUND_CACHE_ID ) || ( buf.GetInt() != GAMESOUND_CACHE_VERSION ) )
+		return;
+
+	CUtlDict< int, int > fileIndex;
+	for ( int i = 0; i < files.Count(); ++i )
+	{
+		fileIndex.Insert( files[i].m_pFileName, i );
+	}
+
+	char fileName[MAX_PATH];
+	int nCachedFiles = buf.GetInt();
+	for ( int i = 0; ( i < nCachedFiles ) && buf.IsValid(); ++i )
+	{
+		int nNameLen = buf.GetInt();
+		if ( ( nNameLen <= 0 ) || ( nNameLen > (int)sizeof( fileName ) ) )
+			return;
+
+		buf.Get( fileName, nNameLen );
+		fileName[nNameLen - 1] = '\0';
+
+		long nFileTime = buf.GetInt();
+		int nSize = buf.GetInt();
+		if ( ( nSize < 0 ) || ( nSize > buf.GetBytesRemaining() ) )
+			return;
+
+		int nIndex = fileIndex.Find( fileName );
+		if ( ( nIndex == fileIndex.InvalidIndex() ) || ( nFileTime == 0 ) ||
+			( files[ fileIndex[nIndex] ].m_nFileTime != nFileTime ) || files[ fileIndex[nIndex] ].m_bCached )
+		{
+			buf.SeekGet( CUtlBuffer::SEEK_CURRENT, nSize );
+			continue;
+		}
+
+		GameSoundFile_t &file = files[ fileIndex[nIndex] ];
+		file.m_Sounds.SetCount( nSize );
+		buf.Get( file.m_Sounds.Base(), nSize );
+
+		// Don't trust a truncated entry
+		if ( buf.IsValid() && ( !nSize || !file.m_Sounds.Tail() ) )
+		{
+			file.m_bCached = true;
+		}
+		else
+		{
+			file.m_Sounds.RemoveAll();
+		}
+	}
+}
+
+
+//-----------------------------------------------------------------------------
+// Saves the game sounds of all soundscripts along with their file times
+//-----------------------------------------------------------------------------
+void CSoundSystem::WriteGameSoundCache( const CUtlVector< GameSoundFile_t > &files )
+{
+	CUtlBuffer buf;
+	buf.PutInt( GAMESOUND_CACHE_ID );
+	buf.PutInt( GAMESOUND_CACHE_VERSION );
+	buf.PutInt( files.Count() );
+
+	for ( int i = 0; i < files.Count(); ++i )
+	{
+		const GameSoundFile_t &file = files[i];
+
+		int nNameLen = V_strlen( file.m_pFileName ) + 1;
+		buf.PutInt( nNameLen );
+		buf.Put( file.m_pFileName, nNameLen );
+
+		buf.PutInt( file.m_nFileTime );
+		buf.PutInt( file.m_Sounds.Count() );
+		if ( file.m_Sounds.Count() )
+		{
+			buf.Put( file.m_Sounds.Base(), file.m_Sounds.Count() );
+		}
+	}
+
+	char cacheFileName[MAX_PATH];
+	GetGameSoundCacheFileName( cacheFileName, sizeof( cacheFileName ) );
+	g_pFullFileSystem->WriteFile( cacheFileName, NULL, buf );
+}
+
+
 //-----------------------------------------------------------------------------
 // Plays a sound
 //-----------------------------------------------------------------------------
@@ -443,24 +744,145 @@ bool CSoundSystem::FindSoundByName( const char *pFilename, SoundType_t *type, in
 	char searchStr[MAX_PATH];
 	V_strncpy( searchStr, pFilename, sizeof( searchStr ) );
 	V_FixSlashes( searchStr );
-	
+	int nSearchLen = V_strlen( searchStr );
+
+	// Finds the last sound of the last type whose name is part of the search string,
+	// by looking up each part of the search string that is as long as some sound name.
 	for ( int i = SOUND_TYPE_COUNT; --i >= 0; )
 	{
-		for ( int j = SoundCount( (SoundType_t)i ); --j >= 0; )
+		const SoundList_t &list = m_SoundList[i];
+		if ( !list.m_NameHashHead.Count() )
+			continue;
+
+		int nBucketMask = list.m_NameHashHead.Count() - 1;
+		int nMaxNameLen = list.m_NameLengths.Count() - 1;
+		int nBest = -1;
+
+		for ( int nStart = 0; nStart < nSearchLen; ++nStart )
 		{
-			if ( Q_stristr( searchStr, SoundName( (SoundType_t)i, j ) ) )
+			unsigned int nHash = SOUND_NAME_HASH_SEED;
+			int nEnd = min( nSearchLen, nStart + nMaxNameLen );
+			for ( int nPos = nStart; nPos < nEnd; ++nPos )
 			{
-				*type = (SoundType_t)i;
-				*nIndex = j;
-				return true;
+				nHash = HashSoundNameChar( nHash, searchStr[nPos] );
+
+				int nLen = nPos - nStart + 1;
+				if ( !list.m_NameLengths[nLen] )
+					continue;
+
+				// Buckets list later sounds first, so stop at the best match found so far
+				for ( int j = list.m_NameHashHead[ nHash & nBucketMask ]; j > nBest; j = list.m_NameHashNext[j] )
+				{
+					const char *pName = list.m_Sounds[j].m_pSoundName;
+					if ( !Q_strnicmp( pName, &searchStr[nStart], nLen ) && !pName[nLen] )
+					{
+						nBest = j;
+						break;
+					}
+				}
 			}
 		}
+
+		if ( nBest >= 0 )
+		{
+			*type = (SoundType_t)i;
+			*nIndex = nBest;
+			return true;
+		}
 	}
 	
 	return false;
 }
 
 
+//-----------------------------------------------------------------------------
+// Finds the sounds of a type whose names contain all of the filters
+//-----------------------------------------------------------------------------
+void CSoundSystem::FindSoundsContaining( SoundType_t type, char **ppFilters, int nFilters, CUtlVector< int > &matches )
+{
+	SoundList_t &list = m_SoundList[type];
+	int nCount = list.m_Sounds.Count();
+
+	matches.RemoveAll();
+	if ( !nFilters )
+	{
+		matches.EnsureCapacity( nCount );
+		for ( int i = 0; i < nCount; ++i )
+		{
+			matches.AddToTail( i );
+		}
+		return;
+	}
+
+	if ( !list.m_NameTrigrams.IsIndexed() )
+	{
+		list.m_NameTrigrams.Init( nCount );
+		for ( int i = 0; i < nCount; ++i )
+		{
+			list.m_NameTrigrams.SetString( i, list.m_Sounds[i].m_pSoundName );
+		}
+		list.m_NameTrigrams.BuildIndex();
+	}
+
+	CUtlVector< int > result;
+	bool bAll = true;
+	char filter[MAX_PATH];
+
+	for ( int i = 0; i < nFilters; ++i )
+	{
+		V_strncpy( filter, ppFilters[i], sizeof( filter ) );
+		V_strupr( filter );
+
+		const int *pPostings;
+		int nPostings = list.m_NameTrigrams.GetShortestPostings( filter, &pPostings );
+		int nCandidates = bAll ? nCount : matches.Count();
+
+		result.RemoveAll();
+		if ( ( nPostings >= 0 ) && ( nPostings < nCandidates ) )
+		{
+			// Both lists are sorted, so they can be walked together
+			int k = 0;
+			for ( int j = 0; j < nPostings; ++j )
+			{
+				int nSound = pPostings[j];
+				if ( !bAll )
+				{
+					while ( ( k < matches.Count() ) && ( matches[k] < nSound ) )
+					{
+						++k;
+					}
+
+					if ( k == matches.Count() )
+						break;
+
+					if ( matches[k] != nSound )
+						continue;
+				}
+
+				if ( strstr( list.m_NameTrigrams.GetString( nSound ), filter ) )
+				{
+					result.AddToTail( nSound );
+				}
+			}
+		}
+		else
+		{
+			for ( int j = 0; j < nCandidates; ++j )
+			{
+				int nSound = bAll ? j : matches[j];
+				if ( strstr( list.m_NameTrigrams.GetString( nSound ), filter ) )
+				{
+					result.AddToTail( nSound );
+				}
+			}
+		}
+
+		matches.Swap( result );
+		bAll = false;
+	}
+}
+
+
 bool CSoundSystem::PlayScene( const char *pFileName )
 {
 	char fullFilename[MAX_PATH];
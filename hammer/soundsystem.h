@@ -13,6 +13,7 @@
 #endif
 
 #include "utlvector.h"
+#include "TrigramIndex.h"
 
 //-----------------------------------------------------------------------------
 // Contains lists of all sounds	available for use
@@ -47,6 +48,9 @@ public:
 	// Search through all the sounds for the specified one.
 	bool FindSoundByName( const char *pFilename, SoundType_t *type, int *nIndex );
 
+	// Finds the sounds whose names contain all of the filters (case insensitive), in ascending order
+	void FindSoundsContaining( SoundType_t type, char **ppFilters, int nFilters, CUtlVector< int > &matches );
+
 	// Plays a sound
 	bool Play( SoundType_t type, int nIndex );
 	bool PlayScene( const char *pFileName );	// Play the first sound in the specified scene.
@@ -81,12 +85,17 @@ private:
 	{
 		CUtlVector< SoundInfo_t >	m_Sounds;
 		StringCache_t	*m_pStrings;
-	};
 
-private:
-	typedef bool (CSoundSystem::*pDirCallbackFn)( const char *pDirectoryName );
+		// Name lookup, rebuilt along with the list
+		CUtlVector< int >	m_NameHashHead;		// First sound in each hash bucket, -1 if empty
+		CUtlVector< int >	m_NameHashNext;		// Next sound in the same bucket, parallel to m_Sounds
+		CUtlVector< bool >	m_NameLengths;		// Whether any sound name has a given length
+		CTrigramIndex		m_NameTrigrams;		// Built the first time the list is searched by substring
+	};
 
+	struct GameSoundFile_t;
 
+private:
 	// Allocate, deallocate a string cache
 	StringCache_t *CreateStringCache( StringCache_t* pPrevious );
 	void DestroyStringCache( StringCache_t *pCache );
@@ -100,25 +109,31 @@ private:
 	// Cleans up the sound list
 	void CleanupSoundList( SoundType_t type );
 
-	// Goes into all subdirectories and calls the callback for each one..
-	bool RecurseIntoDirectories( char const* pDirectoryName, pDirCallbackFn fn );
+	// Builds the hashed name lookup for a sound list
+	void BuildNameIndex( SoundType_t type );
 
-	// Add all sounds that lie within a single directory recursively
-	bool ProcessDirectory_RawFileList( char const* pDirectoryName );
-	bool ProcessDirectory_SceneFileList( char const* pDirectoryName );
+	// Add all files with the given extensions that lie within a directory recursively
+	bool RecurseIntoDirectories( char const* pDirectoryName, const char **ppExtensions, int nExtensions, SoundType_t soundType );
 
-	// Add all sounds that lie within a single directory
-	void BuildFileListInDirectory( char const* pDirectoryName, const char *pExt, SoundType_t soundType );
+	// Adds a single file found in a sound directory
+	void AddFileInDirectory( char const* pDirectoryName, const char *pFileName, SoundType_t soundType );
 
 	// Gamesounds may have macros embedded in them
 	void AddGameSoundToList( const char *pGameSound, char const *pFileName, const char *pSourceFile );
 
 	// Load all game sounds from a particular file 
-	void AddGameSoundsFromFile( const char *pFileName );
+	static void ReadGameSoundFile( GameSoundFile_t *&pFile );
+	static void ParseGameSoundFile( GameSoundFile_t &file );
+	void AddGameSoundsFromFile( const GameSoundFile_t &file );
 
 	// Populate the list of game sounds
 	bool BuildGameSoundList();
 
+	// Persistent cache of parsed soundscripts, keyed by file time
+	void GetGameSoundCacheFileName( char *pFileName, int nMaxLen );
+	void ReadGameSoundCache( CUtlVector< GameSoundFile_t > &files );
+	void WriteGameSoundCache( const CUtlVector< GameSoundFile_t > &files );
+
 private:
 	SoundList_t m_SoundList[SOUND_TYPE_COUNT];	
 };
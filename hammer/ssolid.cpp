@@ -22,6 +22,7 @@
 #include "Options.h"
 #include "WorldSize.h"
 #include "mapdisp.h"
+#include "tier1/utlmap.h"
 
 // memdbgon must be the last include file in a .cpp file!!!
 #include <tier0/memdbgon.h>
@@ -599,6 +600,9 @@ void CSSolid::ToMapSolid(CMapSolid *p)
 		delete[] pts;
 	}
 
+	// New faces only got their parent after their IDs were copied in.
+	CMapWorld::FaceID_UpdateSolid(pSolid);
+
 	pSolid->PostUpdate(Notify_Changed);
 }
 
@@ -816,8 +820,8 @@ void CSSolid::ShowHandles(BOOL bShowVertices, BOOL bShowEdges)
 }
 
 
-// Move handle(s) to a new location ->
-void CSSolid::MoveSelectedHandles(const Vector &Delta)
+// Move handle(s) to a new location - returns whether any were moved ->
+bool CSSolid::MoveSelectedHandles(const Vector &Delta)
 {
 	SSHANDLE MoveVertices[128];
 	int nMoveVertices = 0;
@@ -868,6 +872,8 @@ void CSSolid::MoveSelectedHandles(const Vector &Delta)
 	{
 		CalcEdgeCenter(ppEdges[i]);
 	}
+
+	return (nMoveVertices > 0);
 }
 
 
@@ -1413,69 +1419,145 @@ DoAgain:
 
 // merge same vertices ->
 
-BOOL CSSolid::CanMergeVertices()
+#define VERTEX_HASH_BUCKETS	256
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Hashes a vertex position. Positions are quantized to whole units
+//			so that every position in a bucket can be compared exactly.
+//-----------------------------------------------------------------------------
+static unsigned int HashVertexPosition(const Vector &pos)
+{
+	unsigned int nHash = (unsigned int)(int)floor(pos[0]) * 73856093;
+	nHash ^= (unsigned int)(int)floor(pos[1]) * 19349663;
+	nHash ^= (unsigned int)(int)floor(pos[2]) * 83492791;
+	return nHash;
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Finds vertices that share a position.
+// Output : MergeInto - per vertex, the index of the last vertex at the same
+//			position; vertices with unique positions map to themselves.
+//			Returns TRUE if any two vertices share a position.
+//-----------------------------------------------------------------------------
+BOOL CSSolid::FindCoincidentVertices(CUtlVector<int> &MergeInto)
 {
-	for(int v1 = 0; v1 < m_nVertices; v1++)
+	int nBuckets = VERTEX_HASH_BUCKETS;
+	while ((nBuckets < m_nVertices) && (nBuckets < 65536))
+	{
+		nBuckets *= 2;
+	}
+
+	CUtlVector<int> BucketHead;
+	BucketHead.SetCount(nBuckets);
+	for (int i = 0; i < nBuckets; i++)
 	{
-		for(int v2 = 0; v2 < m_nVertices; v2++)
+		BucketHead[i] = -1;
+	}
+
+	CUtlVector<int> BucketNext;
+	BucketNext.SetCount(m_nVertices);
+	MergeInto.SetCount(m_nVertices);
+
+	BOOL bFound = FALSE;
+
+	// Walk backwards so the vertex kept for each position is the last one.
+	for (int v = m_nVertices - 1; v >= 0; v--)
+	{
+		const Vector &pos = m_Vertices[v].pos;
+		int nBucket = HashVertexPosition(pos) & (nBuckets - 1);
+
+		int nMatch = BucketHead[nBucket];
+		while ((nMatch != -1) && !VectorCompare(m_Vertices[nMatch].pos, pos))
+		{
+			nMatch = BucketNext[nMatch];
+		}
+
+		if (nMatch != -1)
 		{
-			if(v1 == v2)
-				continue;	// no!
-			if(VectorCompare(m_Vertices[v1].pos, m_Vertices[v2].pos))
-				return TRUE;	// got a match
+			MergeInto[v] = nMatch;
+			bFound = TRUE;
+		}
+		else
+		{
+			MergeInto[v] = v;
+			BucketNext[v] = BucketHead[nBucket];
+			BucketHead[nBucket] = v;
 		}
 	}
 
-	return FALSE;
+	return bFound;
 }
 
+
+BOOL CSSolid::CanMergeVertices()
+{
+	CUtlVector<int> MergeInto;
+	return FindCoincidentVertices(MergeInto);
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Merges vertices that share a position into the last of them, then
+//			removes edges that have become degenerate or duplicated and faces
+//			left with fewer than three edges.
+// Output : nDeleted - number of handles deleted.
+//			Returns the IDs of the deleted handles, or NULL if no vertices were
+//			merged. The list is valid until the next call.
+//-----------------------------------------------------------------------------
 SSHANDLE * CSSolid::MergeSameVertices(int& nDeleted)
 {
-	int nMerged = 0;
+	static CUtlVector<SSHANDLE> hDeletedList;
+	hDeletedList.RemoveAll();
 	nDeleted = 0;
-	static SSHANDLE hDeletedList[128];
 
-DoVertices:
-	for(int v1 = 0; v1 < m_nVertices; v1++)
+	CUtlVector<int> MergeInto;
+	if (!FindCoincidentVertices(MergeInto))
+		return NULL;
+
+	// remove merged vertices, remembering which vertex replaces each
+	CUtlMap<SSHANDLE, SSHANDLE, int> Replacements(DefLessFunc(SSHANDLE));
+
+	int nKept = 0;
+	for (int v = 0; v < m_nVertices; v++)
 	{
-		for(int v2 = 0; v2 < m_nVertices; v2++)
+		if (MergeInto[v] != v)
 		{
-			if(v1 == v2)
-				continue;	// no!
-			if(!VectorCompare(m_Vertices[v1].pos, m_Vertices[v2].pos))
-			{	// no match
-				continue;
-			}
+			hDeletedList.AddToTail(m_Vertices[v].id);
+			Replacements.Insert(m_Vertices[v].id, m_Vertices[MergeInto[v]].id);
+			continue;
+		}
 
-			++nMerged;
+		if (nKept != v)
+		{
+			memcpy(&m_Vertices[nKept], &m_Vertices[v], sizeof(CSSVertex));
+		}
+		++nKept;
+	}
 
-			// same vertices - kill v1, set edge refs to use v2.
-			SSHANDLE hV1 = m_Vertices[v1].id;
-			SSHANDLE hV2 = m_Vertices[v2].id;
-			
-			hDeletedList[nDeleted++] = hV1;
-			
-			DeleteVertex(v1);
+	for (int v = nKept; v < m_nVertices; v++)
+	{
+		memset(&m_Vertices[v], 0, sizeof(CSSVertex));
+	}
+	m_nVertices = nKept;
 
-			int nAffected;
-			CSSEdge **ppEdges = FindAffectedEdges(&hV1, 1, nAffected);
+	// point edges at the vertices that replaced theirs
+	for (int e = 0; e < m_nEdges; e++)
+	{
+		CSSEdge &edge = m_Edges[e];
 
-			// run through edges and change references
-			for(int e = 0; e < nAffected; e++)
-			{
-				if(ppEdges[e]->hvStart == hV1)
-					ppEdges[e]->hvStart = hV2;
-				if(ppEdges[e]->hvEnd == hV1)
-					ppEdges[e]->hvEnd = hV2;
-				CalcEdgeCenter(ppEdges[e]);
-			}
-			
-			goto DoVertices;
-		}
-	}
+		int nStart = Replacements.Find(edge.hvStart);
+		int nEnd = Replacements.Find(edge.hvEnd);
+		if ((nStart == Replacements.InvalidIndex()) && (nEnd == Replacements.InvalidIndex()))
+			continue;
 
-	if(!nMerged)
-		return NULL;
+		if (nStart != Replacements.InvalidIndex())
+			edge.hvStart = Replacements[nStart];
+		if (nEnd != Replacements.InvalidIndex())
+			edge.hvEnd = Replacements[nEnd];
+		CalcEdgeCenter(&edge);
+	}
 
 	int e;
 
@@ -1487,50 +1569,62 @@ DoVertices:
 		if(edge.hvStart != edge.hvEnd)
 			continue;	// edge is OK
 
-		hDeletedList[nDeleted++] = edge.id;
+		hDeletedList.AddToTail(edge.id);
 
 		DeleteEdge(e);
 		--e;
 	}
 
-	// kill similar edges (replace in faces too)
-DoEdges:
-	for(e = 0; e < m_nEdges; e++)
+	// kill similar edges, keeping the first edge between each pair of vertices
+	// and replacing the others in faces
+	CUtlMap<uint64, SSHANDLE, int> EdgesByVertices(DefLessFunc(uint64));
+	CUtlMap<SSHANDLE, SSHANDLE, int> EdgeReplacements(DefLessFunc(SSHANDLE));
+
+	nKept = 0;
+	for (e = 0; e < m_nEdges; e++)
 	{
 		CSSEdge &edge = m_Edges[e];
 
-		for(int e2 = 0; e2 < m_nEdges; e2++)
+		SSHANDLE hvLow = min(edge.hvStart, edge.hvEnd);
+		SSHANDLE hvHigh = max(edge.hvStart, edge.hvEnd);
+		uint64 nKey = ((uint64)hvLow << 32) | hvHigh;
+
+		int nIndex = EdgesByVertices.Find(nKey);
+		if (nIndex != EdgesByVertices.InvalidIndex())
 		{
-			if(e == e2)
-				continue;
+			hDeletedList.AddToTail(edge.id);
+			EdgeReplacements.Insert(edge.id, EdgesByVertices[nIndex]);
+			continue;
+		}
 
-			CSSEdge &edge2 = m_Edges[e2];
+		EdgesByVertices.Insert(nKey, edge.id);
 
-			if(!((edge2.hvStart == edge.hvStart && edge2.hvEnd == edge.hvEnd) || 
-				(edge2.hvEnd == edge.hvStart && edge2.hvStart == edge.hvEnd)))
-				continue;
+		if (nKept != e)
+		{
+			memcpy(&m_Edges[nKept], &m_Edges[e], sizeof(CSSEdge));
+		}
+		++nKept;
+	}
 
-			// we're going to delete edge2.
-			SSHANDLE id2 = edge2.id;
-			SSHANDLE id1 = edge.id;
+	if (EdgeReplacements.Count() > 0)
+	{
+		for (e = nKept; e < m_nEdges; e++)
+		{
+			memset(&m_Edges[e], 0, sizeof(CSSEdge));
+		}
+		m_nEdges = nKept;
 
-			for(int f = 0; f < m_nFaces; f++)
+		for (int f = 0; f < m_nFaces; f++)
+		{
+			CSSFace& face = m_Faces[f];
+			for (int ef = 0; ef < face.nEdges; ef++)
 			{
-				CSSFace& face = m_Faces[f];
-				for(int ef = 0; ef < face.nEdges; ef++)
+				int nIndex = EdgeReplacements.Find(face.Edges[ef]);
+				if (nIndex != EdgeReplacements.InvalidIndex())
 				{
-					if(face.Edges[ef] == id2)
-					{
-						face.Edges[ef] = id1;
-						break;
-					}
+					face.Edges[ef] = EdgeReplacements[nIndex];
 				}
 			}
-
-			hDeletedList[nDeleted++] = id2;
-			DeleteEdge(e2);
-
-			goto DoEdges;
 		}
 	}
 
@@ -1562,13 +1656,14 @@ DoConcurrentEdges:
 		if(face.nEdges < 3)
 		{
 			// kill this face
-			hDeletedList[nDeleted++] = face.id;
+			hDeletedList.AddToTail(face.id);
 			DeleteFace(f);
 			--f;
 		}
 	}
 
-	return hDeletedList;
+	nDeleted = hDeletedList.Count();
+	return hDeletedList.Base();
 }
 
 
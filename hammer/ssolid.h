@@ -158,7 +158,7 @@ class CSSolid
 		void Convert(BOOL bFromMapSolid = TRUE, bool bSkipDisplacementFaces = false);
 
 		// move selected handles by a delta:
-		void MoveSelectedHandles(const Vector &Delta);
+		bool MoveSelectedHandles(const Vector &Delta);
 
 		// attached map solid:
 		CMapSolid *m_pMapSolid;
@@ -198,6 +198,7 @@ class CSSolid
 		
 		SSHANDLE * MergeSameVertices(int& nDeleted);
 		BOOL CanMergeVertices();
+		BOOL FindCoincidentVertices(CUtlVector<int> &MergeInto);
 
 		// add face/edge/vertex:
 		CSSFace* AddFace(int* = NULL);
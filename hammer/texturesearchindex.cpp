@@ -0,0 +1,203 @@
+//========= Copyright  1996-2005, Valve Corporation, All rights reserved. ============//
+//
+// Purpose: Trigram index over the names and keywords of the active textures.
+//
+//=============================================================================//
+
+#include "stdafx.h"
+#include "TextureSearchIndex.h"
+#include "TextureSystem.h"
+
+// memdbgon must be the last include file in a .cpp file!!!
+#include <tier0/memdbgon.h>
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Returns whether a sorted list of texture indices contains a given index.
+//-----------------------------------------------------------------------------
+static bool SortedContains(const CUtlVector<int> &List, int nValue)
+{
+	int nLow = 0;
+	int nHigh = List.Count() - 1;
+	while (nLow <= nHigh)
+	{
+		int nMid = (nLow + nHigh) / 2;
+		if (List[nMid] < nValue)
+		{
+			nLow = nMid + 1;
+		}
+		else if (List[nMid] > nValue)
+		{
+			nHigh = nMid - 1;
+		}
+		else
+		{
+			return(true);
+		}
+	}
+
+	return(false);
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Constructor.
+//-----------------------------------------------------------------------------
+CTextureSearchIndex::CTextureSearchIndex(void) :
+	m_TextureIndex(0, 0, DefLessFunc(IEditorTexture *))
+{
+	m_eTextureFormat = tfNone;
+	m_nChangeStamp = -1;
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Returns whether the index still reflects the active textures.
+//-----------------------------------------------------------------------------
+bool CTextureSearchIndex::IsCurrent(TEXTUREFORMAT eTextureFormat) const
+{
+	return (m_nChangeStamp == g_Textures.GetChangeStamp()) && (m_eTextureFormat == eTextureFormat);
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Gathers the active textures of the given format and indexes their
+//			names. Keywords are indexed the first time they are searched.
+//-----------------------------------------------------------------------------
+void CTextureSearchIndex::Build(TEXTUREFORMAT eTextureFormat)
+{
+	m_Textures.RemoveAll();
+	m_TextureIndex.RemoveAll();
+
+	int nEnumIndex = 0;
+	IEditorTexture *pTex;
+	while ((pTex = g_Textures.EnumActiveTextures(&nEnumIndex, eTextureFormat)) != NULL)
+	{
+		m_TextureIndex.Insert(pTex, m_Textures.AddToTail(pTex));
+	}
+
+	int nCount = m_Textures.Count();
+	m_Names.Init(nCount);
+	m_Keywords.Init(nCount);
+
+	char szName[MAX_PATH];
+	for (int i = 0; i < nCount; i++)
+	{
+		m_Textures[i]->GetShortName(szName);
+		m_Names.SetString(i, szName);
+	}
+
+	m_Names.BuildIndex();
+
+	m_eTextureFormat = eTextureFormat;
+	m_nChangeStamp = g_Textures.GetChangeStamp();
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Returns the index of a texture, -1 if it is not in the index.
+//-----------------------------------------------------------------------------
+int CTextureSearchIndex::Find(IEditorTexture *pTex) const
+{
+	int nIndex = m_TextureIndex.Find(pTex);
+	if (!m_TextureIndex.IsValidIndex(nIndex))
+	{
+		return(-1);
+	}
+
+	return(m_TextureIndex[nIndex]);
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Returns a texture's keywords in uppercase, reading them first if
+//			they haven't been read yet. This loads the material.
+//-----------------------------------------------------------------------------
+const char *CTextureSearchIndex::GetKeywords(int nIndex)
+{
+	if (!m_Keywords.HasString(nIndex))
+	{
+		char szKeywords[MAX_PATH];
+		m_Textures[nIndex]->GetKeywords(szKeywords);
+		m_Keywords.SetString(nIndex, szKeywords);
+	}
+
+	return(m_Keywords.GetString(nIndex));
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Filters by texture name. See the header.
+//-----------------------------------------------------------------------------
+void CTextureSearchIndex::FilterNames(CUtlVector<int> &Candidates, bool &bAll, char **ppszTerms, int nTerms)
+{
+	Filter(m_Names, false, Candidates, bAll, ppszTerms, nTerms);
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Filters by keywords. Reading keywords loads materials, so only the
+//			candidates are read, unless all textures are candidates. Then all
+//			keywords get read anyway and are indexed for later searches.
+//-----------------------------------------------------------------------------
+void CTextureSearchIndex::FilterKeywords(CUtlVector<int> &Candidates, bool &bAll, char **ppszTerms, int nTerms)
+{
+	if ((nTerms > 0) && bAll && !m_Keywords.IsIndexed())
+	{
+		for (int i = 0; i < m_Textures.Count(); i++)
+		{
+			GetKeywords(i);
+		}
+
+		m_Keywords.BuildIndex();
+	}
+
+	Filter(m_Keywords, true, Candidates, bAll, ppszTerms, nTerms);
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Keeps the candidates whose string contains all of the terms.
+//-----------------------------------------------------------------------------
+void CTextureSearchIndex::Filter(CTrigramIndex &Index, bool bKeywords, CUtlVector<int> &Candidates, bool &bAll, char **ppszTerms, int nTerms)
+{
+	CUtlVector<int> Result;
+
+	for (int nTerm = 0; nTerm < nTerms; nTerm++)
+	{
+		const char *pszTerm = ppszTerms[nTerm];
+		int nCandidates = bAll ? m_Textures.Count() : Candidates.Count();
+
+		const int *pPostings;
+		int nPostings = Index.GetShortestPostings(pszTerm, &pPostings);
+
+		Result.RemoveAll();
+
+		if ((nPostings != -1) && (nPostings < nCandidates))
+		{
+			for (int i = 0; i < nPostings; i++)
+			{
+				int nTexture = pPostings[i];
+				if ((bAll || SortedContains(Candidates, nTexture)) && (strstr(Index.GetString(nTexture), pszTerm) != NULL))
+				{
+					Result.AddToTail(nTexture);
+				}
+			}
+		}
+		else
+		{
+			for (int i = 0; i < nCandidates; i++)
+			{
+				int nTexture = bAll ? i : Candidates[i];
+				const char *pszString = bKeywords ? GetKeywords(nTexture) : Index.GetString(nTexture);
+				if (strstr(pszString, pszTerm) != NULL)
+				{
+					Result.AddToTail(nTexture);
+				}
+			}
+		}
+
+		Candidates.Swap(Result);
+		bAll = false;
+	}
+}
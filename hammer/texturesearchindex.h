@@ -0,0 +1,62 @@
+//========= Copyright  1996-2005, Valve Corporation, All rights reserved. ============//
+//
+// Purpose: Trigram index over the names and keywords of the active textures,
+//			used by the texture browser to filter large texture sets quickly.
+//
+//=============================================================================//
+
+#ifndef TEXTURESEARCHINDEX_H
+#define TEXTURESEARCHINDEX_H
+#ifdef _WIN32
+#pragma once
+#endif
+
+#include "IEditorTexture.h"
+#include "UtlVector.h"
+#include "TrigramIndex.h"
+#include "tier1/utlmap.h"
+
+
+//-----------------------------------------------------------------------------
+// The active textures of one texture format, in browser order, with indices
+// over their names and keywords.
+//-----------------------------------------------------------------------------
+class CTextureSearchIndex
+{
+public:
+
+	CTextureSearchIndex();
+
+	bool IsCurrent(TEXTUREFORMAT eTextureFormat) const;
+	void Build(TEXTUREFORMAT eTextureFormat);
+
+	inline int GetCount(void) const { return m_Textures.Count(); }
+	inline IEditorTexture *GetTexture(int nIndex) const { return m_Textures[nIndex]; }
+	int Find(IEditorTexture *pTex) const;
+
+	//
+	// Narrows a sorted list of texture indices down to the textures whose name
+	// (or keywords) contain all of the given uppercase terms. When bAll is set
+	// the list is ignored and all textures are candidates; it is cleared when
+	// the list has been filled in.
+	//
+	void FilterNames(CUtlVector<int> &Candidates, bool &bAll, char **ppszTerms, int nTerms);
+	void FilterKeywords(CUtlVector<int> &Candidates, bool &bAll, char **ppszTerms, int nTerms);
+
+private:
+
+	const char *GetKeywords(int nIndex);
+	void Filter(CTrigramIndex &Index, bool bKeywords, CUtlVector<int> &Candidates, bool &bAll, char **ppszTerms, int nTerms);
+
+	CUtlVector<IEditorTexture *> m_Textures;
+	CUtlMap<IEditorTexture *, int, int> m_TextureIndex;
+
+	CTrigramIndex m_Names;
+	CTrigramIndex m_Keywords;	// Filled in lazily, since reading keywords loads the material.
+
+	TEXTUREFORMAT m_eTextureFormat;
+	int m_nChangeStamp;
+};
+
+
+#endif // TEXTURESEARCHINDEX_H
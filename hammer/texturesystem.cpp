@@ -116,6 +116,7 @@ CTextureSystem::CTextureSystem(void)
 	m_pActiveGroup = NULL;
 	m_pCubemapTexture = NULL;
 	m_pNoDrawTexture = NULL;
+	m_nChangeStamp = 0;
 }
 
 
@@ -466,6 +467,8 @@ void CTextureSystem::SetActiveConfig(CGameConfig *pConfig)
 	{
 		m_pActiveContext = NULL;
 	}
+
+	NoteTexturesChanged();
 }
 
 
@@ -488,12 +491,14 @@ void CTextureSystem::SetActiveGroup(const char *pcszName)
 		if (!strcmpi(pGroup->GetName(), pcszName))
 		{
 			m_pActiveGroup = pGroup;
+			NoteTexturesChanged();
 			return;
 		}
 
 		if (strstr(pGroup->GetName(), pcszName))
 		{
 			m_pActiveGroup = pGroup;
+			NoteTexturesChanged();
 			return;
 		}
 
@@ -777,6 +782,8 @@ void CTextureSystem::ReloadTextures( const char *pFilterName )
 
 		m_Textures[i]->Reload( false );
 	}
+
+	NoteTexturesChanged();
 }
 
 
@@ -1266,6 +1273,7 @@ void CTextureGroup::AddTexture(IEditorTexture *pTexture)
 {
 	int index = m_Textures.AddToTail(pTexture);
 	m_TextureNameMap.Insert( pTexture->GetName(), index );
+	g_Textures.NoteTexturesChanged();
 }
 
 
@@ -1286,6 +1294,7 @@ void CTextureGroup::Sort(void)
 
 	// Changing the order means we don't know where we should be loading from
 	m_nTextureToLoad = 0;
+	g_Textures.NoteTexturesChanged();
 }
 
 
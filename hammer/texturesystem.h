@@ -156,6 +156,13 @@ public:
 	IEditorTexture *FindActiveTexture(LPCSTR pszName, int *piIndex = NULL, BOOL bDummy = TRUE);
 	bool HasTexturesForConfig(CGameConfig *pConfig);
 
+	//
+	// Changes whenever the active textures, their order, or their contents may
+	// have changed. Lets views cache what they derive from the active textures.
+	//
+	inline int GetChangeStamp(void) const { return m_nChangeStamp; }
+	inline void NoteTexturesChanged(void) { m_nChangeStamp++; }
+
 	//
 	// Exposes a list of Most Recently Used textures.
 	//
@@ -266,6 +273,8 @@ protected:
 
 	// tools/toolsnodraw
 	IEditorTexture* m_pNoDrawTexture;
+
+	int m_nChangeStamp;
 };
 
 
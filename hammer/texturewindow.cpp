@@ -30,6 +30,15 @@ const int iTexNameFontHeight = 7;
 const int iTexIconHeight = 12;
 
 
+//-----------------------------------------------------------------------------
+// Purpose: Sort function for lists of search index entries.
+//-----------------------------------------------------------------------------
+static int __cdecl SortIndicesProc(const int *pIndex1, const int *pIndex2)
+{
+	return(*pIndex1 - *pIndex2);
+}
+
+
 BEGIN_MESSAGE_MAP(CTextureWindow, CWnd)
 	//{{AFX_MSG_MAP(CTextureWindow)
 	ON_WM_PAINT()
@@ -66,6 +75,16 @@ CTextureWindow::CTextureWindow(void)
 	m_bEnableUpdate = true;
 	m_nTypeFilter = ~0;
 	m_bShowErrors = true;
+
+	m_eFilterStage = FILTER_STAGE_NAMES;
+	m_bIncrementalNames = false;
+	m_bNameMatchesAll = true;
+
+	m_nColumns = 1;
+	m_nItemWidth = 0;
+	m_nItemHeight = 0;
+
+	m_LoadFailed.SetLessFunc(DefLessFunc(IEditorTexture *));
 }
 
 
@@ -124,30 +143,6 @@ void CTextureWindow::EnableUpdate(bool bEnable)
 }
 
 
-//-----------------------------------------------------------------------------
-// Purpose: Searches for all of the keywords in an array of keywords within
-//			a given search string, case-insensitive.
-// Input  : pszSearch - String to search for keywords within.
-//			pszKeyword - Array of pointers to keywords.
-//			nKeywords - Number of keywords in the array.
-// Output : Returns true if all keywords were found, false otherwise.
-//-----------------------------------------------------------------------------
-bool CTextureWindow::MatchKeywords(const char *pszSearch, char **pszKeyword, int nKeywords)
-{
-	if (nKeywords != 0)
-	{
-		for (int i = 0; i < nKeywords; i++)
-		{
-			if (Q_stristr(pszSearch, pszKeyword[i]) == NULL)
-			{
-				return(false);
-			}
-		}
-	}
-
-	return(true);
-}
-
 //-----------------------------------------------------------------------------
 // Changes type filter bits
 //-----------------------------------------------------------------------------
@@ -159,6 +154,8 @@ void CTextureWindow::SetTypeFilter( int filter, bool enable )
 	else
 		m_nTypeFilter &= ~filter;
 
+	InvalidateFilter(FILTER_STAGE_TYPES);
+
 	if (m_bEnableUpdate)
 	{
 		UpdateScrollSizes();
@@ -172,151 +169,282 @@ void CTextureWindow::SetTypeFilter( int filter, bool enable )
 	}
 }
 
+
 //-----------------------------------------------------------------------------
-// Purpose: 
-// Input  : *pTE - 
-//			bStart - 
-// Output : Returns TRUE on success, FALSE on failure.
+// Purpose: Marks a filter stage, and all stages after it, as needing to be rerun.
 //-----------------------------------------------------------------------------
-BOOL CTextureWindow::EnumTexturePositions(TWENUMPOS *pTE, BOOL bStart)
+void CTextureWindow::InvalidateFilter(FilterStage_t eStage)
 {
-	RECT &texrect = pTE->texrect;
+	if (eStage < m_eFilterStage)
+	{
+		m_eFilterStage = eStage;
+	}
 
-	if (bStart)
+	if (eStage == FILTER_STAGE_NAMES)
 	{
-		pTE->cur_x = iPadding;
-		pTE->cur_y = iPadding;
-		pTE->largest_y = 0;
-		pTE->iTexIndex = 0;
+		m_bIncrementalNames = false;
+	}
+}
 
-		if (IsWindow(m_hWnd))
-		{
-			GetClientRect(&pTE->clientrect);
-		}
 
-		SetRect(&texrect, 0, 0, 0, 0);
+//-----------------------------------------------------------------------------
+// Purpose: Returns whether a texture passes the type filter (opacity, etc).
+//-----------------------------------------------------------------------------
+bool CTextureWindow::MatchTypeFilter(IEditorTexture *pTex)
+{
+	if ((m_nTypeFilter & TYPEFILTER_ALL) == TYPEFILTER_ALL)
+	{
+		return(true);
 	}
-	
+
+	// NOTE: This accesses the material, which causes it to be cached (slow!!)
+	IMaterial* pMaterial = pTex->GetMaterial();
+	if (!pMaterial)
+	{
+		return(true);
+	}
+
 	bool bFound = false;
-	
-	do
+	if ( pMaterial->GetMaterialVarFlag( MATERIAL_VAR_SELFILLUM ) )
 	{
-		pTE->pTex = g_Textures.EnumActiveTextures(&pTE->iTexIndex, m_eTextureFormat);
+		if (m_nTypeFilter & TYPEFILTER_SELFILLUM)
+			bFound = true;
+	}
+	if ( pMaterial->GetMaterialVarFlag( MATERIAL_VAR_BASEALPHAENVMAPMASK ) )
+	{
+		if (m_nTypeFilter & TYPEFILTER_ENVMASK)
+			bFound = true;
+	}
 
-		if (pTE->pTex == NULL)
-			continue;
+	if ( pMaterial->GetMaterialVarFlag( MATERIAL_VAR_TRANSLUCENT ) )
+	{
+		if (m_nTypeFilter & TYPEFILTER_TRANSLUCENT)
+			bFound = true;
+	}
+	else
+	{
+		if (m_nTypeFilter & TYPEFILTER_OPAQUE)
+			bFound = true;
+	}
 
-		bFound = false;
+	return(bFound);
+}
 
-		// If we are iterating a specific list of textures, make sure it is in the list.
-		// dvs: inefficient, the specific list should control the loop, not act as a filter
-		if (m_pSpecificList != NULL)
+
+//-----------------------------------------------------------------------------
+// Purpose: Brings the list of textures to show up to date, rerunning only the
+//			filter stages whose inputs have changed.
+//-----------------------------------------------------------------------------
+void CTextureWindow::UpdateFilter(void)
+{
+	if (!m_SearchIndex.IsCurrent(m_eTextureFormat))
+	{
+		m_SearchIndex.Build(m_eTextureFormat);
+		InvalidateFilter(FILTER_STAGE_NAMES);
+	}
+
+	if (m_eFilterStage == FILTER_STAGE_NONE)
+	{
+		return;
+	}
+
+	int nTextures = m_SearchIndex.GetCount();
+
+	if (m_eFilterStage <= FILTER_STAGE_NAMES)
+	{
+		//
+		// If the name filter only got narrower, the last results are a superset
+		// of the new ones. Otherwise start over from the specific list or from
+		// all textures.
+		//
+		bool bAll = true;
+		if (m_bIncrementalNames)
 		{
-			int nIndex = m_pSpecificList->Find(pTE->pTex);
-			if (nIndex == -1)
-				continue;
-	
-			pTE->nUsageCount = m_pSpecificList->Element(nIndex).nUsageCount;
+			bAll = m_bNameMatchesAll;
 		}
-
-		// Filter by texture name.
-		char szTemp[MAX_PATH];
-		pTE->pTex->GetShortName(szTemp);
-		if (MatchKeywords(szTemp, m_Filters, m_nFilters))
+		else if (m_pSpecificList != NULL)
 		{
-			//
-			// Filter by keywords.
-			//
+			bAll = false;
+			m_NameMatches.RemoveAll();
+			m_UsageCount.SetCount(nTextures);
 
-			// NOTE: Try not to access the material here when finding the position
-			// because it causes the materials to be cached (slow!!)
-			if (m_nKeywords)
+			for (int i = 0; i < m_pSpecificList->Count(); i++)
 			{
-				pTE->pTex->GetKeywords(szTemp);
-				if (MatchKeywords(szTemp, m_Keyword, m_nKeywords))
+				int nIndex = m_SearchIndex.Find(m_pSpecificList->Element(i).pTex);
+				if (nIndex != -1)
 				{
-					bFound = true;
+					m_NameMatches.AddToTail(nIndex);
+					m_UsageCount[nIndex] = m_pSpecificList->Element(i).nUsageCount;
 				}
 			}
-			else
-			{
-				bFound = true;
-			}
+
+			// Keep the order of the active textures.
+			m_NameMatches.Sort(SortIndicesProc);
 		}
 
-		// Filter based on opacity, etc.
-		// NOTE: Try not to access the material here when finding the position
-		// because it causes the materials to be cached (slow!!)
-		if (bFound && ((m_nTypeFilter & TYPEFILTER_ALL) != TYPEFILTER_ALL))
+		m_SearchIndex.FilterNames(m_NameMatches, bAll, m_Filters, m_nFilters);
+		m_bNameMatchesAll = bAll;
+	}
+
+	if (m_eFilterStage <= FILTER_STAGE_KEYWORDS)
+	{
+		bool bAll = m_bNameMatchesAll;
+		if (!bAll)
 		{
-			IMaterial* pMaterial = pTE->pTex->GetMaterial();
-			if (pMaterial)
-			{
-				bFound = false;
-				if ( pMaterial->GetMaterialVarFlag( MATERIAL_VAR_SELFILLUM ) )
-				{
-					if (m_nTypeFilter & TYPEFILTER_SELFILLUM)
-						bFound = true;
-				}
-				if ( pMaterial->GetMaterialVarFlag( MATERIAL_VAR_BASEALPHAENVMAPMASK ) )
-				{
-					if (m_nTypeFilter & TYPEFILTER_ENVMASK)
-						bFound = true;
-				}
+			m_Matches.CopyArray(m_NameMatches.Base(), m_NameMatches.Count());
+		}
 
-				if ( pMaterial->GetMaterialVarFlag( MATERIAL_VAR_TRANSLUCENT ) )
-				{
-					if (m_nTypeFilter & TYPEFILTER_TRANSLUCENT)
-						bFound = true;
-				}
-				else
-				{
-					if (m_nTypeFilter & TYPEFILTER_OPAQUE)
-						bFound = true;
-				}
+		m_SearchIndex.FilterKeywords(m_Matches, bAll, m_Keyword, m_nKeywords);
+
+		if (bAll)
+		{
+			m_Matches.SetCount(nTextures);
+			for (int i = 0; i < nTextures; i++)
+			{
+				m_Matches[i] = i;
 			}
 		}
+	}
+
+	m_Items.RemoveAll();
+	m_ItemForTexture.SetCount(nTextures);
+	for (int i = 0; i < nTextures; i++)
+	{
+		m_ItemForTexture[i] = -1;
+	}
+
+	for (int i = 0; i < m_Matches.Count(); i++)
+	{
+		int nIndex = m_Matches[i];
+		IEditorTexture *pTex = m_SearchIndex.GetTexture(nIndex);
+
+		if (!MatchTypeFilter(pTex))
+		{
+			continue;
+		}
 
-		// Blow off zero-size materials, but only if they've been loaded...
+		// Blow off zero-size materials, but only if they've been loaded (or failed to)...
 		// Otherwise we have to cache everything which will take forever...
-		if ( bFound && pTE->pTex->IsLoaded() )
+		if ((pTex->IsLoaded() || m_LoadFailed.IsValidIndex(m_LoadFailed.Find(pTex))) && ((pTex->GetWidth() == 0) || (pTex->GetHeight() == 0)))
 		{
-			if ((pTE->pTex->GetWidth() == 0) || (pTE->pTex->GetHeight() == 0))
-			{
-				bFound = false;
-			}
+			continue;
 		}
-			
-	} while ((pTE->pTex != NULL) && (!bFound));
 
-	if ((!bFound) || (pTE->pTex == NULL))
+		TextureWindowItem_t Item;
+		Item.pTex = pTex;
+		Item.nUsageCount = (m_pSpecificList != NULL) ? m_UsageCount[nIndex] : 0;
+		m_ItemForTexture[nIndex] = m_Items.AddToTail(Item);
+	}
+
+	m_eFilterStage = FILTER_STAGE_NONE;
+	m_bIncrementalNames = false;
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Brings the filtered textures up to date and computes the grid they
+//			are laid out in. Every item has the same size, so the position of
+//			any item follows from its index.
+//-----------------------------------------------------------------------------
+void CTextureWindow::UpdateLayout(void)
+{
+	UpdateFilter();
+
+	CRect clientrect(0, 0, 0, 0);
+	if (IsWindow(m_hWnd))
 	{
-		return(FALSE);
+		GetClientRect(&clientrect);
 	}
 
-doresize:
+	m_nItemWidth = iDisplaySize;
+	m_nItemHeight = iDisplaySize + 8 + iTexNameFontHeight + iTexIconHeight;
+
+	// We want at least one texture on each row, even if it doesn't fit.
+	m_nColumns = max(1, clientrect.right / (m_nItemWidth + iPadding));
+}
 
-	SetRect( &texrect, pTE->cur_x, pTE->cur_y,
-		pTE->cur_x + iDisplaySize,
-		pTE->cur_y + iDisplaySize );
 
-	// if we've got one texture on this row already, and this one goes out of 
-	// the client area, jump to the next row. we want to have at least one texture on 
-	// each row, or we will sit in an infinite loop.
-	if(pTE->cur_x > iPadding && texrect.right > pTE->clientrect.right)
+//-----------------------------------------------------------------------------
+// Purpose: Returns the bounds of an item, in scrolled window coordinates.
+//-----------------------------------------------------------------------------
+void CTextureWindow::GetItemRect(int nItem, RECT &rect)
+{
+	int nColumn = nItem % m_nColumns;
+	int nRow = nItem / m_nColumns;
+
+	rect.left = iPadding + nColumn * (m_nItemWidth + iPadding);
+	rect.top = iPadding + nRow * (m_nItemHeight + iPadding);
+	rect.right = rect.left + m_nItemWidth;
+	rect.bottom = rect.top + m_nItemHeight;
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Returns the range of items in the rows that intersect a rectangle,
+//			in scrolled window coordinates. nLastItem is exclusive.
+//-----------------------------------------------------------------------------
+void CTextureWindow::GetItemRange(const RECT &rect, int &nFirstItem, int &nLastItem)
+{
+	int nRowHeight = m_nItemHeight + iPadding;
+	int nFirstRow = max(0, (int)(rect.top - iPadding) / nRowHeight);
+	int nLastRow = max(0, (int)(rect.bottom - iPadding) / nRowHeight);
+
+	nFirstItem = min(nFirstRow * m_nColumns, m_Items.Count());
+	nLastItem = min((nLastRow + 1) * m_nColumns, m_Items.Count());
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Returns the index of the item showing a texture, -1 if it isn't shown.
+//-----------------------------------------------------------------------------
+int CTextureWindow::FindItem(IEditorTexture *pTex)
+{
+	int nIndex = m_SearchIndex.Find(pTex);
+	if ((nIndex == -1) || (nIndex >= m_ItemForTexture.Count()))
 	{
-		pTE->cur_x = iPadding;
-		pTE->cur_y = pTE->largest_y + iPadding;
-		goto doresize;
+		return(-1);
 	}
 
-	texrect.bottom += (8 + iTexNameFontHeight + iTexIconHeight);
+	return(m_ItemForTexture[nIndex]);
+}
 
-	if(texrect.bottom > pTE->largest_y)
-		pTE->largest_y = texrect.bottom;
 
-	// update cur_x
-	pTE->cur_x = texrect.right + iPadding;
+//-----------------------------------------------------------------------------
+// Purpose: 
+// Input  : *pTE - 
+//			bStart - 
+// Output : Returns TRUE on success, FALSE on failure.
+//-----------------------------------------------------------------------------
+BOOL CTextureWindow::EnumTexturePositions(TWENUMPOS *pTE, BOOL bStart)
+{
+	if (bStart)
+	{
+		UpdateLayout();
+
+		pTE->iTexIndex = 0;
+		SetRect(&pTE->clientrect, 0, 0, 0, 0);
+
+		if (IsWindow(m_hWnd))
+		{
+			GetClientRect(&pTE->clientrect);
+		}
+	}
+
+	if (pTE->iTexIndex >= m_Items.Count())
+	{
+		pTE->pTex = NULL;
+		return(FALSE);
+	}
+
+	const TextureWindowItem_t &Item = m_Items[pTE->iTexIndex];
+	pTE->pTex = Item.pTex;
+	pTE->nUsageCount = Item.nUsageCount;
+	GetItemRect(pTE->iTexIndex, pTE->texrect);
+
+	pTE->cur_x = pTE->texrect.right + iPadding;
+	pTE->cur_y = pTE->texrect.top;
+	pTE->largest_y = pTE->texrect.bottom;
+	pTE->iTexIndex++;
 
 	return TRUE;
 }
@@ -350,6 +478,16 @@ void CTextureWindow::SetNameFilter(LPCTSTR pszFilter)
 		HighlightCurTexture();
 	}
 
+	// keep the old filter so we can tell whether the new one only narrows it
+	char szOldFilter[sizeof(m_szFilter)];
+	memcpy(szOldFilter, m_szFilter, sizeof(m_szFilter));
+	char *OldFilters[ARRAYSIZE(m_Filters)];
+	int nOldFilters = m_nFilters;
+	for (int i = 0; i < nOldFilters; i++)
+	{
+		OldFilters[i] = szOldFilter + (m_Filters[i] - m_szFilter);
+	}
+
 	// set filter
 	strcpy(m_szFilter, pszFilter);
 	strupr(m_szFilter);
@@ -363,6 +501,21 @@ void CTextureWindow::SetNameFilter(LPCTSTR pszFilter)
 		p = strtok(NULL, " ,;");
 	}
 
+	//
+	// When the user types more characters or adds more names, every texture
+	// that passes the new filter passed the old one, so only the old results
+	// need to be searched.
+	//
+	bool bNarrower = (m_nFilters >= nOldFilters);
+	for (int i = 0; bNarrower && (i < nOldFilters); i++)
+	{
+		bNarrower = (strstr(m_Filters[i], OldFilters[i]) != NULL);
+	}
+
+	bool bIncremental = bNarrower && (m_eFilterStage > FILTER_STAGE_NAMES);
+	InvalidateFilter(FILTER_STAGE_NAMES);
+	m_bIncrementalNames = bIncremental;
+
 	if (m_bEnableUpdate)
 	{
 		UpdateScrollSizes();
@@ -402,6 +555,8 @@ void CTextureWindow::SetKeywords(LPCTSTR pszKeywords)
 		p = strtok(NULL, " ,;");
 	}
 
+	InvalidateFilter(FILTER_STAGE_KEYWORDS);
+
 	if (m_bEnableUpdate)
 	{
 		UpdateScrollSizes();
@@ -421,17 +576,27 @@ void CTextureWindow::SetKeywords(LPCTSTR pszKeywords)
 //-----------------------------------------------------------------------------
 void CTextureWindow::UpdateScrollSizes(void)
 {
-	TWENUMPOS TE;
+	UpdateLayout();
+
+	CRect clientrect(0, 0, 0, 0);
+	if (IsWindow(m_hWnd))
+	{
+		GetClientRect(&clientrect);
+	}
 
 	total_x = total_y = 0;
 
-	if(EnumTexturePositions(&TE, TRUE))
-		do {
-			if(TE.texrect.right > total_x)
-				total_x = TE.texrect.right;
-			if(TE.texrect.bottom > total_y)
-				total_y = TE.texrect.bottom;
-		} while(EnumTexturePositions(&TE));
+	int nItems = m_Items.Count();
+	if (nItems > 0)
+	{
+		RECT LastColumnRect;
+		GetItemRect(min(nItems, m_nColumns) - 1, LastColumnRect);
+		total_x = LastColumnRect.right;
+
+		RECT LastRowRect;
+		GetItemRect(nItems - 1, LastRowRect);
+		total_y = LastRowRect.bottom;
+	}
 
 	// update total_x and total_y
 	total_x += iPadding;
@@ -443,62 +608,70 @@ void CTextureWindow::UpdateScrollSizes(void)
 	si.nMin = 0;
 	si.nPos = 0;
 	si.nMax = total_x;
-	si.nPage = TE.clientrect.right;
+	si.nPage = clientrect.right;
 	SetScrollInfo(SB_HORZ, &si, TRUE);
 
 	si.nMax = total_y;
-	si.nPage = TE.clientrect.bottom;
+	si.nPage = clientrect.bottom;
 	SetScrollInfo(SB_VERT, &si, TRUE);
 
 	char szbuf[100];
-	sprintf(szbuf, "Size = %d %d\n", total_y, TE.clientrect.bottom);
+	sprintf(szbuf, "Size = %d %d\n", total_y, clientrect.bottom);
 	TRACE0(szbuf);
 }
 
 
 //-----------------------------------------------------------------------------
-// Purpose: 
+// Purpose: Draws the textures in the rows that need painting. Only those rows
+//			are visited; the rest of the layout follows from the item indices.
 //-----------------------------------------------------------------------------
 void CTextureWindow::OnPaint(void)
 {
 	CPaintDC dc(this); // device context for painting
 
+	UpdateLayout();
+
 	// setup font
 	dc.SelectObject(&TexFont);
 	dc.SetTextColor(RGB(255, 255, 255));
 	//dc.SetBkColor(RGB(0,0,0));
 	dc.SetBkMode(TRANSPARENT);
 
-	CRect clientrect;
-	GetClientRect(clientrect);
-
 	dc.SetWindowOrg(GetScrollPos(SB_HORZ), GetScrollPos(SB_VERT));
 
-	TWENUMPOS TE;
-	BOOL bNotDone = EnumTexturePositions(&TE, TRUE);
-	BOOL bFoundHighlight = FALSE;
-	rectHighlight.left = -1;
-	BOOL bFirst = TRUE;
-	char szDrawTexture[512];
-	char szFirstDrawnTexture[512];
+	CRect cliprect;
+	dc.GetClipBox(&cliprect);
 
-	while (bNotDone)
+	int nFirstItem;
+	int nLastItem;
+	GetItemRange(cliprect, nFirstItem, nLastItem);
+
+	bool bFoundZeroSize = false;
+
+	for (int nItem = nFirstItem; nItem < nLastItem; nItem++)
 	{
-		TE.pTex->GetShortName(szDrawTexture);
+		const TextureWindowItem_t &Item = m_Items[nItem];
 
-		if (!strcmpi(szCurTexture, szDrawTexture))
-		{
-			rectHighlight = TE.texrect;
-			rectHighlight.InflateRect(2, 4);
-			bFoundHighlight = TRUE;
-		}
+		RECT texrect;
+		GetItemRect(nItem, texrect);
 
-		if (dc.RectVisible(&TE.texrect))
+		if (dc.RectVisible(&texrect))
 		{
 			// ensure loaded
-			TE.pTex->Load();
+			Item.pTex->Load();
 
-			CPalette *pOld = dc.SelectPalette(TE.pTex->HasPalette() ? TE.pTex->GetPalette() : g_pGameConfig->Palette, FALSE);
+			// Zero-size textures are only left out once they've been loaded. One that
+			// fails to load is remembered, or it would stay in and repaint forever.
+			if ((Item.pTex->GetWidth() == 0) || (Item.pTex->GetHeight() == 0))
+			{
+				if (!Item.pTex->IsLoaded())
+				{
+					m_LoadFailed.InsertIfNotFound(Item.pTex);
+				}
+				bFoundZeroSize = true;
+			}
+
+			CPalette *pOld = dc.SelectPalette(Item.pTex->HasPalette() ? Item.pTex->GetPalette() : g_pGameConfig->Palette, FALSE);
 			dc.RealizePalette();
 
 			int flags = drawCaption | drawIcons;
@@ -507,33 +680,39 @@ void CTextureWindow::OnPaint(void)
 
 			DrawTexData_t DrawTexData;
 			DrawTexData.nFlags = flags | (m_pSpecificList ? drawUsageCount : 0);
-			DrawTexData.nUsageCount = TE.nUsageCount;
-			TE.pTex->Draw(&dc, TE.texrect, iTexNameFontHeight, iTexIconHeight, DrawTexData);
+			DrawTexData.nUsageCount = Item.nUsageCount;
+			Item.pTex->Draw(&dc, texrect, iTexNameFontHeight, iTexIconHeight, DrawTexData);
 
 			dc.SelectPalette(pOld, FALSE);
 		}
-
-		//
-		// Save the name of the first drawn texture in case we need to highlight it.
-		//
-		if (bFirst)
-		{
-			bFirst = FALSE;
-			strcpy(szFirstDrawnTexture, szDrawTexture);
-		}
-
-		// next texture & position
-		bNotDone = EnumTexturePositions(&TE);
 	}
 
-	if(bFoundHighlight)
+	IEditorTexture *pCurTex = g_Textures.FindActiveTexture(szCurTexture, NULL, FALSE);
+	int nCurItem = (pCurTex != NULL) ? FindItem(pCurTex) : -1;
+
+	if (nCurItem != -1)
 	{
+		GetItemRect(nCurItem, rectHighlight);
+		rectHighlight.InflateRect(2, 4);
 		HighlightCurTexture(&dc);
 	}
 	else
 	{
+		rectHighlight.left = -1;
+
 		// select first texture
-		SelectTexture(szFirstDrawnTexture);
+		if (m_Items.Count() > 0)
+		{
+			char szFirstTexture[MAX_PATH];
+			m_Items[0].pTex->GetShortName(szFirstTexture);
+			SelectTexture(szFirstTexture);
+		}
+	}
+
+	if (bFoundZeroSize)
+	{
+		InvalidateFilter(FILTER_STAGE_TYPES);
+		Invalidate();
 	}
 }
 
@@ -691,9 +870,7 @@ void CTextureWindow::HighlightCurTexture(CDC *pDC)
 //-----------------------------------------------------------------------------
 void CTextureWindow::SelectTexture(LPCTSTR pszTexture, BOOL bAllowRedraw)
 {
-	TWENUMPOS TE;
-	BOOL bNotDone = EnumTexturePositions(&TE, TRUE);
-	int iTextureIndex = 0;
+	UpdateLayout();
 
 	IEditorTexture *pTex = g_Textures.FindActiveTexture(pszTexture);
 
@@ -709,48 +886,45 @@ void CTextureWindow::SelectTexture(LPCTSTR pszTexture, BOOL bAllowRedraw)
 		return;
 	}
 
-	while (bNotDone)
+	int nItem = FindItem(pTex);
+	if (nItem == -1)
 	{
-		if (pTex == TE.pTex)
-		{
-			// found it - make sure it's visible
-			if (IsWindow(m_hWnd))
-			{
-				int iScrollPos = GetScrollPos(SB_VERT);
-				if (iScrollPos + iClientHeight < TE.texrect.top || TE.texrect.bottom < iScrollPos)
-				{
-					SetScrollPos(SB_VERT, TE.texrect.top);
-					ScrollWindow(0, iScrollPos - TE.texrect.top);
-
-					if (bAllowRedraw)
-					{
-						RedrawWindow();
-					}
-				}
+		return;
+	}
 
-				// first remove current highlight
-				HighlightCurTexture();
-			}
+	RECT texrect;
+	GetItemRect(nItem, texrect);
 
-			pTex->GetShortName(szCurTexture);
+	// found it - make sure it's visible
+	if (IsWindow(m_hWnd))
+	{
+		int iScrollPos = GetScrollPos(SB_VERT);
+		if (iScrollPos + iClientHeight < texrect.top || texrect.bottom < iScrollPos)
+		{
+			SetScrollPos(SB_VERT, texrect.top);
+			ScrollWindow(0, iScrollPos - texrect.top);
 
-			// highlight new texture
-			if (IsWindow(m_hWnd))
+			if (bAllowRedraw)
 			{
-				rectHighlight = CRect(&TE.texrect);
-				rectHighlight.InflateRect(2, 4);
-				HighlightCurTexture();
+				RedrawWindow();
 			}
+		}
 
-			GetParent()->PostMessage(TWN_SELCHANGED);
+		// first remove current highlight
+		HighlightCurTexture();
+	}
 
-			return;
-		}
+	pTex->GetShortName(szCurTexture);
 
-		// next texture & position
-		bNotDone = EnumTexturePositions(&TE);
-		++iTextureIndex;
+	// highlight new texture
+	if (IsWindow(m_hWnd))
+	{
+		rectHighlight = CRect(&texrect);
+		rectHighlight.InflateRect(2, 4);
+		HighlightCurTexture();
 	}
+
+	GetParent()->PostMessage(TWN_SELCHANGED);
 }
 
 
@@ -761,32 +935,33 @@ void CTextureWindow::SelectTexture(LPCTSTR pszTexture, BOOL bAllowRedraw)
 //-----------------------------------------------------------------------------
 void CTextureWindow::OnLButtonDown(UINT nFlags, CPoint point) 
 {
-	// find clicked texture
-	TWENUMPOS TE;
-	BOOL bNotDone = EnumTexturePositions(&TE, TRUE);
-	int iTextureIndex = 0;
+	UpdateLayout();
 
 	int iHorzPos = GetScrollPos(SB_HORZ);
 	int iVertPos = GetScrollPos(SB_VERT);
 
-	char szNewTexture[128];
-
 	point += CPoint(iHorzPos, iVertPos);
 
-	while (bNotDone)
+	// find clicked texture
+	RECT hitrect;
+	SetRect(&hitrect, point.x, point.y, point.x + 1, point.y + 1);
+
+	int nFirstItem;
+	int nLastItem;
+	GetItemRange(hitrect, nFirstItem, nLastItem);
+
+	RECT texrect;
+	int nItem;
+	for (nItem = nFirstItem; nItem < nLastItem; nItem++)
 	{
-		if (PtInRect(&TE.texrect, point))
+		GetItemRect(nItem, texrect);
+		if (PtInRect(&texrect, point))
 		{
-			TE.pTex->GetShortName(szNewTexture);
 			break;
 		}
-
-		// next texture & position
-		bNotDone = EnumTexturePositions(&TE);
-		++iTextureIndex;
 	}
 
-	if(!bNotDone)
+	if (nItem == nLastItem)
 	{
 		// no texture was hit
 		return;
@@ -796,8 +971,8 @@ void CTextureWindow::OnLButtonDown(UINT nFlags, CPoint point)
 	HighlightCurTexture();
 
 	// highlight new texture
-	strcpy(szCurTexture, szNewTexture);
-	rectHighlight = CRect(&TE.texrect);
+	m_Items[nItem].pTex->GetShortName(szCurTexture);
+	rectHighlight = CRect(&texrect);
 	rectHighlight.InflateRect(2, 4);
 	HighlightCurTexture();
 
@@ -915,6 +1090,7 @@ void CTextureWindow::OnChar(UINT nChar, UINT nRepCnt, UINT nFlags)
 void CTextureWindow::SetSpecificList(TextureWindowTexList *pList)
 {
 	m_pSpecificList = pList;
+	InvalidateFilter(FILTER_STAGE_NAMES);
 
 	if (m_hWnd != NULL)
 	{
@@ -11,7 +11,9 @@
 #endif
 
 #include "IEditorTexture.h"
+#include "TextureSearchIndex.h"
 #include "UtlVector.h"
+#include "UtlRBTree.h"
 
 
 struct TextureWindowTex_t
@@ -90,7 +92,33 @@ public:
 
 protected:
 
-	bool MatchKeywords(const char *pszSearch, char **pszKeyword, int nKeywords);
+	//
+	// The textures shown are computed in stages, each stage narrowing down the
+	// results of the one before. Changing a filter only reruns its own stage
+	// and the ones after it.
+	//
+	enum FilterStage_t
+	{
+		FILTER_STAGE_NAMES = 0,		// Specific list and name filter.
+		FILTER_STAGE_KEYWORDS,		// Keyword filter.
+		FILTER_STAGE_TYPES,			// Type filter and zero-size textures.
+		FILTER_STAGE_NONE,			// Up to date.
+	};
+
+	struct TextureWindowItem_t
+	{
+		IEditorTexture *pTex;
+		int nUsageCount;
+	};
+
+	void InvalidateFilter(FilterStage_t eStage);
+	void UpdateFilter(void);
+	bool MatchTypeFilter(IEditorTexture *pTex);
+
+	void UpdateLayout(void);
+	void GetItemRect(int nItem, RECT &rect);
+	void GetItemRange(const RECT &rect, int &nFirstItem, int &nLastItem);
+	int FindItem(IEditorTexture *pTex);
 
 	int total_x;
 	int total_y;
@@ -115,6 +143,27 @@ protected:
 
 	TEXTUREFORMAT m_eTextureFormat;
 
+	CTextureSearchIndex m_SearchIndex;	// Names and keywords of the active textures.
+	FilterStage_t m_eFilterStage;		// First filter stage that has to be rerun.
+	bool m_bIncrementalNames;			// The new name filter only narrows down the last one's results.
+
+	bool m_bNameMatchesAll;				// All textures passed the name filter. m_NameMatches is not filled in.
+	CUtlVector<int> m_NameMatches;		// Search index entries that passed the name filter.
+	CUtlVector<int> m_Matches;			// Search index entries that passed the keyword filter.
+	CUtlVector<int> m_UsageCount;		// Per search index entry usage count when showing a specific list.
+
+	CUtlVector<TextureWindowItem_t> m_Items;	// The textures shown, in order.
+	CUtlVector<int> m_ItemForTexture;	// Per search index entry index into m_Items, -1 if not shown.
+
+	CUtlRBTree<IEditorTexture *, int> m_LoadFailed;	// Textures that stayed zero-size without loading; filtered out like loaded zero-size ones.
+
+	//
+	// Every item has the same size, so the layout is a grid defined by these.
+	//
+	int m_nColumns;
+	int m_nItemWidth;
+	int m_nItemHeight;
+
 	//{{AFX_MSG(CTextureWindow)
 	afx_msg void OnPaint();
 	afx_msg void OnSize(UINT nType, int cx, int cy);
@@ -0,0 +1,202 @@
+//========= Copyright  1996-2005, Valve Corporation, All rights reserved. ============//
+//
+// Purpose: Trigram index for fast substring searches over many short strings.
+//
+//=============================================================================//
+
+#include "stdafx.h"
+#include "TrigramIndex.h"
+
+// memdbgon must be the last include file in a .cpp file!!!
+#include <tier0/memdbgon.h>
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Packs three characters into a trigram key.
+//-----------------------------------------------------------------------------
+static inline unsigned int MakeTrigram(const char *psz)
+{
+	return ((unsigned int)(unsigned char)psz[0] << 16) | ((unsigned int)(unsigned char)psz[1] << 8) | (unsigned int)(unsigned char)psz[2];
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Sort function for (trigram, entry) pairs packed into 64 bits.
+//-----------------------------------------------------------------------------
+static int __cdecl CompareTrigramPairs(const uint64 *pPair1, const uint64 *pPair2)
+{
+	if (*pPair1 < *pPair2)
+	{
+		return(-1);
+	}
+
+	return (*pPair1 > *pPair2) ? 1 : 0;
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Constructor.
+//-----------------------------------------------------------------------------
+CTrigramIndex::CTrigramIndex(void)
+{
+	m_bIndexed = false;
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Clears all strings and sizes the index for the given number of entries.
+//-----------------------------------------------------------------------------
+void CTrigramIndex::Init(int nEntries)
+{
+	Purge();
+
+	m_StringOffset.SetCount(nEntries);
+	for (int i = 0; i < nEntries; i++)
+	{
+		m_StringOffset[i] = -1;
+	}
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Frees all strings and the index.
+//-----------------------------------------------------------------------------
+void CTrigramIndex::Purge(void)
+{
+	m_Strings.Purge();
+	m_StringOffset.Purge();
+	m_Trigrams.Purge();
+	m_PostingStart.Purge();
+	m_Postings.Purge();
+	m_bIndexed = false;
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Stores the string for an entry, converted to uppercase.
+//-----------------------------------------------------------------------------
+void CTrigramIndex::SetString(int nEntry, const char *pszString)
+{
+	Assert(!m_bIndexed);
+
+	int nOffset = m_Strings.AddMultipleToTail(strlen(pszString) + 1, pszString);
+	strupr(m_Strings.Base() + nOffset);
+	m_StringOffset[nEntry] = nOffset;
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Builds the trigram lists. All strings must have been set.
+//-----------------------------------------------------------------------------
+void CTrigramIndex::BuildIndex(void)
+{
+	//
+	// Collect each distinct (trigram, entry) pair. Sorting them groups the
+	// pairs by trigram with the entries in ascending order.
+	//
+	CUtlVector<uint64> Pairs;
+	Pairs.EnsureCapacity(m_Strings.Count());
+
+	for (int nEntry = 0; nEntry < m_StringOffset.Count(); nEntry++)
+	{
+		Assert(HasString(nEntry));
+		const char *psz = GetString(nEntry);
+		for (int i = 0; (psz[i] != '\0') && (psz[i + 1] != '\0') && (psz[i + 2] != '\0'); i++)
+		{
+			Pairs.AddToTail(((uint64)MakeTrigram(psz + i) << 32) | (uint64)nEntry);
+		}
+	}
+
+	Pairs.Sort(CompareTrigramPairs);
+
+	m_Trigrams.RemoveAll();
+	m_PostingStart.RemoveAll();
+	m_Postings.RemoveAll();
+	m_Postings.EnsureCapacity(Pairs.Count());
+
+	for (int i = 0; i < Pairs.Count(); i++)
+	{
+		if ((i > 0) && (Pairs[i] == Pairs[i - 1]))
+		{
+			continue;
+		}
+
+		unsigned int nTrigram = (unsigned int)(Pairs[i] >> 32);
+		if ((m_Trigrams.Count() == 0) || (m_Trigrams.Tail() != nTrigram))
+		{
+			m_Trigrams.AddToTail(nTrigram);
+			m_PostingStart.AddToTail(m_Postings.Count());
+		}
+
+		m_Postings.AddToTail((int)(Pairs[i] & 0xFFFFFFFF));
+	}
+
+	m_PostingStart.AddToTail(m_Postings.Count());
+	m_bIndexed = true;
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Finds the entries whose string contains the first three characters
+//			of the given string.
+// Output : Returns the number of entries, and a pointer to their sorted
+//			indices in ppPostings.
+//-----------------------------------------------------------------------------
+int CTrigramIndex::GetPostings(const char *pszTrigram, const int **ppPostings) const
+{
+	unsigned int nTrigram = MakeTrigram(pszTrigram);
+
+	int nLow = 0;
+	int nHigh = m_Trigrams.Count() - 1;
+	while (nLow <= nHigh)
+	{
+		int nMid = (nLow + nHigh) / 2;
+		if (m_Trigrams[nMid] < nTrigram)
+		{
+			nLow = nMid + 1;
+		}
+		else if (m_Trigrams[nMid] > nTrigram)
+		{
+			nHigh = nMid - 1;
+		}
+		else
+		{
+			*ppPostings = m_Postings.Base() + m_PostingStart[nMid];
+			return(m_PostingStart[nMid + 1] - m_PostingStart[nMid]);
+		}
+	}
+
+	*ppPostings = NULL;
+	return(0);
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Finds the shortest entry list among the trigrams of an uppercase
+//			search term. A string that contains the term contains each of the
+//			term's trigrams, so this bounds the strings that have to be checked.
+// Output : Returns the number of entries, or -1 if the term is shorter than
+//			three characters or the index hasn't been built.
+//-----------------------------------------------------------------------------
+int CTrigramIndex::GetShortestPostings(const char *pszTerm, const int **ppPostings) const
+{
+	*ppPostings = NULL;
+	int nPostings = -1;
+
+	if (m_bIndexed)
+	{
+		int nLen = strlen(pszTerm);
+		for (int i = 0; i + 3 <= nLen; i++)
+		{
+			const int *pList;
+			int nCount = GetPostings(pszTerm + i, &pList);
+			if ((nPostings == -1) || (nCount < nPostings))
+			{
+				*ppPostings = pList;
+				nPostings = nCount;
+			}
+		}
+	}
+
+	return(nPostings);
+}
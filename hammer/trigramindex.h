@@ -0,0 +1,52 @@
+//========= Copyright  1996-2005, Valve Corporation, All rights reserved. ============//
+//
+// Purpose: Trigram index for fast substring searches over many short strings.
+//
+//=============================================================================//
+
+#ifndef TRIGRAMINDEX_H
+#define TRIGRAMINDEX_H
+#ifdef _WIN32
+#pragma once
+#endif
+
+#include "UtlVector.h"
+
+
+//-----------------------------------------------------------------------------
+// Uppercase strings, one per entry, with a map from each three character
+// sequence to the sorted list of entries whose string contains it.
+//-----------------------------------------------------------------------------
+class CTrigramIndex
+{
+public:
+
+	CTrigramIndex();
+
+	void Init(int nEntries);
+	void Purge(void);
+
+	inline bool HasString(int nEntry) const { return m_StringOffset[nEntry] != -1; }
+	inline const char *GetString(int nEntry) const { return m_Strings.Base() + m_StringOffset[nEntry]; }
+	void SetString(int nEntry, const char *pszString);
+
+	inline bool IsIndexed(void) const { return m_bIndexed; }
+	void BuildIndex(void);
+
+	int GetPostings(const char *pszTrigram, const int **ppPostings) const;
+	int GetShortestPostings(const char *pszTerm, const int **ppPostings) const;
+
+private:
+
+	CUtlVector<char> m_Strings;				// All strings, uppercase and null terminated.
+	CUtlVector<int> m_StringOffset;			// Per entry offset into m_Strings, -1 if not set yet.
+
+	CUtlVector<unsigned int> m_Trigrams;	// Sorted distinct trigrams.
+	CUtlVector<int> m_PostingStart;			// Per trigram start in m_Postings, plus one past the end.
+	CUtlVector<int> m_Postings;				// Entry indices, sorted within each trigram.
+
+	bool m_bIndexed;
+};
+
+
+#endif // TRIGRAMINDEX_H
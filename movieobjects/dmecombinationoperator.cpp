@@ -15,6 +15,7 @@
 #include "movieobjects/dmelog.h"
 #include "movieobjects/dmevertexdata.h"
 #include "movieobjects/dmemesh.h"
+#include "mathlib/ssemath.h"
 
 // memdbgon must be the last include file in a .cpp file!!!
 #include "tier0/memdbgon.h"
@@ -422,6 +423,7 @@ void CDmeCombinationOperator::OnConstruction()
 	m_Dominators.Init( this, "dominators", FATTRIB_HAS_CALLBACK | FATTRIB_HAS_ARRAY_CALLBACK );
 
 	m_Targets.Init( this, "targets" );
+	m_nRawControlSerialNumber = 0;
 	m_flLastLaggedComputationTime = FLT_MIN;
 }
 
@@ -430,6 +432,12 @@ void CDmeCombinationOperator::OnDestruction()
 	m_RawControlInfo.RemoveAll();
 	m_CombinationInfo.RemoveAll();
 	m_DominatorInfo.RemoveAll();
+	for ( int i = 0; i < COMBO_CONTROL_TYPE_COUNT; ++i )
+	{
+		m_FactorValuesX[i].Purge();
+		m_FactorValuesY[i].Purge();
+	}
+	m_WeightScratch.Purge();
 }
 
 
@@ -1164,6 +1172,9 @@ void CDmeCombinationOperator::RebuildRawControlList()
 //-----------------------------------------------------------------------------
 void CDmeCombinationOperator::RebuildDominatorInfo()
 {
+	// Raw control and dominator indices are about to change, so compiled programs are stale
+	++m_nRawControlSerialNumber;
+
 	m_DominatorInfo.RemoveAll();
 	int nCount = m_Dominators.Count();
 	int *pDominators = (int*)_alloca( m_RawControlInfo.Count() * sizeof(int) );
@@ -1457,6 +1468,7 @@ void CDmeCombinationOperator::ComputeCombinationInfo( int nIndex )
 	}
 
 	CombinationInfo_t &info = m_CombinationInfo[nIndex];
+	info.m_Program.m_nSerialNumber = m_nRawControlSerialNumber;
 
 	CDmElement *pSource = m_Targets[ nIndex ];
 	if ( !pSource )
@@ -1503,6 +1515,98 @@ void CDmeCombinationOperator::ComputeCombinationInfo( int nIndex )
 		// Find dominators
 		FindDominators( op );
 	}
+
+	CompileCombinationProgram( info );
+}
+
+
+//-----------------------------------------------------------------------------
+// Compiles the outputs of a target into blocks of four outputs each, so Operate
+// can evaluate four outputs at once. Outputs are ordered by the number of
+// factors in them, which keeps the padding within each block small.
+//-----------------------------------------------------------------------------
+void CDmeCombinationOperator::CompileCombinationProgram( CombinationInfo_t &info )
+{
+	CombinationProgram_t &program = info.m_Program;
+	program.m_DeltaStateIndices.RemoveAll();
+	program.m_BlockStart.RemoveAll();
+	program.m_Factors.RemoveAll();
+
+	int nOutputCount = info.m_Outputs.Count();
+	if ( nOutputCount == 0 )
+		return;
+
+	int nRawControlCount = m_RawControlInfo.Count();
+	int *pFactorCounts = (int*)_alloca( nOutputCount * sizeof(int) );
+	int nMaxFactorCount = 0;
+	for ( int i = 0; i < nOutputCount; ++i )
+	{
+		const CombinationOperation_t &op = info.m_Outputs[i];
+		pFactorCounts[i] = op.m_ControlIndices.Count() + op.m_DominatorIndices.Count();
+		nMaxFactorCount = max( nMaxFactorCount, pFactorCounts[i] );
+	}
+
+	// Counting sort of the outputs by factor count
+	int *pBucketStart = (int*)_alloca( ( nMaxFactorCount + 2 ) * sizeof(int) );
+	memset( pBucketStart, 0, ( nMaxFactorCount + 2 ) * sizeof(int) );
+	for ( int i = 0; i < nOutputCount; ++i )
+	{
+		++pBucketStart[ pFactorCounts[i] + 1 ];
+	}
+	for ( int i = 1; i <= nMaxFactorCount + 1; ++i )
+	{
+		pBucketStart[i] += pBucketStart[i-1];
+	}
+	int *pOrder = (int*)_alloca( nOutputCount * sizeof(int) );
+	for ( int i = 0; i < nOutputCount; ++i )
+	{
+		pOrder[ pBucketStart[ pFactorCounts[i] ]++ ] = i;
+	}
+
+	int nBlockCount = ( nOutputCount + 3 ) / 4;
+	program.m_DeltaStateIndices.SetCount( nOutputCount );
+	program.m_BlockStart.SetCount( nBlockCount + 1 );
+	for ( int i = 0; i < nBlockCount; ++i )
+	{
+		int nFirstOutput = i * 4;
+		int nLaneCount = min( 4, nOutputCount - nFirstOutput );
+
+		// The last output of the block has the most factors
+		int nRowCount = pFactorCounts[ pOrder[ nFirstOutput + nLaneCount - 1 ] ];
+
+		program.m_BlockStart[i] = program.m_Factors.Count();
+		int nFirstFactor = program.m_Factors.AddMultipleToTail( nRowCount * 4 );
+		int *pFactors = program.m_Factors.Base() + nFirstFactor;
+
+		for ( int j = 0; j < 4; ++j )
+		{
+			int nRow = 0;
+			if ( j < nLaneCount )
+			{
+				const CombinationOperation_t &op = info.m_Outputs[ pOrder[ nFirstOutput + j ] ];
+				program.m_DeltaStateIndices[ nFirstOutput + j ] = op.m_nDeltaStateIndex;
+
+				int nControlCount = op.m_ControlIndices.Count();
+				for ( int k = 0; k < nControlCount; ++k, ++nRow )
+				{
+					pFactors[ nRow * 4 + j ] = 1 + op.m_ControlIndices[k];
+				}
+
+				int nDominatorCount = op.m_DominatorIndices.Count();
+				for ( int k = 0; k < nDominatorCount; ++k, ++nRow )
+				{
+					pFactors[ nRow * 4 + j ] = 1 + nRawControlCount + op.m_DominatorIndices[k];
+				}
+			}
+
+			// Pad with factor 0, which is 1.0
+			for ( ; nRow < nRowCount; ++nRow )
+			{
+				pFactors[ nRow * 4 + j ] = 0;
+			}
+		}
+	}
+	program.m_BlockStart[ nBlockCount ] = program.m_Factors.Count();
 }
 
 
@@ -1533,6 +1637,9 @@ void CDmeCombinationOperator::CleanUpCombinationInfo( int nIndex )
 		info.m_hDestAttribute[i] = DMATTRIBUTE_HANDLE_INVALID;
 	}
 	info.m_Outputs.RemoveAll();
+	info.m_Program.m_DeltaStateIndices.RemoveAll();
+	info.m_Program.m_BlockStart.RemoveAll();
+	info.m_Program.m_Factors.RemoveAll();
 }
 
 
@@ -1690,6 +1797,106 @@ void CDmeCombinationOperator::ComputeLaggedInputValues()
 }
 
 
+//-----------------------------------------------------------------------------
+// Computes every raw control value once, followed by the value each domination
+// rule scales the outputs it applies to by: one minus the product of its
+// dominant controls
+//-----------------------------------------------------------------------------
+void CDmeCombinationOperator::ComputeFactorValues( CombinationControlType_t type )
+{
+	int nRawControlCount = m_RawControlInfo.Count();
+	int nDominatorCount = m_DominatorInfo.Count();
+	int nFactorCount = 1 + nRawControlCount + nDominatorCount;
+
+	CUtlVector< float > &factorX = m_FactorValuesX[type];
+	CUtlVector< float > &factorY = m_FactorValuesY[type];
+	factorX.SetCount( nFactorCount );
+	factorY.SetCount( nFactorCount );
+
+	factorX[0] = factorY[0] = 1.0f;
+
+	float *pRawX = factorX.Base() + 1;
+	float *pRawY = factorY.Base() + 1;
+	for ( int i = 0; i < nRawControlCount; ++i )
+	{
+		Vector2D v;
+		ComputeInternalControlValue( i, type, v );
+		pRawX[i] = v.x;
+		pRawY[i] = v.y;
+	}
+
+	float *pDominatorX = pRawX + nRawControlCount;
+	float *pDominatorY = pRawY + nRawControlCount;
+	for ( int i = 0; i < nDominatorCount; ++i )
+	{
+		const CUtlVector< int > &dominantIndices = m_DominatorInfo[i].m_DominantIndices;
+		int nDominantCount = dominantIndices.Count();
+
+		Vector2D suppressor( -1.0f, -1.0f );
+		for ( int j = 0; j < nDominantCount; ++j )
+		{
+			suppressor.x *= pRawX[ dominantIndices[j] ];
+			suppressor.y *= pRawY[ dominantIndices[j] ];
+		}
+		pDominatorX[i] = suppressor.x + 1.0f;
+		pDominatorY[i] = suppressor.y + 1.0f;
+	}
+}
+
+
+//-----------------------------------------------------------------------------
+// Evaluates four outputs at a time, then writes all of them with a single update
+//-----------------------------------------------------------------------------
+void CDmeCombinationOperator::ExecuteCombinationProgram( const CombinationProgram_t &program, CombinationControlType_t type, CDmrArray< Vector2D > &weights )
+{
+	int nOutputCount = program.m_DeltaStateIndices.Count();
+	if ( nOutputCount == 0 )
+		return;
+
+	const float *pFactorX = m_FactorValuesX[type].Base();
+	const float *pFactorY = m_FactorValuesY[type].Base();
+
+	int nWeightCount = weights.Count();
+	m_WeightScratch.CopyArray( weights.Base(), nWeightCount );
+	Vector2D *pWeights = m_WeightScratch.Base();
+
+	float flX[4], flY[4];
+	const int *pFactors = program.m_Factors.Base();
+	int nBlockCount = program.m_BlockStart.Count() - 1;
+	for ( int i = 0; i < nBlockCount; ++i )
+	{
+		fltx4 x = Four_Ones;
+		fltx4 y = Four_Ones;
+
+		const int *pRow = pFactors + program.m_BlockStart[i];
+		const int *pEnd = pFactors + program.m_BlockStart[i+1];
+		for ( ; pRow != pEnd; pRow += 4 )
+		{
+			flX[0] = pFactorX[ pRow[0] ]; flX[1] = pFactorX[ pRow[1] ]; flX[2] = pFactorX[ pRow[2] ]; flX[3] = pFactorX[ pRow[3] ];
+			flY[0] = pFactorY[ pRow[0] ]; flY[1] = pFactorY[ pRow[1] ]; flY[2] = pFactorY[ pRow[2] ]; flY[3] = pFactorY[ pRow[3] ];
+			x = MulSIMD( x, LoadUnalignedSIMD( flX ) );
+			y = MulSIMD( y, LoadUnalignedSIMD( flY ) );
+		}
+
+		StoreUnalignedSIMD( flX, x );
+		StoreUnalignedSIMD( flY, y );
+
+		int nFirstOutput = i * 4;
+		int nLaneCount = min( 4, nOutputCount - nFirstOutput );
+		for ( int j = 0; j < nLaneCount; ++j )
+		{
+			int nDeltaStateIndex = program.m_DeltaStateIndices[ nFirstOutput + j ];
+			if ( nDeltaStateIndex < nWeightCount )
+			{
+				pWeights[ nDeltaStateIndex ].Init( flX[j], flY[j] );
+			}
+		}
+	}
+
+	weights.SetMultiple( 0, nWeightCount, pWeights );
+}
+
+
 //-----------------------------------------------------------------------------
 // Purpose: 
 //-----------------------------------------------------------------------------
@@ -1697,9 +1904,21 @@ void CDmeCombinationOperator::Operate()
 {
 	ComputeLaggedInputValues();
 
+	bool bFactorsComputed[COMBO_CONTROL_TYPE_COUNT];
+	for ( int i = 0; i < COMBO_CONTROL_TYPE_COUNT; ++i )
+	{
+		bFactorsComputed[i] = false;
+	}
+
 	int nCount = m_CombinationInfo.Count();
 	for ( int i = 0; i < nCount; ++i )
 	{
+		// Recompile programs which refer to raw controls or dominators that have since changed
+		if ( m_CombinationInfo[i].m_Program.m_nSerialNumber != m_nRawControlSerialNumber && i < m_Targets.Count() )
+		{
+			ComputeCombinationInfo( i );
+		}
+
 		CombinationInfo_t &info = m_CombinationInfo[i];
 
 		for ( CombinationControlType_t type = COMBO_CONTROL_FIRST; type < COMBO_CONTROL_TYPE_COUNT; type = (CombinationControlType_t)(type+1) )
@@ -1714,43 +1933,13 @@ void CDmeCombinationOperator::Operate()
 			CDmrArray< Vector2D > vec2D( pAttribute );
 
 			CombinationControlType_t useType = m_bSpecifyingLaggedData ? type : COMBO_CONTROL_NORMAL;
-			int nOutputCount = info.m_Outputs.Count();
-			for ( int j = 0; j < nOutputCount; ++j )
+			if ( !bFactorsComputed[useType] )
 			{
-				CombinationOperation_t &op = info.m_Outputs[j];
-
-				// Compute the core combination
-				Vector2D vecValue( 1.0f, 1.0f );
-				int nCombinationCount = op.m_ControlIndices.Count();
-				for ( int k = 0; k < nCombinationCount; ++k )
-				{
-					Vector2D v;
-					ComputeInternalControlValue( op.m_ControlIndices[k], useType, v );
-					vecValue *= v;
-				}
-
-
-				// Compute the dominators
-				int nDominatorCount = op.m_DominatorIndices.Count();
-				for ( int k = 0; k < nDominatorCount; ++k )
-				{
-					const CUtlVector< int > &dominantIndices = m_DominatorInfo[ op.m_DominatorIndices[k] ].m_DominantIndices;
-					int nDominantCount = dominantIndices.Count();
-
-					Vector2D suppressor( -1.0f, -1.0f );
-					for ( int l = 0; l < nDominantCount; ++l )
-					{
-						Vector2D v;
-						ComputeInternalControlValue( dominantIndices[l], useType, v );
-						suppressor *= v;
-					}
-					suppressor.x += 1.0f; suppressor.y += 1.0f;
-
-					vecValue *= suppressor;
-				}
-
-				vec2D.Set( op.m_nDeltaStateIndex, vecValue );
+				ComputeFactorValues( useType );
+				bFactorsComputed[useType] = true;
 			}
+
+			ExecuteCombinationProgram( info.m_Program, useType, vec2D );
 		}
 	}
 }
@@ -331,10 +331,23 @@ private:
 		CUtlVector< RawControlIndex_t > m_DominatorIndices;
 	};
 
+	// The outputs of a target compiled into blocks of four. Each row of a block
+	// holds, for each of its outputs, the index of a factor to multiply into it.
+	// Factor 0 is 1.0, followed by the raw control values and then the values of
+	// the domination rules (see ComputeFactorValues)
+	struct CombinationProgram_t
+	{
+		int m_nSerialNumber;					// m_nRawControlSerialNumber when compiled
+		CUtlVector< int > m_DeltaStateIndices;	// destination of each output
+		CUtlVector< int > m_BlockStart;			// first factor of each block, plus one past the last
+		CUtlVector< int > m_Factors;
+	};
+
 	struct CombinationInfo_t
 	{
 		DmAttributeHandle_t m_hDestAttribute[COMBO_CONTROL_TYPE_COUNT];
 		CUtlVector< CombinationOperation_t > m_Outputs;
+		CombinationProgram_t m_Program;
 	};
 
 	struct RawControlInfo_t
@@ -369,6 +382,15 @@ private:
 	// Computes lists of dominators and suppressors
 	void RebuildDominatorInfo();
 
+	// Compiles the outputs of a target into its program
+	void CompileCombinationProgram( CombinationInfo_t &info );
+
+	// Computes the raw control and domination rule values used by the programs
+	void ComputeFactorValues( CombinationControlType_t type );
+
+	// Runs a program, writing its outputs into a deltaStateWeights array
+	void ExecuteCombinationProgram( const CombinationProgram_t &program, CombinationControlType_t type, CDmrArray< Vector2D > &weights );
+
 	// Computes list of all remapped controls
 	void RebuildRawControlList();
 
@@ -402,6 +424,12 @@ private:
 	CUtlVector< RawControlInfo_t > m_RawControlInfo;
 	CUtlVector< CombinationInfo_t > m_CombinationInfo;
 	CUtlVector< DominatorInfo_t > m_DominatorInfo;
+	int m_nRawControlSerialNumber;	// changes whenever the raw controls or dominators are rebuilt
+
+	// Per-frame scratch space used by Operate
+	CUtlVector< float > m_FactorValuesX[COMBO_CONTROL_TYPE_COUNT];
+	CUtlVector< float > m_FactorValuesY[COMBO_CONTROL_TYPE_COUNT];
+	CUtlVector< Vector2D > m_WeightScratch;
 
 	float m_flLastLaggedComputationTime;
 };
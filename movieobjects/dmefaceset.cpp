@@ -22,10 +22,13 @@ IMPLEMENT_ELEMENT_FACTORY( DmeFaceSet, CDmeFaceSet );
 //-----------------------------------------------------------------------------
 // Constructor, destructor
 //-----------------------------------------------------------------------------
+int CDmeFaceSet::s_nNextSerialNumber = 0;
+
 void CDmeFaceSet::OnConstruction()
 {
 	m_indices.Init( this, "faces" );
 	m_material.Init( this, "material" );
+	m_nSerialNumber = ++s_nNextSerialNumber;
 }
 
 void CDmeFaceSet::OnDestruction()
@@ -33,6 +36,18 @@ void CDmeFaceSet::OnDestruction()
 }
 
 
+//-----------------------------------------------------------------------------
+// resolve internal data from changed attributes
+//-----------------------------------------------------------------------------
+void CDmeFaceSet::Resolve()
+{
+	BaseClass::Resolve();
+
+	// We're only resolved when some attribute has changed
+	m_nSerialNumber = ++s_nNextSerialNumber;
+}
+
+
 //-----------------------------------------------------------------------------
 // accessors
 //-----------------------------------------------------------------------------
@@ -59,9 +59,17 @@ public:
 	// empty faces (which aren't counted as faces) and a missing -1 terminator at the end
 	int GetFaceCount() const;
 
+	// Returns a number which changes whenever the face set does
+	int GetSerialNumber() const;
+
+	virtual void Resolve();
+
 private:
 	CDmaArray< int > m_indices;
 	CDmaElement< CDmeMaterial > m_material;
+	int m_nSerialNumber;
+
+	static int s_nNextSerialNumber;
 };
 
 
@@ -83,5 +91,10 @@ inline int CDmeFaceSet::GetIndex( int i ) const
 	return m_indices[i];
 }
 
+inline int CDmeFaceSet::GetSerialNumber() const
+{
+	return m_nSerialNumber;
+}
+
 
 #endif // DMEFACESET_H
@@ -177,15 +177,9 @@ float DmeLog_TimeSelection_t::GetAmountForTime( DmeTime_t dmetime ) const
 template < class T >
 T Average( const T *pValues, int nValues)
 {
-	if ( IsInterpolableType( CDmAttributeInfo< T >::AttributeType() ) )
-	{
-		static bool first = true;
-		if ( first )
-		{
-			first = false;
-			Warning( "CDmeLog: interpolable type %s doesn't have an averaging function!", CDmAttributeInfo< T >::AttributeTypeName() );
-		}
-	}
+	// No static warn-once latch here, logs are evaluated from several threads
+	AssertMsg1( !IsInterpolableType( CDmAttributeInfo< T >::AttributeType() ),
+		"CDmeLog: interpolable type %s doesn't have an averaging function!", CDmAttributeInfo< T >::AttributeTypeName() );
 
 	Assert( nValues > 0 );
 	if ( nValues <= 0 )
@@ -308,24 +302,123 @@ Quaternion Average( const Quaternion *pValues, int nValues )
 }
 
 
-
 //-----------------------------------------------------------------------------
-// per-type interpolation methods
+// per-type box filters - each value is replaced by the average of the values
+// within nSampleRadius of it, with the window shrinking towards either end
 //-----------------------------------------------------------------------------
 
-// catch-all for non-interpolable types - just holds first value
+// catch-all - averages each window separately
 template < class T >
-T Interpolate( float t, const T& ti, const T& tj )
+void BoxFilter( const T *pValues, int nValues, int nSampleRadius, CUtlVector< T > &filteredValues )
 {
-	if ( IsInterpolableType( CDmAttributeInfo< T >::AttributeType() ) )
+	filteredValues.EnsureCapacity( nValues );
+	for ( int i = 0; i < nValues; ++i )
 	{
-		static bool first = true;
-		if ( first )
+		int nSamples = min( nSampleRadius, min( i, nValues - i - 1 ) );
+		filteredValues.AddToTail( Average( pValues + i - nSamples, 2 * nSamples + 1 ) );
+	}
+}
+
+// Filters nComponents floats per value using one prefix sum per component, so the cost
+// doesn't depend on the radius. Sums are kept in doubles to avoid drift over long logs.
+static void BoxFilterComponents( const float *pValues, int nValues, int nComponents, int nSampleRadius, float *pFiltered )
+{
+	CUtlVector< double > prefixSums;
+	prefixSums.SetCount( nComponents * ( nValues + 1 ) );
+
+	for ( int c = 0; c < nComponents; ++c )
+	{
+		double *pSums = prefixSums.Base() + c * ( nValues + 1 );
+		const float *pIn = pValues + c;
+
+		double sum = 0.0;
+		pSums[ 0 ] = 0.0;
+		for ( int i = 0; i < nValues; ++i, pIn += nComponents )
+		{
+			sum += *pIn;
+			pSums[ i + 1 ] = sum;
+		}
+
+		float *pOut = pFiltered + c;
+		for ( int i = 0; i < nValues; ++i, pOut += nComponents )
 		{
-			first = false;
-			Warning( "CDmeLog: interpolable type %s doesn't have an interpolation function!", CDmAttributeInfo< T >::AttributeTypeName() );
+			int nSamples = min( nSampleRadius, min( i, nValues - i - 1 ) );
+			double flWindowSum = pSums[ i + nSamples + 1 ] - pSums[ i - nSamples ];
+			*pOut = (float)( flWindowSum / ( 2 * nSamples + 1 ) );
 		}
 	}
+}
+
+// float version
+template <>
+void BoxFilter( const float *pValues, int nValues, int nSampleRadius, CUtlVector< float > &filteredValues )
+{
+	filteredValues.SetCount( nValues );
+	BoxFilterComponents( pValues, nValues, 1, nSampleRadius, filteredValues.Base() );
+}
+
+// Vector2 version
+template <>
+void BoxFilter( const Vector2D *pValues, int nValues, int nSampleRadius, CUtlVector< Vector2D > &filteredValues )
+{
+	filteredValues.SetCount( nValues );
+	BoxFilterComponents( pValues->Base(), nValues, 2, nSampleRadius, filteredValues.Base()->Base() );
+}
+
+// Vector3 version
+template <>
+void BoxFilter( const Vector *pValues, int nValues, int nSampleRadius, CUtlVector< Vector > &filteredValues )
+{
+	filteredValues.SetCount( nValues );
+	BoxFilterComponents( pValues->Base(), nValues, 3, nSampleRadius, filteredValues.Base()->Base() );
+}
+
+// Quaternion version - the normalized mean of the window, which matches the
+// incremental slerp average above to within tolerance for nearby rotations
+template <>
+void BoxFilter( const Quaternion *pValues, int nValues, int nSampleRadius, CUtlVector< Quaternion > &filteredValues )
+{
+	if ( nValues <= 0 )
+		return;
+
+	// Flip each quaternion into the same hemisphere as its predecessor so the sums don't cancel
+	CUtlVector< Quaternion > aligned;
+	aligned.SetCount( nValues );
+	aligned[ 0 ] = pValues[ 0 ];
+	for ( int i = 1; i < nValues; ++i )
+	{
+		QuaternionAlign( aligned[ i - 1 ], pValues[ i ], aligned[ i ] );
+	}
+
+	filteredValues.SetCount( nValues );
+	BoxFilterComponents( aligned.Base()->Base(), nValues, 4, nSampleRadius, filteredValues.Base()->Base() );
+
+	for ( int i = 0; i < nValues; ++i )
+	{
+		Quaternion &q = filteredValues[ i ];
+		QuaternionNormalize( q );
+
+		// keep the hemisphere of the original key
+		const Quaternion &orig = pValues[ i ];
+		if ( q.x * orig.x + q.y * orig.y + q.z * orig.z + q.w * orig.w < 0.0f )
+		{
+			q.Init( -q.x, -q.y, -q.z, -q.w );
+		}
+	}
+}
+
+
+
+//-----------------------------------------------------------------------------
+// per-type interpolation methods
+//-----------------------------------------------------------------------------
+
+// catch-all for non-interpolable types - just holds first value
+template < class T >
+T Interpolate( float t, const T& ti, const T& tj )
+{
+	AssertMsg1( !IsInterpolableType( CDmAttributeInfo< T >::AttributeType() ),
+		"CDmeLog: interpolable type %s doesn't have an interpolation function!", CDmAttributeInfo< T >::AttributeTypeName() );
 
 	return ti;
 }
@@ -385,24 +478,17 @@ QAngle Interpolate( float t, const QAngle& ti, const QAngle& tj )
 template <>
 Quaternion Interpolate( float t, const Quaternion& ti, const Quaternion& tj )
 {
-	static Quaternion s_value;
-	QuaternionSlerp( ti, tj, t, s_value );
-	return s_value;
+	Quaternion value;
+	QuaternionSlerp( ti, tj, t, value );
+	return value;
 }
 
 // catch-all for non-interpolable types - just holds first value
 template < class T >
 T Curve_Interpolate( float t, DmeTime_t times[ 4 ], const T values[ 4 ], int curveTypes[ 4 ], float fmin, float fmax )
 {
-	if ( IsInterpolableType( CDmAttributeInfo< T >::AttributeType() ) )
-	{
-		static bool first = true;
-		if ( first )
-		{
-			first = false;
-			Warning( "CDmeLog: interpolable type %s doesn't have an interpolation function!", CDmAttributeInfo< T >::AttributeTypeName() );
-		}
-	}
+	AssertMsg1( !IsInterpolableType( CDmAttributeInfo< T >::AttributeType() ),
+		"CDmeLog: interpolable type %s doesn't have an interpolation function!", CDmAttributeInfo< T >::AttributeTypeName() );
 
 	return t;
 }
@@ -870,7 +956,6 @@ float CDmeStringLog::s_defaultThreshold = 0.0f;
 void CDmeLogLayer::OnConstruction()
 {
 	m_pOwnerLog = NULL;
-	m_lastKey = 0;
 	m_times.Init( this, "times" );
 	m_CurveTypes.Init( this, "curvetypes" );
 }
@@ -923,39 +1008,74 @@ bool CDmeLogLayer::ValidateKeys() const
 	return true;
 }
 
-int CDmeLogLayer::FindKey( DmeTime_t time ) const
+//-----------------------------------------------------------------------------
+// Finds the last key at or before nTime, given that pTimes[ lo ] <= nTime
+// (or lo == -1) and pTimes[ hi ] > nTime (or hi == the key count)
+//-----------------------------------------------------------------------------
+static int BinarySearchKey( const int *pTimes, int lo, int hi, int nTime )
 {
-	int tn = m_times.Count();
-	if ( m_lastKey >= 0 && m_lastKey < tn )
+	while ( hi - lo > 1 )
 	{
-		if ( time >= DmeTime_t( m_times[ m_lastKey ] ) )
+		int mid = ( lo + hi ) >> 1;
+		if ( pTimes[ mid ] <= nTime )
 		{
-			// common case - playing forward
-			for ( ; m_lastKey < tn - 1; ++m_lastKey )
-			{
-				if ( time < DmeTime_t( m_times[ m_lastKey + 1 ] ) )
-					return m_lastKey;
-			}
-
-			// if time past the end, return the last key
-			return m_lastKey;
+			lo = mid;
 		}
 		else
 		{
-			tn = m_lastKey;
+			hi = mid;
 		}
 	}
+	return lo;
+}
+
+int CDmeLogLayer::FindKey( DmeTime_t time ) const
+{
+	return BinarySearchKey( m_times.Base(), -1, m_times.Count(), time.GetTenthsOfMS() );
+}
 
-	for ( int ti = tn - 1; ti >= 0; --ti )
+int CDmeLogLayer::FindKey( DmeTime_t time, DmeLogCursor_t &cursor ) const
+{
+	int tn = m_times.Count();
+	int nHint = cursor.m_nKey;
+	if ( nHint < 0 || nHint >= tn )
+	{
+		cursor.m_nKey = FindKey( time );
+		return cursor.m_nKey;
+	}
+
+	const int *pTimes = m_times.Base();
+	int nTime = time.GetTenthsOfMS();
+
+	// gallop away from the hint until the key is bracketed, then binary search the bracket
+	int lo, hi;
+	int nStep = 1;
+	if ( pTimes[ nHint ] <= nTime )
+	{
+		// common case - playing forward
+		lo = nHint;
+		hi = nHint + 1;
+		while ( hi < tn && pTimes[ hi ] <= nTime )
+		{
+			lo = hi;
+			nStep <<= 1;
+			hi = min( lo + nStep, tn );
+		}
+	}
+	else
 	{
-		if ( time >= DmeTime_t(  m_times[ ti ] ) )
+		hi = nHint;
+		lo = nHint - 1;
+		while ( lo >= 0 && pTimes[ lo ] > nTime )
 		{
-			m_lastKey = ti;
-			return ti;
+			hi = lo;
+			nStep <<= 1;
+			lo = max( hi - nStep, -1 );
 		}
 	}
 
-	return -1;
+	cursor.m_nKey = BinarySearchKey( pTimes, lo, hi, nTime );
+	return cursor.m_nKey;
 }
 
 
@@ -1354,11 +1474,6 @@ void CDmeTypedLogLayer< T >::RemoveKeys( DmeTime_t starttime )
 	{
 		m_CurveTypes.RemoveMultiple( ti, nKeys );
 	}
-
-	if ( m_lastKey >= ti && m_lastKey < ti + nKeys )
-	{
-		m_lastKey = ( ti > 0 ) ? ti - 1 : 0;
-	}
 }
 
 template< class T >
@@ -1367,7 +1482,6 @@ void CDmeTypedLogLayer< T >::ClearKeys()
 	m_times.RemoveAll();
 	m_values.RemoveAll();
 	m_CurveTypes.RemoveAll();
-	m_lastKey = 0;
 }
 
 template< class T >
@@ -1524,23 +1638,46 @@ static bool CanInterpolateType( DmAttributeType_t attType )
 }
 
 template< class T >
-const T& CDmeTypedLogLayer< T >::GetValue( DmeTime_t time ) const
+T CDmeTypedLogLayer< T >::GetValue( DmeTime_t time ) const
+{
+	// Curve Interpolation only for 1-D float data right now!!!
+	if ( IsUsingCurveTypes() && 
+		CanInterpolateType( GetDataType() ) )
+	{
+		T out;
+		GetValueUsingCurveInfo( time, out );
+		return out;
+	}
+
+	return GetValueAtKey( time, FindKey( time ) );
+}
+
+template< class T >
+T CDmeTypedLogLayer< T >::GetValue( DmeTime_t time, DmeLogCursor_t &cursor ) const
 {
 	// Curve Interpolation only for 1-D float data right now!!!
 	if ( IsUsingCurveTypes() && 
 		CanInterpolateType( GetDataType() ) )
 	{
-		static T out;
+		T out;
 		GetValueUsingCurveInfo( time, out );
 		return out;
 	}
 
+	return GetValueAtKey( time, FindKey( time, cursor ) );
+}
+
+//-----------------------------------------------------------------------------
+// Evaluates the log at a time, given the last key at or before that time
+//-----------------------------------------------------------------------------
+template< class T >
+T CDmeTypedLogLayer< T >::GetValueAtKey( DmeTime_t time, int ti ) const
+{
 	int tc = m_times.Count();
 
 	Assert( m_values.Count() == tc );
 	Assert( !IsUsingCurveTypes() || ( m_CurveTypes.Count() == tc ) );
 
-	int ti = FindKey( time );
 	if ( ti < 0 )
 	{
 		if ( tc > 0 )
@@ -1550,9 +1687,9 @@ const T& CDmeTypedLogLayer< T >::GetValue( DmeTime_t time ) const
 		if ( pOwner->HasDefaultValue() )
 			return pOwner->GetDefaultValue();
 
-		static T s_value;
-		CDmAttributeInfo< T >::SetDefaultValue( s_value ); // TODO - create GetDefaultValue that returns a default T, to avoid rebuilding every time
-		return s_value;
+		T value;
+		CDmAttributeInfo< T >::SetDefaultValue( value ); // TODO - create GetDefaultValue that returns a default T, to avoid rebuilding every time
+		return value;
 	}
 
 	// Early out if we're at the end
@@ -1564,9 +1701,7 @@ const T& CDmeTypedLogLayer< T >::GetValue( DmeTime_t time ) const
 
 	// Figure out the lerp factor
 	float t = GetFractionOfTimeBetween( time, DmeTime_t( m_times[ti] ), DmeTime_t( m_times[ti+1] ) );
-	static T s_value;
-	s_value = Interpolate( t, m_values[ti], m_values[ti+1] );	// Compute the lerp between ti and ti+1
-	return s_value;
+	return Interpolate( t, m_values[ti], m_values[ti+1] );	// Compute the lerp between ti and ti+1
 }
 
 template< class T >
@@ -1677,11 +1812,13 @@ void CDmeTypedLogLayer< T >::Resample( DmeFramerate_t samplerate )
 	resampledValues.EnsureCapacity( nSamples );
 	resampledTimes.EnsureCapacity( nSamples );
 
+	// sample times only increase, so the cursor walks the source keys once
+	DmeLogCursor_t cursor;
 	DmeTime_t time( begin );
 	for ( int i = 0; i < nSamples; ++i )
 	{
 		resampledTimes.AddToTail( time.GetTenthsOfMS() );
-		resampledValues.AddToTail( GetValue( time ) );
+		resampledValues.AddToTail( GetValue( time, cursor ) );
 		if ( IsUsingCurveTypes() )
 		{
 			resampledCurveTypes.AddToTail( CURVE_DEFAULT );
@@ -1706,14 +1843,7 @@ void CDmeTypedLogLayer< T >::Filter( int nSampleRadius )
 	const CUtlVector< T > &values = m_values.Get();
 	CUtlVector< T > filteredValues;
 
-	int nValues = values.Count();
-	filteredValues.EnsureCapacity( nValues );
-
-	for ( int i = 0; i < nValues; ++i )
-	{
-		int nSamples = min( nSampleRadius, min( i, nValues - i - 1 ) );
-		filteredValues.AddToTail( Average( values.Base() + i - nSamples, 2 * nSamples + 1 ) );
-	}
+	BoxFilter( values.Base(), values.Count(), nSampleRadius, filteredValues );
 
 	m_values.SwapArray( filteredValues );
 }
@@ -1734,6 +1864,9 @@ void CDmeTypedLogLayer< T >::Filter2( DmeTime_t sampleRadius )
 	{
 		earliest = DmeTime_t( m_times[ 0 ] );
 	}
+
+	// each of the three sample times only increases, so each gets a cursor
+	DmeLogCursor_t cursors[ 3 ];
 	for ( int i = 0; i < nValues; ++i )
 	{
 		T vals[ 3 ];
@@ -1743,14 +1876,14 @@ void CDmeTypedLogLayer< T >::Filter2( DmeTime_t sampleRadius )
 
 		if ( t0 >= earliest )
 		{
-			vals[ 0 ] = GetValue( t0 );
+			vals[ 0 ] = GetValue( t0, cursors[ 0 ] );
 		}
 		else
 		{
 			vals[ 0 ] = m_values[ 0 ];
 		}
-		vals[ 1 ] = GetValue( t );
-		vals[ 2 ] = GetValue( t1 );
+		vals[ 1 ] = GetValue( t, cursors[ 1 ] );
+		vals[ 2 ] = GetValue( t1, cursors[ 2 ] );
 
 		if ( i == 0 || i == nValues - 1 )
 		{
@@ -1766,12 +1899,12 @@ void CDmeTypedLogLayer< T >::Filter2( DmeTime_t sampleRadius )
 }
 
 template< class T >
-const T& CDmeTypedLogLayer< T >::GetValueSkippingKey( int nKeyToSkip ) const
+T CDmeTypedLogLayer< T >::GetValueSkippingKey( int nKeyToSkip ) const
 {
 	// Curve Interpolation only for 1-D float data right now!!!
 	if ( IsUsingCurveTypes() && CanInterpolateType( GetDataType() ) )
 	{
-		static T out;
+		T out;
 		GetValueUsingCurveInfoSkippingKey( nKeyToSkip, out );
 		return out;
 	}
@@ -1796,10 +1929,7 @@ const T& CDmeTypedLogLayer< T >::GetValueSkippingKey( int nKeyToSkip ) const
 
 	// Figure out the lerp factor
 	float t = GetFractionOfTimeBetween( time, prevTime, nextTime );
-
-	static T s_value;
-	s_value = Interpolate( t, prevValue, nextValue );
-	return s_value;
+	return Interpolate( t, prevValue, nextValue );
 }
 
 template< class T >
@@ -2471,7 +2601,6 @@ void CDmeTypedLogLayer< T >::CopyLayer( const CDmeLogLayer *src )
 {
 	const CDmeTypedLogLayer< T > *pSrc = static_cast< const CDmeTypedLogLayer< T > * >( src );
 	m_times = pSrc->m_times;
-	m_lastKey = pSrc->m_lastKey;
 	m_values = pSrc->m_values;
 	m_CurveTypes = pSrc->m_CurveTypes;
 }
@@ -2520,8 +2649,6 @@ void CDmeTypedLogLayer< T >::ExplodeLayer( const CDmeLogLayer *src, DmeTime_t st
 
 		InsertKey( keyTime, val, usecurvetypes ? GetDefaultCurveType() : CURVE_DEFAULT );
 	}
-
-	m_lastKey = m_times.Count() - 1;
 }
 
 template< class T >
@@ -2557,8 +2684,6 @@ void CDmeTypedLogLayer< T >::CopyPartialLayer( const CDmeLogLayer *src, DmeTime_
 			m_CurveTypes.AddToTail( pSrc->m_CurveTypes[ i ] );
 		}
 	}
-
-	m_lastKey = m_times.Count() - 1;
 }
 
 //-----------------------------------------------------------------------------
@@ -3373,7 +3498,7 @@ struct LayerEvent_t
 };
 
 template< class T >
-static const T& GetActiveLayerValue( CUtlVector< ActiveLayer_t< T > > &layerlist, DmeTime_t t, int nTopmostLayer )
+static T GetActiveLayerValue( CUtlVector< ActiveLayer_t< T > > &layerlist, DmeTime_t t, int nTopmostLayer )
 {
 	int nCount = layerlist.Count();
 #ifdef _DEBUG
@@ -3396,7 +3521,7 @@ static const T& GetActiveLayerValue( CUtlVector< ActiveLayer_t< T > > &layerlist
 			return pOwner->GetDefaultValue();
 	}
 
-	static T defaultVal;
+	T defaultVal;
 	CDmAttributeInfo<T>::SetDefaultValue( defaultVal );
 	return defaultVal;
 }
@@ -4588,21 +4713,35 @@ int CDmeTypedLog< T >::InsertKeyAtTime( DmeTime_t nTime, int curveType /*=CURVE_
 }
 
 template< class T >
-const T& CDmeTypedLog< T >::GetValue( DmeTime_t time ) const
+T CDmeTypedLog< T >::GetValue( DmeTime_t time ) const
 {
 	int bestLayer = FindLayerForTime( time );
 	if ( bestLayer < 0 )
 	{
-		static T s_value;
-		CDmAttributeInfo< T >::SetDefaultValue( s_value ); // TODO - create GetDefaultValue that returns a default T, to avoid rebuilding every time
-		return s_value;
+		T value;
+		CDmAttributeInfo< T >::SetDefaultValue( value ); // TODO - create GetDefaultValue that returns a default T, to avoid rebuilding every time
+		return value;
 	}
 
 	return GetLayer( bestLayer )->GetValue( time );
 }
 
 template< class T >
-const T& CDmeTypedLog< T >::GetValueSkippingTopmostLayer( DmeTime_t time ) const
+T CDmeTypedLog< T >::GetValue( DmeTime_t time, DmeLogCursor_t &cursor ) const
+{
+	int bestLayer = FindLayerForTime( time );
+	if ( bestLayer < 0 )
+	{
+		T value;
+		CDmAttributeInfo< T >::SetDefaultValue( value ); // TODO - create GetDefaultValue that returns a default T, to avoid rebuilding every time
+		return value;
+	}
+
+	return GetLayer( bestLayer )->GetValue( time, cursor );
+}
+
+template< class T >
+T CDmeTypedLog< T >::GetValueSkippingTopmostLayer( DmeTime_t time ) const
 {
 	int nLayer = FindLayerForTimeSkippingTopmost( time );
 	if ( nLayer < 0 )
@@ -5198,6 +5337,9 @@ void CDmeTypedLog< T >::FilterUsingTimeSelection( IUniformRandomStream *random,
 
 	DmeTime_t resample = 0.5f * params.m_nResampleInterval;
 
+	// each pass below samples in increasing time order
+	DmeLogCursor_t baseCursor, writeCursor;
+
 	switch ( filterType )
 	{
 	default:
@@ -5212,7 +5354,7 @@ void CDmeTypedLog< T >::FilterUsingTimeSelection( IUniformRandomStream *random,
 					if ( curtime > params.m_nTimes[ TS_RIGHT_FALLOFF ] )
 						curtime = params.m_nTimes[ TS_RIGHT_FALLOFF ];
 	
-					T curValue = baseLayer->GetValue( curtime );
+					T curValue = baseLayer->GetValue( curtime, baseCursor );
 					writeLayer->SetKey( curtime, curValue, IsUsingCurveTypes() ? GetDefaultCurveType() : CURVE_DEFAULT ); 
 				}
 			}
@@ -5247,13 +5389,13 @@ void CDmeTypedLog< T >::FilterUsingTimeSelection( IUniformRandomStream *random,
 						if ( curtime > params.m_nTimes[ TS_RIGHT_FALLOFF ] )
 							curtime = params.m_nTimes[ TS_RIGHT_FALLOFF ];
 
-						T oldValue = baseLayer->GetValue( curtime );
+						T oldValue = baseLayer->GetValue( curtime, baseCursor );
 
 						if ( curtime >= params.m_nTimes[ TS_LEFT_HOLD ] && curtime <= params.m_nTimes[ TS_RIGHT_HOLD ] )
 							continue;
 
 						// Modulate these keys back down toward the original value
-						T newValue = writeLayer->GetValue( curtime );
+						T newValue = writeLayer->GetValue( curtime, writeCursor );
 
 						float frac = bApplyFalloff ? params.GetAmountForTime( curtime ) : 1.0f;
 
@@ -5279,10 +5421,10 @@ void CDmeTypedLog< T >::FilterUsingTimeSelection( IUniformRandomStream *random,
 						if ( curtime >= params.m_nTimes[ TS_LEFT_HOLD ] && curtime <= params.m_nTimes[ TS_RIGHT_HOLD ] )
 							continue;
 
-						T oldValue = baseLayer->GetValue( curtime );
+						T oldValue = baseLayer->GetValue( curtime, baseCursor );
 
 						// Modulate these keys back down toward the original value
-						T newValue = writeLayer->GetValue( curtime );
+						T newValue = writeLayer->GetValue( curtime, writeCursor );
 
 						float frac = bApplyFalloff ? params.GetAmountForTime( curtime ) : 1.0f;
 
@@ -5318,7 +5460,7 @@ void CDmeTypedLog< T >::FilterUsingTimeSelection( IUniformRandomStream *random,
 
 					float frac = bApplyFalloff ? params.GetAmountForTime( curtime ) : 1.0f;
 
-					T oldValue = baseLayer->GetValue( curtime );
+					T oldValue = baseLayer->GetValue( curtime, baseCursor );
 
 					T newValue;
 					RandomValue( average, oldValue, newValue );
@@ -5343,7 +5485,7 @@ void CDmeTypedLog< T >::FilterUsingTimeSelection( IUniformRandomStream *random,
 
 					float frac = bApplyFalloff ? params.GetAmountForTime( curtime ) : 1.0f;
 
-					T oldValue = baseLayer->GetValue( curtime );
+					T oldValue = baseLayer->GetValue( curtime, baseCursor );
 
 					T newValue;
 					RandomValue( average, oldValue, newValue );
@@ -5373,7 +5515,7 @@ void CDmeTypedLog< T >::FilterUsingTimeSelection( IUniformRandomStream *random,
 
 				float frac = bApplyFalloff ? params.GetAmountForTime( curtime ) : 1.0f;
 
-				T oldValue = baseLayer->GetValue( curtime );
+				T oldValue = baseLayer->GetValue( curtime, baseCursor );
 
 				T newValue = oldValue;
 				if ( frac != 1.0f )
@@ -138,6 +138,19 @@ struct LayerSelectionData_t
 	CUtlVector< DataLayer_t >		m_vecData;
 };
 
+
+//-----------------------------------------------------------------------------
+// Caller-owned lookup hint for sampling a log at nearby times in sequence.
+// Any value is valid; a good hint just makes the key lookup cheaper.
+//-----------------------------------------------------------------------------
+struct DmeLogCursor_t
+{
+	DmeLogCursor_t() : m_nKey( -1 ) {}
+	void Reset() { m_nKey = -1; }
+
+	int m_nKey;
+};
+
 //-----------------------------------------------------------------------------
 // CDmeLogLayer - abstract base class
 //-----------------------------------------------------------------------------
@@ -215,14 +228,16 @@ public:
 	// Removes all keys outside the specified time range
 	void			RemoveKeysOutsideRange( DmeTime_t tStart, DmeTime_t tEnd );
 
-protected:
+	// Returns the index of the last key at or before this time, or -1 if there is none
+	// The cursor version searches outward from the cursor and updates it
 	int FindKey( DmeTime_t time ) const;
+	int FindKey( DmeTime_t time, DmeLogCursor_t &cursor ) const;
 
+protected:
 	void OnUsingCurveTypesChanged();
 
 	CDmeLog *m_pOwnerLog;
 
-	mutable int m_lastKey;
 	CDmaArray< int > m_times;
 	CDmaArray< int > m_CurveTypes;
 };
@@ -463,10 +478,12 @@ public:
 
 	void SetKeyValue( int nKey, const T& value );
 
-	const T& GetValue( DmeTime_t time ) const;
+	// Returns the interpolated value at a time; safe to call from multiple threads
+	T GetValue( DmeTime_t time ) const;
+	T GetValue( DmeTime_t time, DmeLogCursor_t &cursor ) const;
 
 	const T& GetKeyValue( int nKeyIndex ) const;
-	const T& GetValueSkippingKey( int nKeyToSkip ) const;
+	T GetValueSkippingKey( int nKeyToSkip ) const;
 
 	// This inserts a key. Unlike SetKey, this will *not* delete keys after the specified time
 	int InsertKey( DmeTime_t nTime, const T& value, int curveType = CURVE_DEFAULT );
@@ -511,6 +528,7 @@ protected:
 	void GetValueUsingCurveInfo( DmeTime_t time, T& out ) const;
 	void GetValueUsingCurveInfoSkippingKey( int nKeyToSkip, T& out ) const;
 	void GetBoundedSample( int keyindex, DmeTime_t& time, T& val, int& curveType ) const;
+	T GetValueAtKey( DmeTime_t time, int ti ) const;
 
 	void CurveSimplify_R( float thresholdSqr, int startPoint, int endPoint, CDmeTypedLogLayer< T > *output );
 
@@ -560,8 +578,9 @@ public:
 	void SetKey( DmeTime_t time, const T& value, int curveType = CURVE_DEFAULT );
 	int InsertKeyAtTime( DmeTime_t nTime, int curveType = CURVE_DEFAULT );
 	bool ValuesDiffer( const T& a, const T& b ) const;
-	const T& GetValue( DmeTime_t time ) const;
-	const T& GetValueSkippingTopmostLayer( DmeTime_t time ) const;
+	T GetValue( DmeTime_t time ) const;
+	T GetValue( DmeTime_t time, DmeLogCursor_t &cursor ) const;
+	T GetValueSkippingTopmostLayer( DmeTime_t time ) const;
 
 	const T& GetKeyValue( int nKeyIndex ) const;
 
@@ -21,6 +21,11 @@
 #include "movieobjects/dmmeshcomp.h"
 #include "tier3/tier3.h"
 #include "tier1/keyvalues.h"
+#include "tier1/utlpriorityqueue.h"
+#include "tier1/utldict.h"
+#include "tier1/generichash.h"
+#include "vstdlib/jobthread.h"
+#include "mathlib/ssemath.h"
 #include "tier0/dbg.h"
 #include "datamodel/dmelementfactoryhelper.h"
 #include "materialsystem/imaterialsystem.h"
@@ -309,16 +314,22 @@ IMPLEMENT_ELEMENT_FACTORY( DmeMesh, CDmeMesh );
 void CDmeMesh::OnConstruction()
 {
 	m_BindBaseState.Init( this, "bindState" );
-	m_CurrentBaseState.Init( this, "currentState" );
+	m_CurrentBaseState.Init( this, "currentState", FATTRIB_HAS_CALLBACK );
 	m_BaseStates.Init( this, "baseStates", FATTRIB_MUSTCOPY );
-	m_DeltaStates.Init( this, "deltaStates", FATTRIB_MUSTCOPY | FATTRIB_HAS_CALLBACK );
-	m_FaceSets.Init( this, "faceSets", FATTRIB_MUSTCOPY );
+	m_DeltaStates.Init( this, "deltaStates", FATTRIB_MUSTCOPY | FATTRIB_HAS_CALLBACK | FATTRIB_HAS_ARRAY_CALLBACK );
+	m_FaceSets.Init( this, "faceSets", FATTRIB_MUSTCOPY | FATTRIB_HAS_CALLBACK );
 	m_DeltaStateWeights[MESH_DELTA_WEIGHT_NORMAL].Init( this, "deltaStateWeights" );
 	m_DeltaStateWeights[MESH_DELTA_WEIGHT_LAGGED].Init( this, "deltaStateWeightsLagged" );
+	m_pMeshComp = NULL;
+	m_bMeshCompDirty = true;
+	m_bDeltaStateIndexDirty = true;
 }
 
 void CDmeMesh::OnDestruction()
 {
+	delete m_pMeshComp;
+	m_pMeshComp = NULL;
+
 	CMatRenderContextPtr pRenderContext( g_pMaterialSystem );
 	int nCount = m_hwFaceSets.Count();
 	for ( int i = 0; i < nCount; ++i )
@@ -387,6 +398,41 @@ void CDmeMesh::OnAttributeChanged( CDmAttribute *pAttribute )
 			}
 		}
 	}
+	else if ( pAttribute == m_FaceSets.GetAttribute() || pAttribute == m_CurrentBaseState.GetAttribute() )
+	{
+		// Face sets added, removed or reordered, or a new base state; changes within
+		// them are caught by their serial numbers, see CDmMeshComp::IsCurrent()
+		m_bMeshCompDirty = true;
+	}
+	else if ( pAttribute->GetOwner() != this && CastElement< CDmeVertexDeltaData >( pAttribute->GetOwner() ) )
+	{
+		// One of our delta states was renamed
+		m_bDeltaStateIndexDirty = true;
+	}
+}
+
+
+//-----------------------------------------------------------------------------
+// Only delta states added at the end of m_DeltaStates leave the delta state
+// index valid, see UpdateDeltaStateIndex(). Replacing or swapping elements
+// reports a removal followed by an add, so it rebuilds the index too.
+//-----------------------------------------------------------------------------
+void CDmeMesh::OnAttributeArrayElementAdded( CDmAttribute *pAttribute, int nFirstElem, int nLastElem )
+{
+	BaseClass::OnAttributeArrayElementAdded( pAttribute, nFirstElem, nLastElem );
+	if ( pAttribute == m_DeltaStates.GetAttribute() && nLastElem != m_DeltaStates.Count() - 1 )
+	{
+		m_bDeltaStateIndexDirty = true;
+	}
+}
+
+void CDmeMesh::OnAttributeArrayElementRemoved( CDmAttribute *pAttribute, int nFirstElem, int nLastElem )
+{
+	BaseClass::OnAttributeArrayElementRemoved( pAttribute, nFirstElem, nLastElem );
+	if ( pAttribute == m_DeltaStates.GetAttribute() )
+	{
+		m_bDeltaStateIndexDirty = true;
+	}
 }
 
 
@@ -447,55 +493,6 @@ template< class T > bool CDmeMesh::AddVertexDelta(
 }
 	
 
-//-----------------------------------------------------------------------------
-//
-//-----------------------------------------------------------------------------
-void CDmeMesh::AddTexCoordDelta( RenderVertexDelta_t *pRenderDelta, float flWeight, CDmeVertexDeltaData *pDeltaState )
-{
-	FieldIndex_t nFieldIndex = pDeltaState->FindFieldIndex( CDmeVertexDeltaData::FIELD_TEXCOORD );
-	if ( nFieldIndex < 0 )
-		return;
-
-	bool bIsVCoordinateFlipped = pDeltaState->IsVCoordinateFlipped();
-	const CDmrArray<int> indices = pDeltaState->GetIndexData( nFieldIndex );
-	const CDmrArray<Vector2D> delta = pDeltaState->GetVertexData( nFieldIndex );
-	int nDeltaCount = indices.Count();
-	for ( int j = 0; j < nDeltaCount; ++j )
-	{
-		Vector2D uvDelta = delta.Get( j );
-		if ( bIsVCoordinateFlipped )
-		{
-			uvDelta.y = -uvDelta.y;
-		}
-		Vector2D &vec2D = pRenderDelta[ indices.Get( j ) ].m_vecDeltaUV;
-		Vector2DMA( vec2D, flWeight, uvDelta, vec2D );
-	}
-}
-
-
-//-----------------------------------------------------------------------------
-//
-//-----------------------------------------------------------------------------
-void CDmeMesh::AddColorDelta( RenderVertexDelta_t *pRenderDelta, float flWeight, CDmeVertexDeltaData *pDeltaState )
-{
-	FieldIndex_t nFieldIndex = pDeltaState->FindFieldIndex( CDmeVertexDeltaData::FIELD_COLOR );
-	if ( nFieldIndex < 0 )
-		return;
-
-	const CDmrArray<int> indices = pDeltaState->GetIndexData( nFieldIndex );
-	const CDmrArray<Color> delta = pDeltaState->GetVertexData( nFieldIndex );
-	int nDeltaCount = indices.Count();
-	for ( int j = 0; j < nDeltaCount; ++j )
-	{
-		const Color &srcDeltaColor = delta[ j ];
-		Vector4D &vecDelta	= pRenderDelta[ indices[ j ] ].m_vecDeltaColor;
-		vecDelta[0] += flWeight * srcDeltaColor.r();
-		vecDelta[1] += flWeight * srcDeltaColor.g();
-		vecDelta[2] += flWeight * srcDeltaColor.b();
-		vecDelta[3] += flWeight * srcDeltaColor.a();
-	}
-}
-
 template< class T > bool CDmeMesh::AddStereoVertexDelta(
 	CDmeVertexData *pBaseState,
 	void *pVertexData, int nStride, CDmeVertexDataBase::StandardFields_t fieldId, int nIndex, bool bDoLag )
@@ -563,61 +560,348 @@ template< class T > bool CDmeMesh::AddStereoVertexDelta(
 
 
 //-----------------------------------------------------------------------------
-// Draws the mesh when it uses too many bones
+// Packs a field of a delta state for AccumulatePackedDeltaField. The balance
+// and morph speed of each delta are looked up in the bind state once here
+// instead of every time the mesh is drawn.
 //-----------------------------------------------------------------------------
-bool CDmeMesh::BuildDeltaMesh( int nVertices, RenderVertexDelta_t *pRenderDelta )
+static inline float DeltaComponent( const Vector &v, int nComponent )
+{
+	return v[ nComponent ];
+}
+
+static inline float DeltaComponent( float f, int nComponent )
 {
+	return f;
+}
+
+template< class T > void CDmeMesh::PackDeltaField( PackedDeltaField_t &field,
+	CDmeVertexData *pBindState, CDmeVertexDeltaData *pDeltaState, CDmeVertexDataBase::StandardFields_t fieldId, int nComponentCount )
+{
+	field.m_bValid = false;
+	field.m_nMaxIndex = -1;
+	field.m_Indices.RemoveAll();
+	for ( int i = 0; i < 3; ++i )
+	{
+		field.m_Data[i].RemoveAll();
+	}
+	field.m_Balance.RemoveAll();
+	field.m_Speed.RemoveAll();
+
+	const FieldIndex_t nBaseFieldIndex = pBindState->FindFieldIndex( fieldId == CDmeVertexData::FIELD_WRINKLE ? CDmeVertexData::FIELD_TEXCOORD : fieldId );
+	const FieldIndex_t nDeltaFieldIndex = pDeltaState->FindFieldIndex( fieldId );
+	if ( nBaseFieldIndex < 0 || nDeltaFieldIndex < 0 )
+		return;
+
+	field.m_bValid = true;
+
+	const CDmrArrayConst<int> indices = pDeltaState->GetIndexData( nDeltaFieldIndex );
+	const CDmrArrayConst<T> delta = pDeltaState->GetVertexData( nDeltaFieldIndex );
+	const int nDeltaCount = indices.Count();
+	const int nPaddedCount = ( nDeltaCount + 3 ) & ~3;
+
+	field.m_Indices.CopyArray( indices.Base(), nDeltaCount );
+	for ( int j = 0; j < nDeltaCount; ++j )
+	{
+		field.m_nMaxIndex = max( field.m_nMaxIndex, field.m_Indices[j] );
+	}
+
+	for ( int i = 0; i < nComponentCount; ++i )
+	{
+		CUtlVector< float > &data = field.m_Data[i];
+		data.SetCount( nPaddedCount );
+		int j;
+		for ( j = 0; j < nDeltaCount; ++j )
+		{
+			data[j] = DeltaComponent( delta[j], i );
+		}
+		for ( ; j < nPaddedCount; ++j )
+		{
+			data[j] = 0.0f;
+		}
+	}
+
+	const bool bHasBalance = pBindState->FindFieldIndex( CDmeVertexData::FIELD_BALANCE ) >= 0;
+	const bool bHasSpeed = pBindState->FindFieldIndex( CDmeVertexData::FIELD_MORPH_SPEED ) >= 0;
+	if ( !bHasBalance && !bHasSpeed )
+		return;
+
+	if ( bHasBalance )
+	{
+		field.m_Balance.SetCount( nPaddedCount );
+		memset( field.m_Balance.Base(), 0, nPaddedCount * sizeof( float ) );
+	}
+
+	if ( bHasSpeed )
+	{
+		field.m_Speed.SetCount( nPaddedCount );
+		memset( field.m_Speed.Base(), 0, nPaddedCount * sizeof( float ) );
+	}
+
+	const CUtlVector<int> &balanceIndices = pBindState->GetVertexIndexData( CDmeVertexData::FIELD_BALANCE );
+	const CUtlVector<float> &balanceData = pBindState->GetBalanceData();
+	const CUtlVector<int> &speedIndices = pBindState->GetVertexIndexData( CDmeVertexData::FIELD_MORPH_SPEED );
+	const CUtlVector<float> &speedData = pBindState->GetMorphSpeedData();
+	for ( int j = 0; j < nDeltaCount; ++j )
+	{
+		const CUtlVector<int> &list = pBindState->FindVertexIndicesFromDataIndex( nBaseFieldIndex, field.m_Indices[j] );
+		Assert( list.Count() > 0 );
+		if ( list.Count() == 0 )
+			continue;
+
+		// FIXME: Average everything in the list.. shouldn't be necessary though
+		if ( bHasBalance )
+		{
+			field.m_Balance[j] = balanceData[ balanceIndices[ list[0] ] ];
+		}
+
+		if ( bHasSpeed )
+		{
+			field.m_Speed[j] = speedData[ speedIndices[ list[0] ] ];
+		}
+	}
+}
+
+
+//-----------------------------------------------------------------------------
+// Returns a delta state packed for BuildDeltaMesh, repacking it if it or the
+// bind state have changed since it was last packed
+//-----------------------------------------------------------------------------
+const CDmeMesh::PackedDeltaState_t &CDmeMesh::GetPackedDeltaState( int nDeltaIndex, CDmeVertexData *pBindState )
+{
+	PackedDeltaState_t &packed = m_PackedDeltaStates[ nDeltaIndex ];
+
+	CDmeVertexDeltaData *pDeltaState = GetDeltaState( nDeltaIndex );
+	if ( !pDeltaState )
+	{
+		packed.m_nSerialNumber = 0;
+		packed.m_Position.m_bValid = false;
+		packed.m_Normal.m_bValid = false;
+		packed.m_Wrinkle.m_bValid = false;
+		packed.m_TexCoordIndices.RemoveAll();
+		packed.m_ColorIndices.RemoveAll();
+		return packed;
+	}
+
+	if ( packed.m_nSerialNumber == pDeltaState->GetSerialNumber() && packed.m_nBindSerialNumber == pBindState->GetSerialNumber() )
+		return packed;
+
+	packed.m_nSerialNumber = pDeltaState->GetSerialNumber();
+	packed.m_nBindSerialNumber = pBindState->GetSerialNumber();
+
+	PackDeltaField< Vector >( packed.m_Position, pBindState, pDeltaState, CDmeVertexDeltaData::FIELD_POSITION, 3 );
+	PackDeltaField< Vector >( packed.m_Normal, pBindState, pDeltaState, CDmeVertexDeltaData::FIELD_NORMAL, 3 );
+	PackDeltaField< float >( packed.m_Wrinkle, pBindState, pDeltaState, CDmeVertexDeltaData::FIELD_WRINKLE, 1 );
+
+	packed.m_TexCoordIndices.RemoveAll();
+	packed.m_TexCoordDeltas.RemoveAll();
+	FieldIndex_t nFieldIndex = pDeltaState->FindFieldIndex( CDmeVertexDeltaData::FIELD_TEXCOORD );
+	if ( nFieldIndex >= 0 )
+	{
+		const bool bIsVCoordinateFlipped = pDeltaState->IsVCoordinateFlipped();
+		const CDmrArrayConst<int> indices = pDeltaState->GetIndexData( nFieldIndex );
+		const CDmrArrayConst<Vector2D> delta = pDeltaState->GetVertexData( nFieldIndex );
+		const int nDeltaCount = indices.Count();
+		packed.m_TexCoordIndices.CopyArray( indices.Base(), nDeltaCount );
+		packed.m_TexCoordDeltas.CopyArray( delta.Base(), nDeltaCount );
+		if ( bIsVCoordinateFlipped )
+		{
+			for ( int j = 0; j < nDeltaCount; ++j )
+			{
+				packed.m_TexCoordDeltas[j].y = -packed.m_TexCoordDeltas[j].y;
+			}
+		}
+	}
+
+	packed.m_ColorIndices.RemoveAll();
+	packed.m_ColorDeltas.RemoveAll();
+	nFieldIndex = pDeltaState->FindFieldIndex( CDmeVertexDeltaData::FIELD_COLOR );
+	if ( nFieldIndex >= 0 )
+	{
+		const CDmrArrayConst<int> indices = pDeltaState->GetIndexData( nFieldIndex );
+		const CDmrArrayConst<Color> delta = pDeltaState->GetVertexData( nFieldIndex );
+		const int nDeltaCount = indices.Count();
+		packed.m_ColorIndices.CopyArray( indices.Base(), nDeltaCount );
+		packed.m_ColorDeltas.SetCount( nDeltaCount );
+		for ( int j = 0; j < nDeltaCount; ++j )
+		{
+			const Color &srcDeltaColor = delta[ j ];
+			packed.m_ColorDeltas[j].Init( srcDeltaColor.r(), srcDeltaColor.g(), srcDeltaColor.b(), srcDeltaColor.a() );
+		}
+	}
+
+	return packed;
+}
+
+
+//-----------------------------------------------------------------------------
+// Adds a packed delta field into m_RenderDelta, weighting four deltas at a time.
+// The weight of each delta is Lerp( balance, left, right ), and when lagging
+// Lerp( speed, lagged weight, weight )
+//-----------------------------------------------------------------------------
+void CDmeMesh::AccumulatePackedDeltaField( const PackedDeltaField_t &field, int nOffset, int nComponentCount, const Vector2D &weight, const Vector2D &laggedWeight, bool bDoLag )
+{
+	if ( !field.m_bValid )
+		return;
+
+	if ( field.m_nMaxIndex >= m_RenderDelta.Count() )
+	{
+		Assert( 0 );
+		return;
+	}
+
+	const bool bBalance = field.m_Balance.Count() > 0;
+	const bool bSpeed = bDoLag && field.m_Speed.Count() > 0;
+
+	const fltx4 fl4Left = ReplicateX4( weight.x );
+	const fltx4 fl4Range = ReplicateX4( weight.y - weight.x );
+	const fltx4 fl4LaggedLeft = ReplicateX4( laggedWeight.x );
+	const fltx4 fl4LaggedRange = ReplicateX4( laggedWeight.y - laggedWeight.x );
+
+	const int nDeltaCount = field.m_Indices.Count();
+	const int *pIndices = field.m_Indices.Base();
+	char *pRenderDelta = (char*)m_RenderDelta.Base();
+	bool *pTouched = m_RenderDeltaTouched.Base();
+
+	float flResult[3][4];
+	for ( int i = 0; i < nDeltaCount; i += 4 )
+	{
+		fltx4 fl4Weight = fl4Left;
+		fltx4 fl4LaggedWeight = fl4LaggedLeft;
+		if ( bBalance )
+		{
+			const fltx4 fl4Balance = LoadUnalignedSIMD( field.m_Balance.Base() + i );
+			fl4Weight = AddSIMD( fl4Left, MulSIMD( fl4Range, fl4Balance ) );
+			fl4LaggedWeight = AddSIMD( fl4LaggedLeft, MulSIMD( fl4LaggedRange, fl4Balance ) );
+		}
+
+		if ( bSpeed )
+		{
+			const fltx4 fl4Speed = LoadUnalignedSIMD( field.m_Speed.Base() + i );
+			fl4Weight = AddSIMD( fl4LaggedWeight, MulSIMD( SubSIMD( fl4Weight, fl4LaggedWeight ), fl4Speed ) );
+		}
+
+		for ( int c = 0; c < nComponentCount; ++c )
+		{
+			StoreUnalignedSIMD( flResult[c], MulSIMD( LoadUnalignedSIMD( field.m_Data[c].Base() + i ), fl4Weight ) );
+		}
+
+		const int nLaneCount = min( 4, nDeltaCount - i );
+		for ( int j = 0; j < nLaneCount; ++j )
+		{
+			const int nIndex = pIndices[ i + j ];
+			if ( !pTouched[ nIndex ] )
+			{
+				pTouched[ nIndex ] = true;
+				m_TouchedRenderDeltas.AddToTail( nIndex );
+			}
+
+			float *pDst = (float*)( pRenderDelta + nIndex * sizeof( RenderVertexDelta_t ) + nOffset );
+			for ( int c = 0; c < nComponentCount; ++c )
+			{
+				pDst[c] += flResult[c][j];
+			}
+		}
+	}
+}
+
+
+//-----------------------------------------------------------------------------
+// Builds the render deltas for the active delta states into m_RenderDelta.
+// Only the render deltas touched by the previous build are cleared.
+//-----------------------------------------------------------------------------
+bool CDmeMesh::BuildDeltaMesh( int nVertices )
+{
+	if ( m_RenderDelta.Count() != nVertices )
+	{
+		m_RenderDelta.SetCount( nVertices );
+		memset( m_RenderDelta.Base(), 0, nVertices * sizeof( RenderVertexDelta_t ) );
+		m_RenderDeltaTouched.SetCount( nVertices );
+		memset( m_RenderDeltaTouched.Base(), 0, nVertices * sizeof( bool ) );
+	}
+	else
+	{
+		const int nTouchedCount = m_TouchedRenderDeltas.Count();
+		for ( int i = 0; i < nTouchedCount; ++i )
+		{
+			const int nIndex = m_TouchedRenderDeltas[i];
+			memset( &m_RenderDelta[ nIndex ], 0, sizeof( RenderVertexDelta_t ) );
+			m_RenderDeltaTouched[ nIndex ] = false;
+		}
+	}
+	m_TouchedRenderDeltas.RemoveAll();
+
 	bool bHasWrinkleDelta = false;
 
-	memset( pRenderDelta, 0, nVertices * sizeof( RenderVertexDelta_t ) );
 	int nCount = m_DeltaStateWeights[MESH_DELTA_WEIGHT_NORMAL].Count();
 	Assert( m_DeltaStateWeights[MESH_DELTA_WEIGHT_NORMAL].Count() == m_DeltaStateWeights[MESH_DELTA_WEIGHT_LAGGED].Count() );
 
+	if ( m_PackedDeltaStates.Count() < nCount )
+	{
+		m_PackedDeltaStates.AddMultipleToTail( nCount - m_PackedDeltaStates.Count() );
+	}
+	else if ( m_PackedDeltaStates.Count() > nCount )
+	{
+		m_PackedDeltaStates.RemoveMultipleFromTail( m_PackedDeltaStates.Count() - nCount );
+	}
+
 	CDmeVertexData *pBindState = GetBindBaseState();
 
 	const FieldIndex_t nBalanceFieldIndex = pBindState->FindFieldIndex( CDmeVertexDeltaData::FIELD_BALANCE );
 	const FieldIndex_t nSpeedFieldIndex = pBindState->FindFieldIndex( CDmeVertexDeltaData::FIELD_MORPH_SPEED );
 	const bool bDoLag = nSpeedFieldIndex >= 0;
-	if ( nBalanceFieldIndex < 0 )
+
+	bool *pTouched = m_RenderDeltaTouched.Base();
+
+	for ( int i = 0; i < nCount; ++i )
 	{
-		for ( int i = 0; i < nCount; ++i )
+		const Vector2D &weight = m_DeltaStateWeights[MESH_DELTA_WEIGHT_NORMAL][i];
+		const Vector2D &laggedWeight = m_DeltaStateWeights[MESH_DELTA_WEIGHT_LAGGED][i];
+
+		// Without balance data only the left weights are used
+		if ( weight.x <= 0.0f && laggedWeight.x <= 0.0f )
 		{
-			float flWeight = m_DeltaStateWeights[MESH_DELTA_WEIGHT_NORMAL][i].x;
-			float flLaggedWeight = m_DeltaStateWeights[MESH_DELTA_WEIGHT_LAGGED][i].x;
-			if ( flWeight <= 0.0f && flLaggedWeight <= 0.0f )
+			if ( nBalanceFieldIndex < 0 || ( weight.y <= 0.0f && laggedWeight.y <= 0.0f ) )
 				continue;
-
-			// prepare vertices
-			CDmeVertexDeltaData *pDeltaState = GetDeltaState(i);
-			AddVertexDelta<Vector>( pBindState, &pRenderDelta->m_vecDeltaPosition, sizeof(RenderVertexDelta_t), CDmeVertexDeltaData::FIELD_POSITION, i, bDoLag );
-			AddVertexDelta<Vector>( pBindState, &pRenderDelta->m_vecDeltaNormal, sizeof(RenderVertexDelta_t), CDmeVertexDeltaData::FIELD_NORMAL, i, bDoLag );
-			AddTexCoordDelta( pRenderDelta, flWeight, pDeltaState );
-			AddColorDelta( pRenderDelta, flWeight, pDeltaState );
-			bool bWrinkle = AddVertexDelta<float>( pBindState, &pRenderDelta->m_flDeltaWrinkle, sizeof(RenderVertexDelta_t), CDmeVertexDeltaData::FIELD_WRINKLE, i, bDoLag );
-			bHasWrinkleDelta = bHasWrinkleDelta || bWrinkle;
 		}
 
-		return bHasWrinkleDelta;
-	}
-
-	for ( int i = 0; i < nCount; ++i )
-	{
-		float flLeftWeight = m_DeltaStateWeights[MESH_DELTA_WEIGHT_NORMAL][i].x;
-		float flRightWeight = m_DeltaStateWeights[MESH_DELTA_WEIGHT_NORMAL][i].y;
-		float flLeftWeightLagged = m_DeltaStateWeights[MESH_DELTA_WEIGHT_LAGGED][i].x;
-		float flRightWeightLagged = m_DeltaStateWeights[MESH_DELTA_WEIGHT_LAGGED][i].y;
-		if ( flLeftWeight <= 0.0f && flRightWeight <= 0.0f && flLeftWeightLagged <= 0.0f && flRightWeightLagged <= 0.0f )
-			continue;
+		const PackedDeltaState_t &packed = GetPackedDeltaState( i, pBindState );
+		AccumulatePackedDeltaField( packed.m_Position, offsetof( RenderVertexDelta_t, m_vecDeltaPosition ), 3, weight, laggedWeight, bDoLag );
+		AccumulatePackedDeltaField( packed.m_Normal, offsetof( RenderVertexDelta_t, m_vecDeltaNormal ), 3, weight, laggedWeight, bDoLag );
+		AccumulatePackedDeltaField( packed.m_Wrinkle, offsetof( RenderVertexDelta_t, m_flDeltaWrinkle ), 1, weight, laggedWeight, bDoLag );
+		bHasWrinkleDelta = bHasWrinkleDelta || packed.m_Wrinkle.m_bValid;
 
 		// FIXME: Need to make balanced versions of texcoord + color
-		bool bWrinkle;
-		CDmeVertexDeltaData *pDeltaState = GetDeltaState(i);
-		AddStereoVertexDelta<Vector>( pBindState, &pRenderDelta->m_vecDeltaPosition, sizeof(RenderVertexDelta_t), CDmeVertexDeltaData::FIELD_POSITION, i, bDoLag );
-		AddStereoVertexDelta<Vector>( pBindState, &pRenderDelta->m_vecDeltaNormal, sizeof(RenderVertexDelta_t), CDmeVertexDeltaData::FIELD_NORMAL, i, bDoLag );
-		bWrinkle = AddStereoVertexDelta<float>( pBindState, &pRenderDelta->m_flDeltaWrinkle, sizeof(RenderVertexDelta_t), CDmeVertexDeltaData::FIELD_WRINKLE, i, bDoLag);
-		bHasWrinkleDelta = bHasWrinkleDelta || bWrinkle;
-		AddTexCoordDelta( pRenderDelta, flLeftWeight, pDeltaState );
-		AddColorDelta( pRenderDelta, flLeftWeight, pDeltaState );
+		const float flWeight = weight.x;
+
+		const int nTexCoordCount = packed.m_TexCoordIndices.Count();
+		for ( int j = 0; j < nTexCoordCount; ++j )
+		{
+			const int nIndex = packed.m_TexCoordIndices[j];
+			Assert( nIndex < nVertices );
+			if ( !pTouched[ nIndex ] )
+			{
+				pTouched[ nIndex ] = true;
+				m_TouchedRenderDeltas.AddToTail( nIndex );
+			}
+
+			Vector2D &vec2D = m_RenderDelta[ nIndex ].m_vecDeltaUV;
+			Vector2DMA( vec2D, flWeight, packed.m_TexCoordDeltas[j], vec2D );
+		}
+
+		const int nColorCount = packed.m_ColorIndices.Count();
+		for ( int j = 0; j < nColorCount; ++j )
+		{
+			const int nIndex = packed.m_ColorIndices[j];
+			Assert( nIndex < nVertices );
+			if ( !pTouched[ nIndex ] )
+			{
+				pTouched[ nIndex ] = true;
+				m_TouchedRenderDeltas.AddToTail( nIndex );
+			}
+
+			Vector4D &vecDelta = m_RenderDelta[ nIndex ].m_vecDeltaColor;
+			Vector4DMA( vecDelta, flWeight, packed.m_ColorDeltas[j], vecDelta );
+		}
 	}
 
 	return bHasWrinkleDelta;
@@ -672,14 +956,11 @@ void CDmeMesh::DrawDynamicMesh( CDmeFaceSet *pFaceSet, matrix3x4_t *pPoseToWorld
 	// The fact that we're storing one delta per final vertex nVertices
 	// is a waste of memory and simply implementational convenience.
 	bool bHasActiveWrinkle = false;
-	RenderVertexDelta_t *pVertexDelta = (RenderVertexDelta_t*)_alloca( nVertices * sizeof(RenderVertexDelta_t) );
+	RenderVertexDelta_t *pVertexDelta = NULL;
 	if ( bHasActiveDeltaStates )
 	{
-		bHasActiveWrinkle = BuildDeltaMesh( nVertices, pVertexDelta );
-	}
-	else
-	{
-		pVertexDelta = NULL;
+		bHasActiveWrinkle = BuildDeltaMesh( nVertices );
+		pVertexDelta = m_RenderDelta.Base();
 	}
 
 	CRenderInfo renderInfo( pBindBase );
@@ -1354,6 +1635,19 @@ const char *SortDeltaName( const char *pInDeltaName, char *pOutDeltaName, int nO
 }
 
 
+//-----------------------------------------------------------------------------
+// Delta state names match case-insensitively and regardless of the order of
+// the control names in a combination. Returns the form of the name the delta
+// state index is keyed by; both buffers must be nBufLen long
+//-----------------------------------------------------------------------------
+static const char *CanonicalDeltaName( const char *pInDeltaName, char *pLowerBuf, char *pSortBuf, int nBufLen )
+{
+	Q_strncpy( pLowerBuf, pInDeltaName, nBufLen );
+	Q_strlower( pLowerBuf );
+	return SortDeltaName( pLowerBuf, pSortBuf, nBufLen );
+}
+
+
 //-----------------------------------------------------------------------------
 //
 //-----------------------------------------------------------------------------
@@ -1383,24 +1677,110 @@ CDmeVertexDeltaData *CDmeMesh::FindOrCreateDeltaState( const char *pInDeltaName
 //-----------------------------------------------------------------------------
 int CDmeMesh::FindDeltaStateIndex( const char *pInDeltaName ) const
 {
-	const char *pDeltaName = pInDeltaName;
+	UpdateDeltaStateIndex();
+
+	const int nDeltaNameBufLen = Q_strlen( pInDeltaName ) + 1;
+	char *pLowerBuf = reinterpret_cast< char * >( stackalloc( nDeltaNameBufLen * sizeof( char ) ) );
+	char *pSortBuf = reinterpret_cast< char * >( stackalloc( nDeltaNameBufLen * sizeof( char ) ) );
+	return FindDeltaStateSlot( CanonicalDeltaName( pInDeltaName, pLowerBuf, pSortBuf, nDeltaNameBufLen ) );
+}
+
+
+//-----------------------------------------------------------------------------
+// Returns the index slot holding the canonical name, or the empty slot where it belongs
+//-----------------------------------------------------------------------------
+int &CDmeMesh::FindDeltaStateSlot( const char *pCanonicalName ) const
+{
+	int nMask = m_DeltaStateHash.Count() - 1;
+	for ( int i = HashString( pCanonicalName ) & nMask; ; i = ( i + 1 ) & nMask )
+	{
+		int &nDeltaIndex = m_DeltaStateHash[i];
+		if ( nDeltaIndex < 0 || !Q_strcmp( m_IndexedDeltaStateNames[nDeltaIndex], pCanonicalName ) )
+			return nDeltaIndex;
+	}
+}
+
+
+//-----------------------------------------------------------------------------
+// Brings the delta state name index up to date with m_DeltaStates. Delta states
+// appended since the last update are just added to it, as FindOrCreateDeltaState
+// does when building up a rig; inserting, removing, replacing or moving delta
+// states marks the index dirty in OnAttributeArrayElementAdded/Removed() and
+// rebuilds it.
+//-----------------------------------------------------------------------------
+void CDmeMesh::UpdateDeltaStateIndex() const
+{
+	const int nCount = m_DeltaStates.Count();
+	int nFirst = m_IndexedDeltaStates.Count();
+	if ( !m_bDeltaStateIndexDirty )
+	{
+		if ( nFirst == nCount )
+			return;
 
-	if ( strchr( pInDeltaName, '_' ) )
+		// Cheap check for changes made without array callbacks, e.g. while unserializing
+		if ( nFirst > nCount || ( nFirst > 0 && m_DeltaStates.GetHandle( nFirst - 1 ) != m_IndexedDeltaStates[nFirst - 1] ) )
+		{
+			m_bDeltaStateIndexDirty = true;
+		}
+	}
+
+	if ( m_bDeltaStateIndexDirty )
 	{
-		const int nDeltaNameBufLen = Q_strlen( pInDeltaName ) + 1;
-		char *pDeltaNameBuf = reinterpret_cast< char * >( stackalloc( nDeltaNameBufLen * sizeof( char ) ) );
-		pDeltaName = SortDeltaName( pInDeltaName, pDeltaNameBuf, nDeltaNameBufLen );
+		nFirst = 0;
 	}
+	m_bDeltaStateIndexDirty = false;
 
-	int dn = DeltaStateCount();
-	for ( int di = 0; di < dn; ++di )
+	CUtlVector< char > lowerBuf;
+	CUtlVector< char > sortBuf;
+	m_IndexedDeltaStates.SetCount( nCount );
+	m_IndexedDeltaStateNames.SetCount( nCount );
+	for ( int i = nFirst; i < nCount; ++i )
 	{
-		CDmeVertexDeltaData *pDeltaState = GetDeltaState( di );
-		if ( !Q_stricmp( pDeltaName, pDeltaState->GetName() ) )
-			return di;
+		m_IndexedDeltaStates[i] = m_DeltaStates.GetHandle( i );
+
+		CDmeVertexDeltaData *pDeltaState = m_DeltaStates[i];
+		if ( !pDeltaState )
+		{
+			m_IndexedDeltaStateNames[i] = "";
+			continue;
+		}
+
+		const char *pName = pDeltaState->GetName();
+		const int nBufLen = Q_strlen( pName ) + 1;
+		lowerBuf.EnsureCount( nBufLen );
+		sortBuf.EnsureCount( nBufLen );
+		m_IndexedDeltaStateNames[i] = CanonicalDeltaName( pName, lowerBuf.Base(), sortBuf.Base(), nBufLen );
 	}
 
-	return -1;
+	int nSize = 256;
+	while ( nSize < 2 * nCount )
+	{
+		nSize <<= 1;
+	}
+
+	if ( nSize != m_DeltaStateHash.Count() || nFirst == 0 )
+	{
+		m_DeltaStateHash.SetCount( nSize );
+		for ( int i = 0; i < nSize; ++i )
+		{
+			m_DeltaStateHash[i] = -1;
+		}
+		nFirst = 0;
+	}
+
+	// Walking the delta states in order keeps the lowest index for each name,
+	// as the search this replaces would have found
+	for ( int i = nFirst; i < nCount; ++i )
+	{
+		if ( !m_DeltaStates[i] )
+			continue;
+
+		int &nDeltaIndex = FindDeltaStateSlot( m_IndexedDeltaStateNames[i] );
+		if ( nDeltaIndex < 0 )
+		{
+			nDeltaIndex = i;
+		}
+	}
 }
 
 
@@ -1634,126 +2014,307 @@ void CDmeMesh::ComputeTriangulatedIndices( const CDmeVertexData *pBaseState, CDm
 
 
 //-----------------------------------------------------------------------------
-// Build a map from vertex index to a list of triangles that share the vert.
+// The triangles of a mesh in structure-of-arrays form
 //-----------------------------------------------------------------------------
-void CDmeMesh::BuildTriangleMap( const CDmeVertexData *pBaseState, CDmeFaceSet* pFaceSet, CUtlVector<Triangle_t>& triangles, CUtlVector< CUtlVector<int> >* pVertToTriMap )
+struct MeshTriangles_t
 {
-	// prepare indices
-	int nFirstIndex = 0;
-	int nIndexCount = pFaceSet->NumIndices();
-	while ( nFirstIndex < nIndexCount )
+	int Count() const { return m_Corners[0].Count(); }
+
+	CUtlVector< int > m_Corners[3];		// vertex index of each triangle corner
+};
+
+
+//-----------------------------------------------------------------------------
+// Maps each vertex (or some other index per vertex) to the triangles using it,
+// in compressed sparse row form. The triangles of index i are m_Triangles[j]
+// for m_First[i] <= j < m_First[i+1], in triangle order, once per corner.
+//-----------------------------------------------------------------------------
+struct VertToTriMap_t
+{
+	CUtlVector< int > m_First;
+	CUtlVector< int > m_Triangles;
+};
+
+
+//-----------------------------------------------------------------------------
+// Triangulates all face sets of the mesh
+//-----------------------------------------------------------------------------
+static void BuildMeshTriangles( CDmeMesh *pMesh, const CDmeVertexData *pBaseState, MeshTriangles_t &triangles )
+{
+	CUtlVector< int > indices;
+
+	int nFaceSetCount = pMesh->FaceSetCount();
+	for ( int i = 0; i < nFaceSetCount; ++i )
 	{
-		int nVertexCount = pFaceSet->GetNextPolygonVertexCount( nFirstIndex );
-		if ( nVertexCount >= 3 )
+		CDmeFaceSet *pFaceSet = pMesh->GetFaceSet( i );
+
+		int nFirstIndex = 0;
+		int nIndexCount = pFaceSet->NumIndices();
+		while ( nFirstIndex < nIndexCount )
 		{
-			int nOutCount = ( nVertexCount-2 ) * 3;
-			int *pIndices = (int*)_alloca( nOutCount * sizeof(int) );
-			ComputeTriangulatedIndices( pBaseState, pFaceSet, nFirstIndex, pIndices, nOutCount );
-			for ( int ii = 0; ii < nOutCount; ii += 3 )
+			int nVertexCount = pFaceSet->GetNextPolygonVertexCount( nFirstIndex );
+			if ( nVertexCount >= 3 )
 			{
-				int t = triangles.AddToTail();
-				Triangle_t& triangle = triangles[t];
-
-				triangle.m_nIndex[0] = pIndices[ii];
-				triangle.m_nIndex[1] = pIndices[ii+1];
-				triangle.m_nIndex[2] = pIndices[ii+2];
-
-				if ( pVertToTriMap )
+				int nOutCount = ( nVertexCount-2 ) * 3;
+				indices.EnsureCount( nOutCount );
+				pMesh->ComputeTriangulatedIndices( pBaseState, pFaceSet, nFirstIndex, indices.Base(), nOutCount );
+				for ( int ii = 0; ii < nOutCount; ii += 3 )
 				{
-					(*pVertToTriMap)[ pIndices[ii] ].AddToTail( t );
-					(*pVertToTriMap)[ pIndices[ii+1] ].AddToTail( t );
-					(*pVertToTriMap)[ pIndices[ii+2] ].AddToTail( t );
+					triangles.m_Corners[0].AddToTail( indices[ii] );
+					triangles.m_Corners[1].AddToTail( indices[ii+1] );
+					triangles.m_Corners[2].AddToTail( indices[ii+2] );
 				}
 			}
+			nFirstIndex += nVertexCount + 1;
 		}
-		nFirstIndex += nVertexCount + 1;
 	}
 }
 
 
 //-----------------------------------------------------------------------------
-// Computes tangent space data for triangles
+// Replaces the vertex index of each triangle corner with pRemap[ vertex index ]
 //-----------------------------------------------------------------------------
-void CDmeMesh::ComputeTriangleTangets( const CDmeVertexData *pVertexData, CUtlVector<Triangle_t>& triangles )
+static void RemapMeshTriangles( const MeshTriangles_t &triangles, const int *pRemap, MeshTriangles_t &remapped )
 {
-	// Calculate the tangent space for each triangle.
 	int nTriangleCount = triangles.Count();
-	for ( int triID = 0; triID < nTriangleCount; triID++ )
+	for ( int c = 0; c < 3; ++c )
 	{
-		Triangle_t &triangle = triangles[triID];
-
-		const Vector &p0 = pVertexData->GetPosition( triangle.m_nIndex[0] );
-		const Vector &p1 = pVertexData->GetPosition( triangle.m_nIndex[1] );
-		const Vector &p2 = pVertexData->GetPosition( triangle.m_nIndex[2] );
-		const Vector2D &t0 = pVertexData->GetTexCoord( triangle.m_nIndex[0] );
-		const Vector2D &t1 = pVertexData->GetTexCoord( triangle.m_nIndex[1] );
-		const Vector2D &t2 = pVertexData->GetTexCoord( triangle.m_nIndex[2] );
-		CalcTriangleTangentSpace( p0, p1, p2, t0, t1, t2, triangle.m_vecTangentS, triangle.m_vecTangentT );
-	}	
+		remapped.m_Corners[c].SetCount( nTriangleCount );
+		for ( int t = 0; t < nTriangleCount; ++t )
+		{
+			remapped.m_Corners[c][t] = pRemap[ triangles.m_Corners[c][t] ];
+		}
+	}
 }
 
 
 //-----------------------------------------------------------------------------
-// Build a map from vertex index to a list of triangles that share the vert.
+// Builds a map from vertex index, or pRemap[ vertex index ] if specified, to
+// all triangles that use it. nCount is the number of indices mapped
 //-----------------------------------------------------------------------------
-void CDmeMesh::ComputeAverageTangent( CDmeVertexData *pVertexData, bool bSmoothTangents, CUtlVector< CUtlVector<int> >& vertToTriMap, CUtlVector<Triangle_t>& triangles )
+static void BuildVertToTriMap( const MeshTriangles_t &triangles, int nCount, const int *pRemap, VertToTriMap_t &vertToTriMap )
 {
-	FieldIndex_t posField = pVertexData->FindFieldIndex( CDmeVertexData::FIELD_POSITION );
-	FieldIndex_t normalField = pVertexData->FindFieldIndex( CDmeVertexData::FIELD_NORMAL );
-	FieldIndex_t tangentField = pVertexData->FindFieldIndex( CDmeVertexData::FIELD_TANGENT );
+	int nTriangleCount = triangles.Count();
 
-	const CDmrArray<int> pPositionIndices = pVertexData->GetIndexData( posField );
-	const CDmrArray<Vector> pPositionData = pVertexData->GetVertexData( posField );
-	const CDmrArray<int> pNormalIndices = pVertexData->GetIndexData( normalField );
-	const CDmrArray<Vector> pNormalData = pVertexData->GetVertexData( normalField );
+	// Count the corners of each index, then turn the counts into offsets
+	vertToTriMap.m_First.SetCount( nCount + 1 );
+	memset( vertToTriMap.m_First.Base(), 0, ( nCount + 1 ) * sizeof( int ) );
+	for ( int c = 0; c < 3; ++c )
+	{
+		for ( int t = 0; t < nTriangleCount; ++t )
+		{
+			int v = triangles.m_Corners[c][t];
+			++vertToTriMap.m_First[ ( pRemap ? pRemap[v] : v ) + 1 ];
+		}
+	}
+	for ( int i = 1; i <= nCount; ++i )
+	{
+		vertToTriMap.m_First[i] += vertToTriMap.m_First[i-1];
+	}
 
-	// calculate an average tangent space for each vertex.
-	int nVertexCount = pVertexData->VertexCount();
-	Vector4D finalSVect;
-	for( int vertID = 0; vertID < nVertexCount; vertID++ )
+	CUtlVector< int > next;
+	next.CopyArray( vertToTriMap.m_First.Base(), nCount );
+	vertToTriMap.m_Triangles.SetCount( vertToTriMap.m_First[ nCount ] );
+	for ( int t = 0; t < nTriangleCount; ++t )
+	{
+		for ( int c = 0; c < 3; ++c )
+		{
+			int v = triangles.m_Corners[c][t];
+			vertToTriMap.m_Triangles[ next[ pRemap ? pRemap[v] : v ]++ ] = t;
+		}
+	}
+}
+
+
+//-----------------------------------------------------------------------------
+// Runs a kernel over nCount items, split into jobs of MESH_KERNEL_JOB_SIZE
+// items which go to the thread pool if bParallel is set. job supplies the
+// kernel's inputs; each job gets its own copy with the range filled in
+//-----------------------------------------------------------------------------
+#define MESH_KERNEL_JOB_SIZE 4096
+
+template < class JOB >
+static void RunMeshKernel( const char *pName, const JOB &job, int nCount, void (*pfnKernel)( JOB & ), bool bParallel )
+{
+	int nJobCount = ( nCount + MESH_KERNEL_JOB_SIZE - 1 ) / MESH_KERNEL_JOB_SIZE;
+	if ( !bParallel || nJobCount <= 1 || !g_pThreadPool || g_pThreadPool->NumThreads() == 0 )
 	{
-		CUtlVector<int> &triangleList = vertToTriMap[vertID];
+		JOB all = job;
+		all.m_nFirst = 0;
+		all.m_nLast = nCount;
+		pfnKernel( all );
+		return;
+	}
+
+	CUtlVector< JOB > jobs;
+	jobs.SetCount( nJobCount );
+	for ( int i = 0; i < nJobCount; ++i )
+	{
+		jobs[i] = job;
+		jobs[i].m_nFirst = i * MESH_KERNEL_JOB_SIZE;
+		jobs[i].m_nLast = min( nCount, ( i + 1 ) * MESH_KERNEL_JOB_SIZE );
+	}
+	ParallelProcess( pName, jobs.Base(), nJobCount, pfnKernel );
+}
+
+
+//-----------------------------------------------------------------------------
+// Computes tangent space data for triangles
+//-----------------------------------------------------------------------------
+struct TriangleTangentJob_t
+{
+	int m_nFirst;
+	int m_nLast;
+	const MeshTriangles_t *m_pTriangles;
+	const Vector *m_pPositions;
+	const int *m_pPositionIndices;
+	const Vector2D *m_pTexCoords;
+	const int *m_pTexCoordIndices;
+	Vector *m_pTangentS;
+	Vector *m_pTangentT;
+};
+
+static void ComputeTriangleTangents( TriangleTangentJob_t &job )
+{
+	const CUtlVector< int > *pCorners = job.m_pTriangles->m_Corners;
+	for ( int t = job.m_nFirst; t < job.m_nLast; ++t )
+	{
+		int v0 = pCorners[0][t];
+		int v1 = pCorners[1][t];
+		int v2 = pCorners[2][t];
+		const Vector &p0 = job.m_pPositions[ job.m_pPositionIndices[v0] ];
+		const Vector &p1 = job.m_pPositions[ job.m_pPositionIndices[v1] ];
+		const Vector &p2 = job.m_pPositions[ job.m_pPositionIndices[v2] ];
+		const Vector2D &t0 = job.m_pTexCoords[ job.m_pTexCoordIndices[v0] ];
+		const Vector2D &t1 = job.m_pTexCoords[ job.m_pTexCoordIndices[v1] ];
+		const Vector2D &t2 = job.m_pTexCoords[ job.m_pTexCoordIndices[v2] ];
+		CalcTriangleTangentSpace( p0, p1, p2, t0, t1, t2, job.m_pTangentS[t], job.m_pTangentT[t] );
+	}
+}
+
 
+//-----------------------------------------------------------------------------
+// Sums the tangents of the triangles around each vertex
+//-----------------------------------------------------------------------------
+struct VertexTangentJob_t
+{
+	int m_nFirst;
+	int m_nLast;
+	const VertToTriMap_t *m_pVertToTriMap;
+	const Vector *m_pTriangleTangentS;
+	const Vector *m_pTriangleTangentT;
+	Vector *m_pTangentS;
+	Vector *m_pTangentT;
+};
+
+static void SumVertexTangents( VertexTangentJob_t &job )
+{
+	const int *pFirst = job.m_pVertToTriMap->m_First.Base();
+	const int *pTriangles = job.m_pVertToTriMap->m_Triangles.Base();
+	for ( int v = job.m_nFirst; v < job.m_nLast; ++v )
+	{
 		Vector sVect, tVect;
 		sVect.Init( 0.0f, 0.0f, 0.0f );
 		tVect.Init( 0.0f, 0.0f, 0.0f );
-		int nTriangleCount = triangleList.Count();
-		for ( int triID = 0; triID < nTriangleCount; triID++ )
+		for ( int i = pFirst[v]; i < pFirst[v+1]; ++i )
 		{
-			Triangle_t &tri = triangles[ triangleList[triID] ];
-			sVect += tri.m_vecTangentS;
-			tVect += tri.m_vecTangentT;
+			sVect += job.m_pTriangleTangentS[ pTriangles[i] ];
+			tVect += job.m_pTriangleTangentT[ pTriangles[i] ];
 		}
+		job.m_pTangentS[v] = sVect;
+		job.m_pTangentT[v] = tVect;
+	}
+}
 
-		// In the case of zbrush, everything needs to be treated as smooth.
-		if ( bSmoothTangents )
-		{
-			const Vector &vertPos1 = pPositionData.Get( pPositionIndices.Get( vertID ) );
-			for( int vertID2 = 0; vertID2 < nVertexCount; vertID2++ )
-			{
-				if ( vertID2 == vertID )
-					continue;
 
-				const Vector &vertPos2 = pPositionData.Get( pPositionIndices.Get( vertID2 ) );
-				if ( vertPos1 != vertPos2 )
-					continue;
+//-----------------------------------------------------------------------------
+// Gives each vertex the summed tangents of all vertices at the same position
+//-----------------------------------------------------------------------------
+struct VertexPosition_t
+{
+	Vector m_vecPosition;
+	int m_nVertex;
+};
 
-				CUtlVector<int> &triangleList2 = vertToTriMap[vertID2];
-				int nTriangleCount2 = triangleList2.Count();
-				for ( int triID2 = 0; triID2 < nTriangleCount2; triID2++ )
-				{
-					Triangle_t &tri2 = triangles[ triangleList2[triID2] ];
-					sVect += tri2.m_vecTangentS;
-					tVect += tri2.m_vecTangentT;
-				}
+static int VertexPositionLessFunc( const void *a, const void *b )
+{
+	const VertexPosition_t *pA = ( const VertexPosition_t * )a;
+	const VertexPosition_t *pB = ( const VertexPosition_t * )b;
+	for ( int i = 0; i < 3; ++i )
+	{
+		if ( pA->m_vecPosition[i] != pB->m_vecPosition[i] )
+			return pA->m_vecPosition[i] < pB->m_vecPosition[i] ? -1 : 1;
+	}
+	return pA->m_nVertex - pB->m_nVertex;
+}
+
+static void SmoothVertexTangents( int nVertexCount, const Vector *pPositions, const int *pPositionIndices, Vector *pTangentS, Vector *pTangentT )
+{
+	CUtlVector< VertexPosition_t > sorted;
+	sorted.SetCount( nVertexCount );
+	for ( int v = 0; v < nVertexCount; ++v )
+	{
+		sorted[v].m_vecPosition = pPositions[ pPositionIndices[v] ];
+		sorted[v].m_nVertex = v;
+	}
+	qsort( sorted.Base(), nVertexCount, sizeof( VertexPosition_t ), VertexPositionLessFunc );
+
+	for ( int nStart = 0; nStart < nVertexCount; )
+	{
+		int nEnd = nStart + 1;
+		while ( nEnd < nVertexCount && sorted[nEnd].m_vecPosition == sorted[nStart].m_vecPosition )
+		{
+			++nEnd;
+		}
+
+		if ( nEnd - nStart > 1 )
+		{
+			Vector sVect, tVect;
+			sVect.Init( 0.0f, 0.0f, 0.0f );
+			tVect.Init( 0.0f, 0.0f, 0.0f );
+			for ( int i = nStart; i < nEnd; ++i )
+			{
+				sVect += pTangentS[ sorted[i].m_nVertex ];
+				tVect += pTangentT[ sorted[i].m_nVertex ];
+			}
+			for ( int i = nStart; i < nEnd; ++i )
+			{
+				pTangentS[ sorted[i].m_nVertex ] = sVect;
+				pTangentT[ sorted[i].m_nVertex ] = tVect;
 			}
 		}
+		nStart = nEnd;
+	}
+}
+
+
+//-----------------------------------------------------------------------------
+// Makes an orthonormal tangent frame for each vertex from its summed tangents
+//-----------------------------------------------------------------------------
+struct VertexFrameJob_t
+{
+	int m_nFirst;
+	int m_nLast;
+	const Vector *m_pTangentS;
+	const Vector *m_pTangentT;
+	const Vector *m_pNormals;
+	const int *m_pNormalIndices;
+	Vector4D *m_pFinalTangents;
+};
+
+static void ComputeVertexTangentFrames( VertexFrameJob_t &job )
+{
+	for ( int v = job.m_nFirst; v < job.m_nLast; ++v )
+	{
+		Vector sVect = job.m_pTangentS[v];
+		Vector tVect = job.m_pTangentT[v];
+		Vector4D &finalSVect = job.m_pFinalTangents[v];
 
 		// make an orthonormal system.
 		// need to check if we are left or right handed.
 		Vector tmpVect;
 		CrossProduct( sVect, tVect, tmpVect );
-		const Vector &normal = pNormalData.Get( pNormalIndices.Get( vertID ) );
+		const Vector &normal = job.m_pNormals[ job.m_pNormalIndices[v] ];
 		bool bLeftHanded = DotProduct( tmpVect, normal ) < 0.0f;
 		if ( !bLeftHanded )
 		{
@@ -1777,29 +2338,102 @@ void CDmeMesh::ComputeAverageTangent( CDmeVertexData *pVertexData, bool bSmoothT
 			finalSVect[2] = sVect[2];
 			finalSVect[3] = -1.0f;
 		}
+	}
+}
+
+
+//-----------------------------------------------------------------------------
+// Computes the normal of each triangle; corners here are position indices
+//-----------------------------------------------------------------------------
+struct FaceNormalJob_t
+{
+	int m_nFirst;
+	int m_nLast;
+	const MeshTriangles_t *m_pPositionTriangles;
+	const Vector *m_pPositions;
+	Vector *m_pFaceNormals;
+};
+
+static void ComputeFaceNormals( FaceNormalJob_t &job )
+{
+	const CUtlVector< int > *pCorners = job.m_pPositionTriangles->m_Corners;
+	for ( int t = job.m_nFirst; t < job.m_nLast; ++t )
+	{
+		const Vector &p1 = job.m_pPositions[ pCorners[0][t] ];
+		const Vector &p2 = job.m_pPositions[ pCorners[1][t] ];
+		const Vector &p3 = job.m_pPositions[ pCorners[2][t] ];
 
-		pVertexData->SetVertexData( tangentField, vertID, 1, AT_VECTOR4, &finalSVect );
-		pVertexData->SetVertexIndices( tangentField, vertID, 1, &vertID );
+		Vector vecDelta, vecDelta2, vecNormal;
+		VectorSubtract( p2, p1, vecDelta );
+		VectorSubtract( p3, p1, vecDelta2 );
+		CrossProduct( vecDelta, vecDelta2, vecNormal );
+		VectorNormalize( vecNormal );
+		job.m_pFaceNormals[t] = vecNormal;
 	}
 }
 
 
 //-----------------------------------------------------------------------------
-// Builds a map from vertex index to all triangles that use it
+// Averages the normals of the triangles around each normal
 //-----------------------------------------------------------------------------
-void CDmeMesh::BuildVertToTriMap( const CDmeVertexData *pVertexData, CUtlVector<Triangle_t> &triangles, CUtlVector< CUtlVector<int> > &vertToTriMap )
+struct VertexNormalJob_t
 {
-	vertToTriMap.AddMultipleToTail( pVertexData->VertexCount() );
+	int m_nFirst;
+	int m_nLast;
+	const VertToTriMap_t *m_pNormalToTriMap;
+	const Vector *m_pFaceNormals;
+	Vector *m_pNormals;
+};
 
-	int nCount = FaceSetCount();
-	for ( int i = 0; i < nCount; ++i )
+static void AverageFaceNormals( VertexNormalJob_t &job )
+{
+	const int *pFirst = job.m_pNormalToTriMap->m_First.Base();
+	const int *pTriangles = job.m_pNormalToTriMap->m_Triangles.Base();
+	for ( int n = job.m_nFirst; n < job.m_nLast; ++n )
 	{
-		CDmeFaceSet *pFaceSet = GetFaceSet( i );
-		BuildTriangleMap( pVertexData, pFaceSet, triangles, &vertToTriMap );
+		int nNormalsAdded = pFirst[n+1] - pFirst[n];
+		if ( nNormalsAdded <= 0 )
+		{
+			job.m_pNormals[n].Init( 0, 1, 0 );
+			continue;
+		}
+
+		Vector vecNormal( 0.0f, 0.0f, 0.0f );
+		for ( int i = pFirst[n]; i < pFirst[n+1]; ++i )
+		{
+			vecNormal += job.m_pFaceNormals[ pTriangles[i] ];
+		}
+		vecNormal /= nNormalsAdded;
+		VectorNormalize( vecNormal );
+		job.m_pNormals[n] = vecNormal;
 	}
 }
 
 
+//-----------------------------------------------------------------------------
+// Computes correctly averaged vertex normals from position data. The triangle
+// corners of positionTriangles are position indices, and normalToTriMap maps
+// normal indices to triangles. pFaceNormals holds a normal per triangle
+//-----------------------------------------------------------------------------
+static void ComputeNormalsFromPositions( const MeshTriangles_t &positionTriangles, const VertToTriMap_t &normalToTriMap,
+	const Vector *pPositions, int nNormalCount, Vector *pNormals, Vector *pFaceNormals, bool bParallel )
+{
+	Assert( normalToTriMap.m_First.Count() == nNormalCount + 1 );
+
+	FaceNormalJob_t faceJob;
+	faceJob.m_pPositionTriangles = &positionTriangles;
+	faceJob.m_pPositions = pPositions;
+	faceJob.m_pFaceNormals = pFaceNormals;
+	RunMeshKernel( "CDmeMesh::ComputeFaceNormals", faceJob, positionTriangles.Count(), &ComputeFaceNormals, bParallel );
+
+	VertexNormalJob_t normalJob;
+	normalJob.m_pNormalToTriMap = &normalToTriMap;
+	normalJob.m_pFaceNormals = pFaceNormals;
+	normalJob.m_pNormals = pNormals;
+	RunMeshKernel( "CDmeMesh::AverageFaceNormals", normalJob, nNormalCount, &AverageFaceNormals, bParallel );
+}
+
+
 //-----------------------------------------------------------------------------
 // Compute a default per-vertex tangent given normal data + uv data
 //-----------------------------------------------------------------------------
@@ -1821,18 +2455,62 @@ void CDmeMesh::ComputeDefaultTangentData( CDmeVertexData *pVertexData, bool bSmo
 	// the face set data to refer to the new vertices
 
 	// Build a map from vertex to a list of triangles that share the vert.
-	CUtlVector<Triangle_t> triangles( 0, 1024 );
-	CUtlVector< CUtlVector<int> > vertToTriMap;
-	vertToTriMap.AddMultipleToTail( pVertexData->VertexCount() );
+	const int nVertexCount = pVertexData->VertexCount();
+	MeshTriangles_t triangles;
+	BuildMeshTriangles( this, pVertexData, triangles );
+	VertToTriMap_t vertToTriMap;
+	BuildVertToTriMap( triangles, nVertexCount, NULL, vertToTriMap );
 
-	int nCount = FaceSetCount();
-	for ( int i = 0; i < nCount; ++i )
+	const CUtlVector< int > &positionIndices = pVertexData->GetVertexIndexData( posField );
+	const CUtlVector< int > &normalIndices = pVertexData->GetVertexIndexData( normalField );
+	const CUtlVector< Vector > &positions = pVertexData->GetPositionData();
+	const CUtlVector< Vector > &normals = pVertexData->GetNormalData();
+
+	// Calculate the tangent space for each triangle.
+	const int nTriangleCount = triangles.Count();
+	CUtlVector< Vector > triangleTangents[2];
+	triangleTangents[0].SetCount( nTriangleCount );
+	triangleTangents[1].SetCount( nTriangleCount );
+
+	TriangleTangentJob_t triangleJob;
+	triangleJob.m_pTriangles = &triangles;
+	triangleJob.m_pPositions = positions.Base();
+	triangleJob.m_pPositionIndices = positionIndices.Base();
+	triangleJob.m_pTexCoords = pVertexData->GetTextureCoordData().Base();
+	triangleJob.m_pTexCoordIndices = pVertexData->GetVertexIndexData( uvField ).Base();
+	triangleJob.m_pTangentS = triangleTangents[0].Base();
+	triangleJob.m_pTangentT = triangleTangents[1].Base();
+	RunMeshKernel( "CDmeMesh::ComputeTriangleTangents", triangleJob, nTriangleCount, &ComputeTriangleTangents, true );
+
+	// calculate an average tangent space for each vertex.
+	CUtlVector< Vector > vertexTangents[2];
+	vertexTangents[0].SetCount( nVertexCount );
+	vertexTangents[1].SetCount( nVertexCount );
+
+	VertexTangentJob_t vertexJob;
+	vertexJob.m_pVertToTriMap = &vertToTriMap;
+	vertexJob.m_pTriangleTangentS = triangleTangents[0].Base();
+	vertexJob.m_pTriangleTangentT = triangleTangents[1].Base();
+	vertexJob.m_pTangentS = vertexTangents[0].Base();
+	vertexJob.m_pTangentT = vertexTangents[1].Base();
+	RunMeshKernel( "CDmeMesh::SumVertexTangents", vertexJob, nVertexCount, &SumVertexTangents, true );
+
+	// In the case of zbrush, everything needs to be treated as smooth.
+	if ( bSmoothTangents )
 	{
-		CDmeFaceSet *pFaceSet = GetFaceSet( i );
-		BuildTriangleMap( pVertexData, pFaceSet, triangles, &vertToTriMap );
+		SmoothVertexTangents( nVertexCount, positions.Base(), positionIndices.Base(), vertexTangents[0].Base(), vertexTangents[1].Base() );
 	}
 
-	ComputeTriangleTangets( pVertexData, triangles );
+	CUtlVector< Vector4D > finalTangents;
+	finalTangents.SetCount( nVertexCount );
+
+	VertexFrameJob_t frameJob;
+	frameJob.m_pTangentS = vertexTangents[0].Base();
+	frameJob.m_pTangentT = vertexTangents[1].Base();
+	frameJob.m_pNormals = normals.Base();
+	frameJob.m_pNormalIndices = normalIndices.Base();
+	frameJob.m_pFinalTangents = finalTangents.Base();
+	RunMeshKernel( "CDmeMesh::ComputeVertexTangentFrames", frameJob, nVertexCount, &ComputeVertexTangentFrames, true );
 
 	// FIXME: We could do a pass to determine the unique combinations of 
 	// position + tangent indices in the vertex data. We only need to have
@@ -1840,9 +2518,18 @@ void CDmeMesh::ComputeDefaultTangentData( CDmeVertexData *pVertexData, bool bSmo
 	// (and speed), I'll assume all tangents are unique per vertex.
 	FieldIndex_t tangent = pVertexData->CreateField<Vector4D>( "tangents" );
 	pVertexData->RemoveAllVertexData( tangent );
-	pVertexData->AddVertexData( tangent, pVertexData->VertexCount() );
+	pVertexData->AddVertexData( tangent, nVertexCount );
+
+	CUtlVector< int > tangentIndices;
+	tangentIndices.SetCount( nVertexCount );
+	for ( int i = 0; i < nVertexCount; ++i )
+	{
+		tangentIndices[i] = i;
+	}
 
-	ComputeAverageTangent( pVertexData, bSmoothTangents, vertToTriMap, triangles );
+	FieldIndex_t tangentField = pVertexData->FindFieldIndex( CDmeVertexData::FIELD_TANGENT );
+	pVertexData->SetVertexData( tangentField, 0, nVertexCount, AT_VECTOR4, finalTangents.Base() );
+	pVertexData->SetVertexIndices( tangentField, 0, nVertexCount, tangentIndices.Base() );
 }
 
 
@@ -1929,64 +2616,6 @@ void CDmeMesh::AddDelta( CDmeVertexData *pBaseState, Vector *pDeltaPosition, int
 }
 
 
-//-----------------------------------------------------------------------------
-// Computes correctly averaged vertex normals from position data
-//-----------------------------------------------------------------------------
-void CDmeMesh::ComputeNormalsFromPositions(
-	CDmeVertexData *pBase,
-	const Vector *pPosition,
-	const CUtlVector<Triangle_t> &triangles,
-	int nNormalCount,
-	Vector *pNormals )
-{
-	Assert( nNormalCount == pBase->GetNormalData().Count() );
-	int *pNormalsAdded = (int*)_alloca( nNormalCount * sizeof(int) );
-	memset( pNormalsAdded, 0, nNormalCount * sizeof(int) );
-	memset( pNormals, 0, nNormalCount * sizeof(Vector) );
-
-	const CUtlVector<int> &positionIndices = pBase->GetVertexIndexData( CDmeVertexData::FIELD_POSITION );
-	const CUtlVector<int> &normalIndices = pBase->GetVertexIndexData( CDmeVertexData::FIELD_NORMAL );
-
-	int nTriangleCount = triangles.Count();
-	for ( int i = 0; i < nTriangleCount; ++i )
-	{
-		const Triangle_t &tri = triangles[i];
-		int p1 = positionIndices[ tri.m_nIndex[0] ];
-		int p2 = positionIndices[ tri.m_nIndex[1] ];
-		int p3 = positionIndices[ tri.m_nIndex[2] ];
-
-		int n1 = normalIndices[ tri.m_nIndex[0] ];
-		int n2 = normalIndices[ tri.m_nIndex[1] ];
-		int n3 = normalIndices[ tri.m_nIndex[2] ];
-
-		Vector vecDelta, vecDelta2, vecNormal;
-		VectorSubtract( pPosition[p2], pPosition[p1], vecDelta );
-		VectorSubtract( pPosition[p3], pPosition[p1], vecDelta2 );
-		CrossProduct( vecDelta, vecDelta2, vecNormal );
-		VectorNormalize( vecNormal );
-
-		pNormals[n1] += vecNormal;
-		pNormals[n2] += vecNormal;
-		pNormals[n3] += vecNormal;
-
-		++pNormalsAdded[n1]; ++pNormalsAdded[n2]; ++pNormalsAdded[n3];
-	}
-
-	for ( int i = 0; i < nNormalCount; ++i )
-	{
-		if ( pNormalsAdded[i] > 0 )
-		{
-			pNormals[i] /= pNormalsAdded[i];
-			VectorNormalize( pNormals[i] );
-		}
-		else
-		{
-			pNormals[i].Init( 0, 1, 0 );
-		}
-	}
-}
-
-
 //-----------------------------------------------------------------------------
 // Converts pose-space normals into deltas appropriate for correction delta states
 //-----------------------------------------------------------------------------
@@ -1999,8 +2628,9 @@ void CDmeMesh::ComputeCorrectedNormalsFromActualNormals( const CUtlVector<int> &
 	Assert( nNormalCount == pBind->GetNormalData().Count() );
 
 	// Subtract out all other normal contributions
-	Vector *pUncorrectedNormals = (Vector*)_alloca( nNormalCount * sizeof(Vector) );
-	memcpy( pUncorrectedNormals, pBind->GetNormalData().Base(), nNormalCount * sizeof( Vector ) );
+	CUtlVector< Vector > uncorrectedNormals;
+	uncorrectedNormals.CopyArray( pBind->GetNormalData().Base(), nNormalCount );
+	Vector *pUncorrectedNormals = uncorrectedNormals.Base();
 	int nDeltaStateCount = deltaStateList.Count();
 	for ( int i = 0; i < nDeltaStateCount; ++i )
 	{
@@ -2033,24 +2663,130 @@ void CDmeMesh::SetDeltaNormalData( int nDeltaIndex, int nNormalCount, Vector *pN
 		nNormalField = pDeltaState->CreateField( CDmeVertexDeltaData::FIELD_NORMAL );
 	}
 
+	CUtlVector< Vector > normalData;
+	CUtlVector< int > normalIndices;
 	for ( int i = 0; i < nNormalCount; ++i )
 	{
 		if ( pNormals[i].LengthSqr() < 1e-4 )
 			continue;
 
-		int nNormalIndex = pDeltaState->AddVertexData( nNormalField, 1 );
-		pDeltaState->SetVertexData( nNormalField, nNormalIndex, 1, AT_VECTOR3, &pNormals[i] );
-		pDeltaState->SetVertexIndices( nNormalField, nNormalIndex, 1, &i );
+		normalData.AddToTail( pNormals[i] );
+		normalIndices.AddToTail( i );
+	}
+
+	const int nDeltaCount = normalData.Count();
+	if ( nDeltaCount == 0 )
+		return;
+
+	int nNormalIndex = pDeltaState->AddVertexData( nNormalField, nDeltaCount );
+	pDeltaState->SetVertexData( nNormalField, nNormalIndex, nDeltaCount, AT_VECTOR3, normalData.Base() );
+	pDeltaState->SetVertexIndices( nNormalField, nNormalIndex, nDeltaCount, normalIndices.Base() );
+}
+
+
+//-----------------------------------------------------------------------------
+// Discovers the atomic controls used by the various delta states 
+//-----------------------------------------------------------------------------
+static int DeltaStateUsageLessFunc( const int * lhs, const int * rhs )
+{
+	return *lhs - *rhs;
+}
+
+
+static int ControlIndexSortFunc( const void *a, const void *b )
+{
+	return *( const int * )( a ) - *( const int * )( b );
+}
+
+
+//-----------------------------------------------------------------------------
+// Finds sets of control indices by content. The sets are stored sorted, back
+// to back, and hashed; sets with equal contents are chained in order, so
+// Find() returns the first of them, as a search of the list would
+//-----------------------------------------------------------------------------
+class CControlSetIndex
+{
+public:
+	void Init( const CUtlVector< CUtlVector< int > > &controlSets );
+
+	// Returns the first set equal to the sorted control indices, or -1
+	int Find( const int *pControls, int nControls ) const;
+
+	// Returns the next set with the same contents as nSet, or -1
+	int Next( int nSet ) const { return m_NextEqual[ nSet ]; }
+
+private:
+	int &FindSlot( const int *pControls, int nControls ) const;
+
+	CUtlVector< int > m_Controls;
+	CUtlVector< int > m_SetStart;	// nSetCount + 1 entries into m_Controls
+	CUtlVector< int > m_NextEqual;
+	mutable CUtlVector< int > m_Hash;
+};
+
+void CControlSetIndex::Init( const CUtlVector< CUtlVector< int > > &controlSets )
+{
+	const int nSetCount = controlSets.Count();
+	m_SetStart.SetCount( nSetCount + 1 );
+	m_NextEqual.SetCount( nSetCount );
+	m_Controls.RemoveAll();
+	for ( int i = 0; i < nSetCount; ++i )
+	{
+		m_SetStart[i] = m_Controls.Count();
+		m_Controls.AddMultipleToTail( controlSets[i].Count(), controlSets[i].Base() );
+		qsort( m_Controls.Base() + m_SetStart[i], controlSets[i].Count(), sizeof( int ), ControlIndexSortFunc );
+		m_NextEqual[i] = -1;
+	}
+	m_SetStart[ nSetCount ] = m_Controls.Count();
+
+	int nSize = 256;
+	while ( nSize < 2 * nSetCount )
+	{
+		nSize <<= 1;
+	}
+	m_Hash.SetCount( nSize );
+	for ( int i = 0; i < nSize; ++i )
+	{
+		m_Hash[i] = -1;
+	}
+
+	// Remember the tail of each chain so sets stay in order along it
+	CUtlVector< int > lastEqual;
+	lastEqual.SetCount( nSetCount );
+	for ( int i = 0; i < nSetCount; ++i )
+	{
+		int &nFirst = FindSlot( m_Controls.Base() + m_SetStart[i], m_SetStart[i + 1] - m_SetStart[i] );
+		if ( nFirst < 0 )
+		{
+			nFirst = i;
+		}
+		else
+		{
+			m_NextEqual[ lastEqual[ nFirst ] ] = i;
+		}
+		lastEqual[ nFirst ] = i;
 	}
 }
 
+int CControlSetIndex::Find( const int *pControls, int nControls ) const
+{
+	return FindSlot( pControls, nControls );
+}
 
-//-----------------------------------------------------------------------------
-// Discovers the atomic controls used by the various delta states 
-//-----------------------------------------------------------------------------
-static int DeltaStateUsageLessFunc( const int * lhs, const int * rhs )
+int &CControlSetIndex::FindSlot( const int *pControls, int nControls ) const
 {
-	return *lhs - *rhs;
+	int nMask = m_Hash.Count() - 1;
+	for ( int i = HashBlock( pControls, nControls * sizeof( int ) ) & nMask; ; i = ( i + 1 ) & nMask )
+	{
+		int &nSet = m_Hash[i];
+		if ( nSet < 0 )
+			return nSet;
+
+		const int nStart = m_SetStart[ nSet ];
+		if ( m_SetStart[ nSet + 1 ] - nStart == nControls &&
+			!memcmp( m_Controls.Base() + nStart, pControls, nControls * sizeof( int ) ) )
+			return nSet;
+	}
 }
 
 
@@ -2060,6 +2796,7 @@ static int DeltaStateUsageLessFunc( const int * lhs, const int * rhs )
 void CDmeMesh::BuildAtomicControlLists( int nCount, DeltaComputation_t *pInfo, CUtlVector< CUtlVector< int > > &deltaStateUsage )
 {
 	CUtlVector< CUtlString > atomicControls;
+	CUtlDict< int, int > atomicControlDict( true, 0, nCount );	// first control of each name
 	deltaStateUsage.SetCount( nCount );
 
 	// Build a list of atomic controls
@@ -2068,7 +2805,12 @@ void CDmeMesh::BuildAtomicControlLists( int nCount, DeltaComputation_t *pInfo, C
 	{
 		if ( pInfo[nCurrentDelta].m_nDimensionality != 1 )
 			break;
-		int j = atomicControls.AddToTail( GetDeltaState( pInfo[nCurrentDelta].m_nDeltaIndex )->GetName() );
+		const char *pControlName = GetDeltaState( pInfo[nCurrentDelta].m_nDeltaIndex )->GetName();
+		int j = atomicControls.AddToTail( pControlName );
+		if ( atomicControlDict.Find( pControlName ) == atomicControlDict.InvalidIndex() )
+		{
+			atomicControlDict.Insert( pControlName, j );
+		}
 		deltaStateUsage[ nCurrentDelta ].AddToTail( j );
 	}
 
@@ -2090,15 +2832,15 @@ void CDmeMesh::BuildAtomicControlLists( int nCount, DeltaComputation_t *pInfo, C
 
 			// Find this name in the list of strings
 			int j;
-			int nControlCount = atomicControls.Count();
-			for ( j = 0; j < nControlCount; ++j )
+			int nDictIndex = atomicControlDict.Find( pUnderBar );
+			if ( nDictIndex != atomicControlDict.InvalidIndex() )
 			{
-				if ( !Q_stricmp( pUnderBar, atomicControls[j] ) )
-					break;
+				j = atomicControlDict[ nDictIndex ];
 			}
-			if ( j == nControlCount )
+			else
 			{
 				j = atomicControls.AddToTail( pUnderBar );
+				atomicControlDict.Insert( pUnderBar, j );
 			}
 			deltaStateUsage[ nCurrentDelta ].AddToTail( j );
 		}
@@ -2111,6 +2853,8 @@ void CDmeMesh::BuildAtomicControlLists( int nCount, DeltaComputation_t *pInfo, C
 // Construct list of all n-1 -> 1 dimensional delta states 
 // that will be active when this delta state is active
 //-----------------------------------------------------------------------------
+#define MAX_INDEXED_DEPENDENT_CONTROLS 12
+
 void CDmeMesh::ComputeDependentDeltaStateList( CUtlVector< DeltaComputation_t > &compList )
 {
 	if ( compList.Count() == 0 )
@@ -2122,11 +2866,59 @@ void CDmeMesh::ComputeDependentDeltaStateList( CUtlVector< DeltaComputation_t >
 	const int nCount( compList.Count() );
 	BuildAtomicControlLists( nCount, compList.Base(), deltaStateUsage );
 
+	CControlSetIndex usageIndex;
+	usageIndex.Init( deltaStateUsage );
+
 	// Now build up a list of dependent delta states based on usage
 	// NOTE: Usage is sorted in ascending order.
+	CUtlVector< int > subset;
+	CUtlVector< int > dependents;
 	for ( int i = 1; i < nCount; ++i )
 	{
 		int nUsageCount1 = deltaStateUsage[i].Count();
+
+		// Rather than testing every lower dimensional delta state, look up each
+		// subset of this one's controls. Only done while there are few subsets,
+		// and when the controls are distinct so each subset is a set
+		bool bDistinct = ( nUsageCount1 <= MAX_INDEXED_DEPENDENT_CONTROLS );
+		for ( int ii = 1; bDistinct && ii < nUsageCount1; ++ii )
+		{
+			bDistinct = ( deltaStateUsage[i][ii - 1] != deltaStateUsage[i][ii] );
+		}
+
+		if ( bDistinct )
+		{
+			dependents.RemoveAll();
+			const int nSubsetCount = ( 1 << nUsageCount1 ) - 1;	// all but the whole set
+			for ( int nBits = 1; nBits < nSubsetCount; ++nBits )
+			{
+				subset.RemoveAll();
+				for ( int ii = 0; ii < nUsageCount1; ++ii )
+				{
+					if ( nBits & ( 1 << ii ) )
+					{
+						subset.AddToTail( deltaStateUsage[i][ii] );
+					}
+				}
+
+				for ( int j = usageIndex.Find( subset.Base(), subset.Count() ); j >= 0; j = usageIndex.Next( j ) )
+				{
+					if ( compList[j].m_nDimensionality < compList[i].m_nDimensionality )
+					{
+						dependents.AddToTail( j );
+					}
+				}
+			}
+
+			// Keep the order the search below would produce
+			dependents.Sort( DeltaStateUsageLessFunc );
+			for ( int d = 0; d < dependents.Count(); ++d )
+			{
+				compList[i].m_DependentDeltas.AddToTail( compList[ dependents[d] ].m_nDeltaIndex );
+			}
+			continue;
+		}
+
 		for ( int j = 0; j < i; ++j )
 		{
 			// At the point they have the same dimensionality, no more need to check
@@ -2193,6 +2985,42 @@ void CDmeMesh::ComputeDeltaStateComputationList( CUtlVector< DeltaComputation_t
 }
 
 
+//-----------------------------------------------------------------------------
+// Computes the posed normals of a delta state: those of the bind positions
+// with the delta state and all of its dependent delta states applied
+//-----------------------------------------------------------------------------
+struct DeltaNormalJob_t
+{
+	CDmeMesh *m_pMesh;
+	const CDmeMesh::DeltaComputation_t *m_pComputation;
+	const CUtlVector< Vector > *m_pBasePositions;
+	const MeshTriangles_t *m_pPositionTriangles;
+	const VertToTriMap_t *m_pNormalToTriMap;
+	Vector *m_pPositions;
+	Vector *m_pFaceNormals;
+	Vector *m_pNormals;
+};
+
+static void ComputeDeltaNormals( DeltaNormalJob_t &job )
+{
+	CDmeMesh *pMesh = job.m_pMesh;
+	const int nPosCount = job.m_pBasePositions->Count();
+	memcpy( job.m_pPositions, job.m_pBasePositions->Base(), nPosCount * sizeof( Vector ) );
+
+	const CUtlVector< int > &depDeltas = job.m_pComputation->m_DependentDeltas;
+	const int nDepStateCount = depDeltas.Count();
+	for ( int j = 0; j < nDepStateCount; ++j )
+	{
+		pMesh->AddDelta( pMesh->GetDeltaState( depDeltas[ j ] ), job.m_pPositions, nPosCount, CDmeVertexData::FIELD_POSITION );
+	}
+
+	pMesh->AddDelta( pMesh->GetDeltaState( job.m_pComputation->m_nDeltaIndex ), job.m_pPositions, nPosCount, CDmeVertexData::FIELD_POSITION );
+
+	// Jobs already run side by side, so each one computes its normals serially
+	ComputeNormalsFromPositions( *job.m_pPositionTriangles, *job.m_pNormalToTriMap, job.m_pPositions, nPosCount, job.m_pNormals, job.m_pFaceNormals, false );
+}
+
+
 //-----------------------------------------------------------------------------
 // Computes normal deltas for all delta states based on position deltas
 // NOTE: This assumes a naming scheme where delta state names have _ that separate control names
@@ -2208,31 +3036,34 @@ void CDmeMesh::ComputeDeltaStateNormals()
 	const CUtlVector< Vector > &basePosData = pBind->GetPositionData();
 	const int nPosCount = basePosData.Count();
 
-	// Build a map from vertex to a list of triangles that share the vert.
-	CUtlVector< Triangle_t > triangles( 0, 1024 );
-	CUtlVector< CUtlVector<int> > vertToTriMap;
-	vertToTriMap.AddMultipleToTail( pBind->VertexCount() );
+	// Build the triangles once; the normal and position indices set up below
+	// are all that differ between the states whose normals are computed
+	MeshTriangles_t triangles;
+	BuildMeshTriangles( this, pBind, triangles );
+	const int nTriangleCount = triangles.Count();
 
-	const int nFaceSetCount = FaceSetCount();
-	for ( int i = 0; i < nFaceSetCount; ++i )
-	{
-		CDmeFaceSet *pFaceSet = GetFaceSet( i );
-		BuildTriangleMap( pBind, pFaceSet, triangles, &vertToTriMap );
-	}
+	const CUtlVector< int > &basePosIndices = pBind->GetVertexIndexData( CDmeVertexData::FIELD_POSITION );
+	MeshTriangles_t positionTriangles;
+	RemapMeshTriangles( triangles, basePosIndices.Base(), positionTriangles );
+
+	// Normals are indexed like positions
+	VertToTriMap_t normalToTriMap;
+	BuildVertToTriMap( triangles, nPosCount, basePosIndices.Base(), normalToTriMap );
 
 	// Temporary storage for normals
-	Vector *pNormals = reinterpret_cast< Vector * >( alloca( nPosCount * sizeof( Vector ) ) );
+	CUtlVector< Vector > normals;
+	normals.SetCount( nPosCount );
+	CUtlVector< Vector > faceNormals;
+	faceNormals.SetCount( nTriangleCount );
 
 	// Make all of the normals in the bind pose smooth
 	{
-		const CUtlVector< int > &basePosIndices = pBind->GetVertexIndexData( CDmeVertexData::FIELD_POSITION );
-
 		pBind->SetVertexIndices( nBindNormalIndex, 0, basePosIndices.Count(), basePosIndices.Base() );
 		pBind->RemoveAllVertexData( nBindNormalIndex );
 		pBind->AddVertexData( nBindNormalIndex, nPosCount );
 
-		ComputeNormalsFromPositions( pBind, basePosData.Base(), triangles, nPosCount, pNormals );
-		pBind->SetVertexData( nBindNormalIndex, 0, nPosCount, AT_VECTOR3, pNormals );
+		ComputeNormalsFromPositions( positionTriangles, normalToTriMap, basePosData.Base(), nPosCount, normals.Base(), faceNormals.Base(), true );
+		pBind->SetVertexData( nBindNormalIndex, 0, nPosCount, AT_VECTOR3, normals.Base() );
 
 		// Fix up the current state to have smooth normals if current is not bind
 		CDmeVertexData *pCurrent = GetCurrentBaseState();
@@ -2243,38 +3074,91 @@ void CDmeMesh::ComputeDeltaStateNormals()
 			pCurrent->RemoveAllVertexData( nCurrentNormalIndex );
 			pCurrent->AddVertexData( nCurrentNormalIndex, nPosCount );
 
+			MeshTriangles_t currPositionTriangles;
+			RemapMeshTriangles( triangles, pCurrent->GetVertexIndexData( CDmeVertexData::FIELD_POSITION ).Base(), currPositionTriangles );
+
 			const CUtlVector< Vector > &currPosData = pCurrent->GetPositionData();
-			ComputeNormalsFromPositions( pCurrent, currPosData.Base(), triangles, nPosCount, pNormals );
-			pCurrent->SetVertexData( nCurrentNormalIndex, 0, nPosCount, AT_VECTOR3, pNormals );
+			ComputeNormalsFromPositions( currPositionTriangles, normalToTriMap, currPosData.Base(), nPosCount, normals.Base(), faceNormals.Base(), true );
+			pCurrent->SetVertexData( nCurrentNormalIndex, 0, nPosCount, AT_VECTOR3, normals.Base() );
 		}
 	}
 
-	// Temporary storage for the positions
-	Vector *pPosData = reinterpret_cast< Vector * >( alloca( nPosCount * sizeof( Vector ) ) );
-
 	// Compute the dependent delta state list like thing
 	CUtlVector< DeltaComputation_t > computationOrder;
 	ComputeDependentDeltaStateList( computationOrder );
 
-	const int nDeltaStateCount = computationOrder.Count();
-	for ( int i = 0; i < nDeltaStateCount; ++i )
+	// Turn on the current weights to all be 1 to get max effect of morphs
+	// while the normal deltas are corrected, restoring them at the end
+	CUtlVector< Vector2D > deltaStateWeights[MESH_DELTA_WEIGHT_TYPE_COUNT];
+	for ( int i = 0; i < MESH_DELTA_WEIGHT_TYPE_COUNT; ++i )
 	{
-		const DeltaComputation_t &deltaComputation = computationOrder[ i ];
+		deltaStateWeights[i] = m_DeltaStateWeights[i].Get();
+
+		int nCount = m_DeltaStateWeights[i].Count();
+		for ( int j = 0; j < nCount; ++j )
+		{
+			m_DeltaStateWeights[i].Set( j, Vector2D( 1.0f, 1.0f ) );
+		}
+	}
 
-		memcpy( pPosData, basePosData.Base(), nPosCount * sizeof( Vector ) );
+	// The posed normals of delta states only depend on positions, so a batch of
+	// them is computed at once on the thread pool. Correcting them depends on the
+	// normal deltas of the dependent delta states, so that is done in order
+	const int nDeltaStateCount = computationOrder.Count();
+	const bool bParallel = g_pThreadPool && ( g_pThreadPool->NumThreads() > 0 );
+	const int nBatchSize = bParallel ? 2 * ( g_pThreadPool->NumThreads() + 1 ) : 1;
+
+	CUtlVector< DeltaNormalJob_t > jobs;
+	jobs.SetCount( min( nBatchSize, nDeltaStateCount ) );
+	CUtlVector< Vector > jobPositions;
+	jobPositions.SetCount( jobs.Count() * nPosCount );
+	CUtlVector< Vector > jobNormals;
+	jobNormals.SetCount( jobs.Count() * nPosCount );
+	CUtlVector< Vector > jobFaceNormals;
+	jobFaceNormals.SetCount( jobs.Count() * nTriangleCount );
+
+	for ( int nFirst = 0; nFirst < nDeltaStateCount; nFirst += nBatchSize )
+	{
+		const int nJobCount = min( nBatchSize, nDeltaStateCount - nFirst );
+		for ( int i = 0; i < nJobCount; ++i )
+		{
+			DeltaNormalJob_t &job = jobs[ i ];
+			job.m_pMesh = this;
+			job.m_pComputation = &computationOrder[ nFirst + i ];
+			job.m_pBasePositions = &basePosData;
+			job.m_pPositionTriangles = &positionTriangles;
+			job.m_pNormalToTriMap = &normalToTriMap;
+			job.m_pPositions = jobPositions.Base() + i * nPosCount;
+			job.m_pNormals = jobNormals.Base() + i * nPosCount;
+			job.m_pFaceNormals = jobFaceNormals.Base() + i * nTriangleCount;
+		}
 
-		const CUtlVector< int > &depDeltas = deltaComputation.m_DependentDeltas;
-		const int nDepStateCount = depDeltas.Count();
-		for ( int j = 0; j < nDepStateCount; ++j )
+		if ( bParallel && nJobCount > 1 )
+		{
+			ParallelProcess( "CDmeMesh::ComputeDeltaStateNormals", jobs.Base(), nJobCount, &ComputeDeltaNormals );
+		}
+		else
 		{
-			AddDelta( GetDeltaState( depDeltas[ j ] ), pPosData, nPosCount, CDmeVertexData::FIELD_POSITION );
+			for ( int i = 0; i < nJobCount; ++i )
+			{
+				ComputeDeltaNormals( jobs[ i ] );
+			}
 		}
 
-		AddDelta( GetDeltaState( deltaComputation.m_nDeltaIndex ), pPosData, nPosCount, CDmeVertexData::FIELD_POSITION );
+		for ( int i = 0; i < nJobCount; ++i )
+		{
+			const DeltaComputation_t &deltaComputation = *jobs[ i ].m_pComputation;
+			ComputeCorrectedNormalsFromActualNormals( deltaComputation.m_DependentDeltas, nPosCount, jobs[ i ].m_pNormals );
 
-		ComputeNormalsFromPositions( pBind, pPosData, triangles, nPosCount, pNormals );
+			// Finally, store the corrected normals into the delta state
+			SetDeltaNormalData( deltaComputation.m_nDeltaIndex, nPosCount, jobs[ i ].m_pNormals );
+		}
+	}
 
-		SetDeltaNormalDataFromActualNormals( computationOrder[ i ].m_nDeltaIndex, depDeltas, nPosCount, pNormals );
+	// Restore weights to their current value
+	for ( int i = 0; i < MESH_DELTA_WEIGHT_TYPE_COUNT; ++i )
+	{
+		m_DeltaStateWeights[i] = deltaStateWeights[i];
 	}
 }
 
@@ -2524,7 +3408,12 @@ bool CDmeMesh::BuildMissingDependentDeltaList(
 
 	const int nControlIndices( controlIndices.Count() );
 
+	// Combinations are looked up by content rather than with FindDeltaIndexFromControlIndices
+	CControlSetIndex controlSetIndex;
+	controlSetIndex.Init( deltaStateControlList );
+
 	CUtlVector< int > comboControls;
+	CUtlVector< int > sortedComboControls;
 
 	for ( int i( nControlIndices - 1 ); i > 0; --i )
 	{
@@ -2545,7 +3434,9 @@ bool CDmeMesh::BuildMissingDependentDeltaList(
 					comboControls.AddToTail( controlIndices[ comboIndices[ k ] ] );
 				}
 
-				if ( FindDeltaIndexFromControlIndices( comboControls, deltaStateControlList) < 0 )
+				sortedComboControls.CopyArray( comboControls.Base(), nComboIndices );
+				qsort( sortedComboControls.Base(), nComboIndices, sizeof( int ), ControlIndexSortFunc );
+				if ( controlSetIndex.Find( sortedComboControls.Base(), nComboIndices ) < 0 )
 				{
 					dependentStates[ dependentStates.AddToTail() ].CopyArray( comboControls.Base(), comboControls.Count() );
 				}
@@ -3568,6 +4459,27 @@ int CSelectionHelper::BinarySearch( int vIndex ) const
 }
 
 
+//-----------------------------------------------------------------------------
+// Returns the topology of the current base state, building it if need be
+//-----------------------------------------------------------------------------
+CDmMeshComp *CDmeMesh::GetMeshComp()
+{
+	if ( m_pMeshComp && ( m_bMeshCompDirty || !m_pMeshComp->IsCurrent() ) )
+	{
+		delete m_pMeshComp;
+		m_pMeshComp = NULL;
+	}
+
+	if ( !m_pMeshComp )
+	{
+		m_pMeshComp = new CDmMeshComp( this );
+		m_bMeshCompDirty = false;
+	}
+
+	return m_pMeshComp;
+}
+
+
 //-----------------------------------------------------------------------------
 //
 //-----------------------------------------------------------------------------
@@ -3581,7 +4493,7 @@ void CDmeMesh::GrowSelection( int nSize, CDmeSingleIndexedComponent *pSelection,
 	pSelection->GetComponents( sIndices, sWeights );
 	const int nVertices = sIndices.Count();
 
-	CDmMeshComp *pMeshComp = pPassedMeshComp ? pPassedMeshComp : new CDmMeshComp( this );
+	CDmMeshComp *pMeshComp = pPassedMeshComp ? pPassedMeshComp : GetMeshComp();
 
 	CUtlVector< CDmMeshComp::CVert * > neighbours;
 
@@ -3604,11 +4516,6 @@ void CDmeMesh::GrowSelection( int nSize, CDmeSingleIndexedComponent *pSelection,
 	{
 		GrowSelection( nSize - 1, pSelection, pMeshComp );
 	}
-
-	if ( pMeshComp != pPassedMeshComp )
-	{
-		delete pMeshComp;
-	}
 }
 
 
@@ -3625,7 +4532,7 @@ void CDmeMesh::ShrinkSelection( int nSize, CDmeSingleIndexedComponent *pSelectio
 	pSelection->GetComponents( sIndices, sWeights );
 	const int nVertices = sIndices.Count();
 
-	CDmMeshComp *pMeshComp = pPassedMeshComp ? pPassedMeshComp : new CDmMeshComp( this );
+	CDmMeshComp *pMeshComp = pPassedMeshComp ? pPassedMeshComp : GetMeshComp();
 
 	CUtlVector< CDmMeshComp::CVert * > neighbours;
 
@@ -3666,11 +4573,6 @@ void CDmeMesh::ShrinkSelection( int nSize, CDmeSingleIndexedComponent *pSelectio
 	{
 		ShrinkSelection( nSize - 1, pSelection, pMeshComp );
 	}
-
-	if ( pMeshComp != pPassedMeshComp )
-	{
-		delete pMeshComp;
-	}
 }
 
 
@@ -3679,41 +4581,228 @@ CDmeSingleIndexedComponent *CDmeMesh::FeatherSelection(
 	Falloff_t falloffType,
 	Distance_t distanceType,
 	CDmeSingleIndexedComponent *pSelection,
-	CDmMeshComp *pPassedMeshComp )
+	CDmMeshComp *pPassedMeshComp,
+	Metric_t metric /* = METRIC_EUCLIDEAN */ )
 {
 	switch ( falloffType )
 	{
 	case SMOOTH:
-		return FeatherSelection< SMOOTH >( falloffDistance, distanceType, pSelection, pPassedMeshComp );
+		return FeatherSelection< SMOOTH >( falloffDistance, distanceType, pSelection, pPassedMeshComp, metric );
 	case SPIKE:
-		return FeatherSelection< SPIKE >( falloffDistance, distanceType, pSelection, pPassedMeshComp );
+		return FeatherSelection< SPIKE >( falloffDistance, distanceType, pSelection, pPassedMeshComp, metric );
 	case DOME:
-		return FeatherSelection< DOME >( falloffDistance, distanceType, pSelection, pPassedMeshComp );
+		return FeatherSelection< DOME >( falloffDistance, distanceType, pSelection, pPassedMeshComp, metric );
 	default:
-		return FeatherSelection< LINEAR >( falloffDistance, distanceType, pSelection, pPassedMeshComp );
+		return FeatherSelection< LINEAR >( falloffDistance, distanceType, pSelection, pPassedMeshComp, metric );
+	}
+}
+
+
+//-----------------------------------------------------------------------------
+// A k-d tree of points, stored implicitly: the median of each range along
+// the range's widest axis sits in the middle of it, with the lesser half of
+// the range before it and the greater half after it
+//-----------------------------------------------------------------------------
+class CNearestPointTree
+{
+public:
+	void Build( const CUtlVector< Vector > &positions, const CUtlVector< int > &indices );
+
+	// Returns the squared distance from p to the closest point, FLT_MAX if the tree is empty
+	float FindClosestDistSqr( const Vector &p ) const;
+
+protected:
+	void BuildRange( int nStart, int nEnd );
+	void FindClosest( int nStart, int nEnd, const Vector &p, float &flBestDistSqr ) const;
+
+	CUtlVector< Vector > m_points;
+	CUtlVector< unsigned char > m_axes;	// Split axis of the range whose median is at each point
+};
+
+
+//-----------------------------------------------------------------------------
+//
+//-----------------------------------------------------------------------------
+void CNearestPointTree::Build( const CUtlVector< Vector > &positions, const CUtlVector< int > &indices )
+{
+	const int nPoints = indices.Count();
+	m_points.SetCount( nPoints );
+	m_axes.SetCount( nPoints );
+
+	for ( int i = 0; i < nPoints; ++i )
+	{
+		m_points[ i ] = positions[ indices[ i ] ];
+	}
+
+	BuildRange( 0, nPoints );
+}
+
+
+//-----------------------------------------------------------------------------
+// Puts the median of [nStart, nEnd) along its widest axis in the middle
+//-----------------------------------------------------------------------------
+void CNearestPointTree::BuildRange( int nStart, int nEnd )
+{
+	if ( nEnd - nStart <= 0 )
+		return;
+
+	Vector vMins( m_points[ nStart ] );
+	Vector vMaxs( m_points[ nStart ] );
+	for ( int i = nStart + 1; i < nEnd; ++i )
+	{
+		VectorMin( vMins, m_points[ i ], vMins );
+		VectorMax( vMaxs, m_points[ i ], vMaxs );
+	}
+
+	const Vector vExtents( vMaxs - vMins );
+	int nAxis = vExtents.x >= vExtents.y ? 0 : 1;
+	if ( vExtents.z > vExtents[ nAxis ] )
+	{
+		nAxis = 2;
+	}
+
+	// Quickselect the median along the axis
+	const int nMid = ( nStart + nEnd ) / 2;
+	int nLeft = nStart;
+	int nRight = nEnd - 1;
+	while ( nLeft < nRight )
+	{
+		const float flPivot = m_points[ ( nLeft + nRight ) / 2 ][ nAxis ];
+		int i = nLeft;
+		int j = nRight;
+		while ( i <= j )
+		{
+			while ( m_points[ i ][ nAxis ] < flPivot )
+			{
+				++i;
+			}
+			while ( m_points[ j ][ nAxis ] > flPivot )
+			{
+				--j;
+			}
+			if ( i <= j )
+			{
+				V_swap( m_points[ i ], m_points[ j ] );
+				++i;
+				--j;
+			}
+		}
+
+		if ( nMid <= j )
+		{
+			nRight = j;
+		}
+		else if ( nMid >= i )
+		{
+			nLeft = i;
+		}
+		else
+		{
+			break;
+		}
+	}
+
+	m_axes[ nMid ] = nAxis;
+
+	BuildRange( nStart, nMid );
+	BuildRange( nMid + 1, nEnd );
+}
+
+
+//-----------------------------------------------------------------------------
+//
+//-----------------------------------------------------------------------------
+float CNearestPointTree::FindClosestDistSqr( const Vector &p ) const
+{
+	float flBestDistSqr = FLT_MAX;
+	FindClosest( 0, m_points.Count(), p, flBestDistSqr );
+	return flBestDistSqr;
+}
+
+
+//-----------------------------------------------------------------------------
+//
+//-----------------------------------------------------------------------------
+void CNearestPointTree::FindClosest( int nStart, int nEnd, const Vector &p, float &flBestDistSqr ) const
+{
+	if ( nEnd - nStart <= 0 )
+		return;
+
+	const int nMid = ( nStart + nEnd ) / 2;
+	const Vector &vMid = m_points[ nMid ];
+
+	const float flDistSqr = p.DistToSqr( vMid );
+	if ( flDistSqr < flBestDistSqr )
+	{
+		flBestDistSqr = flDistSqr;
+	}
+
+	// Search the side p is on first, the other only if it could hold anything closer
+	const float flPlaneDist = p[ m_axes[ nMid ] ] - vMid[ m_axes[ nMid ] ];
+	if ( flPlaneDist < 0.0f )
+	{
+		FindClosest( nStart, nMid, p, flBestDistSqr );
+		if ( flPlaneDist * flPlaneDist < flBestDistSqr )
+		{
+			FindClosest( nMid + 1, nEnd, p, flBestDistSqr );
+		}
+	}
+	else
+	{
+		FindClosest( nMid + 1, nEnd, p, flBestDistSqr );
+		if ( flPlaneDist * flPlaneDist < flBestDistSqr )
+		{
+			FindClosest( nStart, nMid, p, flBestDistSqr );
+		}
 	}
 }
 
 
 //-----------------------------------------------------------------------------
+// A vertex waiting to be settled by the geodesic feather
+//-----------------------------------------------------------------------------
+struct FeatherVert_t
+{
+	int m_nIndex;
+	float m_flDistance;
+};
+
+static bool FeatherVertLessFunc( const FeatherVert_t &lhs, const FeatherVert_t &rhs )
+{
+	// The priority queue keeps the greatest element at its head; we want the closest
+	return lhs.m_flDistance > rhs.m_flDistance;
+}
+
+
+//-----------------------------------------------------------------------------
+// Feathers the selection in a single pass outward from the selected vertices.
+// Each unselected vertex within fDistance of the selection which is connected
+// to it through other such vertices is added, weighted by the falloff of its
+// distance.
 //
+// METRIC_EUCLIDEAN measures the straight line distance to the closest selected
+// vertex, found with a k-d tree of the selection; it gives the same vertices &
+// weights as growing the selection a ring at a time. METRIC_GEODESIC measures
+// the length of the shortest path along mesh edges from any selected vertex.
 //-----------------------------------------------------------------------------
 template < int T >
 CDmeSingleIndexedComponent *CDmeMesh::FeatherSelection(
 	float fDistance, Distance_t distanceType,
-	CDmeSingleIndexedComponent *pSelection, CDmMeshComp *pPassedMeshComp )
+	CDmeSingleIndexedComponent *pSelection, CDmMeshComp *pPassedMeshComp, Metric_t metric )
 {
 	// TODO: Support feathering inward instead of just outward
 	if ( fDistance <= 0.0f || !pSelection )
 		return NULL;
 
+	CDmMeshComp *pMeshComp = pPassedMeshComp ? pPassedMeshComp : GetMeshComp();
+	CDmeVertexData *pBase = pMeshComp->BaseState();
+	if ( !pBase )
+		return NULL;
+
 	// Make a new CDmeSingleIndexedComponent to do all of the dirty work
 	CDmeSingleIndexedComponent *pNewSelection = CreateElement< CDmeSingleIndexedComponent >( "feather", pSelection->GetFileId() );
 	pSelection->CopyAttributesTo( pNewSelection );
 
-	CDmMeshComp *pMeshComp = pPassedMeshComp ? pPassedMeshComp : new CDmMeshComp( this );
-	CDmeVertexData *pBase = pMeshComp->BaseState();
-
 	if ( distanceType == DIST_RELATIVE )
 	{
 		Vector vCenter;
@@ -3725,51 +4814,117 @@ CDmeSingleIndexedComponent *CDmeMesh::FeatherSelection(
 	const CUtlVector< Vector > &positions( pBase->GetPositionData() );
 	const int nPositions = positions.Count();
 
-	if ( !pBase )
-		return NULL;
-
 	CUtlVector< int > sIndices;
+	pSelection->GetComponents( sIndices );
+
+	// Distance of each vertex from the selection, FLT_MAX until it is reached
+	CUtlVector< float > distances;
+	distances.SetCount( nPositions );
+	for ( int i = 0; i < nPositions; ++i )
+	{
+		distances[ i ] = FLT_MAX;
+	}
 
-	int insideCount = 0;
+	CUtlVector< bool > selected;
+	selected.SetCount( nPositions );
+	memset( selected.Base(), 0, nPositions * sizeof( bool ) );
 
-	CFalloff< T > falloff;
-	
-	do
+	CUtlVector< int > frontier;
+	for ( int i = 0; i < sIndices.Count(); ++i )
 	{
-		insideCount = 0;
-		CUtlVector< CDmMeshComp::CVert * > neighbours;
-		CSelectionHelper sHelper;
+		const int vIndex = sIndices[ i ];
+		if ( vIndex < 0 || vIndex >= nPositions )
+			continue;
+
+		selected[ vIndex ] = true;
+		distances[ vIndex ] = 0.0f;
+		frontier.AddToTail( vIndex );
+	}
+
+	CUtlVector< int > featherIndices;
+	CUtlVector< CDmMeshComp::CVert * > neighbours;
 
-		pNewSelection->GetComponents( sIndices );
-		int nVertices = sIndices.Count();
+	if ( metric == METRIC_GEODESIC )
+	{
+		CUtlPriorityQueue< FeatherVert_t > queue( 0, frontier.Count(), FeatherVertLessFunc );
+		for ( int i = 0; i < frontier.Count(); ++i )
+		{
+			FeatherVert_t v = { frontier[ i ], 0.0f };
+			queue.Insert( v );
+		}
 
-		for ( int i = 0; i < nVertices; ++i )
+		while ( queue.Count() > 0 )
 		{
-			const int nNeighbours = pMeshComp->FindNeighbouringVerts( sIndices[ i ], neighbours );
+			const FeatherVert_t v = queue.ElementAtHead();
+			queue.RemoveAtHead();
 
+			// Skip stale entries for vertices that were since reached by a shorter path
+			if ( v.m_flDistance > distances[ v.m_nIndex ] )
+				continue;
+
+			if ( !selected[ v.m_nIndex ] )
+			{
+				featherIndices.AddToTail( v.m_nIndex );
+			}
+
+			const int nNeighbours = pMeshComp->FindNeighbouringVerts( v.m_nIndex, neighbours );
 			for ( int j = 0; j < nNeighbours; ++j )
 			{
 				const int vIndex = neighbours[ j ]->Index();
-
-				if ( pNewSelection->HasComponent( vIndex ) )
+				if ( vIndex < 0 || vIndex >= nPositions )
 					continue;
 
-				const int closestVert = ClosestSelectedVertex( vIndex, pSelection, pBase );
-				if ( closestVert < 0 || closestVert >= nPositions )
+				const float flDistance = v.m_flDistance + positions[ v.m_nIndex ].DistTo( positions[ vIndex ] );
+				if ( flDistance <= fDistance && flDistance < distances[ vIndex ] )
+				{
+					distances[ vIndex ] = flDistance;
+					FeatherVert_t n = { vIndex, flDistance };
+					queue.Insert( n );
+				}
+			}
+		}
+	}
+	else
+	{
+		CNearestPointTree selectionTree;
+		selectionTree.Build( positions, frontier );
+
+		// Breadth first from the selection; a vertex's distance from the selection
+		// doesn't depend on how it was reached, so each one is only tested once
+		CUtlVector< bool > tested;
+		tested.CopyArray( selected.Base(), nPositions );
+
+		for ( int i = 0; i < frontier.Count(); ++i )
+		{
+			const int nNeighbours = pMeshComp->FindNeighbouringVerts( frontier[ i ], neighbours );
+			for ( int j = 0; j < nNeighbours; ++j )
+			{
+				const int vIndex = neighbours[ j ]->Index();
+				if ( vIndex < 0 || vIndex >= nPositions || tested[ vIndex ] )
 					continue;
 
-				const float vDistance = positions[ vIndex ].DistTo( positions[ closestVert ] );
-				if ( vDistance <= fDistance )
+				tested[ vIndex ] = true;
+
+				const float flDistance = sqrtf( selectionTree.FindClosestDistSqr( positions[ vIndex ] ) );
+				if ( flDistance <= fDistance )
 				{
-					sHelper.AddVert( vIndex, falloff( vDistance / fDistance ) );
-					++insideCount;
+					distances[ vIndex ] = flDistance;
+					frontier.AddToTail( vIndex );
+					featherIndices.AddToTail( vIndex );
 				}
 			}
 		}
+	}
 
-		sHelper.AddToSelection( pNewSelection );
+	// Add the feathered vertices in index order
+	featherIndices.Sort( DeltaStateUsageLessFunc );
 
-	} while ( insideCount > 0 );
+	CFalloff< T > falloff;
+	for ( int i = 0; i < featherIndices.Count(); ++i )
+	{
+		const int vIndex = featherIndices[ i ];
+		pNewSelection->AddComponent( vIndex, falloff( distances[ vIndex ] / fDistance ) );
+	}
 
 	return pNewSelection;
 }
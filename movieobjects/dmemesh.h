@@ -64,6 +64,8 @@ DEFINE_ELEMENT( CDmeMesh, CDmeShape );
 public:
 	// resolve internal data from changed attributes
 	virtual void OnAttributeChanged( CDmAttribute *pAttribute );
+	virtual void OnAttributeArrayElementAdded( CDmAttribute *pAttribute, int nFirstElem, int nLastElem );
+	virtual void OnAttributeArrayElementRemoved( CDmAttribute *pAttribute, int nFirstElem, int nLastElem );
 
 	void GetBoundingSphere( Vector &c, float &r, CDmeVertexData *pPassedBase, CDmeSingleIndexedComponent *pPassedSelection ) const;
 
@@ -176,7 +178,18 @@ public:
 		DIST_DEFAULT
 	};
 
-	CDmeSingleIndexedComponent *FeatherSelection( float falloffDistance, Falloff_t falloffType, Distance_t distanceType, CDmeSingleIndexedComponent *pSelection, CDmMeshComp *pPassedMeshComp );
+	// How FeatherSelection measures the distance of a vertex from the selection
+	enum Metric_t
+	{
+		METRIC_EUCLIDEAN = 0,	// Straight line distance to the closest selected vertex
+		METRIC_GEODESIC			// Shortest path along mesh edges from any selected vertex
+	};
+
+	CDmeSingleIndexedComponent *FeatherSelection( float falloffDistance, Falloff_t falloffType, Distance_t distanceType, CDmeSingleIndexedComponent *pSelection, CDmMeshComp *pPassedMeshComp, Metric_t metric = METRIC_EUCLIDEAN );
+
+	// Returns the topology of the current base state, owned by the mesh. It is built on first
+	// use and rebuilt when the base state or the topology changes.
+	CDmMeshComp *GetMeshComp();
 
 	// Computes new normal deltas for all states based on position deltas
 	void ComputeDeltaStateNormals();
@@ -220,13 +233,6 @@ private:
 		bool m_bBuilt;
 	};
 
-	struct Triangle_t
-	{
-		int m_nIndex[3];
-		Vector m_vecTangentS;
-		Vector m_vecTangentT;
-	};
-
 	struct RenderVertexDelta_t
 	{
 		Vector m_vecDeltaPosition;
@@ -236,6 +242,34 @@ private:
 		float m_flDeltaWrinkle;
 	};
 
+	// One field of a delta state packed for BuildDeltaMesh. Component values
+	// are stored in separate arrays, zero-padded to a multiple of four deltas
+	struct PackedDeltaField_t
+	{
+		bool m_bValid;							// false if the delta or bind state lacks the field
+		int m_nMaxIndex;						// largest render delta index written
+		CUtlVector< int > m_Indices;			// render delta index of each delta
+		CUtlVector< float > m_Data[3];
+		CUtlVector< float > m_Balance;			// right amount of each delta, empty without balance data
+		CUtlVector< float > m_Speed;			// morph speed of each delta, empty without morph speeds
+	};
+
+	// A delta state packed for BuildDeltaMesh, see GetPackedDeltaState
+	struct PackedDeltaState_t
+	{
+		PackedDeltaState_t() : m_nSerialNumber( 0 ), m_nBindSerialNumber( 0 ) {}
+
+		int m_nSerialNumber;					// of the delta state when packed
+		int m_nBindSerialNumber;				// of the bind state when packed
+		PackedDeltaField_t m_Position;
+		PackedDeltaField_t m_Normal;
+		PackedDeltaField_t m_Wrinkle;
+		CUtlVector< int > m_TexCoordIndices;
+		CUtlVector< Vector2D > m_TexCoordDeltas;	// V already flipped if need be
+		CUtlVector< int > m_ColorIndices;
+		CUtlVector< Vector4D > m_ColorDeltas;
+	};
+
 	VertexFormat_t ComputeHwMeshVertexFormat( void );
 	IMorph *CreateHwMorph( IMaterial *pMTL );
 	IMesh *CreateHwMesh( CDmeFaceSet *pFaceSet );
@@ -243,33 +277,32 @@ private:
 	// Draws the mesh when it uses too many bones
 	void DrawDynamicMesh( CDmeFaceSet *pFaceSet, matrix3x4_t *pPoseToWorld, bool bHasActiveDeltaStates, CDmeDrawSettings *pDrawSettings = NULL );
 
-	// Build a map from vertex index to a list of triangles that share the vert.
-	void BuildTriangleMap( const CDmeVertexData *pBaseState, CDmeFaceSet* pFaceSet, CUtlVector<Triangle_t>& triangles, CUtlVector< CUtlVector<int> >* pVertToTriMap = NULL );
-
-	// Computes tangent space data for triangles
-	void ComputeTriangleTangets( const CDmeVertexData *pVertexData, CUtlVector<Triangle_t>& triangles );
-
-	// Build a map from vertex index to a list of triangles that share the vert.
-	void ComputeAverageTangent( CDmeVertexData *pVertexData, bool bSmoothTangents, CUtlVector< CUtlVector<int> >& vertToTriMap, CUtlVector<Triangle_t>& triangles );
-
 	// Do we have active delta state data?
 	bool HasActiveDeltaStates() const;
 
 	// Adds deltas into a delta mesh
 	template< class T > bool AddVertexDelta( CDmeVertexData *pBaseState, void *pVertexData, int nStride, CDmeVertexDataBase::StandardFields_t fieldId, int nIndex, bool bDoLag );
 	template< class T > bool AddStereoVertexDelta( CDmeVertexData *pBaseState, void *pVertexData, int nStride, CDmeVertexDataBase::StandardFields_t fieldId, int nIndex, bool bDoLag );
-	void AddTexCoordDelta( RenderVertexDelta_t *pRenderDelta, float flWeight, CDmeVertexDeltaData *pDeltaState );
-	void AddColorDelta( RenderVertexDelta_t *pRenderDelta, float flWeight, CDmeVertexDeltaData *pDeltaState );
 
-	// Builds deltas based on the current deltas, returns true if there was delta wrinkle data
-	bool BuildDeltaMesh( int nVertices, RenderVertexDelta_t *pDelta );
+	// Packs delta states for BuildDeltaMesh
+	template< class T > void PackDeltaField( PackedDeltaField_t &field, CDmeVertexData *pBindState, CDmeVertexDeltaData *pDeltaState, CDmeVertexDataBase::StandardFields_t fieldId, int nComponentCount );
+	const PackedDeltaState_t &GetPackedDeltaState( int nDeltaIndex, CDmeVertexData *pBindState );
 
-	// Builds a map from vertex index to all triangles that use it
-	void BuildVertToTriMap( const CDmeVertexData *pVertexData, CUtlVector<Triangle_t> &triangles, CUtlVector< CUtlVector<int> > &vertToTriMap );
+	// Adds a packed delta field, scaled by the weights of its delta state, into m_RenderDelta
+	void AccumulatePackedDeltaField( const PackedDeltaField_t &field, int nOffset, int nComponentCount, const Vector2D &weight, const Vector2D &laggedWeight, bool bDoLag );
+
+	// Builds deltas based on the current deltas into m_RenderDelta, returns true if there was delta wrinkle data
+	bool BuildDeltaMesh( int nVertices );
 
 	// Compute the dimensionality of the delta state (how many inputs affect it)
 	int ComputeDeltaStateDimensionality( int nDeltaIndex );
 
+	// Brings the delta state name index up to date with m_DeltaStates
+	void UpdateDeltaStateIndex() const;
+
+	// Returns the index slot holding the canonical name, or the empty slot where it belongs
+	int &FindDeltaStateSlot( const char *pCanonicalName ) const;
+
 	// Discovers the atomic controls used by the various delta states 
 	void BuildAtomicControlLists( int nCount, DeltaComputation_t *pInfo, CUtlVector< CUtlVector< int > > &deltaStateUsage );
 
@@ -396,7 +429,7 @@ private:
 
 	// Feather's the selection by a specified amount, creates a new CDmeSingleIndexedComponent or NULL if error
 	template < int T >
-	CDmeSingleIndexedComponent *FeatherSelection( float fFalloffDistance, Distance_t distanceType, CDmeSingleIndexedComponent *pSelection, CDmMeshComp *pPassedMeshComp );
+	CDmeSingleIndexedComponent *FeatherSelection( float fFalloffDistance, Distance_t distanceType, CDmeSingleIndexedComponent *pSelection, CDmMeshComp *pPassedMeshComp, Metric_t metric );
 
 	bool CreateDeltaFieldFromBaseField( CDmeVertexData::StandardFields_t nStandardFieldIndex, const CDmrArrayConst< float > &baseArray, const CDmrArrayConst< float > &bindArray, CDmeVertexDeltaData *pDelta );
 	bool CreateDeltaFieldFromBaseField( CDmeVertexData::StandardFields_t nStandardFieldIndex, const CDmrArrayConst< Vector2D > &baseArray, const CDmrArrayConst< Vector2D > &bindArray, CDmeVertexDeltaData *pDelta );
@@ -423,8 +456,6 @@ private:
 
 	void DrawWireframeFaceSet( CDmeFaceSet *pFaceSet, matrix3x4_t *pPoseToWorld, bool bHasActiveDeltaStates, CDmeDrawSettings *pDrawSettings );
 
-	void ComputeNormalsFromPositions( CDmeVertexData *pBase, const Vector *pPosition, const CUtlVector<Triangle_t> &triangles, int nNormalCount, Vector *pNormals );
-
 	CDmaElement< CDmeVertexData > m_BindBaseState;
 	CDmaElement< CDmeVertexData > m_CurrentBaseState;
 	CDmaElementArray< CDmeVertexData > m_BaseStates;
@@ -436,6 +467,25 @@ private:
 
 	// Cached-off map of fields->
 	CUtlVector< FaceSet_t > m_hwFaceSets;
+
+	// Cached topology, see GetMeshComp()
+	CDmMeshComp *m_pMeshComp;
+	bool m_bMeshCompDirty;
+
+	// Delta state indices hashed by canonical name, see FindDeltaStateIndex(). The table
+	// size is a power of two and it is kept at most half full. Appended delta states are
+	// added as they are found; anything else rebuilds the index
+	mutable CUtlVector< DmElementHandle_t > m_IndexedDeltaStates;
+	mutable CUtlVector< CUtlString > m_IndexedDeltaStateNames;
+	mutable CUtlVector< int > m_DeltaStateHash;
+	mutable bool m_bDeltaStateIndexDirty;	// a delta state was renamed, removed or moved
+
+	// Delta states packed for rendering, and the render deltas built from them. Only
+	// the render deltas touched by the last BuildDeltaMesh are non-zero
+	CUtlVector< PackedDeltaState_t > m_PackedDeltaStates;
+	CUtlVector< RenderVertexDelta_t > m_RenderDelta;
+	CUtlVector< bool > m_RenderDeltaTouched;
+	CUtlVector< int > m_TouchedRenderDeltas;
 	
 	// Normal rendering materials
 	static bool s_bNormalMaterialInitialized;
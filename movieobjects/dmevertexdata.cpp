@@ -59,9 +59,12 @@ IMPLEMENT_ELEMENT_FACTORY( DmeVertexDataBase, CDmeVertexDataBase );
 //-----------------------------------------------------------------------------
 // Purpose: 
 //-----------------------------------------------------------------------------
+int CDmeVertexDataBase::s_nNextSerialNumber = 0;
+
 void CDmeVertexDataBase::OnConstruction()
 {
 	m_nVertexCount = 0;
+	m_nSerialNumber = ++s_nNextSerialNumber;
 	memset( m_pStandardFieldIndex, 0xFF, sizeof(m_pStandardFieldIndex) );
 	m_VertexFormat.Init( this, "vertexFormat" );
 
@@ -183,6 +186,9 @@ void CDmeVertexDataBase::Resolve()
 {
 	BaseClass::Resolve();
 
+	// We're only resolved when some attribute has changed
+	m_nSerialNumber = ++s_nNextSerialNumber;
+
 	if ( m_VertexFormat.IsDirty() )
 	{
 		ComputeFieldInfo();
@@ -866,6 +872,9 @@ void CDmeVertexData::OnDestruction()
 void CDmeVertexDeltaData::OnConstruction()
 {
 	m_bCorrected.InitAndSet( this, "corrected", false );
+
+	// See OnAttributeChanged
+	GetAttribute( "name" )->AddFlag( FATTRIB_HAS_CALLBACK );
 }
 
 void CDmeVertexDeltaData::OnDestruction()
@@ -873,6 +882,20 @@ void CDmeVertexDeltaData::OnDestruction()
 }
 
 
+//-----------------------------------------------------------------------------
+// Meshes index their delta states by name, so tell them about renames
+//-----------------------------------------------------------------------------
+void CDmeVertexDeltaData::OnAttributeChanged( CDmAttribute *pAttribute )
+{
+	BaseClass::OnAttributeChanged( pAttribute );
+
+	if ( pAttribute == GetAttribute( "name" ) )
+	{
+		InvokeOnAttributeChangedOnReferrers( GetHandle(), pAttribute );
+	}
+}
+
+
 //-----------------------------------------------------------------------------
 // Method to add vertex indices for normal vertex data
 //-----------------------------------------------------------------------------
@@ -56,6 +56,10 @@ public:
 	// resolve internal data from changed attributes
 	virtual void Resolve();
 
+	// Returns a number which changes whenever the vertex data does; no two
+	// vertex data elements ever share a serial number
+	int GetSerialNumber() const;
+
 	// Returns the number of joints per vertex
 	int JointCount() const;
 
@@ -190,6 +194,9 @@ protected:
 	CUtlVector< FieldInfo_t > m_FieldInfo;
 	FieldIndex_t m_pStandardFieldIndex[STANDARD_FIELD_COUNT];
 	int m_nVertexCount;
+	int m_nSerialNumber;
+
+	static int s_nNextSerialNumber;
 };
 
 
@@ -221,6 +228,15 @@ inline int CDmeVertexDataBase::VertexCount() const
 }
 
 
+//-----------------------------------------------------------------------------
+// Returns a number which changes whenever the vertex data does
+//-----------------------------------------------------------------------------
+inline int CDmeVertexDataBase::GetSerialNumber() const
+{
+	return m_nSerialNumber;
+}
+
+
 //-----------------------------------------------------------------------------
 // Returns the number of joints per vertex
 //-----------------------------------------------------------------------------
@@ -323,6 +339,8 @@ public:
 	// The maximum distance any vertex is moved is returned
 	float GenerateWeightDelta( CDmeVertexData *pBindState );
 
+	virtual void OnAttributeChanged( CDmAttribute *pAttribute );
+
 protected:
 	CDmaVar< bool > m_bCorrected;
 
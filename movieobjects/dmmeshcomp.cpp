@@ -22,8 +22,22 @@
 CDmMeshComp::CDmMeshComp( CDmeMesh *pMesh, CDmeVertexData *pPassedBase )
 : m_pMesh( pMesh )
 , m_pBase( NULL )
+, m_bVertFaceTableDirty( true )
+, m_nBaseSerialNumber( 0 )
 {
 	m_pBase = pPassedBase ? pPassedBase : pMesh->GetCurrentBaseState();
+	if ( m_pBase )
+	{
+		m_nBaseSerialNumber = m_pBase->GetSerialNumber();
+	}
+
+	const int nFaceSets = m_pMesh->FaceSetCount();
+	m_faceSetSerialNumbers.SetCount( nFaceSets );
+	for ( int i = 0; i < nFaceSets; ++i )
+	{
+		m_faceSetSerialNumbers[ i ] = m_pMesh->GetFaceSet( i )->GetSerialNumber();
+	}
+
 	if ( !m_pBase )
 		return;
 
@@ -38,6 +52,8 @@ CDmMeshComp::CDmMeshComp( CDmeMesh *pMesh, CDmeVertexData *pPassedBase )
 	if ( nVertices <= 0 )
 		return;
 
+	m_vertsByIndex.EnsureCapacity( nVertices );
+
 	// Create vertices
 	for ( int i = 0; i < nVertices; ++i )
 	{
@@ -119,6 +135,8 @@ CDmMeshComp::CVert::CVert()
 : m_index( -1 )
 , m_pVertexIndices( NULL )
 , m_pPosition( NULL )
+, m_pFirstEdge( NULL )
+, m_pLastEdge( NULL )
 {
 }
 
@@ -166,7 +184,10 @@ CDmMeshComp::CEdge::CEdge()
 : m_pVert0( NULL )
 , m_pVert1( NULL )
 , m_faceCount( 0 )
+, m_nIndex( -1 )
 {
+	m_pNextEdge[ 0 ] = NULL;
+	m_pNextEdge[ 1 ] = NULL;
 }
 
 
@@ -234,6 +255,26 @@ CDmMeshComp::CVert *CDmMeshComp::CreateVert( int nIndex, const CUtlVector< int >
 	pVert->m_pVertexIndices = &vertexIndices;
 	pVert->m_pPosition = &vert;
 
+	// The first vertex created with an index is the one found by it
+	if ( nIndex >= 0 )
+	{
+		if ( nIndex >= m_vertsByIndex.Count() )
+		{
+			const int nOldCount = m_vertsByIndex.Count();
+			m_vertsByIndex.SetCount( nIndex + 1 );
+			for ( int i = nOldCount; i <= nIndex; ++i )
+			{
+				m_vertsByIndex[ i ] = NULL;
+			}
+		}
+
+		if ( !m_vertsByIndex[ nIndex ] )
+		{
+			m_vertsByIndex[ nIndex ] = pVert;
+			m_bVertFaceTableDirty = true;
+		}
+	}
+
 	return pVert;
 }
 
@@ -259,6 +300,25 @@ CDmMeshComp::CEdge *CDmMeshComp::FindOrCreateEdge( int vIndex0, int vIndex1, boo
 
 	pEdge->m_pVert0 = pVert0;
 	pEdge->m_pVert1 = pVert1;
+	pEdge->m_nIndex = m_edges.Count() - 1;
+
+	// Append the edge to the chains of both of its vertices
+	for ( int i = 0; i < 2; ++i )
+	{
+		CVert *pVert = i == 0 ? pVert0 : pVert1;
+		if ( i == 1 && pVert1 == pVert0 )
+			break;
+
+		if ( pVert->m_pLastEdge )
+		{
+			pVert->m_pLastEdge->m_pNextEdge[ pVert->m_pLastEdge->m_pVert0 == pVert ? 0 : 1 ] = pEdge;
+		}
+		else
+		{
+			pVert->m_pFirstEdge = pEdge;
+		}
+		pVert->m_pLastEdge = pEdge;
+	}
 
 	if ( pReverse )
 	{
@@ -274,26 +334,29 @@ CDmMeshComp::CEdge *CDmMeshComp::FindOrCreateEdge( int vIndex0, int vIndex1, boo
 //-----------------------------------------------------------------------------
 CDmMeshComp::CEdge *CDmMeshComp::FindEdge( int vIndex0, int vIndex1, bool *pReverse /* = NULL */ )
 {
-	for ( int ei( m_edges.Head() ); ei != m_edges.InvalidIndex(); ei = m_edges.Next( ei ) )
-	{
-		CEdge &e( m_edges[ ei ] );
+	CVert *pVert0 = FindVert( vIndex0 );
+	if ( !pVert0 )
+		return NULL;
 
-		if ( e.GetVertIndex( 0 ) == vIndex0 && e.GetVertIndex( 1 ) == vIndex1 )
+	// Edges are chained in creation order, so this finds the same edge a search of m_edges would
+	for ( CEdge *pEdge = pVert0->m_pFirstEdge; pEdge; pEdge = pEdge->NextEdge( pVert0 ) )
+	{
+		if ( pEdge->GetVertIndex( 0 ) == vIndex0 && pEdge->GetVertIndex( 1 ) == vIndex1 )
 		{
 			if ( pReverse )
 			{
 				*pReverse = false;
 			}
-			return &e;
+			return pEdge;
 		}
 
-		if ( e.GetVertIndex( 1 ) == vIndex0 && e.GetVertIndex( 0 ) == vIndex1 )
+		if ( pEdge->GetVertIndex( 1 ) == vIndex0 && pEdge->GetVertIndex( 0 ) == vIndex1 )
 		{
 			if ( pReverse )
 			{
 				*pReverse = true;
 			}
-			return &e;
+			return pEdge;
 		}
 	}
 
@@ -306,14 +369,10 @@ CDmMeshComp::CEdge *CDmMeshComp::FindEdge( int vIndex0, int vIndex1, bool *pReve
 //-----------------------------------------------------------------------------
 CDmMeshComp::CVert *CDmMeshComp::FindVert( int vIndex )
 {
-	for ( int vi( m_verts.Head() ); vi != m_verts.InvalidIndex(); vi = m_verts.Next( vi ) )
-	{
-		CVert &v( m_verts[ vi ] );
-		if ( vIndex == v.Index() )
-			return &v;
-	}
+	if ( vIndex < 0 || vIndex >= m_vertsByIndex.Count() )
+		return NULL;
 
-	return NULL;
+	return m_vertsByIndex[ vIndex ];
 }
 
 
@@ -338,10 +397,83 @@ CDmMeshComp::CFace *CDmMeshComp::CreateFace( const CUtlVector< CVert * > &verts,
 		edges[ nEdgeIndex ]->m_faceCount += 1;
 	}
 
+	m_bVertFaceTableDirty = true;
+
 	return pFace;
 }
 
 
+//-----------------------------------------------------------------------------
+// Builds the table of faces using each vertex, each face listed once per vertex
+//-----------------------------------------------------------------------------
+void CDmMeshComp::BuildVertFaceTable()
+{
+	const int nVerts = m_vertsByIndex.Count();
+
+	// Count the faces using each vertex
+	m_vertFaceStart.SetCount( nVerts + 1 );
+	memset( m_vertFaceStart.Base(), 0, m_vertFaceStart.Count() * sizeof( int ) );
+
+	int nTotal = 0;
+	for ( int fi( m_faces.Head() ); fi != m_faces.InvalidIndex(); fi = m_faces.Next( fi ) )
+	{
+		const CFace &face( m_faces[ fi ] );
+		for ( int i = 0; i < face.m_verts.Count(); ++i )
+		{
+			const int vIndex = face.m_verts[ i ]->Index();
+			if ( vIndex >= 0 && vIndex < nVerts )
+			{
+				++m_vertFaceStart[ vIndex + 1 ];
+				++nTotal;
+			}
+		}
+	}
+
+	for ( int i = 0; i < nVerts; ++i )
+	{
+		m_vertFaceStart[ i + 1 ] += m_vertFaceStart[ i ];
+	}
+
+	// Fill it in face order. A vertex used twice by a face sees that face twice in a row.
+	CUtlVector< int > vertFaceEnd;
+	vertFaceEnd.CopyArray( m_vertFaceStart.Base(), nVerts );
+
+	m_vertFaces.SetCount( nTotal );
+	for ( int fi( m_faces.Head() ); fi != m_faces.InvalidIndex(); fi = m_faces.Next( fi ) )
+	{
+		CFace *pFace( &m_faces[ fi ] );
+		for ( int i = 0; i < pFace->m_verts.Count(); ++i )
+		{
+			const int vIndex = pFace->m_verts[ i ]->Index();
+			if ( vIndex < 0 || vIndex >= nVerts )
+				continue;
+
+			int &nEnd = vertFaceEnd[ vIndex ];
+			if ( nEnd > m_vertFaceStart[ vIndex ] && m_vertFaces[ nEnd - 1 ] == pFace )
+				continue;
+
+			m_vertFaces[ nEnd++ ] = pFace;
+		}
+	}
+
+	// Close up the gaps left by the duplicates
+	int nOut = 0;
+	for ( int i = 0; i < nVerts; ++i )
+	{
+		const int nStart = m_vertFaceStart[ i ];
+		m_vertFaceStart[ i ] = nOut;
+		for ( int j = nStart; j < vertFaceEnd[ i ]; ++j )
+		{
+			m_vertFaces[ nOut++ ] = m_vertFaces[ j ];
+		}
+	}
+	m_vertFaceStart[ nVerts ] = nOut;
+	m_vertFaces.RemoveMultipleFromTail( nTotal - nOut );
+
+	m_bVertFaceTableDirty = false;
+}
+
+
 //-----------------------------------------------------------------------------
 //
 //-----------------------------------------------------------------------------
@@ -349,13 +481,13 @@ int CDmMeshComp::FindEdgesWithVert( int vIndex, CUtlVector< CEdge * > &edges )
 {
 	edges.RemoveAll();
 
-	for ( int ei( m_edges.Head() ); ei != m_edges.InvalidIndex(); ei = m_edges.Next( ei ) )
+	CVert *pVert = FindVert( vIndex );
+	if ( !pVert )
+		return 0;
+
+	for ( CEdge *pEdge = pVert->m_pFirstEdge; pEdge; pEdge = pEdge->NextEdge( pVert ) )
 	{
-		CEdge &e( m_edges[ ei ] );
-		if ( e.GetVertIndex( 0 ) == vIndex || e.GetVertIndex( 1 ) == vIndex )
-		{
-			edges.AddToTail( &e );
-		}
+		edges.AddToTail( pEdge );
 	}
 
 	return edges.Count();
@@ -369,19 +501,17 @@ int CDmMeshComp::FindFacesWithVert( int vIndex, CUtlVector< CFace * > &faces )
 {
 	faces.RemoveAll();
 
-	for ( int fi( m_faces.Head() ); fi != m_faces.InvalidIndex(); fi = m_faces.Next( fi ) )
+	if ( vIndex < 0 || vIndex >= m_vertsByIndex.Count() )
+		return 0;
+
+	if ( m_bVertFaceTableDirty )
 	{
-		CFace &face( m_faces[ fi ] );
-		for ( int i = 0; i < face.m_verts.Count(); ++i )
-		{
-			if ( face.m_verts[ i ]->Index() == vIndex )
-			{
-				faces.AddToTail( &face );
-				break;
-			}
-		}
+		BuildVertFaceTable();
 	}
 
+	const int nStart = m_vertFaceStart[ vIndex ];
+	faces.AddMultipleToTail( m_vertFaceStart[ vIndex + 1 ] - nStart, m_vertFaces.Base() + nStart );
+
 	return faces.Count();
 }
 
@@ -393,19 +523,19 @@ int CDmMeshComp::FindNeighbouringVerts( int vIndex, CUtlVector< CVert * > &verts
 {
 	verts.RemoveAll();
 
-	CUtlVector< CEdge * > edges;
-	const int nEdges = FindEdgesWithVert( vIndex, edges );
+	CVert *pVert = FindVert( vIndex );
+	if ( !pVert )
+		return 0;
 
-	for ( int i = 0; i < nEdges; ++i )
+	for ( CEdge *pEdge = pVert->m_pFirstEdge; pEdge; pEdge = pEdge->NextEdge( pVert ) )
 	{
-		CEdge &e( *edges[ i ] );
-		if ( e.GetVertIndex( 0 ) == vIndex )
+		if ( pEdge->GetVertIndex( 0 ) == vIndex )
 		{
-			verts.AddToTail( e.GetVert( 1 ) );
+			verts.AddToTail( pEdge->GetVert( 1 ) );
 		}
 		else
 		{
-			verts.AddToTail( e.GetVert( 0 ) );
+			verts.AddToTail( pEdge->GetVert( 0 ) );
 		}
 	}
 
@@ -414,7 +544,8 @@ int CDmMeshComp::FindNeighbouringVerts( int vIndex, CUtlVector< CVert * > &verts
 
 
 //-----------------------------------------------------------------------------
-// Find all edges that are only used by 1 face
+// Find all edges that are only used by 1 face, grouped into sets of edges
+// connected to each other through shared vertices
 //-----------------------------------------------------------------------------
 int CDmMeshComp::GetBorderEdges( CUtlVector< CUtlVector< CEdge * > > &borderEdgesList )
 {
@@ -422,76 +553,66 @@ int CDmMeshComp::GetBorderEdges( CUtlVector< CUtlVector< CEdge * > > &borderEdge
 
 	borderEdgesList.RemoveAll();
 
-	bool connected;
+	CUtlVector< bool > visited;
+	visited.SetCount( m_edges.Count() );
+	memset( visited.Base(), 0, visited.Count() * sizeof( bool ) );
 
+	// Groups are started in edge creation order, each one by flood filling
+	// along the vertex chains from its first edge
 	for ( int ei( m_edges.Head() ); ei != m_edges.InvalidIndex(); ei = m_edges.Next( ei ) )
 	{
 		CEdge *pEdge( &m_edges[ ei ] );
-		if ( pEdge->IsBorderEdge() )
-		{
-			++retVal;
-			connected = false;
+		if ( !pEdge->IsBorderEdge() || visited[ pEdge->m_nIndex ] )
+			continue;
+
+		CUtlVector< CEdge * > &borderEdges = borderEdgesList[ borderEdgesList.AddToTail() ];
+		borderEdges.AddToTail( pEdge );
+		visited[ pEdge->m_nIndex ] = true;
 
-			for ( int i = borderEdgesList.Count() - 1; !connected && i >= 0; --i )
+		for ( int i = 0; i < borderEdges.Count(); ++i )
+		{
+			CEdge *pBorderEdge = borderEdges[ i ];
+			for ( int j = 0; j < 2; ++j )
 			{
-				CUtlVector< CEdge * > &borderEdges = borderEdgesList[ i ];
-				for ( int j = borderEdges.Count() - 1; j >= 0; --j )
+				CVert *pVert = pBorderEdge->GetVert( j );
+				for ( CEdge *pNext = pVert->m_pFirstEdge; pNext; pNext = pNext->NextEdge( pVert ) )
 				{
-					if ( borderEdges[ j ]->ConnectedTo( pEdge ) )
+					if ( pNext->IsBorderEdge() && !visited[ pNext->m_nIndex ] )
 					{
-						borderEdges.AddToTail( pEdge );
-						connected = true;
-						break;
+						visited[ pNext->m_nIndex ] = true;
+						borderEdges.AddToTail( pNext );
 					}
 				}
 			}
-
-			if ( !connected )
-			{
-				CUtlVector< CEdge * > &borderEdges = borderEdgesList[ borderEdgesList.AddToTail() ];
-				borderEdges.AddToTail( pEdge );
-			}
 		}
+
+		retVal += borderEdges.Count();
 	}
 
-	// Shrink the borderEdgesList to minimum number required
+	return retVal;
+}
 
-	bool anyConnected = false;
-	do 
-	{
-		anyConnected = false;
 
-		for ( int i = borderEdgesList.Count() - 1; i >= 0; --i )
-		{
-			CUtlVector< CEdge * > &srcBorderEdges = borderEdgesList[ i ];
-			for ( int j = srcBorderEdges.Count() - 1; j >= 0; --j )
-			{
-				CEdge *pSrcEdge = srcBorderEdges[ j ];
-				connected = false;
+//-----------------------------------------------------------------------------
+// Returns true if the mesh's current base state & face sets are the ones this
+// was built from. Vertex data & face sets take a new, never reused, serial
+// number whenever they change, so this never compares memory addresses.
+//-----------------------------------------------------------------------------
+bool CDmMeshComp::IsCurrent() const
+{
+	const CDmeVertexData *pBase = m_pMesh->GetCurrentBaseState();
+	if ( ( pBase ? pBase->GetSerialNumber() : 0 ) != m_nBaseSerialNumber )
+		return false;
 
-				for ( int k = 0; !connected && k < i; ++k )
-				{
-					CUtlVector< CEdge * > &dstBorderEdges = borderEdgesList[ k ];
-					for ( int l = dstBorderEdges.Count() - 1; l >= 0; --l )
-					{
-						if ( dstBorderEdges[ l ]->ConnectedTo( pSrcEdge ) )
-						{
-							connected = true;
-							anyConnected = true;
-							dstBorderEdges.AddToTail( pSrcEdge );
-							srcBorderEdges.Remove( j );
-							break;
-						}
-					}
-				}
-			}
+	const int nFaceSets = m_pMesh->FaceSetCount();
+	if ( nFaceSets != m_faceSetSerialNumbers.Count() )
+		return false;
 
-			if ( srcBorderEdges.Count() == 0 )
-			{
-				borderEdgesList.Remove( i );
-			}
-		}
-	} while( anyConnected );
+	for ( int i = 0; i < nFaceSets; ++i )
+	{
+		if ( m_pMesh->GetFaceSet( i )->GetSerialNumber() != m_faceSetSerialNumbers[ i ] )
+			return false;
+	}
 
-	return retVal;
-}
\ No newline at end of file
+	return true;
+}
@@ -26,6 +26,12 @@ class CDmeVertexData;
 //=============================================================================
 // TODO: This works in the local space of the mesh... add option to transform
 // the positions into world space
+//
+// Each edge is threaded onto a chain at each of its two vertices, so the
+// edges around a vertex are found in O(valence) and the edge between two
+// vertices by walking one of the chains. Vertices are indexed by position
+// index and the faces using each vertex are kept in a flat table, which is
+// rebuilt on demand after faces are added.
 //=============================================================================
 class CDmMeshComp
 {
@@ -51,6 +57,8 @@ public:
 		int m_index;								// Index in the position data
 		const CUtlVector< int > *m_pVertexIndices;	// Pointer to a list of the vertex indices for this vertex
 		const Vector *m_pPosition;
+		CEdge *m_pFirstEdge;						// Chain of the edges using this vertex, in creation order
+		CEdge *m_pLastEdge;
 	};
 
 	class CEdge
@@ -74,9 +82,14 @@ public:
 	protected:
 		friend class CDmMeshComp;
 
+		// Returns the next edge in the chain of edges using the specified vertex of this edge
+		CEdge *NextEdge( const CVert *pVert ) const { return m_pNextEdge[ pVert == m_pVert0 ? 0 : 1 ]; }
+
 		CVert *m_pVert0;
 		CVert *m_pVert1;
 		int m_faceCount;
+		int m_nIndex;				// Creation order of this edge
+		CEdge *m_pNextEdge[ 2 ];	// Next edges in the chains of m_pVert0 & m_pVert1
 	};
 
 	class CFace
@@ -110,11 +123,24 @@ public:
 
 	int GetBorderEdges( CUtlVector< CUtlVector< CEdge * > > &borderEdges );
 
+	// Returns true if the mesh's current base state & face sets are the ones this was built from
+	bool IsCurrent() const;
+
 	CDmeMesh *m_pMesh;
 	CDmeVertexData *m_pBase;
 	CUtlFixedLinkedList< CVert > m_verts;
 	CUtlFixedLinkedList< CEdge > m_edges;
 	CUtlFixedLinkedList< CFace > m_faces;
+
+protected:
+	void BuildVertFaceTable();
+
+	CUtlVector< CVert * > m_vertsByIndex;		// Vertices by position index
+	CUtlVector< int > m_vertFaceStart;			// Start of each vertex's faces in m_vertFaces, by position index
+	CUtlVector< CFace * > m_vertFaces;
+	bool m_bVertFaceTableDirty;
+	int m_nBaseSerialNumber;					// Serial number of the base state when built, 0 if none
+	CUtlVector< int > m_faceSetSerialNumbers;	// Serial numbers of the mesh's face sets when built
 };
 
 
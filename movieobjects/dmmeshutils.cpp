@@ -21,6 +21,8 @@
 #include "tier1/utlstring.h"
 #include "tier1/utlstringmap.h"
 #include "tier1/utlbuffer.h"
+#include "tier1/utlmap.h"
+#include "vstdlib/jobthread.h"
 #include "filesystem.h"
 
 
@@ -837,6 +839,39 @@ const int *CDmMeshUtils::BuildDataMirrorMap( CDmeVertexData *pBase, int axis, CD
 }
 
 
+//-----------------------------------------------------------------------------
+// The mirrored data of one field of a delta state, computed by
+// ComputeMirrorDelta() and written to the delta state by ApplyMirrorDelta()
+//-----------------------------------------------------------------------------
+struct MirrorDeltaField_t
+{
+	FieldIndex_t m_nField;
+	DmAttributeType_t m_nType;
+	int m_nOrigCount;					// Data count of the field before mirroring
+	int m_nMirrorCount;					// Number of values in m_Data and m_Indices which are used
+	CUtlVector< unsigned char > m_Data;	// Mirrored values of the field's type
+	CUtlVector< int > m_Indices;
+};
+
+
+//-----------------------------------------------------------------------------
+// A delta state to mirror and the data mirror maps of the base state
+//-----------------------------------------------------------------------------
+struct CDmMeshUtils::MirrorDeltaJob_t
+{
+	CDmeVertexDeltaData *m_pDelta;
+	int m_nAxis;
+	const CUtlVector< int > *m_pPosMirrorMap;
+	const CUtlVector< int > *m_pNormalMirrorMap;
+	const CUtlVector< int > *m_pUVMirrorMap;
+	CUtlVector< MirrorDeltaField_t > m_Fields;	// Filled in by MirrorDeltaJob()
+};
+
+
+static bool ComputeMirrorDelta( CDmeVertexDeltaData *pDelta, int axis, const CUtlVector< int > &posMirrorMap, const CUtlVector< int > &normalMirrorMap, const CUtlVector< int > &uvMirrorMap, CUtlVector< MirrorDeltaField_t > &fields );
+static void ApplyMirrorDelta( CDmeVertexDeltaData *pDelta, const CUtlVector< MirrorDeltaField_t > &fields );
+
+
 //-----------------------------------------------------------------------------
 // y = mirrorMap[ x ] means that if y < 0 then original position x is not
 // mirrored.  Otherwise y is the index into the vertex indices of the mirrored
@@ -910,17 +945,53 @@ bool CDmMeshUtils::MirrorVertices( CDmeMesh *pMesh, CDmeVertexData *pBase, int a
 		MirrorVertices( pBase, axis, nVertexCount, mirrorCount, mirrorMap, posMirrorMap, normalMirrorMap, uvMirrorMap );
 	}
 
+	// Every delta state is mirrored with the same data mirror maps into its own buffers
 	const int nDeltaState = pMesh->DeltaStateCount();
+
+	CUtlVector< MirrorDeltaJob_t > deltaJobs;
+	deltaJobs.SetCount( nDeltaState );
 	for ( int i = 0; i < nDeltaState; ++i )
 	{
-		CDmeVertexDeltaData *pDelta = pMesh->GetDeltaState( i );
-		MirrorDelta( pDelta, axis, posMirrorMap, normalMirrorMap, uvMirrorMap );
+		MirrorDeltaJob_t &job = deltaJobs[ i ];
+		job.m_pDelta = pMesh->GetDeltaState( i );
+		job.m_nAxis = axis;
+		job.m_pPosMirrorMap = &posMirrorMap;
+		job.m_pNormalMirrorMap = &normalMirrorMap;
+		job.m_pUVMirrorMap = &uvMirrorMap;
+	}
+
+	// The jobs only read the delta states, the attributes are written afterwards on this thread
+	if ( nDeltaState > 1 && g_pThreadPool && ( g_pThreadPool->NumThreads() > 0 ) )
+	{
+		ParallelProcess( "CDmMeshUtils::MirrorVertices", deltaJobs.Base(), deltaJobs.Count(), &CDmMeshUtils::MirrorDeltaJob );
+	}
+	else
+	{
+		for ( int i = 0; i < nDeltaState; ++i )
+		{
+			MirrorDeltaJob( deltaJobs[ i ] );
+		}
+	}
+
+	for ( int i = 0; i < nDeltaState; ++i )
+	{
+		ApplyMirrorDelta( deltaJobs[ i ].m_pDelta, deltaJobs[ i ].m_Fields );
+		deltaJobs[ i ].m_Fields.Purge();
 	}
 
 	return true;
 }
 
 
+//-----------------------------------------------------------------------------
+//
+//-----------------------------------------------------------------------------
+void CDmMeshUtils::MirrorDeltaJob( MirrorDeltaJob_t &job )
+{
+	ComputeMirrorDelta( job.m_pDelta, job.m_nAxis, *job.m_pPosMirrorMap, *job.m_pNormalMirrorMap, *job.m_pUVMirrorMap, job.m_Fields );
+}
+
+
 //-----------------------------------------------------------------------------
 //
 //-----------------------------------------------------------------------------
@@ -1116,7 +1187,7 @@ void CDmMeshUtils::MirrorVertices(
 //-----------------------------------------------------------------------------
 template < class T_t >
 void MirrorDeltaData(
-	CDmeVertexDeltaData *pDelta,
+	MirrorDeltaField_t &field,
 	FieldIndex_t fieldIndex,
 	int axis,
 	const CDmrArrayConst< T_t > &origData,
@@ -1127,8 +1198,11 @@ void MirrorDeltaData(
 
 	const int nOrigDataCount = origData.Count();
 
-	T_t *pMirrorData = reinterpret_cast< T_t * >( alloca( nOrigDataCount * sizeof( T_t ) ) );
-	int *pMirrorIndices = reinterpret_cast< int * >( alloca( nOrigDataCount * sizeof( int ) ) );
+	// Not alloca, this runs on the thread pool whose stacks are small
+	field.m_Data.SetCount( nOrigDataCount * sizeof( T_t ) );
+	field.m_Indices.SetCount( nOrigDataCount );
+	T_t *pMirrorData = reinterpret_cast< T_t * >( field.m_Data.Base() );
+	int *pMirrorIndices = field.m_Indices.Base();
 
 	int nMirrorDataCount = 0;
 	for ( int i = 0; i < nOrigDataCount; ++i )
@@ -1142,11 +1216,10 @@ void MirrorDeltaData(
 		}
 	}
 
-	const DmAttributeType_t dmAttributeType = ArrayTypeToValueType( origData.GetAttribute()->GetType() );
-
-	pDelta->AddVertexData( fieldIndex, nMirrorDataCount );
-	pDelta->SetVertexData( fieldIndex, nOrigDataCount, nMirrorDataCount, dmAttributeType, pMirrorData );
-	pDelta->SetVertexIndices( fieldIndex, nOrigDataCount, nMirrorDataCount, pMirrorIndices );
+	field.m_nField = fieldIndex;
+	field.m_nType = ArrayTypeToValueType( origData.GetAttribute()->GetType() );
+	field.m_nOrigCount = nOrigDataCount;
+	field.m_nMirrorCount = nMirrorDataCount;
 }
 
 
@@ -1160,6 +1233,29 @@ bool CDmMeshUtils::MirrorDelta(
 	const CUtlVector< int > &normalMirrorMap,
 	const CUtlVector< int > &uvMirrorMap )
 {
+	CUtlVector< MirrorDeltaField_t > fields;
+	if ( !ComputeMirrorDelta( pDelta, axis, posMirrorMap, normalMirrorMap, uvMirrorMap, fields ) )
+		return false;
+
+	ApplyMirrorDelta( pDelta, fields );
+	return true;
+}
+
+
+//-----------------------------------------------------------------------------
+// Computes the mirrored data of a delta state without changing it, so this
+// can run on the thread pool
+//-----------------------------------------------------------------------------
+static bool ComputeMirrorDelta(
+	CDmeVertexDeltaData *pDelta,
+	int axis,
+	const CUtlVector< int > &posMirrorMap,
+	const CUtlVector< int > &normalMirrorMap,
+	const CUtlVector< int > &uvMirrorMap,
+	CUtlVector< MirrorDeltaField_t > &fields )
+{
+	fields.RemoveAll();
+
 	if ( !pDelta || axis < kXAxis || axis > kZAxis )
 		return false;
 
@@ -1178,19 +1274,19 @@ bool CDmMeshUtils::MirrorDelta(
 		case AT_VECTOR2_ARRAY:
 			if ( i == uvFieldIndex )
 			{
-				MirrorDeltaData( pDelta, i, axis % 2, CDmrArrayConst< Vector2D >( pDeltaData ), deltaIndices, uvMirrorMap );
+				MirrorDeltaData( fields[ fields.AddToTail() ], i, axis % 2, CDmrArrayConst< Vector2D >( pDeltaData ), deltaIndices, uvMirrorMap );
 				continue;
 			}
 			break;
 		case AT_VECTOR3_ARRAY:
 			if ( i == posFieldIndex )
 			{
-				MirrorDeltaData( pDelta, i, axis, CDmrArrayConst< Vector >( pDeltaData ), deltaIndices, posMirrorMap );
+				MirrorDeltaData( fields[ fields.AddToTail() ], i, axis, CDmrArrayConst< Vector >( pDeltaData ), deltaIndices, posMirrorMap );
 				continue;
 			}
 			else if ( i == normalFieldIndex )
 			{
-				MirrorDeltaData( pDelta, i, axis, CDmrArrayConst< Vector >( pDeltaData ), deltaIndices, normalMirrorMap );
+				MirrorDeltaData( fields[ fields.AddToTail() ], i, axis, CDmrArrayConst< Vector >( pDeltaData ), deltaIndices, normalMirrorMap );
 				continue;
 			}
 			break;
@@ -1203,6 +1299,21 @@ bool CDmMeshUtils::MirrorDelta(
 }
 
 
+//-----------------------------------------------------------------------------
+// Writes the mirrored data computed by ComputeMirrorDelta() to the delta state
+//-----------------------------------------------------------------------------
+static void ApplyMirrorDelta( CDmeVertexDeltaData *pDelta, const CUtlVector< MirrorDeltaField_t > &fields )
+{
+	for ( int i = 0; i < fields.Count(); ++i )
+	{
+		const MirrorDeltaField_t &field = fields[ i ];
+		pDelta->AddVertexData( field.m_nField, field.m_nMirrorCount );
+		pDelta->SetVertexData( field.m_nField, field.m_nOrigCount, field.m_nMirrorCount, field.m_nType, field.m_Data.Base() );
+		pDelta->SetVertexIndices( field.m_nField, field.m_nOrigCount, field.m_nMirrorCount, field.m_Indices.Base() );
+	}
+}
+
+
 //-----------------------------------------------------------------------------
 // Finds all materials bound to the mesh and replaces ones which match the
 // source name with the destination name
@@ -1273,33 +1384,169 @@ bool CDmMeshUtils::RemapMaterial( CDmeMesh *pMesh, const int nMaterialIndex, con
 }
 
 
+//-----------------------------------------------------------------------------
+// Buckets points into cells as large as the distance they are compared with,
+// so everything closer than that to a point is in the 27 cells around it
+//-----------------------------------------------------------------------------
+class CPointHash
+{
+public:
+	CPointHash( float flDistSqr );
+
+	void Add( const Vector &p, int nValue );
+
+	// Adds the values of all points which could be within the distance of p
+	void FindNear( const Vector &p, CUtlVector< int > &values ) const;
+
+protected:
+	struct Cell_t
+	{
+		int m_x;
+		int m_y;
+		int m_z;
+	};
+
+	static bool CellLessFunc( const Cell_t &lhs, const Cell_t &rhs );
+
+	Cell_t GetCell( const Vector &p ) const;
+
+	float m_flCellSize;
+	CUtlMap< Cell_t, int > m_cells;	// First point in each cell
+	CUtlVector< int > m_next;		// Next point in the same cell
+	CUtlVector< int > m_values;
+};
+
+
+//-----------------------------------------------------------------------------
+//
+//-----------------------------------------------------------------------------
+CPointHash::CPointHash( float flDistSqr )
+: m_flCellSize( sqrtf( flDistSqr ) )
+, m_cells( CellLessFunc )
+{
+}
+
+
+//-----------------------------------------------------------------------------
+//
+//-----------------------------------------------------------------------------
+bool CPointHash::CellLessFunc( const Cell_t &lhs, const Cell_t &rhs )
+{
+	if ( lhs.m_x != rhs.m_x )
+		return lhs.m_x < rhs.m_x;
+
+	if ( lhs.m_y != rhs.m_y )
+		return lhs.m_y < rhs.m_y;
+
+	return lhs.m_z < rhs.m_z;
+}
+
+
+//-----------------------------------------------------------------------------
+// Infinities and NaNs are never near anything, so any cell will do for them
+//-----------------------------------------------------------------------------
+CPointHash::Cell_t CPointHash::GetCell( const Vector &p ) const
+{
+	Cell_t cell;
+	cell.m_x = IsFinite( p.x ) ? (int)clamp( floor( p.x / m_flCellSize ), -1.0e9, 1.0e9 ) : 0;
+	cell.m_y = IsFinite( p.y ) ? (int)clamp( floor( p.y / m_flCellSize ), -1.0e9, 1.0e9 ) : 0;
+	cell.m_z = IsFinite( p.z ) ? (int)clamp( floor( p.z / m_flCellSize ), -1.0e9, 1.0e9 ) : 0;
+	return cell;
+}
+
+
+//-----------------------------------------------------------------------------
+//
+//-----------------------------------------------------------------------------
+void CPointHash::Add( const Vector &p, int nValue )
+{
+	const int nPoint = m_values.AddToTail( nValue );
+
+	const Cell_t cell = GetCell( p );
+	const int nCell = m_cells.Find( cell );
+	if ( nCell == m_cells.InvalidIndex() )
+	{
+		m_cells.Insert( cell, nPoint );
+		m_next.AddToTail( -1 );
+	}
+	else
+	{
+		m_next.AddToTail( m_cells[ nCell ] );
+		m_cells[ nCell ] = nPoint;
+	}
+}
+
+
+//-----------------------------------------------------------------------------
+//
+//-----------------------------------------------------------------------------
+void CPointHash::FindNear( const Vector &p, CUtlVector< int > &values ) const
+{
+	const Cell_t center = GetCell( p );
+
+	Cell_t cell;
+	for ( cell.m_z = center.m_z - 1; cell.m_z <= center.m_z + 1; ++cell.m_z )
+	{
+		for ( cell.m_y = center.m_y - 1; cell.m_y <= center.m_y + 1; ++cell.m_y )
+		{
+			for ( cell.m_x = center.m_x - 1; cell.m_x <= center.m_x + 1; ++cell.m_x )
+			{
+				const int nCell = m_cells.Find( cell );
+				if ( nCell == m_cells.InvalidIndex() )
+					continue;
+
+				for ( int i = m_cells[ nCell ]; i >= 0; i = m_next[ i ] )
+				{
+					values.AddToTail( m_values[ i ] );
+				}
+			}
+		}
+	}
+}
+
+
 //-----------------------------------------------------------------------------
 // Finds the "socket" on which to base the mesh merge
 // This is defined as the vertices along the two meshes
 // Returns the index into srcBorderEdgesList of the edge list that is found
 // -1 if not found
+//
+// A list matches if as many destination edges match one of its edges as it
+// has edges.  The edges of each list are hashed by their end points, so each
+// destination edge is only compared with the source edges near it.
 //-----------------------------------------------------------------------------
 int CDmMeshUtils::FindMergeSocket(
 	const CUtlVector< CUtlVector< CDmMeshComp::CEdge * > > &srcBorderEdgesList,
 	CDmeMesh *pDstMesh )
 {
-	CDmMeshComp dstComp( pDstMesh );
+	const CUtlFixedLinkedList< CDmMeshComp::CEdge > &edgeList = pDstMesh->GetMeshComp()->m_edges;
 
-	const CUtlFixedLinkedList< CDmMeshComp::CEdge > &edgeList = dstComp.m_edges;
+	CUtlVector< int > nearEdges;
 
 	for ( int i = srcBorderEdgesList.Count() - 1; i >= 0; --i )
 	{
 		const CUtlVector< CDmMeshComp::CEdge * > &srcBorderEdges = srcBorderEdgesList[ i ];
 
+		// CVert::operator== compares squared distances with FLT_EPSILON
+		CPointHash edgeHash( FLT_EPSILON );
+		for ( int k = 0; k < srcBorderEdges.Count(); ++k )
+		{
+			edgeHash.Add( *srcBorderEdges[ k ]->GetVert( 0 )->Position(), k );
+			edgeHash.Add( *srcBorderEdges[ k ]->GetVert( 1 )->Position(), k );
+		}
+
 		int nEdgeMatch = 0;
 
 		for ( int j = edgeList.Head(); j != edgeList.InvalidIndex(); j = edgeList.Next( j ) )
 		{
 			const CDmMeshComp::CEdge &e = edgeList[ j ];
 
-			for ( int k = srcBorderEdges.Count() - 1; k >= 0; --k )
+			nearEdges.RemoveAll();
+			edgeHash.FindNear( *e.GetVert( 0 )->Position(), nearEdges );
+
+			for ( int k = nearEdges.Count() - 1; k >= 0; --k )
 			{
-				if ( e == *srcBorderEdges[ k ] )
+				if ( e == *srcBorderEdges[ nearEdges[ k ] ] )
 				{
 					++nEdgeMatch;
 					break;
@@ -1324,7 +1571,7 @@ int CDmMeshUtils::FindMergeSocket(
 //-----------------------------------------------------------------------------
 bool CDmMeshUtils::Merge( CDmeMesh *pSrcMesh, CDmElement *pRoot )
 {
-	CDmMeshComp srcComp( pSrcMesh );
+	CDmMeshComp &srcComp = *pSrcMesh->GetMeshComp();
 
 	CUtlVector< CUtlVector< CDmMeshComp::CEdge * > > srcBorderEdgesList;
 	if ( srcComp.GetBorderEdges( srcBorderEdgesList ) == 0 )
@@ -1353,6 +1600,7 @@ bool CDmMeshUtils::Merge( CDmeMesh *pSrcMesh, CDmElement *pRoot )
 	pSrcMesh->GetBoundingSphere( srcCenter, srcRadius );
 
 	int nEdgeListIndex = -1;
+	int nDstEdgeListIndex = -1;
 
 	while ( traverseStack.Count() )
 	{
@@ -1382,12 +1630,13 @@ bool CDmMeshUtils::Merge( CDmeMesh *pSrcMesh, CDmElement *pRoot )
 		{
 			sqDist = dstRadius;
 			pDstMesh = pMesh;
+			nDstEdgeListIndex = nEdgeListIndex;
 		}
 	}
 
 	if ( pDstMesh )
 	{
-		return Merge( srcComp, srcBorderEdgesList[ nEdgeListIndex ], pDstMesh );
+		return Merge( srcComp, srcBorderEdgesList[ nDstEdgeListIndex ], pDstMesh );
 	}
 
 	Msg( "Error: Merge() - No Merge Socket Found - i.e. A Set Of Border Edges On The Source Model That Are Found On The Merge Model" );
@@ -1668,14 +1917,10 @@ int MergeBaseState(
 
 
 //-----------------------------------------------------------------------------
-//
+// Creates the fields of the source delta state missing from the destination
 //-----------------------------------------------------------------------------
-void MergeDeltaState( CDmeVertexDeltaData *pSrcDelta, CDmeVertexDeltaData *pDstDelta, int &nPositionOffset, int &nNormalOffset, int &nWrinkleOffset )
+void CreateMissingDeltaFields( CDmeVertexDeltaData *pSrcDelta, CDmeVertexDeltaData *pDstDelta )
 {
-	const int nSrcPositionIndex = pSrcDelta->FindFieldIndex( CDmeVertexData::FIELD_POSITION );
-	const int nSrcNormalIndex = pSrcDelta->FindFieldIndex( CDmeVertexData::FIELD_NORMAL );
-	const int nSrcWrinkleIndex = pSrcDelta->FindFieldIndex( CDmeVertexData::FIELD_WRINKLE );
-
 	for ( int i = 0; i < pSrcDelta->FieldCount(); ++i )
 	{
 		bool bFound = false;
@@ -1696,6 +1941,50 @@ void MergeDeltaState( CDmeVertexDeltaData *pSrcDelta, CDmeVertexDeltaData *pDstD
 			pDstDelta->CreateField( pSrcDelta->FieldName( i ), pSrcData->GetType() );
 		}
 	}
+}
+
+
+//-----------------------------------------------------------------------------
+// A field of a source delta state, the field of the destination delta state
+// it is appended to and the source indices shifted to the destination
+//-----------------------------------------------------------------------------
+struct MergeDeltaField_t
+{
+	int m_nSrcField;
+	int m_nDstField;
+	CUtlVector< int > m_Indices;
+};
+
+
+//-----------------------------------------------------------------------------
+// A source delta state and the destination delta state it is appended to
+//-----------------------------------------------------------------------------
+struct MergeDeltaJob_t
+{
+	CDmeVertexDeltaData *m_pSrcDelta;
+	CDmeVertexDeltaData *m_pDstDelta;
+	int m_nPositionOffset;
+	int m_nNormalOffset;
+	int m_nWrinkleOffset;
+	CUtlVector< MergeDeltaField_t > m_Fields;	// Filled in by MergeDeltaJob()
+};
+
+
+//-----------------------------------------------------------------------------
+// Matches the source fields to the destination fields, which must already
+// exist, see CreateMissingDeltaFields(), and shifts the source indices into
+// job local buffers.  Only reads the delta states so jobs can run in parallel
+//-----------------------------------------------------------------------------
+static void MergeDeltaJob( MergeDeltaJob_t &job )
+{
+	CDmeVertexDeltaData *pSrcDelta = job.m_pSrcDelta;
+	CDmeVertexDeltaData *pDstDelta = job.m_pDstDelta;
+
+	const int nSrcPositionIndex = pSrcDelta->FindFieldIndex( CDmeVertexData::FIELD_POSITION );
+	const int nSrcNormalIndex = pSrcDelta->FindFieldIndex( CDmeVertexData::FIELD_NORMAL );
+	const int nSrcWrinkleIndex = pSrcDelta->FindFieldIndex( CDmeVertexData::FIELD_WRINKLE );
+
+	job.m_Fields.RemoveAll();
 
 	for ( int i = 0; i < pSrcDelta->FieldCount(); ++i )
 	{
@@ -1703,15 +1992,15 @@ void MergeDeltaState( CDmeVertexDeltaData *pSrcDelta, CDmeVertexDeltaData *pDstD
 
 		if ( i == nSrcPositionIndex )
 		{
-			nOffset = nPositionOffset;
+			nOffset = job.m_nPositionOffset;
 		}
 		else if ( i == nSrcNormalIndex )
 		{
-			nOffset = nNormalOffset;
+			nOffset = job.m_nNormalOffset;
 		}
 		else if ( i == nSrcWrinkleIndex )
 		{
-			nOffset = nWrinkleOffset;
+			nOffset = job.m_nWrinkleOffset;
 		}
 
 		for ( int j = 0; j < pDstDelta->FieldCount(); ++j )
@@ -1719,49 +2008,100 @@ void MergeDeltaState( CDmeVertexDeltaData *pSrcDelta, CDmeVertexDeltaData *pDstD
 			if ( Q_strcmp( pSrcDelta->FieldName( i ), pDstDelta->FieldName( j ) ) )
 				continue;
 
-			CDmAttribute *pSrcData = pSrcDelta->GetVertexData( i );
-			CDmAttribute *pDstData = pDstDelta->GetVertexData( j );
+			MergeDeltaField_t &field = job.m_Fields[ job.m_Fields.AddToTail() ];
+			field.m_nSrcField = i;
+			field.m_nDstField = j;
 
-			switch ( pSrcData->GetType() )
+			const CUtlVector< int > &srcIndices( pSrcDelta->GetVertexIndexData( i ) );
+			const int nSrcIndexCount = srcIndices.Count();
+			field.m_Indices.SetCount( nSrcIndexCount );
+			for ( int k = 0; k < nSrcIndexCount; ++k )
 			{
-			case AT_FLOAT_ARRAY:
-				AppendData( CDmrArrayConst< float >( pSrcData ), CDmrArray< float >( pDstData ) );
-				break;
-			case AT_VECTOR2_ARRAY:
-				AppendData( CDmrArrayConst< Vector2D >( pSrcData ), CDmrArray< Vector2D >( pDstData ) );
-				break;
-			case AT_VECTOR3_ARRAY:
-				AppendData( CDmrArrayConst< Vector >( pSrcData ), CDmrArray< Vector >( pDstData ) );
-				break;
-			case AT_VECTOR4_ARRAY:
-				AppendData( CDmrArrayConst< Vector4D >( pSrcData ), CDmrArray< Vector4D >( pDstData ) );
-				break;
-			case AT_QUATERNION_ARRAY:
-				AppendData( CDmrArrayConst< Quaternion >( pSrcData ), CDmrArray< Quaternion >( pDstData ) );
-				break;
-			case AT_COLOR_ARRAY:
-				AppendData( CDmrArrayConst< Color >( pSrcData ), CDmrArray< Color >( pDstData ) );
-				break;
-			default:
-				Assert( 0 );
-				break;
+				field.m_Indices[ k ] = srcIndices[ k ] + nOffset;
 			}
 
-			CDmrArray< int > srcIndices( pSrcDelta->GetIndexData( i ) );
-			CDmrArray< int > dstIndices( pDstDelta->GetIndexData( j ) );
+			break;
+		}
+	}
+}
 
-			const int nSrcIndexCount = srcIndices.Count();
-			const int nDstIndexCount = dstIndices.Count();
 
-			dstIndices.AddMultipleToTail( nSrcIndexCount );
+//-----------------------------------------------------------------------------
+// Appends the data and the shifted indices computed by MergeDeltaJob() to
+// the destination delta state.  Writes attributes, so only on the main thread
+//-----------------------------------------------------------------------------
+static void ApplyMergeDeltaJob( MergeDeltaJob_t &job )
+{
+	for ( int i = 0; i < job.m_Fields.Count(); ++i )
+	{
+		const MergeDeltaField_t &field = job.m_Fields[ i ];
 
-			for ( int k = 0; k < nSrcIndexCount; ++k )
-			{
-				dstIndices.Set( nDstIndexCount + k, srcIndices.Get( k ) + nOffset );
-			}
+		CDmAttribute *pSrcData = job.m_pSrcDelta->GetVertexData( field.m_nSrcField );
+		CDmAttribute *pDstData = job.m_pDstDelta->GetVertexData( field.m_nDstField );
 
+		switch ( pSrcData->GetType() )
+		{
+		case AT_FLOAT_ARRAY:
+			AppendData( CDmrArrayConst< float >( pSrcData ), CDmrArray< float >( pDstData ) );
+			break;
+		case AT_VECTOR2_ARRAY:
+			AppendData( CDmrArrayConst< Vector2D >( pSrcData ), CDmrArray< Vector2D >( pDstData ) );
+			break;
+		case AT_VECTOR3_ARRAY:
+			AppendData( CDmrArrayConst< Vector >( pSrcData ), CDmrArray< Vector >( pDstData ) );
+			break;
+		case AT_VECTOR4_ARRAY:
+			AppendData( CDmrArrayConst< Vector4D >( pSrcData ), CDmrArray< Vector4D >( pDstData ) );
+			break;
+		case AT_QUATERNION_ARRAY:
+			AppendData( CDmrArrayConst< Quaternion >( pSrcData ), CDmrArray< Quaternion >( pDstData ) );
+			break;
+		case AT_COLOR_ARRAY:
+			AppendData( CDmrArrayConst< Color >( pSrcData ), CDmrArray< Color >( pDstData ) );
+			break;
+		default:
+			Assert( 0 );
 			break;
 		}
+
+		const int nSrcIndexCount = field.m_Indices.Count();
+		if ( nSrcIndexCount == 0 )
+			continue;
+
+		CDmrArray< int > dstIndices( job.m_pDstDelta->GetIndexData( field.m_nDstField ) );
+		const int nDstIndexCount = dstIndices.Count();
+		dstIndices.AddMultipleToTail( nSrcIndexCount );
+		dstIndices.SetMultiple( nDstIndexCount, nSrcIndexCount, field.m_Indices.Base() );
+	}
+
+	job.m_Fields.Purge();
+}
+
+
+//-----------------------------------------------------------------------------
+// Appends the data of each job's source delta state to its destination.  The
+// shifted indices are computed on the thread pool, the attributes are written
+// afterwards on this thread in job order
+//-----------------------------------------------------------------------------
+static void MergeDeltaStates( CUtlVector< MergeDeltaJob_t > &jobs )
+{
+	const int nJobs = jobs.Count();
+
+	if ( nJobs > 1 && g_pThreadPool && ( g_pThreadPool->NumThreads() > 0 ) )
+	{
+		ParallelProcess( "CDmMeshUtils::Merge", jobs.Base(), nJobs, &MergeDeltaJob );
+	}
+	else
+	{
+		for ( int i = 0; i < nJobs; ++i )
+		{
+			MergeDeltaJob( jobs[ i ] );
+		}
+	}
+
+	for ( int i = 0; i < nJobs; ++i )
+	{
+		ApplyMergeDeltaJob( jobs[ i ] );
 	}
 }
 
@@ -1845,6 +2185,9 @@ bool CDmMeshUtils::Merge( CDmeMesh *pSrcMesh, CDmeMesh *pDstMesh, int nSkinningJ
 	}
 
 	// Merge Deltas
+	// Delta states and fields are created up front, only the data is appended in MergeDeltaStates()
+
+	CUtlVector< MergeDeltaJob_t > deltaJobs;
 
 	for ( int i = 0; i < pSrcMesh->DeltaStateCount(); ++i )
 	{
@@ -1859,15 +2202,30 @@ bool CDmMeshUtils::Merge( CDmeMesh *pSrcMesh, CDmeMesh *pDstMesh, int nSkinningJ
 				continue;
 
 			bMerged = true;
-			MergeDeltaState( pSrcDelta, pDstDelta, nPositionOffset, nNormalOffset, nWrinkleOffset );
+			MergeDeltaJob_t &job = deltaJobs[ deltaJobs.AddToTail() ];
+			job.m_pSrcDelta = pSrcDelta;
+			job.m_pDstDelta = pDstDelta;
 		}
 
 		if ( !bMerged )
 		{
-			MergeDeltaState( pSrcDelta, pDstMesh->FindOrCreateDeltaState( pSrcDelta->GetName() ), nPositionOffset, nNormalOffset, nWrinkleOffset );
+			MergeDeltaJob_t &job = deltaJobs[ deltaJobs.AddToTail() ];
+			job.m_pSrcDelta = pSrcDelta;
+			job.m_pDstDelta = pDstMesh->FindOrCreateDeltaState( pSrcDelta->GetName() );
 		}
 	}
 
+	for ( int i = 0; i < deltaJobs.Count(); ++i )
+	{
+		MergeDeltaJob_t &job = deltaJobs[ i ];
+		job.m_nPositionOffset = nPositionOffset;
+		job.m_nNormalOffset = nNormalOffset;
+		job.m_nWrinkleOffset = nWrinkleOffset;
+		CreateMissingDeltaFields( job.m_pSrcDelta, job.m_pDstDelta );
+	}
+
+	MergeDeltaStates( deltaJobs );
+
 	return true;
 }
 
@@ -2170,38 +2528,58 @@ bool CDmMeshUtils::Merge(
 	CUtlVector< VertexWeightMap_s > vertexWeightMap;
 	vertexWeightMap.SetSize( nSrcCount );
 
-	for ( int i = 0; i < nSrcCount; ++i )
+	// Matching positions are found through a hash, only unmatched ones search everything
+	CPointHash dstPosHash( FLT_EPSILON * 10.0f );
+	for ( int j = 0; j < nDstCount; ++j )
 	{
-		int nClosestIndex = -1;
-		float closest = FLT_MAX;
+		dstPosHash.Add( dstPosData[ j ], j );
+	}
 
+	CUtlVector< int > nearPositions;
+
+	for ( int i = 0; i < nSrcCount; ++i )
+	{
 		VertexWeightMap_s &vertexWeight = vertexWeightMap[ i ];
 		vertexWeight.m_nVertexWeights = 0;
 
 		const Vector &vSrc = srcPosData[ i ];
 
-		for ( int j = 0; j < nDstCount; ++j )
+		// The lowest matching index is the one a search in order would find
+		int nMatchIndex = -1;
+
+		nearPositions.RemoveAll();
+		dstPosHash.FindNear( vSrc, nearPositions );
+		for ( int k = 0; k < nearPositions.Count(); ++k )
 		{
-			const Vector &vDst = dstPosData[ j ];
-			if ( vSrc.DistToSqr( vDst ) < FLT_EPSILON * 10.0f )
+			const int j = nearPositions[ k ];
+			if ( ( nMatchIndex < 0 || j < nMatchIndex ) && vSrc.DistToSqr( dstPosData[ j ] ) < FLT_EPSILON * 10.0f )
 			{
-				vertexWeight.m_nVertexWeights = 1;
-				vertexWeight.m_vertexWeights[ 0 ].m_vertexDataIndex = j;
-				vertexWeight.m_vertexWeights[ 0 ].m_vertexWeight = 1.0f;
-				vertexWeight.m_vertexWeights[ 0 ].m_pVertexIndices = &pDstData->FindVertexIndicesFromDataIndex( CDmeVertexData::FIELD_POSITION, j );
-				break;
+				nMatchIndex = j;
 			}
+		}
 
-			float distance = vSrc.DistToSqr( vDst );
-			if ( distance < closest )
+		if ( nMatchIndex >= 0 )
+		{
+			vertexWeight.m_nVertexWeights = 1;
+			vertexWeight.m_vertexWeights[ 0 ].m_vertexDataIndex = nMatchIndex;
+			vertexWeight.m_vertexWeights[ 0 ].m_vertexWeight = 1.0f;
+			vertexWeight.m_vertexWeights[ 0 ].m_pVertexIndices = &pDstData->FindVertexIndicesFromDataIndex( CDmeVertexData::FIELD_POSITION, nMatchIndex );
+		}
+		else
+		{
+			int nClosestIndex = -1;
+			float closest = FLT_MAX;
+
+			for ( int j = 0; j < nDstCount; ++j )
 			{
-				closest = distance;
-				nClosestIndex = j;
+				const float distance = vSrc.DistToSqr( dstPosData[ j ] );
+				if ( distance < closest )
+				{
+					closest = distance;
+					nClosestIndex = j;
+				}
 			}
-		}
 
-		if ( vertexWeight.m_nVertexWeights == 0 )
-		{
 			Warning( "Warning: Merge() - No Match For Src Vertex: %f %f %f, Using Closest: %f %f %f\n",
 				vSrc.x, vSrc.y, vSrc.z,
 				dstPosData[ nClosestIndex ].x, dstPosData[ nClosestIndex ].y, dstPosData[ nClosestIndex ].z );
@@ -69,6 +69,10 @@ protected:
 
 	static bool MirrorDelta( CDmeVertexDeltaData *pDelta, int axis, const CUtlVector< int > &posMirrorMap, const CUtlVector< int > &normalMirrorMap, const CUtlVector< int > &uvMirrorMap );
 
+	struct MirrorDeltaJob_t;
+
+	static void MirrorDeltaJob( MirrorDeltaJob_t &job );
+
 	static bool Merge( CDmMeshComp &srcComp, const CUtlVector< CDmMeshComp::CEdge * > &edgeList, CDmeMesh *pDstMesh );
 
 	static int FindMergeSocket(
@@ -6,7 +6,6 @@
 
 
 // Valve includes
-#include "tier1/characterset.h"
 #include "movieobjects/dmedag.h"
 #include "movieobjects/dmemesh.h"
 #include "movieobjects/dmefaceset.h"
@@ -17,7 +16,283 @@
 #include "filesystem.h"
 #include "tier2/tier2.h"
 #include "tier1/UtlStringMap.h"
+#include "tier1/utlmap.h"
 #include "mathlib/mathlib.h"
+#include "vstdlib/jobthread.h"
+#include <ctype.h>
+
+
+//-----------------------------------------------------------------------------
+// OBJ tokenizing. Lines are parsed in place in the file buffer; the numeric
+// parsers accept exactly what sscanf's %f and atoi did before.
+//-----------------------------------------------------------------------------
+static inline bool IsObjSpace( char c )
+{
+	return isspace( (unsigned char)c ) != 0;
+}
+
+static inline const char *SkipObjSpace( const char *pBuf, const char *pEnd )
+{
+	while ( pBuf < pEnd && IsObjSpace( *pBuf ) )
+		++pBuf;
+
+	return pBuf;
+}
+
+static inline bool IsObjDigit( const char *pBuf, const char *pEnd )
+{
+	return pBuf < pEnd && *pBuf >= '0' && *pBuf <= '9';
+}
+
+
+//-----------------------------------------------------------------------------
+// Parses a float the way sscanf( "%f" ) does, including skipping leading white
+// space. Numbers with at most 24 bits of significant digits and a small decimal
+// exponent are computed exactly with one float multiply or divide, anything
+// else is handed to sscanf
+//-----------------------------------------------------------------------------
+static const float s_flPowersOf10[] = { 1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f, 1e10f };
+
+static bool ParseObjFloat( const char *&pBuf, const char *pEnd, float &flValue )
+{
+	const char *p = SkipObjSpace( pBuf, pEnd );
+	const char *pStart = p;
+
+	bool bNegative = false;
+	if ( p < pEnd && ( *p == '-' || *p == '+' ) )
+	{
+		bNegative = ( *p == '-' );
+		++p;
+	}
+
+	uint64 nMantissa = 0;
+	int nExponent = 0;
+	int nPendingZeros = 0;
+	int nDigits = 0;
+	bool bExact = true;
+
+	for ( bool bFraction = false; ; )
+	{
+		if ( IsObjDigit( p, pEnd ) )
+		{
+			const int nDigit = *p - '0';
+			++nDigits;
+			if ( bFraction )
+			{
+				--nExponent;
+			}
+
+			// Trailing zeros are folded into the exponent
+			if ( nDigit == 0 )
+			{
+				if ( nMantissa != 0 )
+				{
+					++nPendingZeros;
+				}
+			}
+			else if ( bExact )
+			{
+				for ( ; nPendingZeros > 0 && nMantissa <= ( 1 << 24 ); --nPendingZeros )
+				{
+					nMantissa *= 10;
+				}
+				nMantissa = nMantissa * 10 + nDigit;
+				bExact = ( nPendingZeros == 0 ) && ( nMantissa <= ( 1 << 24 ) );
+			}
+			++p;
+			continue;
+		}
+
+		if ( !bFraction && p < pEnd && *p == '.' )
+		{
+			bFraction = true;
+			++p;
+			continue;
+		}
+
+		break;
+	}
+
+	nExponent += nPendingZeros;
+
+	if ( p < pEnd && ( *p == 'e' || *p == 'E' ) )
+	{
+		const char *pExp = p + 1;
+		bool bNegativeExp = false;
+		if ( pExp < pEnd && ( *pExp == '-' || *pExp == '+' ) )
+		{
+			bNegativeExp = ( *pExp == '-' );
+			++pExp;
+		}
+
+		if ( IsObjDigit( pExp, pEnd ) )
+		{
+			int nExp = 0;
+			for ( ; IsObjDigit( pExp, pEnd ); ++pExp )
+			{
+				nExp = min( nExp * 10 + ( *pExp - '0' ), 100000 );
+			}
+			nExponent += bNegativeExp ? -nExp : nExp;
+			p = pExp;
+		}
+	}
+
+	// Hex floats, infinities and NaNs
+	const bool bSpecial = ( nDigits == 0 ) || ( p < pEnd && ( *p == 'x' || *p == 'X' ) );
+
+	if ( !bSpecial && ( nMantissa == 0 || ( bExact && nExponent >= -10 && nExponent <= 10 ) ) )
+	{
+		float flResult = (float)nMantissa;
+		if ( nMantissa == 0 )
+		{
+			flResult = 0.0f;
+		}
+		else if ( nExponent < 0 )
+		{
+			flResult /= s_flPowersOf10[ -nExponent ];
+		}
+		else
+		{
+			flResult *= s_flPowersOf10[ nExponent ];
+		}
+
+		flValue = bNegative ? -flResult : flResult;
+		pBuf = p;
+		return true;
+	}
+
+	// Slow path: hand the token to sscanf
+	char pToken[ 128 ];
+	int nLen = 0;
+	for ( const char *q = pStart; q < pEnd && !IsObjSpace( *q ) && nLen < (int)sizeof( pToken ) - 1; ++q )
+	{
+		pToken[ nLen++ ] = *q;
+	}
+	pToken[ nLen ] = '\0';
+
+	int nConsumed = 0;
+	if ( sscanf( pToken, "%f%n", &flValue, &nConsumed ) != 1 )
+		return false;
+
+	pBuf = pStart + nConsumed;
+	return true;
+}
+
+
+//-----------------------------------------------------------------------------
+// Parses a number of floats, returns false if they are not all there
+//-----------------------------------------------------------------------------
+static bool ParseObjFloats( const char *pBuf, const char *pEnd, int nCount, float *pValues )
+{
+	for ( int i = 0; i < nCount; ++i )
+	{
+		if ( !ParseObjFloat( pBuf, pEnd, pValues[i] ) )
+			return false;
+	}
+	return true;
+}
+
+
+//-----------------------------------------------------------------------------
+// Parses an int the way atoi does
+//-----------------------------------------------------------------------------
+static int ParseObjInt( const char *pBuf, const char *pEnd )
+{
+	pBuf = SkipObjSpace( pBuf, pEnd );
+
+	bool bNegative = false;
+	if ( pBuf < pEnd && ( *pBuf == '-' || *pBuf == '+' ) )
+	{
+		bNegative = ( *pBuf == '-' );
+		++pBuf;
+	}
+
+	int nValue = 0;
+	for ( ; IsObjDigit( pBuf, pEnd ); ++pBuf )
+	{
+		nValue = nValue * 10 + ( *pBuf - '0' );
+	}
+
+	return bNegative ? -nValue : nValue;
+}
+
+
+//-----------------------------------------------------------------------------
+// If the line starts with the keyword, copies the white space delimited word
+// after it the way sscanf( "<keyword> %s" ) does
+//-----------------------------------------------------------------------------
+static bool ParseObjKeywordString( const char *pBuf, const char *pEnd, const char *pKeyword, char *pString, int nMaxLen )
+{
+	for ( ; *pKeyword; ++pKeyword, ++pBuf )
+	{
+		if ( pBuf >= pEnd || *pBuf != *pKeyword )
+			return false;
+	}
+
+	pBuf = SkipObjSpace( pBuf, pEnd );
+
+	int nLen = 0;
+	for ( ; pBuf < pEnd && !IsObjSpace( *pBuf ) && nLen < nMaxLen - 1; ++pBuf )
+	{
+		pString[ nLen++ ] = *pBuf;
+	}
+	pString[ nLen ] = '\0';
+
+	return nLen > 0;
+}
+
+
+//-----------------------------------------------------------------------------
+// Returns the next line of the buffer, not including the newline
+//-----------------------------------------------------------------------------
+static inline bool NextObjLine( const char *&pBuf, const char *pBufEnd, const char *&pLine, const char *&pLineEnd )
+{
+	if ( pBuf >= pBufEnd )
+		return false;
+
+	pLine = pBuf;
+	pLineEnd = (const char*)memchr( pBuf, '\n', pBufEnd - pBuf );
+	if ( pLineEnd )
+	{
+		pBuf = pLineEnd + 1;
+	}
+	else
+	{
+		pLineEnd = pBufEnd;
+		pBuf = pBufEnd;
+	}
+
+	return true;
+}
+
+
+//-----------------------------------------------------------------------------
+// Face vertices are tokenized like CUtlBuffer::ParseToken with a break set of
+// "/\\": white space is skipped and each break character is a token of its own
+//-----------------------------------------------------------------------------
+static inline bool IsObjFaceBreak( const char *pBuf, const char *pEnd )
+{
+	return pBuf < pEnd && ( *pBuf == '/' || *pBuf == '\\' );
+}
+
+static bool ParseObjFaceToken( const char *&pBuf, const char *pEnd, const char *&pToken )
+{
+	pBuf = SkipObjSpace( pBuf, pEnd );
+	if ( pBuf >= pEnd )
+		return false;
+
+	pToken = pBuf;
+	if ( IsObjFaceBreak( pBuf, pEnd ) )
+	{
+		++pBuf;
+		return true;
+	}
+
+	while ( pBuf < pEnd && !IsObjSpace( *pBuf ) && !IsObjFaceBreak( pBuf, pEnd ) )
+		++pBuf;
+
+	return true;
+}
 
 //-----------------------------------------------------------------------------
 //
@@ -85,6 +360,8 @@ void CFaceSetData::AddToMesh( CDmeMesh *pMesh )
 class CVertexData
 {
 public:
+	CVertexData() { SetDefLessFunc( m_uvCells ); }
+
 	void Clear();
 
 	inline void AddPosition( const Vector &p ) { m_positions.AddToTail( p ); }
@@ -95,7 +372,7 @@ public:
 
 	inline void AddNormalIndex( int i ) { m_nIndices.AddToTail( i ); }
 
-	inline void AddUV( const Vector2D &uv ) { AddUniqueValue( uv, m_uvs, m_uvIndexMap, FLT_EPSILON * 0.1f ); }
+	inline void AddUV( const Vector2D &uv ) { m_uvIndexMap.AddToTail( AddUniqueUV( uv ) ); }
 
 	inline void AddUVIndex( int i ) { Assert( i < m_uvIndexMap.Count() ); m_uvIndices.AddToTail( m_uvIndexMap[ i ] ); }
 
@@ -103,26 +380,16 @@ public:
 
 	CDmeVertexDataBase *AddToMesh( CDmeMesh *pMesh, bool bAbsolute, const char *pName, bool bDelta );
 
+	inline const CUtlVector< Vector > &GetPositions() const { return m_positions; }
+
+	inline const CUtlVector< Vector > &GetNormals() const { return m_normals; }
+
 protected:
-	template < class T_t > void AddUniqueValue(
-		const T_t &v,
-		CUtlVector< T_t > &vs,
-		CUtlVector< int > &map,
-		float flThresh = FLT_EPSILON )
-	{
-		const int nVs( vs.Count() );
-		for ( int i( 0 ); i < nVs; ++i )
-		{
-			if ( v.DistToSqr( vs[ i ] ) < flThresh )
-			{
-				map.AddToTail( i );
-				return;
-			}
-		}
+	// Returns the index of the first UV within the weld threshold of uv, adding it if there is none
+	int AddUniqueUV( const Vector2D &uv );
 
-		map.AddToTail( vs.Count() );
-		vs.AddToTail( v );
-	}
+	// Returns the cell of the UV hash grid containing uv
+	static uint64 UVCell( const Vector2D &uv, int nOffsetX = 0, int nOffsetY = 0 );
 
 	CDmeVertexDataBase *Add( CDmeMesh *pMesh, const char *pName = "bind" );
 
@@ -137,9 +404,82 @@ protected:
 	CUtlVector< Vector2D > m_uvs;
 	CUtlVector< int > m_uvIndexMap;
 	CUtlVector< int > m_uvIndices;
+
+	// UVs bucketed into cells as large as the weld distance: first UV in each cell, next UV in the same cell
+	CUtlMap< uint64, int > m_uvCells;
+	CUtlVector< int > m_uvNext;
 };
 
 
+//-----------------------------------------------------------------------------
+// UVs closer than this are welded together
+//-----------------------------------------------------------------------------
+static const float s_flUVWeldDistSqr = FLT_EPSILON * 0.1f;
+static const float s_flUVCellSize = sqrtf( FLT_EPSILON * 0.1f );
+
+
+//-----------------------------------------------------------------------------
+//
+//-----------------------------------------------------------------------------
+uint64 CVertexData::UVCell( const Vector2D &uv, int nOffsetX, int nOffsetY )
+{
+	// Infinities and NaNs never weld to anything, so any cell will do for them
+	const double flX = IsFinite( uv.x ) ? clamp( floor( uv.x / s_flUVCellSize ), -1.0e9, 1.0e9 ) : 0.0;
+	const double flY = IsFinite( uv.y ) ? clamp( floor( uv.y / s_flUVCellSize ), -1.0e9, 1.0e9 ) : 0.0;
+	const uint32 nX = (uint32)( (int)flX + nOffsetX );
+	const uint32 nY = (uint32)( (int)flY + nOffsetY );
+	return ( (uint64)nX << 32 ) | nY;
+}
+
+
+//-----------------------------------------------------------------------------
+// Any UV within the weld distance is in the same or a neighbouring cell, so
+// only those need checking. The lowest index found is the one a linear
+// search through all the UVs would have found first.
+//-----------------------------------------------------------------------------
+int CVertexData::AddUniqueUV( const Vector2D &uv )
+{
+	int nFound = -1;
+	for ( int y = -1; y <= 1; ++y )
+	{
+		for ( int x = -1; x <= 1; ++x )
+		{
+			const int nCell = m_uvCells.Find( UVCell( uv, x, y ) );
+			if ( nCell == m_uvCells.InvalidIndex() )
+				continue;
+
+			for ( int i = m_uvCells[ nCell ]; i >= 0; i = m_uvNext[ i ] )
+			{
+				if ( ( nFound < 0 || i < nFound ) && uv.DistToSqr( m_uvs[ i ] ) < s_flUVWeldDistSqr )
+				{
+					nFound = i;
+				}
+			}
+		}
+	}
+
+	if ( nFound >= 0 )
+		return nFound;
+
+	const int nIndex = m_uvs.AddToTail( uv );
+
+	const uint64 nKey = UVCell( uv );
+	const int nCell = m_uvCells.Find( nKey );
+	if ( nCell == m_uvCells.InvalidIndex() )
+	{
+		m_uvCells.Insert( nKey, nIndex );
+		m_uvNext.AddToTail( -1 );
+	}
+	else
+	{
+		m_uvNext.AddToTail( m_uvCells[ nCell ] );
+		m_uvCells[ nCell ] = nIndex;
+	}
+
+	return nIndex;
+}
+
+
 //-----------------------------------------------------------------------------
 //
 //-----------------------------------------------------------------------------
@@ -154,6 +494,8 @@ void CVertexData::Clear()
 	m_uvs.RemoveAll();
 	m_uvIndexMap.RemoveAll();
 	m_uvIndices.RemoveAll();
+	m_uvCells.RemoveAll();
+	m_uvNext.RemoveAll();
 }
 
 
@@ -302,6 +644,41 @@ CDmeVertexDeltaData *CVertexData::AddDelta( CDmeMesh *pMesh, bool bAbsolute, con
 }
 
 
+//-----------------------------------------------------------------------------
+// Reads just the positions and normals of an OBJ, which is all a delta OBJ
+// contributes. Touches nothing but vertexData, so it can run on any thread.
+//-----------------------------------------------------------------------------
+static void ParseObjVertices( CUtlBuffer &buf, CVertexData &vertexData )
+{
+	Vector p;
+
+	const char *pBuf = (const char*)buf.PeekGet();
+	const char *pBufEnd = pBuf + buf.GetBytesRemaining();
+	const char *pLine;
+	const char *pLineEnd;
+
+	while ( NextObjLine( pBuf, pBufEnd, pLine, pLineEnd ) )
+	{
+		if ( pLine < pLineEnd && *pLine == 'v' && ParseObjFloats( pLine + 1, pLineEnd, 3, p.Base() ) )
+		{
+			vertexData.AddPosition( p );
+			continue;
+		}
+
+		const char *pToken = pLine;
+		while ( pToken < pLineEnd && ( *pToken == ' ' || *pToken == '\t' ) )
+			++pToken;
+
+		if ( pToken + 1 < pLineEnd && pToken[0] == 'v' && pToken[1] == 'n' && ParseObjFloats( pToken + 2, pLineEnd, 3, p.Base() ) )
+		{
+			vertexData.AddNormal( p );
+		}
+	}
+
+	buf.SeekGet( CUtlBuffer::SEEK_CURRENT, buf.GetBytesRemaining() );
+}
+
+
 //-----------------------------------------------------------------------------
 // Convert from DME -> OBJ
 //-----------------------------------------------------------------------------
@@ -388,6 +765,8 @@ CDmElement *CDmObjSerializer::ReadOBJ(
 
 		FileFindHandle_t hFind;
 
+		CUtlVector< DeltaLoadJob_t > deltaJobs;
+
 		char deltaFile[ MAX_PATH ];
 		char deltaPath[ MAX_PATH ];
 
@@ -429,13 +808,20 @@ CDmElement *CDmObjSerializer::ReadOBJ(
 
 				if ( bLoadAllDeltas )
 				{
-					GetDelta( pControlName, bAbsolute );
+					// Loaded below, in the order they were found
+					DeltaLoadJob_t &job = deltaJobs[ deltaJobs.AddToTail() ];
+					job.m_deltaName = pControlName;
+					Q_ComposeFileName( m_objDirectory, deltaInfo.m_filename, deltaPath, sizeof( deltaPath ) );
+					Q_FixSlashes( deltaPath );
+					job.m_deltaPath = deltaPath;
 				}
 			}
 		}
 
 		g_pFullFileSystem->FindClose( hFind );
 
+		LoadDeltas( deltaJobs, bAbsolute );
+
 		if ( pCombo )
 		{
 			pCombo->AddTarget( pMesh );
@@ -447,6 +833,80 @@ CDmElement *CDmObjSerializer::ReadOBJ(
 }
 
 
+//-----------------------------------------------------------------------------
+// A delta OBJ which ReadOBJ found next to the base OBJ
+//-----------------------------------------------------------------------------
+struct CDmObjSerializer::DeltaLoadJob_t
+{
+	CUtlString m_deltaName;
+	CUtlString m_deltaPath;
+	CVertexData *m_pVertexData;
+	bool m_bLoaded;
+};
+
+
+//-----------------------------------------------------------------------------
+// Reads & parses one delta OBJ, touches nothing but the job so it can run on
+// any thread
+//-----------------------------------------------------------------------------
+void CDmObjSerializer::ReadDeltaOBJ( DeltaLoadJob_t &job )
+{
+	CUtlBuffer utlBuf;
+	job.m_bLoaded = g_pFullFileSystem->ReadFile( job.m_deltaPath, NULL, utlBuf );
+	if ( job.m_bLoaded )
+	{
+		ParseObjVertices( utlBuf, *job.m_pVertexData );
+	}
+}
+
+
+//-----------------------------------------------------------------------------
+// Loads the deltas found by ReadOBJ. Files are read and parsed in parallel a
+// batch at a time, which bounds the memory held by parsed but unapplied deltas,
+// and are then added to the mesh in order so the result doesn't depend on timing
+//-----------------------------------------------------------------------------
+void CDmObjSerializer::LoadDeltas( CUtlVector< DeltaLoadJob_t > &jobs, bool bAbsolute )
+{
+	const bool bParallel = g_pThreadPool && ( g_pThreadPool->NumThreads() > 0 );
+	const int nBatchSize = bParallel ? g_pThreadPool->NumThreads() + 1 : 1;
+
+	CVertexData *pVertexData = new CVertexData[ nBatchSize ];
+
+	const int nJobs = jobs.Count();
+	for ( int nFirst = 0; nFirst < nJobs; nFirst += nBatchSize )
+	{
+		const int nCount = min( nBatchSize, nJobs - nFirst );
+		DeltaLoadJob_t *pJobs = jobs.Base() + nFirst;
+
+		for ( int i = 0; i < nCount; ++i )
+		{
+			pVertexData[ i ].Clear();
+			pJobs[ i ].m_pVertexData = &pVertexData[ i ];
+		}
+
+		if ( bParallel && nCount > 1 )
+		{
+			ParallelProcess( "CDmObjSerializer::LoadDeltas", pJobs, nCount, &CDmObjSerializer::ReadDeltaOBJ );
+		}
+		else
+		{
+			for ( int i = 0; i < nCount; ++i )
+			{
+				ReadDeltaOBJ( pJobs[ i ] );
+			}
+		}
+
+		for ( int i = 0; i < nCount; ++i )
+		{
+			GetDelta( pJobs[ i ].m_deltaName, bAbsolute, &pJobs[ i ] );
+			pJobs[ i ].m_pVertexData = NULL;
+		}
+	}
+
+	delete[] pVertexData;
+}
+
+
 //-----------------------------------------------------------------------------
 // Common function both ReadOBJ & Unserialize can call
 //-----------------------------------------------------------------------------
@@ -472,14 +932,17 @@ CDmElement *CDmObjSerializer::ReadOBJ( CUtlBuffer &buf,
 
 	m_mtlLib.RemoveAll();
 
+	if ( pBaseMesh )
+	{
+		// Delta OBJs only contribute positions and normals
+		CVertexData vertexData;
+		ParseObjVertices( buf, vertexData );
+		return vertexData.AddToMesh( pBaseMesh, bAbsolute, pName, true );
+	}
+
 	char tmpBuf0[ 4096 ];
 	char tmpBuf1[ 4096 ];
 
-	characterset_t breakSet;
-	CharacterSetBuild( &breakSet, "/\\" );
-
-	const char *pBuf;
-
 	Vector p;
 	Vector2D uv;
 
@@ -492,13 +955,16 @@ CDmElement *CDmObjSerializer::ReadOBJ( CUtlBuffer &buf,
 	CDmeMesh *pDmeMesh( NULL );
 	CUtlVector< int > *pFaceIndices( NULL );
 
-	while ( buf.IsValid() )
-	{
-		buf.GetLine( tmpBuf0, sizeof( tmpBuf0 ) );
-
-		pBuf = SkipSpace( tmpBuf0 );
+	const char *pBuf = (const char*)buf.PeekGet();
+	const char *pBufEnd = pBuf + buf.GetBytesRemaining();
+	const char *pLine;
+	const char *pLineEnd;
 
-		if ( sscanf( tmpBuf0, "v %f %f %f", &p.x, &p.y, &p.z ) == 3 )
+	while ( NextObjLine( pBuf, pBufEnd, pLine, pLineEnd ) )
+	{
+		// As with the other keywords, positions may be followed directly by a number,
+		// but unlike them they must start the line
+		if ( pLine < pLineEnd && *pLine == 'v' && ParseObjFloats( pLine + 1, pLineEnd, 3, p.Base() ) )
 		{
 			if ( pDmeDag )
 			{
@@ -511,28 +977,29 @@ CDmElement *CDmObjSerializer::ReadOBJ( CUtlBuffer &buf,
 			}
 
 			vertexData.AddPosition( p );
-
 			continue;
 		}
 
-		if ( sscanf( pBuf, "vn %f %f %f", &p.x, &p.y, &p.z ) == 3 )
-		{
-			vertexData.AddNormal( p );
+		const char *pToken = SkipSpace( pLine, pLineEnd );
+		if ( pToken >= pLineEnd )
 			continue;
-		}
 
-		if ( !pBaseMesh )
+		switch ( *pToken )
 		{
-			if ( sscanf( pBuf, "vt %f %f", &uv.x, &uv.y ) == 2 )
+		case 'v':
+			if ( pToken + 1 < pLineEnd && pToken[1] == 'n' && ParseObjFloats( pToken + 2, pLineEnd, 3, p.Base() ) )
+			{
+				vertexData.AddNormal( p );
+			}
+			else if ( pToken + 1 < pLineEnd && pToken[1] == 't' && ParseObjFloats( pToken + 2, pLineEnd, 2, uv.Base() ) )
 			{
 				vertexData.AddUV( uv );
-				continue;
 			}
+			break;
 
-			if ( pFilename && sscanf( pBuf, "mtllib %4096s", tmpBuf1 ) == 1 )
+		case 'm':
+			if ( pFilename && ParseObjKeywordString( pToken, pLineEnd, "mtllib", tmpBuf1, sizeof( tmpBuf1 ) ) )
 			{
-				CUtlString mtlLib( tmpBuf1 );
-
 				Q_strncpy( tmpBuf0, pFilename, sizeof( tmpBuf0 ) );
 				Q_FixSlashes( tmpBuf0 );
 				Q_StripFilename( tmpBuf0 );
@@ -546,11 +1013,11 @@ CDmElement *CDmObjSerializer::ReadOBJ( CUtlBuffer &buf,
 				{
 					ParseMtlLib( utlBuf );
 				}
-
-				continue;
 			}
+			break;
 
-			if ( sscanf( pBuf, "usemtl %4096s", tmpBuf1 ) == 1 )
+		case 'u':
+			if ( ParseObjKeywordString( pToken, pLineEnd, "usemtl", tmpBuf1, sizeof( tmpBuf1 ) ) )
 			{
 				// Remove any 'SG' suffix from the material
 				const uint sLen = Q_strlen( tmpBuf1 );
@@ -568,20 +1035,22 @@ CDmElement *CDmObjSerializer::ReadOBJ( CUtlBuffer &buf,
 				{
 					pFaceIndices = faceSetData.GetFaceSetIndices( tmpBuf1 );
 				}
-
-				continue;
 			}
+			break;
 
-			if ( sscanf( pBuf, "g %4096s", tmpBuf1 ) == 1 )
+		case 'g':
+			if ( ParseObjKeywordString( pToken, pLineEnd, "g", tmpBuf1, sizeof( tmpBuf1 ) ) )
 			{
 				groupName = tmpBuf1;
 				if ( pFaceIndices == NULL )
 				{
 					pFaceIndices = faceSetData.GetFaceSetIndices( tmpBuf1 );
 				}
-				continue;
 			}
-			if ( *pBuf == 'f' && ( *( pBuf + 1 ) == ' ' || *( pBuf + 1 ) == '\t' ) )
+			break;
+
+		case 'f':
+			if ( pToken + 1 < pLineEnd && ( pToken[1] == ' ' || pToken[1] == '\t' ) )
 			{
 				if ( pDmeDag == NULL )
 				{
@@ -610,16 +1079,9 @@ CDmElement *CDmObjSerializer::ReadOBJ( CUtlBuffer &buf,
 				int t;
 				int n;
 
-				pBuf = SkipSpace( pBuf + 1 );
-				int nLen = Q_strlen( pBuf );
-
-				CUtlBuffer bufParse( pBuf, nLen, CUtlBuffer::TEXT_BUFFER | CUtlBuffer::READ_ONLY );
-
-				while ( bufParse.IsValid() )
+				const char *pVertex = SkipSpace( pToken + 1, pLineEnd );
+				while ( ParseVertex( pVertex, pLineEnd, v, t, n ) )
 				{
-					if ( !ParseVertex( bufParse, breakSet, v, t, n ) )
-						break;
-
 					pFaceIndices->AddToTail( vertexData.VertexCount() );
 					if ( v > 0 )
 					{
@@ -638,31 +1100,21 @@ CDmElement *CDmObjSerializer::ReadOBJ( CUtlBuffer &buf,
 				}
 
 				pFaceIndices->AddToTail( -1 );
-				continue;
 			}
+			break;
 		}
 	}
 
-	CDmeVertexDataBase *pVertexData( NULL );
+	buf.SeekGet( CUtlBuffer::SEEK_CURRENT, buf.GetBytesRemaining() );
 
-	if ( pBaseMesh )
-	{
-		pVertexData = vertexData.AddToMesh( pBaseMesh, bAbsolute, pName, true );
-	}
-	else
-	{
-		pVertexData = vertexData.AddToMesh( pDmeMesh, bAbsolute, "bind", false );
-		faceSetData.AddToMesh( pDmeMesh );
-	}
+	vertexData.AddToMesh( pDmeMesh, bAbsolute, "bind", false );
+	faceSetData.AddToMesh( pDmeMesh );
 
 	if ( pModel )
 	{
 		pModel->CaptureJointsToBaseState( "bind" );
 	}
 
-	if ( pBaseMesh )
-		return pVertexData;
-
 	return pRoot;
 }
 
@@ -1209,35 +1661,31 @@ const char *CDmObjSerializer::FindMtlEntry( const char *pTgaName )
 //-----------------------------------------------------------------------------
 //
 //-----------------------------------------------------------------------------
-bool CDmObjSerializer::ParseVertex( CUtlBuffer& bufParse, characterset_t &breakSet, int &v, int &t, int &n )
+bool CDmObjSerializer::ParseVertex( const char *&pBuf, const char *pEnd, int &v, int &t, int &n )
 {
-	char	cmd[1024];
-	int nLen = bufParse.ParseToken( &breakSet, cmd, sizeof(cmd), false );
-	if ( nLen <= 0 )
+	const char *pToken;
+	if ( !ParseObjFaceToken( pBuf, pEnd, pToken ) )
 		return false;
 
-	v = atoi( cmd );
+	v = ParseObjInt( pToken, pEnd );
 	n = 0;
 	t = 0;
 
-	char c = *(char*)bufParse.PeekGet();
-	bool bHasTexCoord = IN_CHARACTERSET( breakSet, c ) != 0;
+	bool bHasTexCoord = IsObjFaceBreak( pBuf, pEnd );
 	bool bHasNormal = false;
 	if ( bHasTexCoord )
 	{
 		// Snag the '/'
-		nLen = bufParse.ParseToken( &breakSet, cmd, sizeof(cmd), false );
-		Assert( nLen == 1 );
+		++pBuf;
 
-		c = *(char*)bufParse.PeekGet();
-		if ( !IN_CHARACTERSET( breakSet, c ) )
+		if ( !IsObjFaceBreak( pBuf, pEnd ) )
 		{
-			nLen = bufParse.ParseToken( &breakSet, cmd, sizeof(cmd), false );
-			Assert( nLen > 0 );
-			t = atoi( cmd );
+			if ( ParseObjFaceToken( pBuf, pEnd, pToken ) )
+			{
+				t = ParseObjInt( pToken, pEnd );
+			}
 
-			c = *(char*)bufParse.PeekGet();
-			bHasNormal = IN_CHARACTERSET( breakSet, c ) != 0;
+			bHasNormal = IsObjFaceBreak( pBuf, pEnd );
 		}
 		else
 		{
@@ -1248,12 +1696,12 @@ bool CDmObjSerializer::ParseVertex( CUtlBuffer& bufParse, characterset_t &breakS
 		if ( bHasNormal )
 		{
 			// Snag the '/'
-			nLen = bufParse.ParseToken( &breakSet, cmd, sizeof(cmd), false );
-			Assert( nLen == 1 );
+			++pBuf;
 
-			nLen = bufParse.ParseToken( &breakSet, cmd, sizeof(cmd), false );
-			Assert( nLen > 0 );
-			n = atoi( cmd );
+			if ( ParseObjFaceToken( pBuf, pEnd, pToken ) )
+			{
+				n = ParseObjInt( pToken, pEnd );
+			}
 		}
 	}
 	return true;
@@ -1264,9 +1712,9 @@ bool CDmObjSerializer::ParseVertex( CUtlBuffer& bufParse, characterset_t &breakS
 //
 //-----------------------------------------------------------------------------
 const char *CDmObjSerializer::SkipSpace(
-	const char *pBuf )
+	const char *pBuf, const char *pEnd )
 {
-	while ( *pBuf == ' ' || *pBuf == '\t' )
+	while ( pBuf < pEnd && ( *pBuf == ' ' || *pBuf == '\t' ) )
 		++pBuf;
 
 	return pBuf;
@@ -1277,6 +1725,15 @@ const char *CDmObjSerializer::SkipSpace(
 //
 //-----------------------------------------------------------------------------
 CDmeVertexDeltaData *CDmObjSerializer::GetDelta( const char *pDeltaName, bool bAbsolute )
+{
+	return GetDelta( pDeltaName, bAbsolute, NULL );
+}
+
+
+//-----------------------------------------------------------------------------
+// If pJob is specified, its file has already been read & parsed
+//-----------------------------------------------------------------------------
+CDmeVertexDeltaData *CDmObjSerializer::GetDelta( const char *pDeltaName, bool bAbsolute, DeltaLoadJob_t *pJob )
 {
 	if ( !m_deltas.Defined( pDeltaName ) )
 		return NULL;
@@ -1289,6 +1746,21 @@ CDmeVertexDeltaData *CDmObjSerializer::GetDelta( const char *pDeltaName, bool bA
 	if ( !LoadDependentDeltas( pDeltaName ) )
 		return NULL;
 
+	if ( pJob )
+	{
+		if ( !pJob->m_bLoaded )
+			return NULL;
+
+		if ( deltaInfo.m_pComboOp && !strchr( pDeltaName, '_' ) )
+		{
+			deltaInfo.m_pComboOp->FindOrCreateControl( pDeltaName, false, true );
+		}
+
+		deltaInfo.m_pDeltaData = CastElement< CDmeVertexDeltaData >( pJob->m_pVertexData->AddToMesh( deltaInfo.m_pMesh, bAbsolute, pDeltaName, true ) );
+
+		return deltaInfo.m_pDeltaData;
+	}
+
 	CUtlBuffer utlBuf;
 
 	char deltaPath[ MAX_PATH ];
@@ -68,9 +68,9 @@ private:
 
 	const char *FindMtlEntry( const char *pTgaName );
 
-	static bool ParseVertex( CUtlBuffer& bufParse, characterset_t &breakSet, int &v, int &t, int &n );
+	static bool ParseVertex( const char *&pBuf, const char *pEnd, int &v, int &t, int &n );
 
-	static const char *SkipSpace( const char *pBuf );
+	static const char *SkipSpace( const char *pBuf, const char *pEnd );
 
 	void DagToObj( CUtlBuffer &b, const matrix3x4_t &parentWorldMatrix, CDmeDag *pDag, const char *pDeltaName = NULL, bool absolute = true );
 
@@ -78,6 +78,14 @@ private:
 
 	bool LoadDependentDeltas( const char *pDeltaName );
 
+	struct DeltaLoadJob_t;
+
+	static void ReadDeltaOBJ( DeltaLoadJob_t &job );
+
+	void LoadDeltas( CUtlVector< DeltaLoadJob_t > &jobs, bool bAbsolute );
+
+	CDmeVertexDeltaData *GetDelta( const char *pDeltaName, bool bAbsolute, DeltaLoadJob_t *pJob );
+
 	struct MtlInfo_t
 	{
 		CUtlString m_MtlName;